@@ -17,8 +17,32 @@
 #include <stack>
 #include "Command.hpp"
 #include <memory>
+#include <vector>
 // Project header files
-// #include ...
+#include "Document.hpp"
+#include "ImageExport.hpp"
+#include "ImageImport.hpp"
+#include "Journal.hpp"
+#include "Latency.hpp"
+#include "LayerStack.hpp"
+#include "Memory.hpp"
+#include "Network.hpp"
+#include "SelectionMask.hpp"
+#include "TaskPool.hpp"
+#include "TextureStreamer.hpp"
+
+// Tools the mouse can be used with on the canvas.
+enum Tool{
+	TOOL_BRUSH,
+	TOOL_SELECT_RECT,
+	TOOL_SELECT_ELLIPSE,
+	TOOL_SELECT_LASSO,
+	TOOL_COUNT
+};
+
+// Commands waiting or kept for undo, in pooled nodes so painting does not
+// go to the heap as commands come and go.
+typedef std::deque<std::shared_ptr<Command>, PoolAllocator<std::shared_ptr<Command>>> CommandQueue;
 
 // Singleton for our Application called 'App'.
 class App{
@@ -30,22 +54,63 @@ private:
 	int windowHeight;
     sf::RenderWindow* m_window;
 	// Deque stores the next command to do.
-	std::deque<std::shared_ptr<Command>> m_commands;
+	CommandQueue m_commands;
 	// Deque that stores the last action to occur.
-	std::deque<std::shared_ptr<Command>> m_undo;
+	CommandQueue m_undo;
 	// Stack that stores operations that can be redone
-    std::stack<std::shared_ptr<Command>> m_redo;
-	// Main image
-	sf::Image* m_image;
+    std::stack<std::shared_ptr<Command>, CommandQueue> m_redo;
+	// Layers of the canvas and the project file they are saved in
+	Document* m_document;
+	// Tiles recomposited since the last texture upload
+	std::vector<unsigned> m_updatedTiles;
+	// Region that tools and filters are limited to
+	SelectionMask* m_selection;
+	// Copy of m_selection shared by the commands made since it last changed
+	std::shared_ptr<const SelectionMask> m_selectionSnapshot;
+	// Outline of the selection drawn over the canvas
+	sf::RectangleShape* m_selectionOutline;
+	// Marks where the other users point, drawn over the canvas
+	sf::CircleShape* m_cursorShape;
+	// Tool used when the mouse is pressed on the canvas
+	Tool m_tool;
+	// Worker threads for filters, compositing, saves and loads
+	TaskPool* m_tasks;
+	// Allocation of the canvas, running while the windows are created
+	TaskGroup* m_canvasTask;
+	// Writes the canvas to disk in the background
+	ImageExporter* m_exporter;
+	// Loads images into new layers in the background
+	ImageImporter* m_importer;
+	// Records everything done to the canvas for crash recovery
+	Journal* m_journal;
+	std::string m_journalPath;
+	// Keep the journal on exit as a recording of the session
+	bool m_keepJournal;
+	// No window or texture, the canvas is only composited in memory
+	bool m_headless;
+	// Shares the canvas with the other users of a server
+	NetworkClient* m_network;
 	// Create a sprite that we overaly
 	// on top of the texture.
 	sf::Sprite* m_sprite;
 	// Texture sent to the GPU for rendering
 	sf::Texture* m_texture;
+	// Sends the tiles that changed to m_texture
+	TextureStreamer* m_streamer;
 	// amount of undos allowed
     int m_numUndos;
 	// hold the last command that was added to m_commands
 	std::shared_ptr<Command> m_lastcommand;
+	// Memory of the current frame, given back at the end of Loop()
+	FrameArena* m_frameArena;
+	// Heap allocations of the main thread when the last frame ended, and
+	// how many the frame before made
+	std::uint64_t m_frameAllocationsStart;
+	std::uint64_t m_frameAllocations;
+	// Time from input to the frame that shows it
+	LatencyTracker* m_latency;
+	// When the input being handled was polled, given to the commands it adds
+	InputClock::time_point m_inputTime;
 
     // Member functions
 	// Store the address of our funcion pointer
@@ -54,6 +119,8 @@ private:
 	void (*m_updateFunc)(App *&&app);
 	void (*m_drawFunc)(App *&&app);
 	bool commandExists(std::shared_ptr<Command> command);
+	void ResetCanvas();
+	void NoteInput(InputClock::time_point input);
 	App(const App&);
 
 public:
@@ -65,20 +132,48 @@ public:
     void SetBackgroundColor(sf::Color color);
     void 	AddCommand(std::shared_ptr<Command> c);
 	void 	ExecuteCommand();
-	sf::Image& GetImage();
+	void 	RunCommand(std::shared_ptr<Command> c);
+	void 	ApplyRemoteCommand(std::shared_ptr<Command> c, unsigned user);
+	void SetLayerSettings(unsigned id, sf::Uint8 opacity, bool visible, BlendMode mode);
+	void SetActiveLayer(unsigned id);
+	LayerStack& GetLayers();
+	SelectionMask& GetSelection();
+	std::shared_ptr<const SelectionMask> GetSelectionSnapshot();
+	Tool GetTool();
+	void SetTool(Tool tool);
+	bool Export(const std::string &path, ExportFormat format);
+	ImageExporter& GetExporter();
+	void Import(const std::string &path);
+	ImageImporter& GetImporter();
+	bool SaveProject(const std::string &path);
+	bool OpenProject(const std::string &path);
+	Document& GetDocument();
+	NetworkClient& GetNetwork();
+	TaskPool& GetTasks();
+	FrameArena& GetFrameArena();
+	std::uint64_t GetFrameAllocations() const;
+	void SetInputTime(InputClock::time_point time);
+	LatencyTracker& GetLatency();
 	sf::Texture& GetTexture();
+	TextureStreamer& GetTextureStreamer();
+	void UpdateTexture();
 	sf::RenderWindow& GetWindow();
 	void Undo();
+	bool Revert(const std::shared_ptr<Command> &command);
 	void Redo();
 	const std::shared_ptr<Command> GetLastCommand();
 	int GetWindowWidth();
 	int GetWindowHeight();
 
 	void Destroy();
+	void AllocateCanvas();
 	void Init(void (*initFunction)(void));
+	void InitHeadless(int width, int height, unsigned threads = TaskPool::AUTO_THREADS);
+	void RecordSession(const std::string &path);
 	void UpdateCallback(void (*updateFunction)(App *&&app));
 	void DrawCallback(void (*drawFunction)(App *&&app));
 	void Loop();
+	void EndFrame();
 	void AddUndo(std::shared_ptr<Command> c);
 
 
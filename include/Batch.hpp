@@ -0,0 +1,84 @@
+/**
+ *  @file   Batch.hpp
+ *  @brief  Runs a chain of filters over many image files from the command line.
+ *  @author Team Avengers
+ *  @date   2020-12-10
+ ***********************************************/
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+// Project header files
+#include "Filter.hpp"
+#include "ImageExport.hpp"
+#include "TiledImage.hpp"
+
+// What a batch run does.
+struct BatchOptions{
+    // Filters applied to every image, in order
+    std::vector<FilterType> filters;
+    std::vector<std::string> inputs;
+    // Directory the results are written to, named after the inputs
+    std::string outputDir;
+    ExportFormat format;
+    unsigned threads;
+    // Most images decoded but not yet written at any time
+    unsigned inFlight;
+};
+
+// Decodes, filters and encodes images on a pool of worker threads.
+//
+// Every image goes through three steps: decode, the filter chain and
+// encode. A free worker takes the step furthest along first, so images
+// finish before new ones are started, and a new file is only decoded
+// while fewer than inFlight images are in memory. Different images are
+// in different steps at the same time, which keeps the disk and every
+// core busy, and memory stays bounded however many files there are.
+//
+// Filters run through FilterCommand::FilterSelection(), the same code as
+// the filter buttons, with a selection covering the whole image.
+//
+// Results are named after their input. When inputs from different
+// directories have the same name, the later ones get -2, -3... appended,
+// so no two workers ever write the same file.
+class BatchProcessor{
+public:
+    explicit BatchProcessor(const BatchOptions &options);
+
+    unsigned Run();
+    const std::string& GetOutputPath(std::size_t input) const;
+
+    static int Main(int argc, char** argv);
+
+private:
+    // An image between two steps
+    typedef std::pair<std::size_t, TiledImage> Item;
+
+    BatchOptions m_options;
+    // File every input is written to, by index
+    std::vector<std::string> m_outputs;
+    // Everything below is guarded by m_mutex
+    std::mutex  m_mutex;
+    std::condition_variable m_wake;
+    std::deque<Item> m_decoded;
+    std::deque<Item> m_filtered;
+    std::size_t m_next;
+    unsigned    m_active;
+    unsigned    m_failed;
+
+    void Work();
+    void Finish(bool ok);
+    BatchProcessor(const BatchProcessor&);
+};
+
+
+#endif
@@ -0,0 +1,49 @@
+/**
+ *  @file   Blend.hpp
+ *  @brief  Blend modes used to composite layers.
+ *  @author Team Avengers
+ *  @date   2020-12-02
+ ***********************************************/
+#ifndef BLEND_HPP
+#define BLEND_HPP
+
+// Include our Third-Party SFML header
+#include <SFML/Config.hpp>
+// Include standard library C++ libraries.
+#include <cstddef>
+// Project header files
+// #include ...
+
+// Blend modes a layer can be composited with.
+enum BlendMode{
+    BLEND_NORMAL,
+    BLEND_MULTIPLY,
+    BLEND_SCREEN,
+    BLEND_OVERLAY,
+    BLEND_ADD,
+    BLEND_DARKEN,
+    BLEND_LIGHTEN,
+    BLEND_MODE_COUNT
+};
+
+// Instruction sets a row kernel can be written for.
+enum BlendIsa{
+    BLEND_ISA_SCALAR,
+    BLEND_ISA_SSE2,
+    BLEND_ISA_AVX2,
+    BLEND_ISA_COUNT
+};
+
+// A row kernel blends 'pixels' premultiplied RGBA8 pixels of 'src' onto 'dst'.
+// 'opacity' from 0 to 255 scales the source before blending.
+// Every kernel of a mode gives bit-identical results to the scalar one.
+typedef void (*BlendRowFunc)(sf::Uint8* dst, const sf::Uint8* src, std::size_t pixels, unsigned opacity);
+
+const char*  GetBlendModeName(BlendMode mode);
+const char*  GetBlendIsaName(BlendIsa isa);
+BlendIsa     GetBestBlendIsa();
+BlendRowFunc GetBlendRow(BlendMode mode);
+BlendRowFunc GetBlendRow(BlendMode mode, BlendIsa isa);
+
+
+#endif
@@ -0,0 +1,120 @@
+/**
+ *  @file   BlendSimd.hpp
+ *  @brief  Blend kernels shared by every SIMD instruction set.
+ *  @author Team Avengers
+ *  @date   2020-12-02
+ ***********************************************/
+#ifndef BLEND_SIMD_HPP
+#define BLEND_SIMD_HPP
+
+// Include our Third-Party SFML header
+#include <SFML/Config.hpp>
+// Include standard library C++ libraries.
+#include <cstddef>
+// Project header files
+#include "Blend.hpp"
+
+// Only included by the translation units that implement an instruction set.
+// Each of them defines a traits struct V with the operations below and
+// instantiates BlendRowSimd for every mode. The math works on 16 bit lanes
+// holding 8 bit values and matches the scalar kernels in Blend.cpp exactly:
+//
+//   typedef ... Bytes;                         // register of RGBA8 pixels
+//   typedef ... Wide;                          // register of 16 bit lanes
+//   static const std::size_t PIXELS;           // pixels per Bytes register
+//   Bytes Load(const sf::Uint8*); void Store(sf::Uint8*, Bytes);
+//   Wide  Lo(Bytes); Wide Hi(Bytes); Bytes Pack(Wide, Wide);
+//   Wide  Set1(int); Add; Sub; MulLo; Shr8; Min; Max; Select(mask, a, b);
+//   Wide  LessEq(a, b); Alpha(Wide);
+
+// Scalar kernels, used for the pixels left over at the end of a row.
+extern const BlendRowFunc g_blendRowsScalar[BLEND_MODE_COUNT];
+
+namespace blend_simd {
+
+// a * b / 255 with rounding, for a and b in [0, 255]
+template <class V>
+inline typename V::Wide Mul255(typename V::Wide a, typename V::Wide b){
+    typename V::Wide t = V::Add(V::MulLo(a, b), V::Set1(128));
+    return V::Shr8(V::Add(t, V::Shr8(t)));
+}
+
+// Terms shared by the separable modes: s * (1 - da) + d * (1 - sa)
+template <class V>
+inline typename V::Wide Outside(typename V::Wide s, typename V::Wide d,
+                                typename V::Wide sa, typename V::Wide da){
+    typename V::Wide full = V::Set1(255);
+    return V::Add(Mul255<V>(s, V::Sub(full, da)), Mul255<V>(d, V::Sub(full, sa)));
+}
+
+template <class V>
+inline typename V::Wide Apply(BlendMode mode, typename V::Wide s, typename V::Wide d){
+    typedef typename V::Wide W;
+    W sa = V::Alpha(s);
+    W da = V::Alpha(d);
+    switch (mode){
+        case BLEND_MULTIPLY:
+            return V::Add(Outside<V>(s, d, sa, da), Mul255<V>(s, d));
+        case BLEND_SCREEN:
+            return V::Sub(V::Add(s, d), Mul255<V>(s, d));
+        case BLEND_OVERLAY:
+        {
+            W zero = V::Set1(0);
+            W low = V::Add(Mul255<V>(s, d), Mul255<V>(s, d));
+            W t = Mul255<V>(V::Max(V::Sub(da, d), zero), V::Max(V::Sub(sa, s), zero));
+            W high = V::Max(V::Sub(Mul255<V>(sa, da), V::Add(t, t)), zero);
+            W mask = V::LessEq(V::Add(d, d), da);
+            return V::Add(Outside<V>(s, d, sa, da), V::Select(mask, low, high));
+        }
+        case BLEND_ADD:
+            return V::Add(s, d);
+        case BLEND_DARKEN:
+            return V::Add(Outside<V>(s, d, sa, da), V::Min(Mul255<V>(s, da), Mul255<V>(d, sa)));
+        case BLEND_LIGHTEN:
+            return V::Add(Outside<V>(s, d, sa, da), V::Max(Mul255<V>(s, da), Mul255<V>(d, sa)));
+        case BLEND_NORMAL:
+        default:
+            return V::Add(s, Mul255<V>(d, V::Sub(V::Set1(255), sa)));
+    }
+}
+
+// Row kernel for one mode. The mode is a template argument so the switch
+// in Apply is resolved at compile time.
+template <class V, BlendMode MODE>
+void BlendRowSimd(sf::Uint8* dst, const sf::Uint8* src, std::size_t pixels, unsigned opacity){
+    typedef typename V::Wide W;
+    W o = V::Set1(static_cast<int>(opacity));
+    W full = V::Set1(255);
+    std::size_t i = 0;
+    for (; i + V::PIXELS <= pixels; i += V::PIXELS){
+        typename V::Bytes s = V::Load(src + i * 4);
+        typename V::Bytes d = V::Load(dst + i * 4);
+        W slo = V::Lo(s);
+        W shi = V::Hi(s);
+        if (opacity != 255){
+            slo = Mul255<V>(slo, o);
+            shi = Mul255<V>(shi, o);
+        }
+        W rlo = V::Min(Apply<V>(MODE, slo, V::Lo(d)), full);
+        W rhi = V::Min(Apply<V>(MODE, shi, V::Hi(d)), full);
+        V::Store(dst + i * 4, V::Pack(rlo, rhi));
+    }
+    if (i < pixels){
+        g_blendRowsScalar[MODE](dst + i * 4, src + i * 4, pixels - i, opacity);
+    }
+}
+
+}
+
+// Build the table of row kernels of one instruction set.
+#define BLEND_SIMD_TABLE(V) { \
+    &blend_simd::BlendRowSimd<V, BLEND_NORMAL>, \
+    &blend_simd::BlendRowSimd<V, BLEND_MULTIPLY>, \
+    &blend_simd::BlendRowSimd<V, BLEND_SCREEN>, \
+    &blend_simd::BlendRowSimd<V, BLEND_OVERLAY>, \
+    &blend_simd::BlendRowSimd<V, BLEND_ADD>, \
+    &blend_simd::BlendRowSimd<V, BLEND_DARKEN>, \
+    &blend_simd::BlendRowSimd<V, BLEND_LIGHTEN> }
+
+
+#endif
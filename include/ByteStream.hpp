@@ -0,0 +1,66 @@
+/**
+ *  @file   ByteStream.hpp
+ *  @brief  Compact binary encoding of commands and records.
+ *  @author Team Avengers
+ *  @date   2020-12-08
+ ***********************************************/
+#ifndef BYTE_STREAM_HPP
+#define BYTE_STREAM_HPP
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+// Project header files
+// #include ...
+
+// Appends values to a growing byte buffer. Unsigned numbers are stored
+// as varints, 7 bits per byte, so small ids and counts take one byte.
+// Signed numbers are zigzag encoded first so small negative values stay
+// small too.
+class ByteWriter{
+public:
+    void PutU8(std::uint8_t value);
+    void PutVarint(std::uint64_t value);
+    void PutSigned(std::int64_t value);
+    void PutBytes(const void* data, std::size_t size);
+    void PutString(const std::string &value);
+
+    const std::uint8_t* GetData() const;
+    std::size_t GetSize() const;
+    void Clear();
+
+private:
+    std::vector<std::uint8_t> m_bytes;
+};
+
+// Reads values written by ByteWriter. Reading past the end, or a varint
+// that is too long, puts the reader in a failed state and every value
+// read after that is 0.
+class ByteReader{
+public:
+    ByteReader(const void* data, std::size_t size);
+
+    std::uint8_t GetU8();
+    std::uint64_t GetVarint();
+    std::int64_t GetSigned();
+    const std::uint8_t* GetBytes(std::size_t size);
+    std::string GetString();
+
+    bool Ok() const;
+    bool AtEnd() const;
+    std::size_t GetRemaining() const;
+
+private:
+    const std::uint8_t* m_data;
+    std::size_t m_left;
+    bool m_ok;
+
+    void Fail();
+};
+
+
+#endif
@@ -14,24 +14,47 @@
 // Project header files
 #include "Command.hpp"
 #include "App.hpp"
+#include "SelectionMask.hpp"
+#include "TiledImage.hpp"
 #include <memory>
+#include <utility>
+#include <vector>
 
 // Anytime we want to implement a new command in our paint tool,
 // we have to inherit from the command class.
 // This forces us to implement an 'execute' and 'undo' command.
 class ClearCanvas : public Command{
 	public:
-        ClearCanvas(const std::string &m_commandDescription, const sf::Color &color,
+        ClearCanvas(const char* m_commandDescription, const sf::Color &color,
             const sf::Color &prev_color, App &app);
         ~ClearCanvas();
+        static std::shared_ptr<Command> Deserialize(ByteReader &in, App &app);
+        unsigned GetLayer() const;
     private:
         App& m_app;
         sf::Color m_color;
         sf::Color m_prev_color;
-        std::shared_ptr<sf::Image> m_prev_img;
+        // Layer that is cleared
+        unsigned m_layer;
+        // Selection at the time the command was created, shared with the
+        // other commands made with it
+        std::shared_ptr<const SelectionMask> m_selection;
+        // Copy-on-write snapshot of the layer before it was cleared,
+        // used when nothing is selected
+        TiledImage m_prev_img;
+        TiledImage m_after_img;
+        // Tiles replaced when only a selection was cleared, and what replaced them
+        std::vector<std::pair<unsigned, TilePtr>> m_prevTiles;
+        std::vector<TilePtr> m_afterTiles;
+        // Tiles the last revert() replaced
+        std::vector<std::pair<unsigned, TilePtr>> m_revertTiles;
         bool execute();
         bool undo();
+        bool revert();
+        bool unrevert();
         bool compare(const std::shared_ptr<Command> &rhs);
+        CommandType GetType() const;
+        void Serialize(ByteWriter &out) const;
 
 };
 
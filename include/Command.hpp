@@ -11,19 +11,44 @@
 // Include our Third-Party SFML header
 // #include ...
 // Include standard library C++ libraries.
+#include <cstdint>
 #include <string>
 #include <memory>
 // Project header files
-// #include ...
+#include "ByteStream.hpp"
+#include "Latency.hpp"
+
+class App;
+
+// Kinds of commands, written in front of every serialized command so the
+// journal knows which class to read it back into.
+enum CommandType{
+	COMMAND_DRAW,
+	COMMAND_CLEAR,
+	COMMAND_LAYER,
+	COMMAND_FILTER,
+	COMMAND_REVERT,
+	COMMAND_IMPORT,
+	COMMAND_TYPE_COUNT
+};
+
+const char* GetCommandTypeName(CommandType type);
 
 // The command class
 class Command{
 protected:
-	std::string m_commandDescription;
+	// Always a string literal, so creating a command never copies a string
+	const char* m_commandDescription;
+	// When the input that made the command was polled, to time it until
+	// it is shown. Not serialized.
+	InputClock::time_point m_inputTime;
+	// Number the journal gave the record of the command, 0 if it was not
+	// journaled. Not serialized.
+	std::uint64_t m_record;
 public:
     /*! \brief Command constructor that initializes command description.
     */
-	Command(const std::string &commandDescription);
+	Command(const char* commandDescription);
 	// Destructor for a command
 	/*! \brief Virtual Command destructor.
 	*/
@@ -41,11 +66,36 @@ public:
 	/*! \brief Purely virtual function for undoing command.
 	*/
 	virtual bool undo() = 0;
+	/*! \brief Undo only the pixels that are still what this command left,
+	*	so what other users drew over them stays. Used to undo on a
+	*	shared canvas. By default the same as undo().
+	*/
+	virtual bool revert();
+	/*! \brief Put back what the last revert() changed. By default the
+	*	same as execute().
+	*/
+	virtual bool unrevert();
 	/*! \brief Purely virtual function for comparing two commands.
 	*/
 	virtual bool compare(const std::shared_ptr<Command> &c_rhs) = 0;
+	/*! \brief Purely virtual function for getting the kind of command.
+	*/
+	virtual CommandType GetType() const = 0;
+	/*! \brief Purely virtual function for writing everything needed to
+	*	create the command again, without the state it saved for undo.
+	*/
+	virtual void Serialize(ByteWriter &out) const = 0;
+	void SetInputTime(InputClock::time_point time);
+	InputClock::time_point GetInputTime() const;
+	void SetRecord(std::uint64_t record);
+	std::uint64_t GetRecord() const;
 };
 
+// Write a command with its type in front, as the journal and the network send it.
+void WriteCommand(const Command &command, ByteWriter &out);
+// Read a command written by WriteCommand(). Returns nullptr if the data is damaged.
+std::shared_ptr<Command> ReadCommand(ByteReader &in, App &app);
+
 
 
 #endif
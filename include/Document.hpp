@@ -0,0 +1,76 @@
+/**
+ *  @file   Document.hpp
+ *  @brief  Canvas document and its native tiled project file.
+ *  @author Team Avengers
+ *  @date   2020-12-07
+ ***********************************************/
+#ifndef DOCUMENT_HPP
+#define DOCUMENT_HPP
+
+// Include our Third-Party SFML header
+#include <SFML/Graphics/Color.hpp>
+// Include standard library C++ libraries.
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+// Project header files
+#include "LayerStack.hpp"
+#include "TiledImage.hpp"
+
+// A document owns the layers of the canvas and knows the project file
+// they were last saved to.
+//
+// The project file is append only. It starts with a small header that
+// points at the newest index. Every save appends the tiles that changed
+// followed by a new index, which lists the layers and the file offset of
+// each of their tiles, and then moves the header over. An index also
+// points at the one before it, so older saves stay readable as revisions
+// and a crash in the middle of a save leaves the last one intact.
+//
+// Open() maps the file into memory and the layer tiles point straight
+// into the mapping, so nothing but the index is read up front. Pages are
+// faulted in when a tile is first drawn. Tiles are copy-on-write, so
+// editing one copies it out of the mapping first. A save to a new file is
+// written aside and renamed over the target, so a file still mapped is
+// replaced without ever being cut short.
+//
+// A save only writes tiles whose pointer is not in the file yet. Tiles
+// untouched since the last save or open keep their offsets, and a tile
+// shared by many slots, like a filled layer, is written once.
+class Document{
+public:
+    Document(unsigned width, unsigned height, const sf::Color &background);
+    ~Document();
+
+    LayerStack& GetLayers();
+    const std::string& GetPath() const;
+    unsigned GetRevisionCount() const;
+    const std::string& GetStatus() const;
+
+    bool Save(const std::string &path);
+    bool Open(const std::string &path, unsigned revision = 0);
+
+private:
+    // A read only file mapping, unmapped when the last tile using it is gone
+    struct Mapping;
+    // Tiles in the project file by address, with the reference that keeps
+    // the address from being reused for other pixels
+    typedef std::unordered_map<const sf::Uint8*, std::pair<TilePtr, std::uint64_t>> TileOffsets;
+
+    LayerStack* m_layers;
+    std::string m_path;
+    std::shared_ptr<Mapping> m_mapping;
+    TileOffsets m_saved;
+    // Offset of the newest index and end of the data in the project file
+    std::uint64_t m_index;
+    std::uint64_t m_fileSize;
+    unsigned    m_revisions;
+    std::string m_status;
+
+    Document(const Document&);
+};
+
+
+#endif
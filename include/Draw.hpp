@@ -21,17 +21,36 @@
 // This forces us to implement an 'execute' and 'undo' command.
 class Draw : public Command{
 	public:
-        Draw(const std::string &m_commandDescription, sf::Vector2i coord, const sf::Color &color,
-            const sf::Color &background, App &app);
+        Draw(const char* m_commandDescription, sf::Vector2i coord, const sf::Color &color,
+            App &app);
         ~Draw();
+        static std::shared_ptr<Command> Deserialize(ByteReader &in, App &app);
+        static std::shared_ptr<Command> Create(sf::Vector2i coord, const sf::Color &color, unsigned layer,
+            sf::Uint8 coverage, App &app);
+        sf::Vector2i GetCoords() const;
+        sf::Color GetColor() const;
+        unsigned GetLayer() const;
+        sf::Uint8 GetCoverage() const;
     private:
         App& m_app;
         sf::Vector2i m_coords;
         sf::Color m_color;
-        sf::Color m_background;
+        // Layer the pixel is drawn on
+        unsigned m_layer;
+        // Premultiplied color of the pixel before and after it was drawn
+        sf::Color m_prev;
+        sf::Color m_after;
+        // Set if the last revert() put back m_prev
+        bool m_reverted;
+        // How much of the pixel is selected
+        sf::Uint8 m_coverage;
         bool execute();
         bool undo();
+        bool revert();
+        bool unrevert();
         bool compare(const std::shared_ptr<Command> &rhs);
+        CommandType GetType() const;
+        void Serialize(ByteWriter &out) const;
         bool InBounds();
 
 };
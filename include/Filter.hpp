@@ -0,0 +1,35 @@
+/**
+ *  @file   Filter.hpp
+ *  @brief  Image filter kernels working one tile at a time.
+ *  @author Team Avengers
+ *  @date   2020-12-04
+ ***********************************************/
+#ifndef FILTER_HPP
+#define FILTER_HPP
+
+// Include our Third-Party SFML header
+#include <SFML/Config.hpp>
+// Include standard library C++ libraries.
+#include <string>
+// Project header files
+#include "TiledImage.hpp"
+
+// Filters offered in the toolbar, in the order of the buttons.
+enum FilterType{
+    FILTER_SEPIA,
+    FILTER_GRAYSCALE,
+    FILTER_SHARPEN,
+    FILTER_BLUR,
+    FILTER_COUNT
+};
+
+const char* GetFilterName(FilterType type);
+bool FindFilter(const std::string &name, FilterType &type);
+
+// Filter one tile of 'src' into 'out' (TILE_BYTES bytes).
+// Filters that look at neighbouring pixels read across the tile border
+// and repeat the edge pixels of the image. 'out' must not be a tile of 'src'.
+void FilterTile(FilterType type, const TiledImage &src, unsigned tile, sf::Uint8* out);
+
+
+#endif
@@ -0,0 +1,58 @@
+/**
+ *  @file   FilterCommand.hpp
+ *  @brief  Apply a filter to the selected part of the active layer.
+ *  @author Team Avengers
+ *  @date   2020-12-04
+ ***********************************************/
+#ifndef FILTER_COMMAND_HPP
+#define FILTER_COMMAND_HPP
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <string>
+#include <memory>
+#include <utility>
+#include <vector>
+// Project header files
+#include "Command.hpp"
+#include "App.hpp"
+#include "Filter.hpp"
+#include "SelectionMask.hpp"
+
+// Filters only the tiles of the selection, so the cost of a filter follows
+// the size of the selection. Runs of tiles are filtered on the task pool of
+// the app. Undo puts back the tiles that were replaced.
+class FilterCommand : public Command{
+	public:
+        FilterCommand(const char* m_commandDescription, FilterType type, App &app);
+        ~FilterCommand();
+        static std::shared_ptr<Command> Deserialize(ByteReader &in, App &app);
+        static void FilterSelection(FilterType type, const TiledImage &pixels, const SelectionMask &selection,
+                                    std::vector<std::pair<unsigned, TilePtr>> &filtered, TaskPool* tasks = nullptr);
+        unsigned GetLayer() const;
+    private:
+        App& m_app;
+        FilterType m_type;
+        // Layer that is filtered
+        unsigned m_layer;
+        // Selection at the time the command was created, shared with the
+        // other commands made with it
+        std::shared_ptr<const SelectionMask> m_selection;
+        // Tiles of the layer before the filter ran, and the filtered ones
+        std::vector<std::pair<unsigned, TilePtr>> m_prevTiles;
+        std::vector<TilePtr> m_afterTiles;
+        // Tiles the last revert() replaced
+        std::vector<std::pair<unsigned, TilePtr>> m_revertTiles;
+        bool execute();
+        bool undo();
+        bool revert();
+        bool unrevert();
+        bool compare(const std::shared_ptr<Command> &rhs);
+        CommandType GetType() const;
+        void Serialize(ByteWriter &out) const;
+
+};
+
+
+#endif
@@ -0,0 +1,57 @@
+/**
+ *  @file   FontCache.hpp
+ *  @brief  Baked font atlas kept on disk between runs.
+ *  @author Team Avengers
+ *  @date   2020-12-17
+ ***********************************************/
+#ifndef FONT_CACHE_HPP
+#define FONT_CACHE_HPP
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <cstddef>
+#include <string>
+// Project header files
+// #include ...
+
+// Baking the font atlas of the GUI rasterizes every glyph on each start.
+// The result only depends on the font and its size, so it is written to a
+// cache file once and mapped into memory on the next start.
+//
+// A cache file holds the RGBA pixels of the atlas and a block of glyph
+// tables the GUI backend reads back. Both are in the byte order of the
+// machine that wrote them. The file starts with the key it was baked
+// for, and a file with another key, a wrong size or a bad checksum is
+// ignored and baked over.
+class FontCache{
+public:
+    FontCache();
+    ~FontCache();
+
+    bool Open(const std::string &path, const std::string &key);
+    void Close();
+    const void* GetPixels() const;
+    int GetWidth() const;
+    int GetHeight() const;
+    const void* GetTables() const;
+    std::size_t GetTablesSize() const;
+
+    static bool Write(const std::string &path, const std::string &key, const void* pixels, int width,
+                      int height, const void* tables, std::size_t tablesSize);
+    static std::string GetPath(const std::string &font, float size);
+
+private:
+    void* m_mapping;
+    std::size_t m_size;
+    const void* m_pixels;
+    int m_width;
+    int m_height;
+    const void* m_tables;
+    std::size_t m_tablesSize;
+
+    FontCache(const FontCache&);
+};
+
+
+#endif
@@ -18,24 +18,37 @@
 #include <SFML/Graphics/Sprite.hpp>
 #include <SFML/OpenGL.hpp>
 #include <SFML/Window.hpp>
+// Include standard library C++ libraries.
+#include <deque>
+#include <vector>
 
 #include "App.hpp"
 
+// The toolbar is drawn with OpenGL into its own window, or without a
+// window by a software renderer into a framebuffer in memory. The second
+// one is for tests and benchmarks, events are handed to it with
+// pushEvent() and show up on the next loop().
+
 
 class GUI {
     public:
         GUI(App* app);
+        GUI(App* app, unsigned width, unsigned height);
         ~GUI();
         // Function to render our GUI
         void                    drawLayout();
         sf::Color               GetInputColor();
         void                    UsePreset(int key_pressed);
         void                    Init();
+        void                    InitHeadless(unsigned width, unsigned height);
         void                    loop();
         struct nk_context*      getContext();
         sf::RenderWindow*       getWindow();
         void                    setPresetIndex(int i);
         int                     getPreset();
+        void                    pushEvent(const sf::Event& event);
+        const sf::Uint8*        getFramebuffer() const;
+        sf::Vector2u            getFramebufferSize() const;
 
     private:
         App*                app;
@@ -48,7 +61,17 @@ class GUI {
         struct nk_context*  ctx;
         sf::RenderWindow*   window;
         struct nk_colorf*   bg;
+        // Fixed memory Nuklear runs in
+        FixedArena*         memory;
+        // Without a window: the software renderer, the RGBA pixels it
+        // draws into and the events for the next loop()
+        struct rawfb_context* rawfb;
+        std::vector<sf::Uint8> framebuffer;
+        sf::Vector2u        framebuffer_size;
+        std::deque<sf::Event> events;
+        void                setDefaults(App* a);
         void                setPresetColors();
+        void                loadFont();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,64 @@
+/**
+ *  @file   ImageExport.hpp
+ *  @brief  Saves the canvas to PNG or TGA in the background.
+ *  @author Team Avengers
+ *  @date   2020-12-05
+ ***********************************************/
+#ifndef IMAGE_EXPORT_HPP
+#define IMAGE_EXPORT_HPP
+
+// Include our Third-Party SFML header
+#include <SFML/Config.hpp>
+// Include standard library C++ libraries.
+#include <atomic>
+#include <string>
+// Project header files
+#include "TaskPool.hpp"
+#include "TiledImage.hpp"
+
+// File formats the canvas can be saved as.
+enum ExportFormat{
+    EXPORT_PNG,     // zlib compressed, small but slower to write
+    EXPORT_TGA,     // uncompressed 32 bit, as fast as the disk
+    EXPORT_FORMAT_COUNT
+};
+
+const char* GetExportExtension(ExportFormat format);
+
+// Writes one image at a time as a background task of the pool.
+//
+// Start() only copies the tile pointers of the image, which is cheap even
+// for a huge canvas. Tiles are copy-on-write, so painting can go on while
+// the worker encodes: a tile that gets edited is copied first and the
+// worker keeps reading the old one.
+class ImageExporter{
+public:
+    explicit ImageExporter(TaskPool &tasks);
+    ~ImageExporter();
+
+    bool Start(const TiledImage &snapshot, const std::string &path, ExportFormat format);
+    void Wait();
+    bool IsBusy() const;
+    float GetProgress() const;
+    const std::string& GetStatus() const;
+
+    static bool Write(const TiledImage &image, const std::string &path, ExportFormat format,
+                      std::atomic<unsigned>* rowsDone = nullptr);
+
+private:
+    TaskPool& m_tasks;
+    TaskGroup m_task;
+    std::atomic<bool> m_busy;
+    // Rows written so far and rows in the image being written
+    std::atomic<unsigned> m_rowsDone;
+    unsigned m_rows;
+    // Result of the last export, shown in the GUI. The export writes it
+    // before it clears m_busy, so it is only read while nothing runs.
+    std::string m_status;
+
+    void Run(TiledImage snapshot, std::string path, ExportFormat format);
+    ImageExporter(const ImageExporter&);
+};
+
+
+#endif
@@ -0,0 +1,78 @@
+/**
+ *  @file   ImageImport.hpp
+ *  @brief  Loads images into layers in the background.
+ *  @author Team Avengers
+ *  @date   2020-12-06
+ ***********************************************/
+#ifndef IMAGE_IMPORT_HPP
+#define IMAGE_IMPORT_HPP
+
+// Include our Third-Party SFML header
+#include <SFML/Config.hpp>
+// Include standard library C++ libraries.
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+// Project header files
+#include "LayerStack.hpp"
+#include "TaskPool.hpp"
+#include "TiledImage.hpp"
+
+// Decodes PNG, JPEG, BMP and TGA files with stb_image, one background task
+// per file, so several files load in parallel. The decoded pixels go straight into
+// premultiplied canvas tiles, there is no full size sf::Image in between.
+//
+// Tiles are handed to the frame loop a row at a time. Poll() moves the
+// tiles that are ready into their layer, so the image shows up on the
+// canvas while the rest of it is still being converted.
+//
+// The time from Start() until the first tile reaches the canvas is
+// recorded for every file and reported in the status.
+class ImageImporter{
+public:
+    explicit ImageImporter(TaskPool &tasks);
+    ~ImageImporter();
+
+    void Start(const std::string &path, unsigned layerId, unsigned width, unsigned height);
+    void Poll(LayerStack &layers);
+    void Wait();
+    bool IsBusy() const;
+    const std::string& GetStatus() const;
+
+    static bool Read(const std::string &path, TiledImage &image);
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    // One file being loaded
+    struct Job{
+        Job(): task(TASK_BACKGROUND){}
+        std::string path;
+        unsigned    layer;
+        unsigned    width;
+        unsigned    height;
+        Clock::time_point start;
+        // Milliseconds until the first tile was placed, -1 until then
+        long long   firstPixel;
+        TaskGroup   task;
+        // Tiles converted by the worker and not yet placed in the layer
+        std::mutex  mutex;
+        std::vector<std::pair<unsigned, TilePtr>> ready;
+        std::atomic<bool> done;
+        bool        failed;
+    };
+
+    TaskPool& m_tasks;
+    std::vector<std::unique_ptr<Job>> m_jobs;
+    std::string m_status;
+
+    static void Decode(Job* job);
+    ImageImporter(const ImageImporter&);
+};
+
+
+#endif
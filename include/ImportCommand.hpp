@@ -0,0 +1,45 @@
+/**
+ *  @file   ImportCommand.hpp
+ *  @brief  Undoable opening of an image as a new layer.
+ *  @author Team Avengers
+ *  @date   2020-12-06
+ ***********************************************/
+#ifndef IMPORT_COMMAND_HPP
+#define IMPORT_COMMAND_HPP
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <string>
+#include <memory>
+// Project header files
+#include "Command.hpp"
+#include "App.hpp"
+#include "Layer.hpp"
+
+// Opens an image file in a new layer on top of the stack. The ImageImporter
+// decodes it in the background, so the command returns before the image is
+// loaded. Undo removes the layer and redo puts the very same layer back.
+// The file is only on this machine, so imports are never shared.
+class ImportCommand : public Command{
+	public:
+        ImportCommand(const char* m_commandDescription, const std::string &path, App &app);
+        ~ImportCommand();
+        static std::shared_ptr<Command> Deserialize(ByteReader &in, App &app);
+    private:
+        App& m_app;
+        std::string m_path;
+        // Layer the image is loaded into, created on the first execute
+        std::shared_ptr<Layer> m_layer;
+        // Active layer before the command executed
+        unsigned m_prevActive;
+        bool execute();
+        bool undo();
+        bool compare(const std::shared_ptr<Command> &rhs);
+        CommandType GetType() const;
+        void Serialize(ByteWriter &out) const;
+
+};
+
+
+#endif
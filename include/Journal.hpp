@@ -0,0 +1,115 @@
+/**
+ *  @file   Journal.hpp
+ *  @brief  Append-only journal of everything done to the canvas.
+ *  @author Team Avengers
+ *  @date   2020-12-08
+ ***********************************************/
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+// Include our Third-Party SFML header
+#include <SFML/Config.hpp>
+// Include standard library C++ libraries.
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+// Project header files
+#include "Blend.hpp"
+#include "ByteStream.hpp"
+#include "Command.hpp"
+
+class App;
+
+// Records every executed command, undo and redo, and the layer settings
+// changed from the GUI, so the canvas can be rebuilt after a crash.
+// Commands of the other users on a shared canvas have records of their
+// own, they are replayed without going on the undo stack, so the undo
+// records that follow take back the same commands as they did.
+//
+// On a shared canvas an undo only takes back the pixels nobody drew over.
+// Those undos, ours and the ones of the others, are journaled as reverts
+// that name the record of the command they take back, counted from the
+// last command record. Replay keeps the last UNDO_HISTORY commands of
+// every user to find them, as many as the network client keeps.
+//
+// Logging only encodes the record into a memory buffer, which takes well
+// under a microsecond for a draw. A background thread writes the buffer
+// out and calls fsync every FLUSH_MS milliseconds, so at most that much
+// work is lost when the machine goes down.
+//
+// The journal file is removed on a clean exit. If it is still there on
+// startup the last run crashed, and Replay() applies the records to the
+// fresh canvas. App::RecordSession() keeps the journal instead, and the
+// headless harness replays it as a benchmark. Saving or opening a project starts the journal over with
+// the project file as its base.
+class Journal{
+public:
+    // Milliseconds between two flushes
+    static const unsigned FLUSH_MS = 100;
+    // Called after Replay() applied a record, with a short name for the
+    // kind of record, so a replay can be timed record by record
+    typedef void (*ReplayCallback)(const char* kind, void* user);
+
+    Journal();
+    ~Journal();
+
+    bool Open(const std::string &path, std::uint64_t keep = 0);
+    void Close(bool clean);
+    bool IsOpen() const;
+    void Restart(const std::string &base);
+
+    void LogCommand(Command &command);
+    void LogRemoteCommand(Command &command, unsigned user);
+    void LogRevert(const Command &target, unsigned user);
+    void LogUndo();
+    void LogRedo();
+    void LogLayer(unsigned id, sf::Uint8 opacity, bool visible, BlendMode mode);
+    void LogActive(unsigned id);
+
+    static bool Exists(const std::string &path);
+    static std::uint64_t Replay(const std::string &path, App &app, unsigned* records = nullptr,
+                                ReplayCallback callback = nullptr, void* user = nullptr);
+
+private:
+    // Kinds of records
+    enum Record{
+        RECORD_BASE,
+        RECORD_COMMAND,
+        RECORD_UNDO,
+        RECORD_REDO,
+        RECORD_LAYER,
+        RECORD_ACTIVE,
+        // Only read, imports are journaled as commands now
+        RECORD_IMPORT,
+        // Command of another user, which is not on the undo stack
+        RECORD_REMOTE,
+        // Undo on a shared canvas of a command of a user, 0 for ours
+        RECORD_REVERT
+    };
+
+    std::string m_path;
+    int         m_fd;
+    // Numbers given to command records so far, and when the file was
+    // opened. Commands with a number up to m_opened are not in the file.
+    std::uint64_t m_commands;
+    std::uint64_t m_opened;
+    // Reused to encode one record at a time
+    ByteWriter  m_record;
+    // Records waiting for the background thread, guarded by m_mutex
+    std::vector<std::uint8_t> m_pending;
+    std::mutex  m_mutex;
+    std::condition_variable m_wake;
+    bool        m_stop;
+    std::thread m_thread;
+
+    void Begin(Record type);
+    void Append();
+    void Run();
+    Journal(const Journal&);
+};
+
+
+#endif
@@ -0,0 +1,75 @@
+/**
+ *  @file   Latency.hpp
+ *  @brief  Time from an input event to the frame that shows what it did.
+ *  @author Team Avengers
+ *  @date   2020-12-17
+ ***********************************************/
+#ifndef LATENCY_HPP
+#define LATENCY_HPP
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+// Project header files
+// #include ...
+
+// Clock input events are stamped with when they are polled. A default
+// constructed time point means a command did not come from input.
+typedef std::chrono::steady_clock InputClock;
+
+// Counts latencies in buckets of BUCKET_MS milliseconds. The last bucket
+// holds everything from (BUCKETS - 1) * BUCKET_MS up, the longest latency
+// is kept exactly.
+class LatencyHistogram{
+public:
+    static const unsigned BUCKETS = 50;
+    static const unsigned BUCKET_MS = 2;
+
+    LatencyHistogram();
+
+    void Add(InputClock::duration latency);
+    void Reset();
+    std::uint64_t GetCount() const;
+    std::uint64_t GetBucket(unsigned bucket) const;
+    float GetMean() const;
+    float GetMax() const;
+    float GetPercentile(float percentile) const;
+    void Write(std::ostream &out) const;
+
+private:
+    std::uint64_t m_buckets[BUCKETS];
+    std::uint64_t m_count;
+    // Nanoseconds of every latency added, and of the longest
+    std::uint64_t m_total;
+    std::uint64_t m_max;
+};
+
+// Follows input through the frame loop. The commands of an event carry
+// when it was polled. Once one is executed, its time waits for the texture
+// upload that contains it, and then for the display() that shows that
+// upload, where its latency goes into the histogram.
+//
+// The lists keep their memory, so a steady frame does not allocate.
+class LatencyTracker{
+public:
+    void Executed(InputClock::time_point input);
+    void Uploaded(bool complete);
+    void Presented(InputClock::time_point now);
+    std::size_t GetWaiting() const;
+    LatencyHistogram& GetHistogram();
+
+private:
+    // Executed but not composited and uploaded yet
+    std::vector<InputClock::time_point> m_executed;
+    // In the texture, shown by the next display()
+    std::vector<InputClock::time_point> m_uploaded;
+    LatencyHistogram m_histogram;
+};
+
+
+#endif
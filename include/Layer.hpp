@@ -0,0 +1,43 @@
+/**
+ *  @file   Layer.hpp
+ *  @brief  A single layer of the canvas.
+ *  @author Team Avengers
+ *  @date   2020-11-30
+ ***********************************************/
+#ifndef LAYER_HPP
+#define LAYER_HPP
+
+// Include our Third-Party SFML header
+#include <SFML/Graphics/Color.hpp>
+// Include standard library C++ libraries.
+#include <string>
+// Project header files
+#include "Blend.hpp"
+#include "TiledImage.hpp"
+
+// A layer owns its pixels and the settings used when it is composited.
+// Layers are only changed through the LayerStack that holds them,
+// so that the stack can keep its cached composites up to date.
+class Layer{
+public:
+    Layer(unsigned id, const std::string &name, unsigned width, unsigned height);
+    unsigned            GetId() const;
+    const std::string&  GetName() const;
+    sf::Uint8           GetOpacity() const;
+    bool                IsVisible() const;
+    BlendMode           GetBlendMode() const;
+    TiledImage&         GetPixels();
+    const TiledImage&   GetPixels() const;
+
+private:
+    friend class LayerStack;
+    unsigned    m_id;
+    std::string m_name;
+    sf::Uint8   m_opacity;
+    bool        m_visible;
+    BlendMode   m_blendMode;
+    TiledImage  m_pixels;
+};
+
+
+#endif
@@ -0,0 +1,46 @@
+/**
+ *  @file   LayerCommand.hpp
+ *  @brief  Undoable changes to the layer stack.
+ *  @author Team Avengers
+ *  @date   2020-11-30
+ ***********************************************/
+#ifndef LAYER_COMMAND_HPP
+#define LAYER_COMMAND_HPP
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <string>
+#include <memory>
+// Project header files
+#include "Command.hpp"
+#include "App.hpp"
+#include "Layer.hpp"
+
+// Adds, removes or reorders a layer of the canvas.
+// Opacity and visibility are layer settings and are not undoable.
+class LayerCommand : public Command{
+	public:
+        enum Action { ADD, REMOVE, MOVE_UP, MOVE_DOWN };
+        LayerCommand(const char* m_commandDescription, Action action, App &app);
+        ~LayerCommand();
+        static std::shared_ptr<Command> Deserialize(ByteReader &in, App &app);
+    private:
+        App& m_app;
+        Action m_action;
+        // Layer the command works on
+        std::shared_ptr<Layer> m_layer;
+        // Position of the layer before the command executed
+        std::size_t m_index;
+        // Active layer before the command executed
+        unsigned m_prevActive;
+        bool execute();
+        bool undo();
+        bool compare(const std::shared_ptr<Command> &rhs);
+        CommandType GetType() const;
+        void Serialize(ByteWriter &out) const;
+
+};
+
+
+#endif
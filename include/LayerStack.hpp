@@ -0,0 +1,105 @@
+/**
+ *  @file   LayerStack.hpp
+ *  @brief  Ordered stack of layers with a cached flattened image.
+ *  @author Team Avengers
+ *  @date   2020-11-30
+ ***********************************************/
+#ifndef LAYER_STACK_HPP
+#define LAYER_STACK_HPP
+
+// Include our Third-Party SFML header
+#include <SFML/Graphics/Color.hpp>
+// Include standard library C++ libraries.
+#include <memory>
+#include <string>
+#include <vector>
+// Project header files
+#include "Blend.hpp"
+#include "Layer.hpp"
+#include "TaskPool.hpp"
+#include "TiledImage.hpp"
+
+// The layer stack owns every layer of the canvas. Index 0 is the bottom layer.
+//
+// The flattened image is cached and only the tiles that changed since the
+// last call to Flatten() are composited again. On top of that, the stack
+// keeps two more cached composites per tile: everything below the active
+// layer and everything above it. Editing the active layer then only costs
+// three tile blends no matter how many layers there are. The cache above
+// is only used while every layer above the active one blends normally,
+// since the other blend modes can not be grouped that way.
+//
+// Given a task pool, Flatten() composites runs of dirty tiles in parallel.
+// Tiles whose task did not start before the deadline stay dirty for the
+// next call, so a frame never waits for a whole canvas to be composited.
+//
+// All colors passed in and out of the stack are premultiplied.
+class LayerStack{
+public:
+    LayerStack(unsigned width, unsigned height, const sf::Color &background);
+
+    unsigned GetWidth() const;
+    unsigned GetHeight() const;
+
+    // Layer management
+    std::size_t GetLayerCount() const;
+    std::shared_ptr<Layer> GetLayer(std::size_t index) const;
+    std::shared_ptr<Layer> FindLayer(unsigned id) const;
+    int  IndexOf(unsigned id) const;
+    unsigned GetActiveId() const;
+    int  GetActiveIndex() const;
+    void SetActive(unsigned id);
+    std::shared_ptr<Layer> CreateLayer(const std::string &name);
+    void InsertLayer(const std::shared_ptr<Layer> &layer, std::size_t index);
+    std::shared_ptr<Layer> RemoveLayer(unsigned id);
+    bool MoveLayer(unsigned id, std::size_t index);
+    void SetOpacity(unsigned id, sf::Uint8 opacity);
+    void SetVisible(unsigned id, bool visible);
+    void SetBlendMode(unsigned id, BlendMode mode);
+
+    // Pixel access
+    sf::Color GetPixel(unsigned id, unsigned x, unsigned y) const;
+    void SetPixel(unsigned id, unsigned x, unsigned y, const sf::Color &color);
+    void Fill(unsigned id, const sf::Color &color);
+    TilePtr GetTile(unsigned id, unsigned tile) const;
+    void SetTile(unsigned id, unsigned tile, const TilePtr &pixels);
+    TilePtr RevertTile(unsigned id, unsigned tile, const TilePtr &before, const TilePtr &after);
+    TiledImage Snapshot(unsigned id) const;
+    void Restore(unsigned id, const TiledImage &snapshot);
+
+    // Compositing
+    const TiledImage& Flatten(std::vector<unsigned>* updated = nullptr, TaskPool* tasks = nullptr,
+                              TaskClock::time_point deadline = TaskClock::time_point::max());
+    const TiledImage& GetFlattened() const;
+    void MarkAllDirty();
+    bool HasDirtyTiles() const;
+
+private:
+    // Per tile state bits
+    enum { TILE_DIRTY = 1, TILE_BELOW_VALID = 2, TILE_ABOVE_VALID = 4 };
+
+    unsigned    m_width;
+    unsigned    m_height;
+    unsigned    m_nextId;
+    unsigned    m_activeId;
+    std::vector<std::shared_ptr<Layer>> m_layers;
+    // Composite of the visible layers below the active layer
+    std::vector<TilePtr> m_below;
+    // Composite of the visible layers above the active layer
+    std::vector<TilePtr> m_above;
+    // Final image that is shown on screen
+    TiledImage  m_flattened;
+    std::vector<sf::Uint8> m_tileState;
+    // Tiles waiting to be composited by the next Flatten()
+    std::vector<unsigned> m_dirtyList;
+
+    void MarkTile(int layerIndex, unsigned tile);
+    void MarkLayer(int layerIndex);
+    void InvalidateCaches();
+    void CompositeRange(std::size_t first, std::size_t last, unsigned tile, TilePtr &out) const;
+    void CompositeTile(unsigned tile);
+    bool AboveIsNormal(std::size_t active) const;
+};
+
+
+#endif
@@ -0,0 +1,164 @@
+/**
+ *  @file   Memory.hpp
+ *  @brief  Frame arena, block pools and a count of heap allocations.
+ *  @author Team Avengers
+ *  @date   2020-12-16
+ ***********************************************/
+#ifndef MEMORY_HPP
+#define MEMORY_HPP
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+// Project header files
+// #include ...
+
+// Number of heap allocations the calling thread made with new since it
+// started. Memory.cpp replaces the global operator new to count them.
+std::uint64_t GetHeapAllocations();
+
+// Bump allocator for memory that is only needed until the end of a frame.
+//
+// Allocating moves a pointer and Reset() gives everything back at once.
+// When a frame needs more than the arena holds, the rest comes from the
+// heap and the arena grows on the next Reset(), so a steady frame only
+// ever uses the one block. Nothing allocated here is destructed.
+class FrameArena{
+public:
+    // Bytes the arena starts with
+    static const std::size_t DEFAULT_SIZE = 256 * 1024;
+
+    explicit FrameArena(std::size_t size = DEFAULT_SIZE);
+    ~FrameArena();
+
+    void* Allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+    void Reset();
+    std::size_t GetCapacity() const;
+    std::size_t GetUsed() const;
+
+private:
+    // Heap block taken because the arena was full, freed by Reset()
+    struct Overflow{
+        Overflow* next;
+    };
+
+    char* m_memory;
+    std::size_t m_size;
+    std::size_t m_used;
+    Overflow* m_overflow;
+    std::size_t m_overflowBytes;
+
+    FrameArena(const FrameArena&);
+};
+
+// Bump allocator over one block that never grows, for memory that lives
+// as long as its owner. Allocate() returns nullptr once the block is used
+// up, so whatever runs on it has a known upper bound.
+class FixedArena{
+public:
+    explicit FixedArena(std::size_t size);
+    ~FixedArena();
+
+    void* Allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t));
+    std::size_t GetCapacity() const;
+    std::size_t GetUsed() const;
+    unsigned GetFailures() const;
+
+private:
+    char* m_memory;
+    std::size_t m_size;
+    std::size_t m_used;
+    // Allocations that did not fit
+    unsigned m_failures;
+
+    FixedArena(const FixedArena&);
+};
+
+// Free list of blocks of one size, safe to use from any thread.
+//
+// Freed blocks are kept for the next allocation instead of going back to
+// the heap, up to a few megabytes per pool.
+class BlockPool{
+public:
+    explicit BlockPool(std::size_t size);
+
+    void* Allocate();
+    void Free(void* block);
+    std::size_t GetBlockSize() const;
+
+private:
+    struct FreeBlock{
+        FreeBlock* next;
+    };
+
+    std::mutex m_mutex;
+    FreeBlock* m_free;
+    std::size_t m_freeCount;
+    std::size_t m_maxFree;
+    std::size_t m_size;
+
+    BlockPool(const BlockPool&);
+};
+
+// Allocate from the pool of the smallest size class that fits, or from
+// the heap for more than POOL_MAX_BYTES.
+const std::size_t POOL_MAX_BYTES = 1024;
+void* PoolAllocate(std::size_t size);
+void PoolFree(void* block, std::size_t size);
+
+// Allocator for containers and shared objects that come and go all the
+// time. Single objects come from a pool of their exact size, arrays from
+// the size classes of PoolAllocate().
+template<typename T>
+class PoolAllocator{
+public:
+    typedef T value_type;
+
+    PoolAllocator(){
+    }
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U>&){
+    }
+
+    T* allocate(std::size_t n){
+        return static_cast<T*>(n == 1 ? GetPool().Allocate() : PoolAllocate(n * sizeof(T)));
+    }
+    void deallocate(T* block, std::size_t n){
+        if (n == 1){
+            GetPool().Free(block);
+        } else{
+            PoolFree(block, n * sizeof(T));
+        }
+    }
+
+    static BlockPool& GetPool(){
+        // Never destroyed, static objects may free blocks during exit
+        static BlockPool* pool = new BlockPool(sizeof(T));
+        return *pool;
+    }
+};
+
+template<typename T, typename U>
+bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&){
+    return true;
+}
+
+template<typename T, typename U>
+bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&){
+    return false;
+}
+
+// make_shared for objects created many times a second, the object and its
+// reference count share one pooled block.
+template<typename T, typename... Args>
+std::shared_ptr<T> MakePooled(Args&&... args){
+    return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
+
+
+#endif
@@ -0,0 +1,306 @@
+/**
+ *  @file   Network.hpp
+ *  @brief  Messages and connections for drawing together over TCP.
+ *  @author Team Avengers
+ *  @date   2020-12-11
+ ***********************************************/
+#ifndef NETWORK_HPP
+#define NETWORK_HPP
+
+// Include our Third-Party SFML header
+#include <SFML/Graphics/Rect.hpp>
+// Include standard library C++ libraries.
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+// Project header files
+#include "ByteStream.hpp"
+#include "Command.hpp"
+#include "StrokeCodec.hpp"
+#include "TiledImage.hpp"
+
+class App;
+
+// Kinds of messages between the server and its clients.
+enum MessageType{
+    MESSAGE_HELLO,      // client: protocol version, room, viewport, hashes of the tiles it has
+    MESSAGE_WELCOME,    // server: user id, canvas width and height, tiles in the snapshot,
+                        // ids of the layers of the client the room shares
+    MESSAGE_COMMANDS,   // client: a command batch, server: user id in front
+    MESSAGE_TILE,       // server: layer id, tile index, hash, pixels of one snapshot tile
+    MESSAGE_SNAPSHOT,   // server: a SnapshotStage the snapshot reached, numbered if it is
+                        // SNAPSHOT_DONE, client: SNAPSHOT_DONE and its number once
+                        // everything it drew before is sent
+    MESSAGE_ACK,        // server: number of the client's batches applied so far
+    MESSAGE_CURSOR,     // client: if its cursor is on the canvas, x and y in PRESENCE_QUANTUM units
+    MESSAGE_CURSORS,    // server: number of cursors on the canvas, then user id, x and y of each
+    MESSAGE_TYPE_COUNT
+};
+
+// Stages of the snapshot a client gets when it joins.
+enum SnapshotStage{
+    SNAPSHOT_VIEWPORT,  // every tile the client sees was sent
+    SNAPSHOT_DONE,      // every tile was sent
+    SNAPSHOT_CATCH_UP   // the client fell behind, batches were dropped and
+                        // the whole canvas follows
+};
+
+// How the pixels of a MESSAGE_TILE are stored
+enum TileEncoding{
+    TILE_EMPTY,         // transparent, no pixels follow
+    TILE_RAW,           // TILE_BYTES bytes
+    TILE_DEFLATE        // varint size and zlib data
+};
+
+const unsigned PROTOCOL_VERSION = 7;
+// Most samples packed into one stroke of a command batch
+const std::size_t MAX_STROKE_SAMPLES = 256;
+const unsigned short DEFAULT_PORT = 7777;
+// Commands of every user kept to be undone, more than the undo stack holds
+const std::size_t UNDO_HISTORY = 16;
+// Milliseconds between two cursor updates of a client or of a room
+const unsigned PRESENCE_MS = 50;
+// Pixels a cursor position is rounded to
+const int PRESENCE_QUANTUM = 4;
+
+// Where another user points on the canvas.
+struct RemoteCursor{
+    unsigned id;
+    sf::Vector2i position;
+};
+
+// Framed messages that are queued on many connections without a copy.
+typedef std::shared_ptr<const std::vector<std::uint8_t>> SharedMessages;
+
+// A non-blocking TCP socket that sends and receives framed messages.
+// Every message is a varint length, the type and the payload.
+//
+// Send() only queues, Flush() writes as much as the socket takes. The
+// queue is a list of chunks, small messages are appended to the last one
+// and messages for many connections are shared, and Flush() hands all of
+// them to the socket in one call. Receive() reads whatever arrived and
+// NextMessage() hands out the complete messages one at a time.
+class Connection{
+public:
+    Connection();
+    explicit Connection(int fd);
+    ~Connection();
+
+    bool Connect(const std::string &host, unsigned short port);
+    void Close();
+    bool IsOpen() const;
+    int  GetFd() const;
+
+    void Send(MessageType type, const std::uint8_t* payload, std::size_t size);
+    void SendFramed(const std::uint8_t* messages, std::size_t size);
+    void SendShared(const SharedMessages &messages);
+    bool Flush();
+    bool HasPending() const;
+    std::size_t GetPendingSize() const;
+    std::size_t DropPending();
+
+    bool Receive();
+    bool NextMessage(std::uint8_t &type, const std::uint8_t* &payload, std::size_t &size);
+
+    static void Frame(MessageType type, const std::uint8_t* payload, std::size_t size, ByteWriter &out);
+
+private:
+    // Queued bytes, 'own' is set while more can be appended
+    struct Chunk{
+        SharedMessages data;
+        std::vector<std::uint8_t>* own;
+    };
+
+    int m_fd;
+    // Received bytes, the messages before m_inStart were handed out
+    std::vector<std::uint8_t> m_in;
+    std::size_t m_inStart;
+    // Chunks to send, the bytes of the first one before m_outStart were sent
+    std::deque<Chunk> m_out;
+    std::size_t m_outStart;
+    std::size_t m_pending;
+
+    std::vector<std::uint8_t>& Append();
+    void Setup();
+    Connection(const Connection&);
+};
+
+void WriteTilePixels(const sf::Uint8* pixels, ByteWriter &out, std::vector<std::uint8_t> &scratch);
+bool ReadTilePixels(ByteReader &in, TilePtr &tile);
+
+// Packs commands into the payload of a MESSAGE_COMMANDS message: the number
+// of entries, then every entry as a tag byte followed by either a command
+// written by WriteCommand() or a stroke written by EncodeStroke().
+// Consecutive draws with the same color on the same layer become one stroke.
+// The buffers are allocated once, adding a command does not allocate.
+class CommandBatchWriter{
+public:
+    CommandBatchWriter();
+
+    void Add(const Command &command);
+    bool IsEmpty() const;
+    void Finish(ByteWriter &out);
+
+private:
+    ByteWriter  m_entries;
+    unsigned    m_count;
+    // Draws waiting to be packed into a stroke
+    StrokeHeader m_header;
+    std::vector<sf::Vector2i> m_points;
+    std::vector<sf::Uint8> m_coverage;
+    std::size_t m_samples;
+    std::vector<std::uint8_t> m_encoded;
+
+    void FlushStroke();
+};
+
+// Unpacks the commands of a MESSAGE_COMMANDS payload.
+class CommandBatchReader{
+public:
+    CommandBatchReader();
+
+    bool Read(ByteReader &in, App &app, std::vector<std::shared_ptr<Command>> &commands);
+
+private:
+    std::vector<sf::Vector2i> m_points;
+    std::vector<sf::Uint8> m_coverage;
+};
+
+// The last commands of one user, so a RevertCommand finds the command it
+// takes back on every canvas. A sequence number can be kept with each.
+class CommandHistory{
+public:
+    void Record(const std::shared_ptr<Command> &command, std::uint64_t sequence = 0,
+                std::uint64_t* targetSequence = nullptr);
+    std::shared_ptr<Command> Find(std::uint64_t back, std::uint64_t* sequence = nullptr) const;
+    std::uint64_t GetBack(const Command* command) const;
+    void Clear();
+
+private:
+    std::deque<std::pair<std::uint64_t, std::shared_ptr<Command>>> m_entries;
+};
+
+// The side of the app that talks to the server.
+//
+// Commands that execute on this canvas are queued and sent as one message
+// per frame. Commands of the other users are applied in Poll(), once per
+// frame like the image importer. They do not go on the undo stack, undo
+// only takes back what this user did.
+//
+// Only draws, clears and filters are shared. Layers are not: every client
+// numbers its own, so the same id can be another layer elsewhere. The
+// welcome names our layers the room has, which the snapshot makes the
+// same everywhere. Commands on our other layers are kept to this canvas,
+// and commands of the others on layers we do not share are kept for their
+// undo but not drawn.
+//
+// On joining, the client sends the hash of every tile it has and the
+// server streams the tiles that differ, the ones in the viewport first.
+// Commands of the other users keep coming in between, so the canvas can
+// be drawn on as soon as the viewport arrived.
+//
+// The order the server applies batches in is the order for everyone. Our
+// own commands are drawn right away and stay pending until the server
+// acknowledges their batch. A batch of another user that arrives before
+// that came first on the server, so if it touches a pixel of a pending
+// command, the pending commands are undone, the batch is applied and they
+// are executed again. Everyone ends up with the same pixels, without ever
+// going back further than the commands in flight.
+//
+// Undo sends a RevertCommand, which every canvas applies to its own copy
+// of the command, so an undo costs as much as the command it takes back.
+//
+// The mouse position goes out at most once every PRESENCE_MS and only if
+// it moved by PRESENCE_QUANTUM. The server sends the cursors of everybody
+// in the room, so an update that is lost is made up by the next one.
+class NetworkClient{
+public:
+    NetworkClient();
+
+    bool Connect(const std::string &address);
+    void Disconnect();
+    bool IsConnected() const;
+    unsigned GetUserId() const;
+    const std::string& GetStatus() const;
+    void SetViewport(const sf::IntRect &viewport);
+    bool IsViewportLoaded() const;
+    bool IsCanvasLoaded() const;
+
+    void Queue(const std::shared_ptr<Command> &command);
+    bool Undo(const std::shared_ptr<Command> &command);
+    void SetCursor(const sf::Vector2i &position, bool visible);
+    const std::vector<RemoteCursor>& GetCursors() const;
+    void Poll(App &app);
+
+private:
+    Connection  m_connection;
+    std::string m_room;
+    // Part of the canvas on screen, the window if it is empty
+    sf::IntRect m_viewport;
+    bool        m_helloSent;
+    // Commands waiting for the next message
+    CommandBatchWriter m_batch;
+    CommandBatchReader m_reader;
+    std::vector<std::shared_ptr<Command>> m_received;
+    ByteWriter  m_message;
+    // Our commands the server did not acknowledge yet, oldest first, and
+    // how many of them went out in each batch not acknowledged yet
+    std::deque<std::shared_ptr<Command>> m_pending;
+    std::deque<std::size_t> m_pendingBatches;
+    std::size_t m_unsent;
+    // Pixels the pending commands change, rebuilt after an acknowledgement
+    std::unordered_set<std::uint64_t> m_footprint;
+    bool        m_footprintAll;
+    bool        m_footprintStale;
+    std::uint64_t m_batchesSent;
+    std::uint64_t m_batchesAcked;
+    // Our commands and the ones of every other user, to be undone
+    CommandHistory m_own;
+    std::map<unsigned, CommandHistory> m_users;
+    // 0 until the server welcomed us
+    unsigned    m_userId;
+    // Our layers the room has too, set by the welcome
+    std::vector<unsigned> m_sharedLayers;
+    std::string m_status;
+    // m_status with the loading progress, reused so the GUI does not
+    // allocate a new string every frame
+    mutable std::string m_statusLine;
+    // Tiles the snapshot sends and how many of them arrived
+    unsigned    m_snapshotTiles;
+    unsigned    m_snapshotReceived;
+    bool        m_viewportLoaded;
+    bool        m_canvasLoaded;
+    // Last tile received, shared with the next one if it is the same
+    TilePtr     m_lastTile;
+    std::uint64_t m_lastHash;
+    // Our mouse, what the others last got of it and when
+    sf::Vector2i m_cursor;
+    bool        m_cursorVisible;
+    sf::Vector2i m_cursorSent;
+    bool        m_cursorSentVisible;
+    std::chrono::steady_clock::time_point m_cursorTime;
+    // Cursors of the other users
+    std::vector<RemoteCursor> m_cursors;
+
+    void SendHello(App &app);
+    void SendBatch();
+    void SendCursor();
+    bool ReceiveCursors(ByteReader &in);
+    void AddPending(const std::shared_ptr<Command> &command);
+    void AddFootprint(const Command &command);
+    void Acknowledge(std::uint64_t batches);
+    bool Conflicts(const std::vector<std::shared_ptr<Command>> &commands);
+    bool IsShared(const Command &command) const;
+    void ResetShared();
+    bool ReceiveTile(ByteReader &in, App &app);
+    void Fail(const std::string &reason);
+    NetworkClient(const NetworkClient&);
+};
+
+
+#endif
@@ -0,0 +1,95 @@
+/**
+ *  @file   Profiler.hpp
+ *  @brief  Scoped timers showing where the time of a frame goes.
+ *  @author Team Avengers
+ *  @date   2020-12-14
+ ***********************************************/
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+// Project header files
+#include "Trace.hpp"
+
+// Parts of a frame that are timed. Zones can be nested, the time of
+// commands is also part of the input that runs them.
+enum ProfileZone{
+    PROFILE_FRAME,          // one turn of the main loop
+    PROFILE_INPUT,          // update(), events, mouse and keys of the canvas
+    PROFILE_COMMANDS,       // executing, undoing and redoing commands
+    PROFILE_NETWORK,        // sending and applying commands of the other users
+    PROFILE_UPLOAD,         // compositing changed tiles and sending them to the GPU
+    PROFILE_PRESENT,        // drawing the canvas window and showing it
+    PROFILE_GUI_INPUT,      // events of the toolbar window
+    PROFILE_GUI_LAYOUT,     // building the toolbar with Nuklear
+    PROFILE_GUI_RENDER,     // converting the toolbar to vertices and drawing it
+    PROFILE_GUI_PRESENT,    // showing the toolbar window
+    PROFILE_ZONE_COUNT
+};
+
+const char* GetProfileZoneName(ProfileZone zone);
+
+// Collects the time spent in every zone of the last PROFILE_FRAMES frames.
+//
+// Every thread has its own ring of frames, so timing a zone takes no lock.
+// Nothing is timed while neither the profiler nor a trace is on, a scope
+// then only loads two flags.
+class Profiler{
+public:
+    // Frames kept to be shown
+    static const std::size_t FRAMES = 240;
+
+    static bool IsEnabled(){
+        return s_enabled.load(std::memory_order_relaxed);
+    }
+    static void SetEnabled(bool enabled);
+    static void Add(ProfileZone zone, std::uint64_t nanoseconds);
+    static void EndFrame();
+
+    static std::size_t GetFrameCount();
+    static float GetMilliseconds(ProfileZone zone, std::size_t frame);
+    static float GetPercentile(ProfileZone zone, float percentile);
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+// Adds the time from its construction to its destruction to a zone of
+// the calling thread's current frame, and to the trace if one is captured.
+class ProfileScope{
+public:
+    explicit ProfileScope(ProfileZone zone): m_zone(zone), m_active(Profiler::IsEnabled()),
+     m_tracing(Trace::IsCapturing()){
+        if (m_active || m_tracing){
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+    ~ProfileScope(){
+        if (!m_active && !m_tracing){
+            return;
+        }
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        if (m_active){
+            Profiler::Add(m_zone, std::chrono::duration_cast<std::chrono::nanoseconds>(end - m_start).count());
+        }
+        if (m_tracing){
+            Trace::Add(GetProfileZoneName(m_zone), m_start, end);
+        }
+    }
+
+private:
+    ProfileZone m_zone;
+    bool        m_active;
+    bool        m_tracing;
+    std::chrono::steady_clock::time_point m_start;
+    ProfileScope(const ProfileScope&);
+};
+
+
+#endif
@@ -0,0 +1,47 @@
+/**
+ *  @file   RevertCommand.hpp
+ *  @brief  Undo of one user's command on a shared canvas.
+ *  @author Team Avengers
+ *  @date   2020-12-13
+ ***********************************************/
+#ifndef REVERT_COMMAND_HPP
+#define REVERT_COMMAND_HPP
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <cstdint>
+#include <string>
+#include <memory>
+// Project header files
+#include "Command.hpp"
+
+// Sent instead of an undo when the canvas is shared. It names the command
+// it takes back by how many commands of the same user came before it, so
+// every canvas finds its own copy of that command, with the pixels it
+// saved there. Only pixels that are still what that command left go back,
+// what other users drew since stays.
+class RevertCommand : public Command{
+	public:
+        RevertCommand(const char* m_commandDescription, std::uint64_t back,
+            const std::shared_ptr<Command> &target);
+        ~RevertCommand();
+        static std::shared_ptr<Command> Deserialize(ByteReader &in, App &app);
+        std::uint64_t GetBack() const;
+        const std::shared_ptr<Command>& GetTarget() const;
+        void SetTarget(const std::shared_ptr<Command> &target);
+    private:
+        // 1 for the last command of the user, 2 for the one before...
+        std::uint64_t m_back;
+        // Command taken back, nullptr if this canvas does not have it
+        std::shared_ptr<Command> m_target;
+        bool execute();
+        bool undo();
+        bool compare(const std::shared_ptr<Command> &rhs);
+        CommandType GetType() const;
+        void Serialize(ByteWriter &out) const;
+
+};
+
+
+#endif
@@ -0,0 +1,87 @@
+/**
+ *  @file   SelectionMask.hpp
+ *  @brief  Tiled coverage mask of the current selection.
+ *  @author Team Avengers
+ *  @date   2020-12-04
+ ***********************************************/
+#ifndef SELECTION_MASK_HPP
+#define SELECTION_MASK_HPP
+
+// Include our Third-Party SFML header
+#include <SFML/Graphics.hpp>
+// Include standard library C++ libraries.
+#include <cstdint>
+#include <vector>
+// Project header files
+#include "ByteStream.hpp"
+#include "TiledImage.hpp"
+
+// The selection is an 8 bit coverage mask split into the same tiles as the
+// layers. Every tile is flagged as empty, full or partial, and only partial
+// tiles store coverage bytes. Tools walk GetSelectedTiles() and take a fast
+// path for full tiles, so their cost follows the size of the selection
+// rather than the size of the canvas.
+//
+// When nothing is selected the whole canvas counts as selected.
+//
+// The mask also remembers the shape it was made from, which is all that
+// Serialize() writes. Deserialize() rasterizes the shape again. Shapes
+// come from the network and from journals, so only the rows and columns
+// on the canvas are ever stored, however far off the shape reaches.
+class SelectionMask{
+public:
+    enum TileState { TILE_EMPTY, TILE_FULL, TILE_PARTIAL };
+
+    SelectionMask();
+    SelectionMask(unsigned width, unsigned height);
+
+    bool IsActive() const;
+    void Clear();
+    void SelectRect(const sf::IntRect &rect);
+    void SelectEllipse(const sf::IntRect &bounds);
+    void SelectLasso(const std::vector<sf::Vector2i> &points);
+
+    TileState GetTileState(unsigned tile) const;
+    const sf::Uint8* GetTileCoverage(unsigned tile) const;
+    sf::Uint8 GetCoverage(unsigned x, unsigned y) const;
+    const std::vector<unsigned>& GetSelectedTiles() const;
+    sf::IntRect GetBounds() const;
+    std::uint64_t GetVersion() const;
+
+    void Serialize(ByteWriter &out) const;
+    bool Deserialize(ByteReader &in);
+
+    static void ApplyCoverage(const sf::Uint8* coverage, const sf::Uint8* original, sf::Uint8* edited);
+
+private:
+    // Shape the selection was made from
+    enum Shape { SHAPE_ALL, SHAPE_RECT, SHAPE_ELLIPSE, SHAPE_LASSO };
+    // Half open run [x0, x1) of selected pixels on one row
+    struct Span{ int x0; int x1; };
+    typedef std::vector<std::vector<Span>> SpanRows;
+    // Edges of a rectangle in 64 bits, so far off corners can not overflow
+    struct Extent{ std::int64_t left; std::int64_t top; std::int64_t right; std::int64_t bottom; };
+
+    unsigned    m_width;
+    unsigned    m_height;
+    unsigned    m_tilesX;
+    unsigned    m_tilesY;
+    bool        m_active;
+    std::vector<sf::Uint8> m_states;
+    std::vector<TilePtr> m_coverage;
+    std::vector<unsigned> m_selected;
+    sf::IntRect m_bounds;
+    Shape       m_shape;
+    sf::IntRect m_shapeRect;
+    std::vector<sf::Vector2i> m_shapePoints;
+    // Counts every change of the selection
+    std::uint64_t m_version;
+
+    void Reset();
+    void Rasterize(int top, const SpanRows &rows);
+    static const std::vector<Span>& RowSpans(const SpanRows &rows, int top, int y);
+    static Extent Normalize(const sf::IntRect &rect);
+};
+
+
+#endif
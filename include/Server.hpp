@@ -0,0 +1,102 @@
+/**
+ *  @file   Server.hpp
+ *  @brief  Collaboration server holding the canvases everyone draws on.
+ *  @author Team Avengers
+ *  @date   2020-12-11
+ ***********************************************/
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+// Project header files
+#include "Network.hpp"
+
+// Rooms a server holds, each with a canvas of its own. Rooms last until
+// the server stops, so a join that would open one more is refused.
+const unsigned MAX_ROOMS = 64;
+// Longest room name a client can ask for, in bytes
+const std::size_t MAX_ROOM_NAME = 64;
+
+// Totals of a running server, for load tests.
+struct ServerStats{
+    std::uint64_t messages;     // messages received from clients
+    std::uint64_t bytesSent;
+    std::uint64_t catchUps;     // times a slow client got a snapshot instead of its queue
+    double        cpuSeconds;   // time the server threads spent on a CPU
+};
+
+// Keeps the authoritative canvases and relays commands between clients.
+//
+// Clients join a room by name and everybody in a room draws on the same
+// canvas. A room keeps its canvas when everybody left, for whoever comes
+// back, so only MAX_ROOMS of them are ever opened. The thread calling Run() accepts connections and waits for
+// their hello, then hands them to the worker thread that owns their room.
+// Rooms are spread over a few workers by the hash of their name. A worker
+// waits on its sockets with epoll and never shares a room with another
+// thread, so rooms need no locks.
+//
+// A batch of commands from a client is applied to the room's own headless
+// canvas, which also checks it, then framed once and queued for every
+// other client of the room without a copy. Everything a client is owed
+// after a round of epoll goes out in one writev.
+//
+// The order batches are applied in here is the order on every canvas.
+// Each batch is acknowledged to its sender, which puts its own commands
+// drawn in the meantime back on top of the batches that came first. An
+// undo is a RevertCommand applied to the copy of the command on every
+// canvas. Clients that joined after the command was drawn do not have it
+// and get the tiles it changed instead.
+//
+// A client that joins gets a snapshot of the canvas streamed tile by
+// tile, nearest to its viewport first. Tiles whose hash matches one the
+// client already has are skipped. Batches of the other clients go out in
+// between, and since a tile is read from the canvas when it is sent, the
+// client ends up with what everyone else has without anybody waiting.
+// A tile the client itself drew on after it was sent is sent again.
+//
+// The queue of a client is bounded. A client that falls too far behind
+// has its queue dropped and gets a new snapshot instead, which costs at
+// most one canvas no matter how much was drawn meanwhile.
+class Server{
+public:
+    Server(unsigned width, unsigned height, unsigned threads = 0);
+    ~Server();
+
+    bool Listen(unsigned short port);
+    void Run();
+    void Stop();
+    unsigned short GetPort() const;
+    unsigned GetClientCount() const;
+    unsigned GetRoomCount() const;
+    ServerStats GetStats() const;
+
+private:
+    struct Client;
+    struct Room;
+    struct Worker;
+
+    unsigned    m_width;
+    unsigned    m_height;
+    int         m_listen;
+    unsigned short m_port;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<unsigned> m_nextId;
+    std::atomic<unsigned> m_clients;
+    std::atomic<unsigned> m_rooms;
+    // Nanoseconds the accepting thread spent on a CPU
+    std::atomic<std::uint64_t> m_acceptCpu;
+    std::atomic<bool> m_stop;
+
+    void Accept(int epoll, std::vector<std::unique_ptr<Connection>> &waiting);
+    Server(const Server&);
+};
+
+
+#endif
@@ -0,0 +1,49 @@
+/**
+ *  @file   StrokeCodec.hpp
+ *  @brief  Compact binary encoding of brush strokes.
+ *  @author Team Avengers
+ *  @date   2020-12-12
+ ***********************************************/
+#ifndef STROKE_CODEC_HPP
+#define STROKE_CODEC_HPP
+
+// Include our Third-Party SFML header
+#include <SFML/Graphics/Color.hpp>
+#include <SFML/System/Vector2.hpp>
+// Include standard library C++ libraries.
+#include <cstddef>
+#include <cstdint>
+// Project header files
+// #include ...
+
+// Version byte at the start of every encoded stroke
+const std::uint8_t STROKE_VERSION = 1;
+
+// What every sample of a stroke has in common.
+struct StrokeHeader{
+    sf::Color color;
+    unsigned  layer;
+    sf::Uint8 brushSize;
+};
+
+// A stroke is a run of draws with one color on one layer. It is encoded as
+//
+//   version, flags, color (4 bytes), brush size, layer (varint),
+//   sample count (varint), first x and y (zigzag varints),
+//   then for every further sample dx and dy (zigzag varints),
+//   then one coverage byte per sample if flags has STROKE_COVERAGE.
+//
+// Samples of a stroke are next to each other, so most deltas fit in one
+// byte each and a sample takes 2 bytes instead of the 10 of a serialized
+// Draw. Coverage is only written when part of the stroke is outside a
+// soft selection edge.
+//
+// Both directions work on buffers the caller owns and never allocate.
+std::size_t GetMaxStrokeSize(std::size_t samples);
+std::size_t EncodeStroke(const StrokeHeader &header, const sf::Vector2i* points, const sf::Uint8* coverage,
+                         std::size_t samples, std::uint8_t* out, std::size_t capacity);
+std::size_t DecodeStroke(const std::uint8_t* in, std::size_t size, StrokeHeader &header,
+                         sf::Vector2i* points, sf::Uint8* coverage, std::size_t capacity, std::size_t &samples);
+
+
+#endif
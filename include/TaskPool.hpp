@@ -0,0 +1,118 @@
+/**
+ *  @file   TaskPool.hpp
+ *  @brief  Work-stealing worker threads for filters, compositing and I/O.
+ *  @author Team Avengers
+ *  @date   2020-12-16
+ ***********************************************/
+#ifndef TASK_POOL_HPP
+#define TASK_POOL_HPP
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+// Project header files
+// #include ...
+
+typedef std::chrono::steady_clock TaskClock;
+
+// Which queue a task waits in.
+enum TaskLane{
+    TASK_FRAME,         // work a frame waits for: filters, compositing
+    TASK_BACKGROUND     // saves, loads and compression nobody waits for
+};
+
+class TaskPool;
+
+// Tasks submitted together, waited for together.
+//
+// A group may have a deadline. Tasks of the group that have not started
+// when the deadline passes are skipped, so a frame can hand out more work
+// than it has time for and pick up the rest on the next frame.
+class TaskGroup{
+public:
+    explicit TaskGroup(TaskLane lane = TASK_FRAME, TaskClock::time_point deadline = TaskClock::time_point::max());
+    ~TaskGroup();
+
+    bool IsDone() const;
+    unsigned GetSkipped() const;
+
+private:
+    friend class TaskPool;
+    TaskLane m_lane;
+    TaskClock::time_point m_deadline;
+    // Pool the tasks went to, waited on by the destructor
+    TaskPool* m_pool;
+    std::atomic<unsigned> m_pending;
+    std::atomic<unsigned> m_skipped;
+
+    TaskGroup(const TaskGroup&);
+};
+
+// Worker threads owned by the App.
+//
+// Every worker has its own deque of frame tasks. It takes the newest task
+// of its own deque and steals the oldest task of another deque when its own
+// runs dry. Background tasks wait in one shared queue and only run when
+// there is no frame task. They never take more than all but one of the
+// workers, so one long save can not hold up the compositing of a frame.
+// A thread that waits for a group runs frame tasks in the meantime.
+//
+// A pool started with no threads runs every task right in Submit().
+class TaskPool{
+public:
+    // Start one worker per core but one, the main thread helps out
+    static const unsigned AUTO_THREADS = ~0u;
+
+    TaskPool();
+    ~TaskPool();
+
+    void Start(unsigned threads = AUTO_THREADS);
+    void Stop();
+    void Submit(TaskGroup &group, std::function<void()> task);
+    void Wait(TaskGroup &group);
+    unsigned GetThreadCount() const;
+
+private:
+    struct Task{
+        std::function<void()> work;
+        TaskGroup* group;
+    };
+    // One worker thread and the frame tasks queued on it
+    struct Worker{
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    // Frame tasks queued on all workers together
+    std::atomic<unsigned> m_queued;
+    // Worker that gets the next task submitted from outside the pool
+    std::atomic<unsigned> m_next;
+    // Guards the background queue and the sleeping of the workers
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    std::deque<Task> m_background;
+    unsigned m_backgroundRunning;
+    unsigned m_backgroundLimit;
+    bool m_stop;
+
+    bool TakeFrameTask(unsigned worker, Task &task);
+    bool TakeBackgroundTask(Task &task);
+    void Run(Task &task);
+    void Work(unsigned worker);
+    TaskPool(const TaskPool&);
+};
+
+
+#endif
@@ -0,0 +1,79 @@
+/**
+ *  @file   TextureStreamer.hpp
+ *  @brief  Tile uploads to the canvas texture through pixel buffer objects.
+ *  @author Team Avengers
+ *  @date   2020-12-17
+ ***********************************************/
+#ifndef TEXTURE_STREAMER_HPP
+#define TEXTURE_STREAMER_HPP
+
+// Include our Third-Party SFML header
+#include <SFML/Graphics/Texture.hpp>
+// Include standard library C++ libraries.
+#include <cstdint>
+#include <vector>
+// Project header files
+#include "TaskPool.hpp"
+#include "TiledImage.hpp"
+
+// Sends the tiles that changed to the canvas texture.
+//
+// sf::Texture::update() copies the pixels out of our memory on the render
+// thread before it returns. Where the GL has persistently mapped buffers
+// (GL 4.4 or ARB_buffer_storage) and fences (GL 3.2 or ARB_sync), the
+// workers write the tiles into a ring of pixel buffer objects instead,
+// and the render thread only issues the copies from a buffer to the
+// texture. A fence after the copies of a buffer tells when the buffer can
+// be written again. While the render thread issues the copies of one
+// buffer, the workers already fill the next one.
+//
+// Mesa's software GL has both extensions, so the buffers are used on
+// machines without a GPU as well. Without them, before Init(), without a
+// current context or with FSD_NO_PBO set in the environment, the tiles
+// go through sf::Texture::update() one by one.
+//
+// Everything but the filling of the buffers runs on the thread the GL
+// context is current on.
+class TextureStreamer{
+public:
+    // Buffers in the ring, and the tiles one buffer holds
+    static const unsigned RING_SIZE = 3;
+    static const unsigned SLOT_TILES = 64;
+
+    explicit TextureStreamer(TaskPool &tasks);
+    ~TextureStreamer();
+
+    bool Init();
+    void Release();
+    bool IsStreaming() const;
+    void Upload(sf::Texture &texture, const TiledImage &image, const std::vector<unsigned> &tiles);
+    std::uint64_t GetStalls() const;
+
+private:
+    // GL entry points newer than the GL headers
+    struct Functions;
+    // One buffer of the ring, mapped for as long as it exists
+    struct Slot{
+        unsigned buffer;
+        sf::Uint8* mapping;
+        // Of the copies out of the buffer, null once they are done
+        void* fence;
+    };
+
+    TaskPool& m_tasks;
+    Functions* m_gl;
+    Slot m_slots[RING_SIZE];
+    // Slot filled next
+    unsigned m_next;
+    // Times a buffer was still being copied from when it was needed again
+    std::uint64_t m_stalls;
+
+    void UploadDirect(sf::Texture &texture, const TiledImage &image, const std::vector<unsigned> &tiles);
+    void WaitForSlot(Slot &slot);
+    void Fill(TaskGroup &group, Slot &slot, const TiledImage &image, const unsigned* tiles, unsigned count);
+    void Issue(Slot &slot, const TiledImage &image, const unsigned* tiles, unsigned count);
+    TextureStreamer(const TextureStreamer&);
+};
+
+
+#endif
@@ -0,0 +1,68 @@
+/**
+ *  @file   TiledImage.hpp
+ *  @brief  Tiled, copy-on-write pixel storage for canvas layers.
+ *  @author Team Avengers
+ *  @date   2020-11-30
+ ***********************************************/
+#ifndef TILED_IMAGE_HPP
+#define TILED_IMAGE_HPP
+
+// Include our Third-Party SFML header
+#include <SFML/Graphics/Color.hpp>
+// Include standard library C++ libraries.
+#include <cstdint>
+#include <memory>
+#include <vector>
+// Project header files
+// #include ...
+
+// Side length in pixels of one square tile.
+static const unsigned TILE_SIZE = 64;
+// Number of bytes in one RGBA8 tile.
+static const unsigned TILE_BYTES = TILE_SIZE * TILE_SIZE * 4;
+
+// A tile is a block of TILE_BYTES bytes. Tiles are shared between
+// images and only copied when somebody writes to a shared one.
+typedef std::shared_ptr<sf::Uint8> TilePtr;
+
+// An image split into TILE_SIZE x TILE_SIZE tiles of premultiplied RGBA8.
+// A null tile is fully transparent and costs no memory.
+// Copying a TiledImage only copies tile pointers, which makes
+// snapshots for undo cheap.
+class TiledImage{
+public:
+    TiledImage();
+    TiledImage(unsigned width, unsigned height);
+
+    unsigned GetWidth() const;
+    unsigned GetHeight() const;
+    unsigned GetTilesX() const;
+    unsigned GetTilesY() const;
+    unsigned GetTileCount() const;
+    unsigned TileIndex(unsigned x, unsigned y) const;
+
+    const sf::Uint8* GetTile(unsigned index) const;
+    sf::Uint8* GetMutableTile(unsigned index);
+    TilePtr GetTilePtr(unsigned index) const;
+    void SetTilePtr(unsigned index, const TilePtr &tile);
+
+    sf::Color GetPixel(unsigned x, unsigned y) const;
+    void SetPixel(unsigned x, unsigned y, const sf::Color &premultiplied);
+    void Fill(const sf::Color &premultiplied);
+    bool SameTiles(const TiledImage &rhs) const;
+
+    static std::uint64_t HashTile(const sf::Uint8* pixels);
+    static TilePtr AllocateTile();
+    static sf::Color Premultiply(const sf::Color &color);
+    static sf::Color Unpremultiply(const sf::Color &color);
+
+private:
+    unsigned m_width;
+    unsigned m_height;
+    unsigned m_tilesX;
+    unsigned m_tilesY;
+    std::vector<TilePtr> m_tiles;
+};
+
+
+#endif
@@ -0,0 +1,78 @@
+/**
+ *  @file   Trace.hpp
+ *  @brief  Capture of what every thread does, for chrome://tracing.
+ *  @author Team Avengers
+ *  @date   2020-12-14
+ ***********************************************/
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+// Project header files
+// #include ...
+
+// Trace written when the capture is started from the toolbar
+const char* const DEFAULT_TRACE_PATH = "fsd-trace.json";
+
+// Writes a Chrome trace-event file of the scopes every thread ran while
+// the capture was on. It opens in chrome://tracing and in Perfetto.
+//
+// Every thread puts its events in its own ring, which only it writes
+// and only the flushing thread reads, so recording an event takes no
+// lock. The flushing thread empties the rings into the file every
+// FLUSH_MS. Events that do not fit in a full ring are dropped and
+// counted. While the capture is off, a scope only loads a flag.
+//
+// Setting the environment variable FSD_TRACE to a file name captures
+// the whole run into it.
+class Trace{
+public:
+    // Milliseconds between two flushes
+    static const unsigned FLUSH_MS = 100;
+
+    static bool IsCapturing(){
+        return s_capturing.load(std::memory_order_relaxed);
+    }
+    static bool Start(const std::string &path);
+    static void StartFromEnvironment();
+    static void Stop();
+    static const std::string& GetStatus();
+
+    static void NameThread(const char* name);
+    static void Add(const char* name, std::chrono::steady_clock::time_point start,
+                    std::chrono::steady_clock::time_point end);
+
+private:
+    static std::atomic<bool> s_capturing;
+};
+
+// Records the time from its construction to its destruction as an event
+// of the calling thread. 'name' must outlive the capture.
+class TraceScope{
+public:
+    explicit TraceScope(const char* name): m_name(name), m_active(Trace::IsCapturing()){
+        if (m_active){
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+    ~TraceScope(){
+        if (m_active){
+            Trace::Add(m_name, m_start, std::chrono::steady_clock::now());
+        }
+    }
+
+private:
+    const char* m_name;
+    bool        m_active;
+    std::chrono::steady_clock::time_point m_start;
+    TraceScope(const TraceScope&);
+};
+
+
+#endif
@@ -15,11 +15,30 @@
 
 #include <SFML/Window.hpp>
 
+/* The default font as it comes out of baking: the RGBA32 atlas and the
+ * glyph tables needed to set the font up again without baking it. */
+struct nk_sfml_baked_atlas {
+    const void* pixels;
+    int width;
+    int height;
+    const void* tables;
+    nk_size tables_size;
+};
+
+#ifdef NK_INCLUDE_DEFAULT_ALLOCATOR
 NK_API struct nk_context*   nk_sfml_init(sf::Window* window);
+#endif
+NK_API struct nk_context*   nk_sfml_init_fixed(sf::Window* window, const struct nk_allocator* permanent,
+                                               const struct nk_allocator* frame, nk_size context_size,
+                                               nk_size command_size);
 NK_API void                 nk_sfml_font_stash_begin(struct nk_font_atlas** atlas);
 NK_API void                 nk_sfml_font_stash_end(void);
+NK_API void                 nk_sfml_font_stash_end_baked(struct nk_sfml_baked_atlas* baked);
+NK_API int                  nk_sfml_font_stash_load(const struct nk_sfml_baked_atlas* baked);
 NK_API int                  nk_sfml_handle_event(sf::Event* event);
+NK_API int                  nk_sfml_input_event(struct nk_context* ctx, const sf::Event* event);
 NK_API void                 nk_sfml_render(enum nk_anti_aliasing);
+NK_API void                 nk_sfml_memory_peak(nk_size* context, nk_size* commands);
 NK_API void                 nk_sfml_shutdown(void);
 
 #endif
@@ -36,6 +55,31 @@ struct nk_sfml_device {
     struct nk_buffer cmds;
     struct nk_draw_null_texture null;
     GLuint font_tex;
+    /* allocator of the context, command buffer and fonts, and of what only
+     * lives for one frame: the vertex and element buffers and the memory
+     * used while baking fonts */
+    struct nk_allocator permanent_alloc;
+    struct nk_allocator frame_alloc;
+    int has_alloc;
+    /* bytes the vertex and element buffers needed last time, so they do
+     * not grow */
+    nk_size vbuf_needed;
+    nk_size ebuf_needed;
+    /* most bytes the context and command buffer were asked for */
+    nk_size context_peak;
+    nk_size commands_peak;
+};
+
+/* Glyph tables of a baked atlas, followed by glyph_count glyphs. Only
+ * atlases of the default font with its default ranges are kept. */
+struct nk_sfml_font_tables {
+    int glyph_count;
+    int glyph_size;
+    float size;
+    nk_rune fallback;
+    struct nk_baked_font info;
+    struct nk_recti custom;
+    struct nk_cursor cursors[NK_CURSOR_COUNT];
 };
 
 struct nk_sfml_vertex {
@@ -127,9 +171,21 @@ nk_sfml_render(enum nk_anti_aliasing AA)
         config.line_AA = AA;
 
         /* convert shapes into vertices */
-        nk_buffer_init_default(&vbuf);
-        nk_buffer_init_default(&ebuf);
+#ifdef NK_INCLUDE_DEFAULT_ALLOCATOR
+        if (!dev->has_alloc) {
+            nk_buffer_init_default(&vbuf);
+            nk_buffer_init_default(&ebuf);
+        } else
+#endif
+        {
+            nk_buffer_init(&vbuf, &dev->frame_alloc, NK_MAX(dev->vbuf_needed, (nk_size)NK_BUFFER_DEFAULT_INITIAL_SIZE));
+            nk_buffer_init(&ebuf, &dev->frame_alloc, NK_MAX(dev->ebuf_needed, (nk_size)NK_BUFFER_DEFAULT_INITIAL_SIZE));
+        }
         nk_convert(&sfml.ctx, &dev->cmds, &vbuf, &ebuf, &config);
+        dev->vbuf_needed = vbuf.needed;
+        dev->ebuf_needed = ebuf.needed;
+        dev->context_peak = NK_MAX(dev->context_peak, sfml.ctx.memory.needed);
+        dev->commands_peak = NK_MAX(dev->commands_peak, dev->cmds.needed);
 
         /* setup vertex buffer pointer */
         const void* vertices = nk_buffer_memory_const(&vbuf);
@@ -210,6 +266,7 @@ nk_sfml_clipboard_copy(nk_handle usr, const char* text, int len)
 #endif
 }
 
+#ifdef NK_INCLUDE_DEFAULT_ALLOCATOR
 NK_API struct nk_context*
 nk_sfml_init(sf::Window* window)
 {
@@ -221,25 +278,158 @@ nk_sfml_init(sf::Window* window)
     nk_buffer_init_default(&sfml.ogl.cmds);
     return &sfml.ctx;
 }
+#endif
+
+/* The context and the command buffer get one fixed block each from the
+ * permanent allocator and never grow. Fonts are kept in permanent memory
+ * as well, the frame allocator is only asked for memory that is not
+ * needed after the frame. */
+NK_API struct nk_context*
+nk_sfml_init_fixed(sf::Window* window, const struct nk_allocator* permanent,
+                   const struct nk_allocator* frame, nk_size context_size, nk_size command_size)
+{
+    struct nk_sfml_device* dev = &sfml.ogl;
+    void* context_memory = permanent->alloc(permanent->userdata, 0, context_size);
+    void* command_memory = permanent->alloc(permanent->userdata, 0, command_size);
+    if (!context_memory || !command_memory) return 0;
+    sfml.window = window;
+    dev->permanent_alloc = *permanent;
+    dev->frame_alloc = *frame;
+    dev->has_alloc = 1;
+    nk_init_fixed(&sfml.ctx, context_memory, context_size, 0);
+    sfml.ctx.clip.copy = nk_sfml_clipboard_copy;
+    sfml.ctx.clip.paste = nk_sfml_clipboard_paste;
+    sfml.ctx.clip.userdata = nk_handle_ptr(0);
+    nk_buffer_init_fixed(&dev->cmds, command_memory, command_size);
+    return &sfml.ctx;
+}
+
+NK_API void
+nk_sfml_memory_peak(nk_size* context, nk_size* commands)
+{
+    *context = sfml.ogl.context_peak;
+    *commands = sfml.ogl.commands_peak;
+}
 
 NK_API void
 nk_sfml_font_stash_begin(struct nk_font_atlas** atlas)
 {
-    nk_font_atlas_init_default(&sfml.atlas);
+#ifdef NK_INCLUDE_DEFAULT_ALLOCATOR
+    if (!sfml.ogl.has_alloc)
+        nk_font_atlas_init_default(&sfml.atlas);
+    else
+#endif
+    nk_font_atlas_init_custom(&sfml.atlas, &sfml.ogl.permanent_alloc, &sfml.ogl.frame_alloc);
     nk_font_atlas_begin(&sfml.atlas);
     *atlas = &sfml.atlas;
 }
 
 NK_API void
 nk_sfml_font_stash_end()
+{
+    nk_sfml_font_stash_end_baked(NULL);
+}
+
+/* Bake like nk_sfml_font_stash_end() and hand out what was baked, to be
+ * cached. The pixels and tables come from the frame allocator, so they
+ * are only there until the frame ends, and only after nk_sfml_init_fixed. */
+NK_API void
+nk_sfml_font_stash_end_baked(struct nk_sfml_baked_atlas* baked)
 {
     int w, h;
     const void* img;
-    img = nk_font_atlas_bake(&sfml.atlas, &w, &h, NK_FONT_ATLAS_RGBA32);
+    struct nk_font_atlas* atlas = &sfml.atlas;
+    img = nk_font_atlas_bake(atlas, &w, &h, NK_FONT_ATLAS_RGBA32);
     nk_sfml_device_upload_atlas(img, w, h);
-    nk_font_atlas_end(&sfml.atlas, nk_handle_id((int)sfml.ogl.font_tex), &sfml.ogl.null);
-    if(sfml.atlas.default_font)
-        nk_style_set_font(&sfml.ctx, &sfml.atlas.default_font->handle);
+    if (baked) {
+        NK_MEMSET(baked, 0, sizeof(*baked));
+        if (img && sfml.ogl.has_alloc && atlas->font_num == 1) {
+            nk_size size = sizeof(struct nk_sfml_font_tables) +
+                sizeof(struct nk_font_glyph) * (nk_size)atlas->glyph_count;
+            struct nk_sfml_font_tables* tables = (struct nk_sfml_font_tables*)
+                atlas->temporary.alloc(atlas->temporary.userdata, 0, size);
+            if (tables) {
+                NK_MEMSET(tables, 0, sizeof(*tables));
+                tables->glyph_count = atlas->glyph_count;
+                tables->glyph_size = (int)sizeof(struct nk_font_glyph);
+                tables->size = atlas->config->size;
+                tables->fallback = atlas->config->fallback_glyph;
+                tables->info = atlas->fonts->info;
+                tables->info.ranges = 0;
+                tables->custom = atlas->custom;
+                NK_MEMCPY(tables->cursors, atlas->cursors, sizeof(atlas->cursors));
+                NK_MEMCPY(tables + 1, atlas->glyphs, sizeof(struct nk_font_glyph) * (nk_size)atlas->glyph_count);
+                baked->pixels = img;
+                baked->width = w;
+                baked->height = h;
+                baked->tables = tables;
+                baked->tables_size = size;
+            }
+        }
+    }
+    nk_font_atlas_end(atlas, nk_handle_id((int)sfml.ogl.font_tex), &sfml.ogl.null);
+    if(atlas->default_font)
+        nk_style_set_font(&sfml.ctx, &atlas->default_font->handle);
+}
+
+/* Set up the default font from an atlas baked before, in place of
+ * nk_sfml_font_stash_begin() and nk_sfml_font_stash_end(). Only after
+ * nk_sfml_init_fixed. Returns 0 if the tables do not fit this build. */
+NK_API int
+nk_sfml_font_stash_load(const struct nk_sfml_baked_atlas* baked)
+{
+    struct nk_sfml_device* dev = &sfml.ogl;
+    struct nk_font_atlas* atlas = &sfml.atlas;
+    struct nk_allocator* permanent = &dev->permanent_alloc;
+    struct nk_sfml_font_tables tables;
+    const nk_rune* ranges = nk_font_default_glyph_ranges();
+    struct nk_font_config* cfg;
+    struct nk_font* font;
+    nk_size glyph_bytes;
+
+    if (!dev->has_alloc || !baked->pixels || baked->tables_size < sizeof(tables)) return 0;
+    NK_MEMCPY(&tables, baked->tables, sizeof(tables));
+    glyph_bytes = sizeof(struct nk_font_glyph) * (nk_size)tables.glyph_count;
+    if (tables.glyph_size != (int)sizeof(struct nk_font_glyph) ||
+        tables.glyph_count != nk_range_glyph_count(ranges, nk_range_count(ranges)) ||
+        baked->tables_size != sizeof(tables) + glyph_bytes ||
+        tables.custom.x + tables.custom.w > baked->width || tables.custom.y + tables.custom.h > baked->height)
+        return 0;
+
+    nk_font_atlas_init_custom(atlas, permanent, &dev->frame_alloc);
+    cfg = (struct nk_font_config*)permanent->alloc(permanent->userdata, 0, sizeof(struct nk_font_config));
+    font = (struct nk_font*)permanent->alloc(permanent->userdata, 0, sizeof(struct nk_font));
+    atlas->glyphs = (struct nk_font_glyph*)permanent->alloc(permanent->userdata, 0, glyph_bytes);
+    if (!cfg || !font || !atlas->glyphs) return 0;
+
+    /* the same font and config nk_font_atlas_add() sets up, without the
+     * TTF data that is only needed for baking */
+    *cfg = nk_font_config(tables.size);
+    cfg->range = ranges;
+    cfg->fallback_glyph = tables.fallback;
+    cfg->n = cfg;
+    cfg->p = cfg;
+    cfg->next = 0;
+    nk_zero(font, sizeof(*font));
+    font->config = cfg;
+    cfg->font = &font->info;
+    NK_MEMCPY(atlas->glyphs, (const struct nk_sfml_font_tables*)baked->tables + 1, glyph_bytes);
+    atlas->glyph_count = tables.glyph_count;
+    atlas->config = cfg;
+    atlas->fonts = font;
+    atlas->default_font = font;
+    atlas->font_num = 1;
+    atlas->custom = tables.custom;
+    NK_MEMCPY(atlas->cursors, tables.cursors, sizeof(atlas->cursors));
+    atlas->tex_width = baked->width;
+    atlas->tex_height = baked->height;
+    tables.info.ranges = ranges;
+    nk_font_init(font, cfg->size, cfg->fallback_glyph, atlas->glyphs, &tables.info, nk_handle_ptr(0));
+
+    nk_sfml_device_upload_atlas(baked->pixels, baked->width, baked->height);
+    nk_font_atlas_end(atlas, nk_handle_id((int)dev->font_tex), &dev->null);
+    nk_style_set_font(&sfml.ctx, &font->handle);
+    return 1;
 }
 
 NK_API int
@@ -255,6 +445,13 @@ nk_sfml_handle_event(sf::Event* evt)
         sf::Mouse::setPosition(sf::Vector2i(x, y), *sfml.window);
         ctx->input.mouse.ungrab = 0;
     }
+    return nk_sfml_input_event(ctx, evt);
+}
+
+/* Hand an event to any context, with or without a window. */
+NK_API int
+nk_sfml_input_event(struct nk_context* ctx, const sf::Event* evt)
+{
     if(evt->type == sf::Event::KeyReleased || evt->type == sf::Event::KeyPressed)
     {
         int down = evt->type == sf::Event::KeyPressed;
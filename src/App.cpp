@@ -11,18 +11,32 @@
 #include <SFML/Graphics/Texture.hpp>
 #include <SFML/Graphics/Sprite.hpp>
 // Include standard library C++ libraries.
+#include <algorithm>
 #include <cassert>
+#include <chrono>
 // Project header files
 #include "App.hpp"
 #include "Draw.hpp"
+#include "ImportCommand.hpp"
+#include "Profiler.hpp"
+#include "RevertCommand.hpp"
 #include <iostream>
 
+// Journal of the running session, removed again on a clean exit
+static const char* const JOURNAL_PATH = "fsd.journal";
+// Time a frame spends compositing before the rest waits for the next frame
+static const std::chrono::milliseconds COMPOSITE_BUDGET(8);
+
 
 /*! \brief Constructor for App class
 	\param m_initFunc(nullptr) function pointer to initialization in main.cpp
 */
-App::App(): m_window(nullptr), m_image(new sf::Image), m_sprite(new sf::Sprite),
-m_texture(new sf::Texture), m_initFunc(nullptr), m_updateFunc(nullptr), m_drawFunc(nullptr),
+App::App(): m_window(nullptr), m_document(nullptr), m_selection(nullptr),
+m_selectionOutline(new sf::RectangleShape), m_cursorShape(new sf::CircleShape(5)), m_tool(TOOL_BRUSH), m_tasks(new TaskPool),
+m_canvasTask(nullptr), m_exporter(new ImageExporter(*m_tasks)), m_importer(new ImageImporter(*m_tasks)), m_journal(new Journal), m_journalPath(JOURNAL_PATH), m_keepJournal(false),
+m_headless(false), m_network(new NetworkClient), m_sprite(new sf::Sprite),
+m_texture(new sf::Texture), m_streamer(new TextureStreamer(*m_tasks)), m_frameArena(new FrameArena), m_frameAllocationsStart(GetHeapAllocations()),
+m_frameAllocations(0), m_latency(new LatencyTracker), m_initFunc(nullptr), m_updateFunc(nullptr), m_drawFunc(nullptr),
 windowWidth(600), windowHeight(400), m_numUndos(10), m_currentColor(sf::Color::Black),
  m_backgroundColor(sf::Color::White)
 {
@@ -89,6 +103,10 @@ int App::GetWindowHeight(){
 void App::AddCommand(std::shared_ptr<Command> c){
     // add command if it doesn't already exist
     if (!commandExists(c)){
+        // made by the input being handled, unless it was stamped already
+        if (c->GetInputTime() == InputClock::time_point()){
+            c->SetInputTime(m_inputTime);
+        }
         // add to command deque
         m_commands.push_back(c);
     }
@@ -105,27 +123,64 @@ void App::AddUndo(std::shared_ptr<Command> c){
     }
 }
 
-/*! \brief Undo the most recent command
+/*! \brief Undo the most recent command. On a shared canvas only what
+*		this user drew goes back, and only where nobody drew over it.
 */
 void App::Undo(){
+    ProfileScope profile(PROFILE_COMMANDS);
     if (m_undo.size() > 0){
         std::cout << "Called undo" << std::endl;
         std::shared_ptr<Command> command = m_undo.front();
+        bool shared = m_network->IsConnected();
+        if (!shared){
+            command->undo();
+        } else if (!m_network->Undo(command)){
+            // Drawn before joining, the others have it as part of the canvas.
+            // It stays on the stack, to be undone once disconnected
+            std::cout << "Can not undo what was drawn before connecting" << std::endl;
+            return;
+        }
         m_undo.pop_front();
-        command->undo();
         m_redo.push(command);
+        if (shared){
+            m_journal->LogRevert(*command, 0);
+        } else{
+            m_journal->LogUndo();
+        }
+        NoteInput(m_inputTime);
+    }
+}
+
+/*! \brief Undo the most recent command the way a shared canvas does, only
+*		where nobody drew over it. Replays an undo made while connected.
+	\param command command to take back
+	\return false if it is not the most recent command
+*/
+bool App::Revert(const std::shared_ptr<Command> &command){
+    if (m_undo.empty() || m_undo.front() != command){
+        return false;
     }
+    command->revert();
+    m_undo.pop_front();
+    m_redo.push(command);
+    m_journal->LogRevert(*command, 0);
+    return true;
 }
 
 /*! \brief Redo the last command that was undone.
 */
 void App::Redo(){
+    ProfileScope profile(PROFILE_COMMANDS);
     if (m_redo.size() > 0){
         std::cout << "Called redo" << std::endl;
         std::shared_ptr<Command> command = m_redo.top();
         m_redo.pop();
         command->execute();
         m_undo.push_front(command);
+        m_journal->LogRedo();
+        // The others see it as a new command
+        m_network->Queue(command);
+        NoteInput(m_inputTime);
     }
 }
 
@@ -134,6 +189,7 @@ void App::Redo(){
 *
 */
 void App::ExecuteCommand(){
+    ProfileScope profile(PROFILE_COMMANDS);
     if (m_commands.size() > 0){
         std::shared_ptr<Command> command = m_commands.front();
         bool success = command->execute();
@@ -144,12 +200,82 @@ void App::ExecuteCommand(){
                 m_redo.pop();
             }
             AddUndo(command);
+            m_journal->LogCommand(*command);
+            m_network->Queue(command);
+            NoteInput(command->GetInputTime());
         }
         m_commands.pop_front();
 
     }
 }
 
+/*! \brief 	Start timing an input whose command or undo was executed, until
+*		the frame that shows it. A headless app shows nothing, so
+*		nothing is timed.
+	\param input when the input was polled, default constructed if it
+	*		did not come from input
+*/
+void App::NoteInput(InputClock::time_point input){
+    if (!m_headless && input != InputClock::time_point()){
+        m_latency->Executed(input);
+    }
+}
+
+/*! \brief 	Execute a command right away, even if it is the same as the
+*		last one. Used to replay the journal.
+	\param c command object to execute
+*/
+void App::RunCommand(std::shared_ptr<Command> c){
+    m_commands.push_front(c);
+    ExecuteCommand();
+}
+
+/*! \brief 	Execute a command another user drew on the server. It is
+*		journaled as a remote command and does not go on the undo
+*		stack, so undo only takes back what this user did.
+	\param c command object to execute
+	\param user user who drew it
+*/
+void App::ApplyRemoteCommand(std::shared_ptr<Command> c, unsigned user){
+    if (!c->execute()){
+        return;
+    }
+    if (c->GetType() == COMMAND_REVERT){
+        m_journal->LogRevert(*static_cast<RevertCommand&>(*c).GetTarget(), user);
+    } else{
+        m_journal->LogRemoteCommand(*c, user);
+    }
+}
+
+/*! \brief 	Change the settings of a layer. Layer settings are not
+*		undoable, but they are journaled when they change.
+	\param id layer to change
+	\param opacity opacity of the layer
+	\param visible if the layer is shown
+	\param mode how the layer blends with the layers below it
+*/
+void App::SetLayerSettings(unsigned id, sf::Uint8 opacity, bool visible, BlendMode mode){
+    std::shared_ptr<Layer> layer = GetLayers().FindLayer(id);
+    if (!layer || (layer->GetOpacity() == opacity && layer->IsVisible() == visible && layer->GetBlendMode() == mode)){
+        return;
+    }
+    GetLayers().SetOpacity(id, opacity);
+    GetLayers().SetVisible(id, visible);
+    GetLayers().SetBlendMode(id, mode);
+    m_journal->LogLayer(id, opacity, visible, mode);
+}
+
+/*! \brief 	Make another layer the one that is drawn on.
+	\param id layer to activate
+*/
+void App::SetActiveLayer(unsigned id){
+    if (id == GetLayers().GetActiveId() || !GetLayers().FindLayer(id)){
+        return;
+    }
+    GetLayers().SetActive(id);
+    m_journal->LogActive(id);
+}
+
 /*! \brief Return the most recent command put in the queue.
 	\return the command that was last added
 */
@@ -157,12 +283,12 @@ const std::shared_ptr<Command> App::GetLastCommand(){
     return m_lastcommand;
 }
 
-/*! \brief 	Return a reference to our m_image, so that
+/*! \brief 	Return a reference to the layers of m_document, so that
 *		we do not have to publicly expose it.
-	\return Pointer to image
+	\return Reference to the layer stack
 */
-sf::Image& App::GetImage(){
-	return *m_image;
+LayerStack& App::GetLayers(){
+	return m_document->GetLayers();
 }
 
 /*! \brief 	Return a reference to our m_Texture so that
@@ -173,6 +299,200 @@ sf::Texture& App::GetTexture(){
 	return *m_texture;
 }
 
+/*! \brief 	Get what sends the changed tiles to the texture.
+*/
+TextureStreamer& App::GetTextureStreamer(){
+	return *m_streamer;
+}
+
+/*! \brief 	Return a reference to our m_selection, so that
+*		we do not have to publicly expose it.
+	\return Reference to the selection
+*/
+SelectionMask& App::GetSelection(){
+	return *m_selection;
+}
+
+/*! \brief 	Get a copy of the selection that never changes. Commands keep
+*		the selection they were made with, and all the commands made
+*		until the selection changes share one copy.
+	\return The copy, made again only if the selection changed since
+*/
+std::shared_ptr<const SelectionMask> App::GetSelectionSnapshot(){
+	if (!m_selectionSnapshot || m_selectionSnapshot->GetVersion() != m_selection->GetVersion()){
+		m_selectionSnapshot = std::make_shared<const SelectionMask>(*m_selection);
+	}
+	return m_selectionSnapshot;
+}
+
+/*! \brief Get the tool used when the mouse is pressed on the canvas.
+*/
+Tool App::GetTool(){
+	return m_tool;
+}
+
+/*! \brief Change the tool used when the mouse is pressed on the canvas.
+	\param tool new tool
+*/
+void App::SetTool(Tool tool){
+	m_tool = tool;
+}
+
+/*! \brief 	Composite the layers and upload only the tiles that changed
+*		since the last call to the texture. A headless app only
+*		composites. With a window, tiles that do not fit in the
+*		frame's budget are composited on the next frame. The
+*		tiles reach the texture through the TextureStreamer.
+*
+*/
+void App::UpdateTexture(){
+	TaskClock::time_point deadline = m_headless ? TaskClock::time_point::max() : TaskClock::now() + COMPOSITE_BUDGET;
+	const TiledImage &flattened = GetLayers().Flatten(&m_updatedTiles, m_tasks, deadline);
+	if (!m_headless){
+		m_streamer->Upload(*m_texture, flattened, m_updatedTiles);
+	}
+	m_updatedTiles.clear();
+	// The inputs executed so far are in the texture once no tile was
+	// left for the next frame
+	m_latency->Uploaded(!GetLayers().HasDirtyTiles());
+}
+
+/*! \brief 	Save the canvas as it is shown on screen.
+*		The file is written on a background thread, so this returns
+*		right away and painting can go on in the meantime.
+	\param path file to write
+	\param format file format
+	\return false if another save is still running
+*/
+bool App::Export(const std::string &path, ExportFormat format){
+	// Bring the flattened image up to date. The tiles this recomposites
+	// stay queued for the next texture upload.
+	const TiledImage &flattened = GetLayers().Flatten(&m_updatedTiles, m_tasks);
+	return m_exporter->Start(flattened, path, format);
+}
+
+/*! \brief 	Open an image as a new layer on top of the stack.
+*		The file is decoded in the background and shows up on the
+*		canvas a row of tiles at a time. Several files can be
+*		loading at once. It is a command like any other edit, so
+*		undo removes the layer again.
+	\param path file to open
+*/
+void App::Import(const std::string &path){
+	AddCommand(std::make_shared<ImportCommand>("import", path, *this));
+	ExecuteCommand();
+}
+
+/*! \brief 	Save the document to a project file. Saving again to
+*		the same file only appends what changed since the last save.
+	\param path project file to write
+	\return true if the save is complete
+*/
+bool App::SaveProject(const std::string &path){
+	bool saved = m_document->Save(path);
+	std::cout << m_document->GetStatus() << std::endl;
+	if (saved){
+		// Everything so far is in the project file now
+		m_journal->Restart(path);
+	}
+	return saved;
+}
+
+/*! \brief 	Open a project file in place of the current canvas.
+*		The history belongs to the old layers, so it is dropped.
+	\param path project file to open
+	\return true if the file was opened
+*/
+bool App::OpenProject(const std::string &path){
+	// Images that are still loading go into the old layers first
+	m_importer->Wait();
+	m_importer->Poll(GetLayers());
+	if (!m_document->Open(path)){
+		std::cout << m_document->GetStatus() << std::endl;
+		return false;
+	}
+	std::cout << m_document->GetStatus() << std::endl;
+	m_commands.clear();
+	m_undo.clear();
+	while (m_redo.size() > 0){
+		m_redo.pop();
+	}
+	m_lastcommand.reset();
+	ResetCanvas();
+	m_journal->Restart(path);
+	return true;
+}
+
+/*! \brief 	Return a reference to our m_network, so that
+*		the GUI can connect to a server.
+	\return Reference to the network client
+*/
+NetworkClient& App::GetNetwork(){
+	return *m_network;
+}
+
+/*! \brief 	Return a reference to the worker threads, for the
+*		commands that split their work into tasks.
+	\return Reference to the task pool
+*/
+TaskPool& App::GetTasks(){
+	return *m_tasks;
+}
+
+/*! \brief 	Return a reference to the memory of the current frame,
+*		for what is only needed until the frame ends.
+	\return Reference to the frame arena
+*/
+FrameArena& App::GetFrameArena(){
+	return *m_frameArena;
+}
+
+/*! \brief 	Return how many times the main thread went to the heap
+*		during the last frame. Painting should not need to.
+	\return Heap allocations of the last frame
+*/
+std::uint64_t App::GetFrameAllocations() const{
+	return m_frameAllocations;
+}
+
+/*! \brief 	Set when the input being handled was polled. Commands added
+*		until the next call carry it, and so do undos and redos.
+	\param time time of the input, default constructed once it is handled
+*/
+void App::SetInputTime(InputClock::time_point time){
+	m_inputTime = time;
+}
+
+/*! \brief 	Get the time from input to the frame that shows it.
+*/
+LatencyTracker& App::GetLatency(){
+	return *m_latency;
+}
+
+/*! \brief 	Return a reference to our m_document, so that
+*		the GUI can show where it was saved.
+	\return Reference to the document
+*/
+Document& App::GetDocument(){
+	return *m_document;
+}
+
+/*! \brief 	Return a reference to our m_importer, so that
+*		the GUI can show which files are loading.
+	\return Reference to the importer
+*/
+ImageImporter& App::GetImporter(){
+	return *m_importer;
+}
+
+/*! \brief 	Return a reference to our m_exporter, so that
+*		the GUI can show the progress of a save.
+	\return Reference to the exporter
+*/
+ImageExporter& App::GetExporter(){
+	return *m_exporter;
+}
+
 /*! \brief 	Return a reference to our m_window so that we
 *		do not have to publicly expose it.
 	\return Pointer to window
@@ -185,9 +505,36 @@ sf::RenderWindow& App::GetWindow(){
 *
 */
 void App::Destroy(){
-	delete m_image;
+	// A clean exit, so the journal is not needed for recovery
+	// unless the session is being recorded
+	m_journal->Close(!m_keepJournal);
+	delete m_journal;
+	m_journal = nullptr;
+	delete m_network;
+	m_network = nullptr;
+	// Let a running save finish before the program exits
+	delete m_exporter;
+	m_exporter = nullptr;
+	delete m_importer;
+	m_importer = nullptr;
+	delete m_streamer;
+	m_streamer = nullptr;
+	delete m_tasks;
+	m_tasks = nullptr;
+	delete m_document;
+	delete m_selection;
+	delete m_selectionOutline;
+	delete m_cursorShape;
 	delete m_sprite;
 	delete m_texture;
+	delete m_frameArena;
+	m_frameArena = nullptr;
+	// How long the inputs of the session took to show, to compare runs
+	if (m_latency->GetHistogram().GetCount() > 0){
+		m_latency->GetHistogram().Write(std::cout);
+	}
+	delete m_latency;
+	m_latency = nullptr;
 
 }
 
@@ -196,23 +543,119 @@ void App::Destroy(){
 	\param (*initFunction)(void) function pointer to our initilization function in main.cpp
 */
 void App::Init(void (*initFunction)(void)){
-	// Create our window
+	if (!m_canvasTask){
+		AllocateCanvas();
+	}
+	// Create our window while a worker allocates the canvas
 	m_window = new sf::RenderWindow(sf::VideoMode(App::windowWidth, App::windowHeight),"Mini-Paint alpha 0.0.2",sf::Style::Titlebar);
 	m_window->setVerticalSyncEnabled(true);
-	// Create an image which stores the pixels we will update
-	m_image->create(App::windowWidth, App::windowHeight,sf::Color::White);
-	assert(m_image != nullptr && "m_image != nullptr");
-	// Create a texture which lives in the GPU and will render our image
-	m_texture->loadFromImage(*m_image);
-	assert(m_texture != nullptr && "m_texture != nullptr");
-	// Create a sprite which is the entity that can be textured
-	m_sprite->setTexture(*m_texture);
+	// Tiles are streamed through pixel buffers where the GL has them
+	if (m_streamer->Init()){
+		std::cout << "Texture uploads: " << TextureStreamer::RING_SIZE << " pixel buffers" << std::endl;
+	} else{
+		std::cout << "Texture uploads: sf::Texture::update" << std::endl;
+	}
+	m_tasks->Wait(*m_canvasTask);
+	delete m_canvasTask;
+	m_canvasTask = nullptr;
+	assert(m_document != nullptr && "m_document != nullptr");
+	m_selectionOutline->setFillColor(sf::Color::Transparent);
+	m_selectionOutline->setOutlineColor(sf::Color(0, 120, 215));
+	m_selectionOutline->setOutlineThickness(1);
+	m_cursorShape->setOrigin(5, 5);
+	m_cursorShape->setOutlineColor(sf::Color::White);
+	m_cursorShape->setOutlineThickness(1);
+	ResetCanvas();
 	assert(m_sprite != nullptr && "m_sprite != nullptr");
+	// The journal is only left behind if the last run did not exit cleanly.
+	// A recording always starts over.
+	std::uint64_t keep = 0;
+	if (!m_keepJournal && Journal::Exists(m_journalPath)){
+		unsigned records = 0;
+		keep = Journal::Replay(m_journalPath, *this, &records);
+		std::cout << "Recovered " << records << " actions from the last session" << std::endl;
+	}
+	m_journal->Open(m_journalPath, keep);
 	// Set our initialization function to perform any user
 	// initialization
 	m_initFunc = initFunction;
 }
 
+/*! \brief 	Start the worker threads and allocate the canvas on one of
+*		them, so the windows can be created in the meantime.
+*		Init() waits for it, and calls it if it was not called.
+*
+*/
+void App::AllocateCanvas(){
+	m_tasks->Start();
+	m_canvasTask = new TaskGroup;
+	m_tasks->Submit(*m_canvasTask, [this]{
+		// Create the document which holds the layers we will update
+		m_document = new Document(App::windowWidth, App::windowHeight, m_backgroundColor);
+	});
+}
+
+/*! \brief 	Initializes the App without a window, for replaying and
+*		benchmarking sessions. The canvas is composited in memory
+*		and never uploaded, and GetWindow() must not be called.
+*		Nothing is journaled unless RecordSession() was called.
+	\param width width of the canvas
+	\param height height of the canvas
+	\param threads worker threads of the task pool, 0 runs every
+	*		task on the calling thread
+*/
+void App::InitHeadless(int width, int height, unsigned threads){
+	m_tasks->Start(threads);
+	m_headless = true;
+	App::windowWidth = width;
+	App::windowHeight = height;
+	m_document = new Document(width, height, m_backgroundColor);
+	assert(m_document != nullptr && "m_document != nullptr");
+	ResetCanvas();
+	if (m_keepJournal){
+		m_journal->Open(m_journalPath);
+	}
+}
+
+/*! \brief 	Record the session to a journal that is kept on exit, so
+*		it can be replayed later by the headless harness.
+*		Call before Init() or InitHeadless().
+	\param path journal file to write
+*/
+void App::RecordSession(const std::string &path){
+	m_journalPath = path;
+	m_keepJournal = true;
+}
+
+/*! \brief 	Size the selection and the texture to the layers of
+*		the document, and upload the whole canvas again.
+*
+*/
+void App::ResetCanvas(){
+	LayerStack &layers = GetLayers();
+	// Nothing is selected at first
+	delete m_selection;
+	m_selection = new SelectionMask(layers.GetWidth(), layers.GetHeight());
+	m_selectionSnapshot.reset();
+	layers.MarkAllDirty();
+	m_updatedTiles.clear();
+	if (m_headless){
+		UpdateTexture();
+		return;
+	}
+	// Create a texture which lives in the GPU and will render our image.
+	// It is rounded up to whole tiles so every tile uploads the same way.
+	const TiledImage &flattened = layers.GetFlattened();
+	m_texture->create(flattened.GetTilesX() * TILE_SIZE, flattened.GetTilesY() * TILE_SIZE);
+	assert(m_texture != nullptr && "m_texture != nullptr");
+	UpdateTexture();
+	// Create a sprite which is the entity that can be textured.
+	// It shows the part of the canvas that fits in the window.
+	m_sprite->setTexture(*m_texture);
+	m_sprite->setTextureRect(sf::IntRect(0, 0, std::min<int>(App::windowWidth, layers.GetWidth()),
+		std::min<int>(App::windowHeight, layers.GetHeight())));
+}
+
 /*! \brief 	Set a callback function which will be called
 		each iteration of the main loop before drawing.
 *
@@ -243,15 +686,62 @@ void App::Loop(){
 	// Clear the window
 	m_window->clear();
 	// Updates specified by the user
-	m_updateFunc(this);
+	{
+		ProfileScope profile(PROFILE_INPUT);
+		m_updateFunc(this);
+	}
+	// Place the tiles of images that are loading
+	m_importer->Poll(GetLayers());
+	// Send what was drawn this frame and apply what the others drew
+	{
+		ProfileScope profile(PROFILE_NETWORK);
+		m_network->Poll(*this);
+	}
 	// Additional drawing specified by user
-	m_drawFunc(this);
+	{
+		ProfileScope profile(PROFILE_UPLOAD);
+		m_drawFunc(this);
+	}
 	// Update the texture
 	// Note: This can be done in the 'draw call'
-	// Draw to the canvas
-	m_window->draw(*m_sprite);
-	// Display the canvas
+	// Draw to the canvas. The layers are stored with premultiplied alpha.
+	ProfileScope profile(PROFILE_PRESENT);
+	static const sf::BlendMode premultiplied(sf::BlendMode::One, sf::BlendMode::OneMinusSrcAlpha);
+	m_window->draw(*m_sprite, sf::RenderStates(premultiplied));
+	// Outline the selection on top of the canvas
+	if (m_selection->IsActive()){
+		sf::IntRect bounds = m_selection->GetBounds();
+		m_selectionOutline->setPosition(bounds.left, bounds.top);
+		m_selectionOutline->setSize(sf::Vector2f(bounds.width, bounds.height));
+		m_window->draw(*m_selectionOutline);
+	}
+	// Mark where the other users point. Only the window is drawn on, the
+	// canvas and its texture stay as they are.
+	static const sf::Color cursorColors[] = {sf::Color(230, 25, 75), sf::Color(60, 180, 75),
+		sf::Color(0, 130, 200), sf::Color(245, 130, 48), sf::Color(145, 30, 180), sf::Color(70, 240, 240)};
+	const std::vector<RemoteCursor> &cursors = m_network->GetCursors();
+	for (std::size_t i = 0; i < cursors.size(); i++){
+		m_cursorShape->setFillColor(cursorColors[cursors[i].id % 6]);
+		m_cursorShape->setPosition(cursors[i].position.x, cursors[i].position.y);
+		m_window->draw(*m_cursorShape);
+	}
+	// Display the canvas. With vsync this waits for the swap, which is
+	// as close to the pixels changing as we can tell.
 	m_window->display();
+	m_latency->Presented(InputClock::now());
+	EndFrame();
+}
+
+/*! \brief 	End a frame: give back the memory of the frame and count
+*		the heap allocations made since the last frame ended.
+*		Loop() calls it, headless callers call it themselves.
+*
+*/
+void App::EndFrame(){
+	m_frameArena->Reset();
+	std::uint64_t allocations = GetHeapAllocations();
+	m_frameAllocations = allocations - m_frameAllocationsStart;
+	m_frameAllocationsStart = allocations;
 }
 
 
@@ -0,0 +1,264 @@
+/**
+ *  @file   Batch.cpp
+ *  @brief  Implementation of Batch.hpp
+ *  @author Team Avengers
+ *  @date   2020-12-10
+ ***********************************************/
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <thread>
+#include <sys/stat.h>
+// Project header files
+#include "Batch.hpp"
+#include "FilterCommand.hpp"
+#include "ImageImport.hpp"
+#include "SelectionMask.hpp"
+#include "Trace.hpp"
+
+namespace {
+
+void PrintUsage(const char* program){
+    std::cerr << "usage: " << program << " --batch --filters NAME[,NAME...] [--format png|tga] [--out DIR]"
+              << " [--threads N] [--in-flight N] [--list FILE|-] [images...]" << std::endl;
+    std::cerr << "filters:";
+    for (int f = 0; f < FILTER_COUNT; f++){
+        std::cerr << (f > 0 ? ", " : " ") << GetFilterName(static_cast<FilterType>(f));
+    }
+    std::cerr << std::endl;
+}
+
+// Lower case copy of an output name.
+std::string Lower(std::string text){
+    for (std::size_t i = 0; i < text.size(); i++){
+        text[i] = static_cast<char>(std::tolower(static_cast<unsigned char>(text[i])));
+    }
+    return text;
+}
+
+// Read one path per line, for lists too long for the command line.
+void ReadList(std::istream &in, std::vector<std::string> &inputs){
+    std::string line;
+    while (std::getline(in, line)){
+        if (!line.empty()){
+            inputs.push_back(line);
+        }
+    }
+}
+
+}
+
+/*! \brief Construct a processor for one batch run.
+    \param options filters, files and limits of the run
+*/
+BatchProcessor::BatchProcessor(const BatchOptions &options): m_options(options), m_next(0),
+ m_active(0), m_failed(0){
+    m_options.threads = std::max(1u, m_options.threads);
+    m_options.inFlight = std::max(1u, m_options.inFlight);
+    // Names are compared without case, for the file systems that ignore it
+    std::set<std::string> taken;
+    for (std::size_t i = 0; i < m_options.inputs.size(); i++){
+        const std::string &input = m_options.inputs[i];
+        std::size_t slash = input.find_last_of("/\\");
+        std::string name = slash == std::string::npos ? input : input.substr(slash + 1);
+        std::size_t dot = name.find_last_of('.');
+        if (dot != std::string::npos && dot > 0){
+            name = name.substr(0, dot);
+        }
+        std::string unique = name;
+        for (unsigned n = 2; !taken.insert(Lower(unique)).second; n++){
+            unique = name + "-" + std::to_string(n);
+        }
+        if (unique != name){
+            std::cout << input << " is written as " << unique << " because another input has its name" << std::endl;
+        }
+        m_outputs.push_back(m_options.outputDir + "/" + unique + GetExportExtension(m_options.format));
+    }
+}
+
+/*! \brief Process every input and wait until all of them are written.
+    \return number of images that could not be read or written
+*/
+unsigned BatchProcessor::Run(){
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < m_options.threads; i++){
+        workers.push_back(std::thread(&BatchProcessor::Work, this));
+    }
+    for (std::size_t i = 0; i < workers.size(); i++){
+        workers[i].join();
+    }
+    return m_failed;
+}
+
+/*! \brief Get the file an input is written to, named like the input with
+        the extension of the output format, and made unique in the batch.
+    \param input index of the input in the options
+*/
+const std::string& BatchProcessor::GetOutputPath(std::size_t input) const{
+    return m_outputs[input];
+}
+
+/*! \brief Run a batch from the command line, without opening any window.
+    \param argc argument count, including the program and --batch
+    \param argv arguments
+    \return exit code, 0 if every image was written
+*/
+int BatchProcessor::Main(int argc, char** argv){
+    BatchOptions options;
+    options.outputDir = "filtered";
+    options.format = EXPORT_PNG;
+    options.threads = std::max(1u, std::thread::hardware_concurrency());
+    options.inFlight = 0;
+    for (int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        if (arg == "--batch"){
+            continue;
+        }
+        if (arg.size() < 2 || arg.compare(0, 2, "--") != 0){
+            options.inputs.push_back(arg);
+            continue;
+        }
+        if (i + 1 >= argc){
+            PrintUsage(argv[0]);
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (arg == "--filters"){
+            std::size_t start = 0;
+            while (start <= value.size()){
+                std::size_t comma = std::min(value.find(',', start), value.size());
+                FilterType type;
+                if (!FindFilter(value.substr(start, comma - start), type)){
+                    std::cerr << "Unknown filter " << value.substr(start, comma - start) << std::endl;
+                    PrintUsage(argv[0]);
+                    return 1;
+                }
+                options.filters.push_back(type);
+                start = comma + 1;
+            }
+        } else if (arg == "--format"){
+            options.format = value == "tga" ? EXPORT_TGA : EXPORT_PNG;
+        } else if (arg == "--out"){
+            options.outputDir = value;
+        } else if (arg == "--threads"){
+            options.threads = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--in-flight"){
+            options.inFlight = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--list"){
+            if (value == "-"){
+                ReadList(std::cin, options.inputs);
+            } else{
+                std::ifstream list(value.c_str());
+                ReadList(list, options.inputs);
+            }
+        } else{
+            PrintUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (options.filters.empty() || options.inputs.empty()){
+        PrintUsage(argv[0]);
+        return 1;
+    }
+    // Enough images to keep every worker busy without holding many more
+    if (options.inFlight == 0){
+        options.inFlight = options.threads * 2;
+    }
+    mkdir(options.outputDir.c_str(), 0755);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    BatchProcessor batch(options);
+    unsigned failed = batch.Run();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::size_t written = options.inputs.size() - failed;
+    std::cout << "Filtered " << written << " of " << options.inputs.size() << " images in " << seconds
+              << " s (" << written / seconds << " images/s, " << options.threads << " threads)" << std::endl;
+    return failed > 0 ? 1 : 0;
+}
+
+/*! \brief Body of a worker thread. Takes the next step of some image
+        until every image is done.
+*/
+void BatchProcessor::Work(){
+    Trace::NameThread("Batch worker");
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true){
+        if (!m_filtered.empty()){
+            Item item = m_filtered.front();
+            m_filtered.pop_front();
+            lock.unlock();
+            const std::string &output = GetOutputPath(item.first);
+            bool ok;
+            {
+                TraceScope trace("Save image");
+                ok = ImageExporter::Write(item.second, output, m_options.format);
+            }
+            // Let go of the pixels before the next image may be decoded
+            item.second = TiledImage();
+            lock.lock();
+            if (!ok){
+                std::cerr << "Could not write " << output << std::endl;
+            }
+            Finish(ok);
+        } else if (!m_decoded.empty()){
+            Item item = m_decoded.front();
+            m_decoded.pop_front();
+            lock.unlock();
+            TiledImage &image = item.second;
+            SelectionMask all(image.GetWidth(), image.GetHeight());
+            std::vector<std::pair<unsigned, TilePtr>> filtered;
+            for (std::size_t f = 0; f < m_options.filters.size(); f++){
+                FilterCommand::FilterSelection(m_options.filters[f], image, all, filtered);
+                for (std::size_t i = 0; i < filtered.size(); i++){
+                    image.SetTilePtr(filtered[i].first, filtered[i].second);
+                }
+                filtered.clear();
+            }
+            lock.lock();
+            m_filtered.push_back(item);
+            m_wake.notify_one();
+        } else if (m_next < m_options.inputs.size() && m_active < m_options.inFlight){
+            std::size_t index = m_next++;
+            m_active++;
+            lock.unlock();
+            Item item(index, TiledImage());
+            bool ok;
+            {
+                TraceScope trace("Decode image");
+                ok = ImageImporter::Read(m_options.inputs[index], item.second);
+            }
+            lock.lock();
+            if (ok){
+                m_decoded.push_back(item);
+                m_wake.notify_one();
+            } else{
+                std::cerr << "Could not read " << m_options.inputs[index] << std::endl;
+                Finish(false);
+            }
+        } else if (m_next == m_options.inputs.size() && m_active == 0){
+            break;
+        } else{
+            m_wake.wait(lock);
+        }
+    }
+}
+
+/*! \brief Account for an image that left the pipeline. Called with
+        m_mutex held.
+    \param ok false if the image failed
+*/
+void BatchProcessor::Finish(bool ok){
+    m_active--;
+    if (!ok){
+        m_failed++;
+    }
+    // A new image may start, or the others may find that all are done
+    m_wake.notify_all();
+}
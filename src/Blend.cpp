@@ -0,0 +1,147 @@
+/**
+ *  @file   Blend.cpp
+ *  @brief  Scalar blend kernels and instruction set dispatch.
+ *  @author Team Avengers
+ *  @date   2020-12-02
+ ***********************************************/
+
+// Include our Third-Party SFML header
+#include <SFML/Config.hpp>
+// Include standard library C++ libraries.
+#include <algorithm>
+// Project header files
+#include "Blend.hpp"
+#include "BlendSimd.hpp"
+
+// Tables of the SIMD translation units, only built on x86.
+#ifdef FSD_BLEND_SIMD
+extern const BlendRowFunc g_blendRowsSSE2[BLEND_MODE_COUNT];
+extern const BlendRowFunc g_blendRowsAVX2[BLEND_MODE_COUNT];
+#endif
+
+namespace {
+
+// a * b / 255 with rounding, for a and b in [0, 255]
+inline int Mul255(int a, int b){
+    int t = a * b + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+// s * (1 - da) + d * (1 - sa)
+inline int Outside(int s, int d, int sa, int da){
+    return Mul255(s, 255 - da) + Mul255(d, 255 - sa);
+}
+
+// Reference implementation of every mode on one premultiplied channel.
+// The alpha channel goes through the same formula, which gives the
+// usual sa + da - sa * da for every mode except add.
+template <BlendMode MODE>
+inline int Apply(int s, int d, int sa, int da){
+    switch (MODE){
+        case BLEND_MULTIPLY:
+            return Outside(s, d, sa, da) + Mul255(s, d);
+        case BLEND_SCREEN:
+            return s + d - Mul255(s, d);
+        case BLEND_OVERLAY:
+        {
+            int low = 2 * Mul255(s, d);
+            int t = Mul255(std::max(da - d, 0), std::max(sa - s, 0));
+            int high = std::max(Mul255(sa, da) - 2 * t, 0);
+            return Outside(s, d, sa, da) + (2 * d <= da ? low : high);
+        }
+        case BLEND_ADD:
+            return s + d;
+        case BLEND_DARKEN:
+            return Outside(s, d, sa, da) + std::min(Mul255(s, da), Mul255(d, sa));
+        case BLEND_LIGHTEN:
+            return Outside(s, d, sa, da) + std::max(Mul255(s, da), Mul255(d, sa));
+        case BLEND_NORMAL:
+        default:
+            return s + Mul255(d, 255 - sa);
+    }
+}
+
+template <BlendMode MODE>
+void BlendRowScalar(sf::Uint8* dst, const sf::Uint8* src, std::size_t pixels, unsigned opacity){
+    for (std::size_t i = 0; i < pixels; i++, dst += 4, src += 4){
+        int s[4] = {src[0], src[1], src[2], src[3]};
+        if (opacity != 255){
+            for (int c = 0; c < 4; c++){
+                s[c] = Mul255(s[c], opacity);
+            }
+        }
+        int da = dst[3];
+        for (int c = 0; c < 4; c++){
+            dst[c] = static_cast<sf::Uint8>(std::min(Apply<MODE>(s[c], dst[c], s[3], da), 255));
+        }
+    }
+}
+
+const char* const g_blendModeNames[BLEND_MODE_COUNT] = {
+    "Normal", "Multiply", "Screen", "Overlay", "Add", "Darken", "Lighten"
+};
+
+const char* const g_blendIsaNames[BLEND_ISA_COUNT] = {
+    "scalar", "sse2", "avx2"
+};
+
+}
+
+const BlendRowFunc g_blendRowsScalar[BLEND_MODE_COUNT] = {
+    &BlendRowScalar<BLEND_NORMAL>,
+    &BlendRowScalar<BLEND_MULTIPLY>,
+    &BlendRowScalar<BLEND_SCREEN>,
+    &BlendRowScalar<BLEND_OVERLAY>,
+    &BlendRowScalar<BLEND_ADD>,
+    &BlendRowScalar<BLEND_DARKEN>,
+    &BlendRowScalar<BLEND_LIGHTEN>
+};
+
+/*! \brief Get the name of a blend mode as shown in the GUI.
+*/
+const char* GetBlendModeName(BlendMode mode){
+    return g_blendModeNames[mode];
+}
+
+/*! \brief Get the name of an instruction set.
+*/
+const char* GetBlendIsaName(BlendIsa isa){
+    return g_blendIsaNames[isa];
+}
+
+/*! \brief Get the fastest instruction set the CPU supports.
+        The result is computed once.
+*/
+BlendIsa GetBestBlendIsa(){
+#ifdef FSD_BLEND_SIMD
+    static const BlendIsa best = __builtin_cpu_supports("avx2") ? BLEND_ISA_AVX2 : BLEND_ISA_SSE2;
+    return best;
+#else
+    return BLEND_ISA_SCALAR;
+#endif
+}
+
+/*! \brief Get the fastest row kernel of a blend mode.
+*/
+BlendRowFunc GetBlendRow(BlendMode mode){
+    static const BlendIsa best = GetBestBlendIsa();
+    return GetBlendRow(mode, best);
+}
+
+/*! \brief Get the row kernel of a blend mode for a specific instruction set.
+    \return the kernel, or nullptr if the instruction set is not built in
+*/
+BlendRowFunc GetBlendRow(BlendMode mode, BlendIsa isa){
+    switch (isa){
+        case BLEND_ISA_SCALAR:
+            return g_blendRowsScalar[mode];
+#ifdef FSD_BLEND_SIMD
+        case BLEND_ISA_SSE2:
+            return g_blendRowsSSE2[mode];
+        case BLEND_ISA_AVX2:
+            return __builtin_cpu_supports("avx2") ? g_blendRowsAVX2[mode] : nullptr;
+#endif
+        default:
+            return nullptr;
+    }
+}
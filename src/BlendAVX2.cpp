@@ -0,0 +1,45 @@
+/**
+ *  @file   BlendAVX2.cpp
+ *  @brief  AVX2 blend kernels, eight pixels at a time.
+ *          This file is compiled with -mavx2 and only called
+ *          after checking the CPU supports it.
+ *  @author Team Avengers
+ *  @date   2020-12-02
+ ***********************************************/
+
+// Include our Third-Party SFML header
+#include <SFML/Config.hpp>
+// Include standard library C++ libraries.
+#include <immintrin.h>
+// Project header files
+#include "BlendSimd.hpp"
+
+namespace {
+
+// Unpacking and packing both work within 128 bit lanes,
+// so the pixels come back out in the order they went in.
+struct AVX2{
+    typedef __m256i Bytes;
+    typedef __m256i Wide;
+    static const std::size_t PIXELS = 8;
+
+    static Bytes Load(const sf::Uint8* p){ return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static void  Store(sf::Uint8* p, Bytes v){ _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    static Wide  Lo(Bytes v){ return _mm256_unpacklo_epi8(v, _mm256_setzero_si256()); }
+    static Wide  Hi(Bytes v){ return _mm256_unpackhi_epi8(v, _mm256_setzero_si256()); }
+    static Bytes Pack(Wide lo, Wide hi){ return _mm256_packus_epi16(lo, hi); }
+    static Wide  Set1(int v){ return _mm256_set1_epi16(static_cast<short>(v)); }
+    static Wide  Add(Wide a, Wide b){ return _mm256_add_epi16(a, b); }
+    static Wide  Sub(Wide a, Wide b){ return _mm256_sub_epi16(a, b); }
+    static Wide  MulLo(Wide a, Wide b){ return _mm256_mullo_epi16(a, b); }
+    static Wide  Shr8(Wide a){ return _mm256_srli_epi16(a, 8); }
+    static Wide  Min(Wide a, Wide b){ return _mm256_min_epi16(a, b); }
+    static Wide  Max(Wide a, Wide b){ return _mm256_max_epi16(a, b); }
+    static Wide  LessEq(Wide a, Wide b){ return _mm256_xor_si256(_mm256_cmpgt_epi16(a, b), _mm256_set1_epi16(-1)); }
+    static Wide  Select(Wide mask, Wide a, Wide b){ return _mm256_blendv_epi8(b, a, mask); }
+    static Wide  Alpha(Wide v){ return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(v, 0xFF), 0xFF); }
+};
+
+}
+
+extern const BlendRowFunc g_blendRowsAVX2[BLEND_MODE_COUNT] = BLEND_SIMD_TABLE(AVX2);
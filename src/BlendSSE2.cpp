@@ -0,0 +1,41 @@
+/**
+ *  @file   BlendSSE2.cpp
+ *  @brief  SSE2 blend kernels, four pixels at a time.
+ *  @author Team Avengers
+ *  @date   2020-12-02
+ ***********************************************/
+
+// Include our Third-Party SFML header
+#include <SFML/Config.hpp>
+// Include standard library C++ libraries.
+#include <emmintrin.h>
+// Project header files
+#include "BlendSimd.hpp"
+
+namespace {
+
+struct SSE2{
+    typedef __m128i Bytes;
+    typedef __m128i Wide;
+    static const std::size_t PIXELS = 4;
+
+    static Bytes Load(const sf::Uint8* p){ return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static void  Store(sf::Uint8* p, Bytes v){ _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+    static Wide  Lo(Bytes v){ return _mm_unpacklo_epi8(v, _mm_setzero_si128()); }
+    static Wide  Hi(Bytes v){ return _mm_unpackhi_epi8(v, _mm_setzero_si128()); }
+    static Bytes Pack(Wide lo, Wide hi){ return _mm_packus_epi16(lo, hi); }
+    static Wide  Set1(int v){ return _mm_set1_epi16(static_cast<short>(v)); }
+    static Wide  Add(Wide a, Wide b){ return _mm_add_epi16(a, b); }
+    static Wide  Sub(Wide a, Wide b){ return _mm_sub_epi16(a, b); }
+    static Wide  MulLo(Wide a, Wide b){ return _mm_mullo_epi16(a, b); }
+    static Wide  Shr8(Wide a){ return _mm_srli_epi16(a, 8); }
+    static Wide  Min(Wide a, Wide b){ return _mm_min_epi16(a, b); }
+    static Wide  Max(Wide a, Wide b){ return _mm_max_epi16(a, b); }
+    static Wide  LessEq(Wide a, Wide b){ return _mm_xor_si128(_mm_cmpgt_epi16(a, b), _mm_set1_epi16(-1)); }
+    static Wide  Select(Wide mask, Wide a, Wide b){ return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+    static Wide  Alpha(Wide v){ return _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, 0xFF), 0xFF); }
+};
+
+}
+
+extern const BlendRowFunc g_blendRowsSSE2[BLEND_MODE_COUNT] = BLEND_SIMD_TABLE(SSE2);
@@ -0,0 +1,151 @@
+/**
+ *  @file   ByteStream.cpp
+ *  @brief  Implementation of ByteStream.hpp
+ *  @author Team Avengers
+ *  @date   2020-12-08
+ ***********************************************/
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+// Project header files
+#include "ByteStream.hpp"
+
+/*! \brief Append one byte.
+*/
+void ByteWriter::PutU8(std::uint8_t value){
+    m_bytes.push_back(value);
+}
+
+/*! \brief Append an unsigned number as a varint of 1 to 10 bytes.
+*/
+void ByteWriter::PutVarint(std::uint64_t value){
+    while (value >= 0x80){
+        m_bytes.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    m_bytes.push_back(static_cast<std::uint8_t>(value));
+}
+
+/*! \brief Append a signed number, zigzag encoded as a varint.
+*/
+void ByteWriter::PutSigned(std::int64_t value){
+    PutVarint((static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+}
+
+/*! \brief Append raw bytes.
+*/
+void ByteWriter::PutBytes(const void* data, std::size_t size){
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    m_bytes.insert(m_bytes.end(), bytes, bytes + size);
+}
+
+/*! \brief Append a string as its length followed by its characters.
+*/
+void ByteWriter::PutString(const std::string &value){
+    PutVarint(value.size());
+    PutBytes(value.data(), value.size());
+}
+
+/*! \brief Get the bytes written so far.
+*/
+const std::uint8_t* ByteWriter::GetData() const{
+    return m_bytes.empty() ? nullptr : &m_bytes[0];
+}
+
+/*! \brief Get the number of bytes written so far.
+*/
+std::size_t ByteWriter::GetSize() const{
+    return m_bytes.size();
+}
+
+/*! \brief Forget the bytes written, but keep the memory for reuse.
+*/
+void ByteWriter::Clear(){
+    m_bytes.clear();
+}
+
+/*! \brief Construct a reader over a block of bytes, which is not copied.
+*/
+ByteReader::ByteReader(const void* data, std::size_t size):
+ m_data(static_cast<const std::uint8_t*>(data)), m_left(size), m_ok(true){
+}
+
+/*! \brief Read one byte.
+*/
+std::uint8_t ByteReader::GetU8(){
+    const std::uint8_t* byte = GetBytes(1);
+    return byte ? *byte : 0;
+}
+
+/*! \brief Read a varint.
+*/
+std::uint64_t ByteReader::GetVarint(){
+    std::uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7){
+        const std::uint8_t* byte = GetBytes(1);
+        if (!byte){
+            return 0;
+        }
+        value |= static_cast<std::uint64_t>(*byte & 0x7F) << shift;
+        if (!(*byte & 0x80)){
+            return value;
+        }
+    }
+    Fail();
+    return 0;
+}
+
+/*! \brief Read a zigzag encoded signed number.
+*/
+std::int64_t ByteReader::GetSigned(){
+    std::uint64_t value = GetVarint();
+    return static_cast<std::int64_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+/*! \brief Read raw bytes.
+    \return pointer into the buffer, or nullptr if there are not enough bytes left
+*/
+const std::uint8_t* ByteReader::GetBytes(std::size_t size){
+    if (!m_ok || size > m_left){
+        Fail();
+        return nullptr;
+    }
+    const std::uint8_t* bytes = m_data;
+    m_data += size;
+    m_left -= size;
+    return bytes;
+}
+
+/*! \brief Read a string written by ByteWriter::PutString.
+*/
+std::string ByteReader::GetString(){
+    std::size_t size = static_cast<std::size_t>(GetVarint());
+    const std::uint8_t* bytes = GetBytes(size);
+    return bytes ? std::string(reinterpret_cast<const char*>(bytes), size) : std::string();
+}
+
+/*! \brief Check that nothing was read past the end.
+*/
+bool ByteReader::Ok() const{
+    return m_ok;
+}
+
+/*! \brief Check if every byte has been read.
+*/
+bool ByteReader::AtEnd() const{
+    return m_left == 0;
+}
+
+/*! \brief Get the number of bytes not read yet.
+*/
+std::size_t ByteReader::GetRemaining() const{
+    return m_left;
+}
+
+/*! \brief Stop reading, every later read returns 0.
+*/
+void ByteReader::Fail(){
+    m_ok = false;
+    m_left = 0;
+}
@@ -8,23 +8,26 @@
 // Include our Third-Party SFML header
 #include <SFML/Graphics/Color.hpp>
 // Include standard library C++ libraries.
-// #include ...
+#include <cstring>
 // Project header files
 #include "App.hpp"
 #include "ClearCanvas.hpp"
+#include "LayerStack.hpp"
 #include <iostream>
 
 /*! \brief ClearCommand constructor which initializes all members
     \param m_commandDescription string of action should be "clear"
     \param curr_color color of that the canvas should be wiped to
-    \param app reference to object that stores the image and actions
+    \param app reference to object that stores the layers and actions
 */
-ClearCanvas::ClearCanvas(const std::string &m_commandDescription, const sf::Color &curr_color,
+ClearCanvas::ClearCanvas(const char* m_commandDescription, const sf::Color &curr_color,
     const sf::Color &prev_color, App &app):
  Command(m_commandDescription), m_color(curr_color), m_app(app),
- m_prev_color(prev_color), m_prev_img(std::make_shared<sf::Image>()){
-    m_prev_img->create(m_app.GetWindowWidth(), m_app.GetWindowHeight());
-    m_prev_img->copy(m_app.GetImage(), 0, 0);
+ m_prev_color(prev_color), m_layer(app.GetLayers().GetActiveId()),
+ m_selection(app.GetSelectionSnapshot()){
+    if (!m_selection->IsActive()){
+        m_prev_img = app.GetLayers().Snapshot(m_layer);
+    }
 }
 
 /*! \brief ClearCanvas destructor
@@ -40,16 +43,18 @@ bool ClearCanvas::compare(const std::shared_ptr<Command> &c_rhs){
     const auto rhs = std::dynamic_pointer_cast<ClearCanvas>(c_rhs);
 
     if (rhs){
-        for (unsigned int i = 0; i < m_app.GetWindowHeight(); i++){
-            for (unsigned int j = 0; j < m_app.GetWindowWidth(); j++){
-                if (m_app.GetImage().getPixel(i, j) != rhs->m_prev_img->getPixel(i, j))
-                    std::cout << "original images not equal" << std::endl;
-                    return false;
-            }
+        // Clearing a selection twice is two separate actions.
+        if (m_selection->IsActive() || rhs->m_selection->IsActive()){
+            return false;
+        }
+        // Snapshots share their tiles, so equal originals have the same tiles.
+        if (!m_prev_img.SameTiles(rhs->m_prev_img)){
+            return false;
         }
 
-        return (m_commandDescription.compare(rhs->m_commandDescription) == 0
+        return (std::strcmp(m_commandDescription, rhs->m_commandDescription) == 0
             && m_color == rhs->m_color
+            && m_layer == rhs->m_layer
             );
     } else{
         return false;
@@ -58,14 +63,54 @@ bool ClearCanvas::compare(const std::shared_ptr<Command> &c_rhs){
 }
 
 
-/*! \brief 	Execute the clear command by replacing every pixel with the new color.
-    \return boolean of if execute was completed
+/*! \brief 	Execute the clear command by replacing every selected pixel of the layer
+        with the new color. Fully selected tiles all share one filled tile,
+        only tiles on the edge of the selection are blended.
+    \return boolean of if execute was completed, false if the layer was
+        removed since
 *
 */
 bool ClearCanvas::execute(){
-    m_app.GetImage().create(m_app.GetWindowWidth(), m_app.GetWindowHeight(), m_color);
-    m_app.SetBackgroundColor(m_color);
-    return true;
+    LayerStack &layers = m_app.GetLayers();
+    if (!layers.FindLayer(m_layer)){
+        return false;
+    }
+    sf::Color color = TiledImage::Premultiply(m_color);
+    if (!m_selection->IsActive()){
+        // Taken again, the layer may have changed since the command was made
+        m_prev_img = layers.Snapshot(m_layer);
+        layers.Fill(m_layer, color);
+        m_after_img = layers.Snapshot(m_layer);
+        m_app.SetBackgroundColor(m_color);
+        return true;
+    }
+
+    const std::vector<unsigned> &tiles = m_selection->GetSelectedTiles();
+    TiledImage filled(TILE_SIZE, TILE_SIZE);
+    filled.Fill(color);
+    TilePtr full = filled.GetTilePtr(0);
+    m_prevTiles.clear();
+    m_afterTiles.clear();
+    for (std::size_t i = 0; i < tiles.size(); i++){
+        unsigned tile = tiles[i];
+        TilePtr prev = layers.GetTile(m_layer, tile);
+        m_prevTiles.push_back(std::make_pair(tile, prev));
+        if (m_selection->GetTileState(tile) == SelectionMask::TILE_FULL){
+            layers.SetTile(m_layer, tile, full);
+            m_afterTiles.push_back(full);
+        } else{
+            TilePtr out = TiledImage::AllocateTile();
+            if (full){
+                std::memcpy(out.get(), full.get(), TILE_BYTES);
+            } else{
+                std::memset(out.get(), 0, TILE_BYTES);
+            }
+            SelectionMask::ApplyCoverage(m_selection->GetTileCoverage(tile), prev.get(), out.get());
+            layers.SetTile(m_layer, tile, out);
+            m_afterTiles.push_back(out);
+        }
+    }
+    return !tiles.empty();
 
 }
 
@@ -73,10 +118,105 @@ bool ClearCanvas::execute(){
     \return boolean of if undo was completed
 */
 bool ClearCanvas::undo(){
-    m_app.GetImage().copy(*m_prev_img, 0, 0);
-    m_app.SetBackgroundColor(m_prev_color);
+    LayerStack &layers = m_app.GetLayers();
+    if (!m_selection->IsActive()){
+        layers.Restore(m_layer, m_prev_img);
+        m_app.SetBackgroundColor(m_prev_color);
+        return true;
+    }
+    for (std::size_t i = 0; i < m_prevTiles.size(); i++){
+        layers.SetTile(m_layer, m_prevTiles[i].first, m_prevTiles[i].second);
+    }
+    return true;
+
+}
+
+/*! \brief 	Put back the original pixels that nobody drew over since the clear.
+    \return boolean of if the clear executed on this canvas
+*/
+bool ClearCanvas::revert(){
+    LayerStack &layers = m_app.GetLayers();
+    m_revertTiles.clear();
+    if (!m_selection->IsActive()){
+        if (m_after_img.GetTileCount() == 0){
+            return false;
+        }
+        for (unsigned tile = 0; tile < m_after_img.GetTileCount(); tile++){
+            TilePtr current = layers.RevertTile(m_layer, tile, m_prev_img.GetTilePtr(tile), m_after_img.GetTilePtr(tile));
+            m_revertTiles.push_back(std::make_pair(tile, current));
+        }
+        m_app.SetBackgroundColor(m_prev_color);
+        return true;
+    }
+    for (std::size_t i = 0; i < m_afterTiles.size(); i++){
+        unsigned tile = m_prevTiles[i].first;
+        TilePtr current = layers.RevertTile(m_layer, tile, m_prevTiles[i].second, m_afterTiles[i]);
+        m_revertTiles.push_back(std::make_pair(tile, current));
+    }
+    return true;
+}
+
+/*! \brief 	Put back the tiles the last revert() replaced.
+    \return true
+*/
+bool ClearCanvas::unrevert(){
+    LayerStack &layers = m_app.GetLayers();
+    for (std::size_t i = 0; i < m_revertTiles.size(); i++){
+        layers.SetTile(m_layer, m_revertTiles[i].first, m_revertTiles[i].second);
+    }
+    m_revertTiles.clear();
+    if (!m_selection->IsActive()){
+        m_app.SetBackgroundColor(m_color);
+    }
     return true;
+}
+
+/*! \brief Get the layer that is cleared.
+*/
+unsigned ClearCanvas::GetLayer() const{
+    return m_layer;
+}
 
+/*! \brief Get the kind of command.
+*/
+CommandType ClearCanvas::GetType() const{
+    return COMMAND_CLEAR;
 }
 
+/*! \brief Write the colors, the layer and the selection of the clear.
+*/
+void ClearCanvas::Serialize(ByteWriter &out) const{
+    const sf::Color colors[2] = {m_color, m_prev_color};
+    for (int i = 0; i < 2; i++){
+        out.PutU8(colors[i].r);
+        out.PutU8(colors[i].g);
+        out.PutU8(colors[i].b);
+        out.PutU8(colors[i].a);
+    }
+    out.PutVarint(m_layer);
+    m_selection->Serialize(out);
+}
 
+/*! \brief Create a clear command from the data written by Serialize().
+    \return the command, or nullptr if the data is damaged
+*/
+std::shared_ptr<Command> ClearCanvas::Deserialize(ByteReader &in, App &app){
+    sf::Color colors[2];
+    for (int i = 0; i < 2; i++){
+        colors[i].r = in.GetU8();
+        colors[i].g = in.GetU8();
+        colors[i].b = in.GetU8();
+        colors[i].a = in.GetU8();
+    }
+    unsigned layer = static_cast<unsigned>(in.GetVarint());
+    std::shared_ptr<SelectionMask> selection = std::make_shared<SelectionMask>(app.GetLayers().GetWidth(),
+                                                                               app.GetLayers().GetHeight());
+    if (!selection->Deserialize(in) || !in.Ok()){
+        return nullptr;
+    }
+    std::shared_ptr<ClearCanvas> clear = std::make_shared<ClearCanvas>("clear", colors[0], colors[1], app);
+    clear->m_layer = layer;
+    clear->m_selection = selection;
+    clear->m_prev_img = selection->IsActive() ? TiledImage() : app.GetLayers().Snapshot(layer);
+    return clear;
+}
@@ -10,12 +10,61 @@
 // Include standard library C++ libraries.
 #include <string>
 // Project header files
+#include "ClearCanvas.hpp"
 #include "Command.hpp"
+#include "Draw.hpp"
+#include "FilterCommand.hpp"
+#include "ImportCommand.hpp"
+#include "LayerCommand.hpp"
+#include "RevertCommand.hpp"
+
+namespace {
+
+typedef std::shared_ptr<Command> (*CommandReader)(ByteReader &in, App &app);
+
+// Indexed by CommandType
+const CommandReader g_commandReaders[COMMAND_TYPE_COUNT] = {
+	&Draw::Deserialize,
+	&ClearCanvas::Deserialize,
+	&LayerCommand::Deserialize,
+	&FilterCommand::Deserialize,
+	&RevertCommand::Deserialize,
+	&ImportCommand::Deserialize
+};
+
+}
+
+/*! \brief 	Get a short name for a kind of command, as used in reports.
+*
+*/
+const char* GetCommandTypeName(CommandType type){
+	static const char* const names[COMMAND_TYPE_COUNT] = {"draw", "clear", "layer", "filter", "revert", "import"};
+	return type < COMMAND_TYPE_COUNT ? names[type] : "unknown";
+}
+
+/*! \brief 	Write a command with its type in front.
+*
+*/
+void WriteCommand(const Command &command, ByteWriter &out){
+	out.PutU8(static_cast<std::uint8_t>(command.GetType()));
+	command.Serialize(out);
+}
+
+/*! \brief 	Read a command written by WriteCommand().
+	\return the command, or nullptr if the data is damaged
+*/
+std::shared_ptr<Command> ReadCommand(ByteReader &in, App &app){
+	std::uint8_t type = in.GetU8();
+	if (!in.Ok() || type >= COMMAND_TYPE_COUNT){
+		return nullptr;
+	}
+	return g_commandReaders[type](in, app);
+}
 
 /*! \brief 	N/A
 *
 */
-Command::Command(const std::string &commandDescription) : m_commandDescription(commandDescription) {
+Command::Command(const char* commandDescription) : m_commandDescription(commandDescription), m_record(0) {
 }
 
 /*! \brief 	N/A
@@ -23,3 +72,45 @@ Command::Command(const std::string &commandDescription) : m_commandDescription(c
 */
 Command::~Command(){
 }
+
+/*! \brief 	Undo the command, for commands whose pixels are not shared.
+*
+*/
+bool Command::revert(){
+	return undo();
+}
+
+/*! \brief 	Execute the command again, for commands whose pixels are not shared.
+*
+*/
+bool Command::unrevert(){
+	return execute();
+}
+
+/*! \brief 	Stamp the command with when the input that made it was polled.
+	\param time time of the input, default constructed if there was none
+*/
+void Command::SetInputTime(InputClock::time_point time){
+	m_inputTime = time;
+}
+
+/*! \brief 	Get when the input that made the command was polled.
+	\return default constructed time if it did not come from input
+*/
+InputClock::time_point Command::GetInputTime() const{
+	return m_inputTime;
+}
+
+/*! \brief 	Keep the number the journal gave the record of the command.
+*
+*/
+void Command::SetRecord(std::uint64_t record){
+	m_record = record;
+}
+
+/*! \brief 	Get the number the journal gave the record of the command.
+	\return 0 if the command was not journaled
+*/
+std::uint64_t Command::GetRecord() const{
+	return m_record;
+}
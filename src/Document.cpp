@@ -0,0 +1,425 @@
+/**
+ *  @file   Document.cpp
+ *  @brief  Implementation of Document.hpp
+ *  @author Team Avengers
+ *  @date   2020-12-07
+ ***********************************************/
+
+// Include our Third-Party SFML header
+#include <SFML/Graphics/Color.hpp>
+// Include standard library C++ libraries.
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+// Project header files
+#include "Document.hpp"
+#include "Trace.hpp"
+
+namespace {
+
+const char PROJECT_MAGIC[8] = {'F', 'S', 'D', 'P', 'R', 'O', 'J', '1'};
+const char INDEX_MAGIC[4] = {'F', 'S', 'D', 'I'};
+// The header gets a page of its own so tile data starts page aligned.
+const std::uint64_t HEADER_BYTES = 4096;
+// Tiles are page aligned, so faulting one in never reads part of another.
+const std::uint64_t TILE_ALIGN = 4096;
+// Tiles are collected and written this many at a time.
+const std::size_t WRITE_BATCH = 64;
+
+void Put32(std::vector<unsigned char> &out, std::uint32_t value){
+    for (int i = 0; i < 4; i++){
+        out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+}
+
+void Put64(std::vector<unsigned char> &out, std::uint64_t value){
+    for (int i = 0; i < 8; i++){
+        out.push_back(static_cast<unsigned char>(value >> (8 * i)));
+    }
+}
+
+std::uint32_t Crc(const unsigned char* data, std::size_t size){
+    return static_cast<std::uint32_t>(crc32(0L, data, static_cast<uInt>(size)));
+}
+
+// Reads little endian values and remembers if it ran past the end.
+class Reader{
+public:
+    Reader(const unsigned char* data, std::size_t size): m_data(data), m_left(size), m_ok(true){
+    }
+
+    const unsigned char* Bytes(std::size_t size){
+        if (size > m_left){
+            Fail();
+            return nullptr;
+        }
+        const unsigned char* bytes = m_data;
+        m_data += size;
+        m_left -= size;
+        return bytes;
+    }
+
+    std::uint64_t Get(int size){
+        const unsigned char* bytes = Bytes(size);
+        std::uint64_t value = 0;
+        for (int i = 0; bytes && i < size; i++){
+            value |= static_cast<std::uint64_t>(bytes[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    bool Ok() const{
+        return m_ok;
+    }
+
+    void Fail(){
+        m_ok = false;
+        m_left = 0;
+    }
+
+private:
+    const unsigned char* m_data;
+    std::size_t m_left;
+    bool m_ok;
+};
+
+bool WriteAll(int fd, const void* data, std::size_t size, std::uint64_t offset){
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0){
+        ssize_t written = pwrite(fd, bytes, size, static_cast<off_t>(offset));
+        if (written <= 0){
+            return false;
+        }
+        bytes += written;
+        size -= written;
+        offset += written;
+    }
+    return true;
+}
+
+// Find the newest index in a mapped project file.
+bool ReadHeader(const unsigned char* base, std::uint64_t size, std::uint64_t &index, std::uint64_t &end){
+    if (size < HEADER_BYTES || std::memcmp(base, PROJECT_MAGIC, 8) != 0){
+        return false;
+    }
+    Reader reader(base + 8, 28);
+    index = reader.Get(8);
+    std::uint64_t indexSize = reader.Get(8);
+    end = reader.Get(8);
+    std::uint32_t crc = static_cast<std::uint32_t>(reader.Get(4));
+    return crc == Crc(base, 32) && end <= size && index >= HEADER_BYTES && index + indexSize <= end;
+}
+
+}
+
+struct Document::Mapping{
+    void*       address;
+    std::size_t size;
+
+    Mapping(void* a, std::size_t s): address(a), size(s){
+    }
+
+    ~Mapping(){
+        munmap(address, size);
+    }
+};
+
+/*! \brief Construct an unsaved document with a single background layer.
+    \param width width of the canvas in pixels
+    \param height height of the canvas in pixels
+    \param background color of the background layer
+*/
+Document::Document(unsigned width, unsigned height, const sf::Color &background):
+ m_layers(new LayerStack(width, height, background)), m_index(0), m_fileSize(0), m_revisions(0){
+}
+
+/*! \brief Document destructor.
+*/
+Document::~Document(){
+    delete m_layers;
+}
+
+/*! \brief Get the layers of the document.
+*/
+LayerStack& Document::GetLayers(){
+    return *m_layers;
+}
+
+/*! \brief Get the project file the document was last saved to or opened from.
+*/
+const std::string& Document::GetPath() const{
+    return m_path;
+}
+
+/*! \brief Get the number of saves in the project file.
+*/
+unsigned Document::GetRevisionCount() const{
+    return m_revisions;
+}
+
+/*! \brief Get a message describing the last save or open.
+*/
+const std::string& Document::GetStatus() const{
+    return m_status;
+}
+
+/*! \brief Save the document to a project file.
+        Saving to the file it was last saved to only appends the tiles
+        that changed, any other file is written from scratch.
+    \param path project file to write
+    \return true if the save is complete and on disk
+*/
+bool Document::Save(const std::string &path){
+    TraceScope trace("Save project");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool incremental = path == m_path && m_fileSize > 0;
+    // A new file is written next to the target and renamed over it. Tiles
+    // of an opened project may still point into the file being replaced,
+    // which must not be cut short under them.
+    std::string target = incremental ? path : path + ".tmp";
+    int fd = open(target.c_str(), O_RDWR | O_CREAT | (incremental ? 0 : O_TRUNC), 0644);
+    if (fd < 0){
+        m_status = "Could not save " + path;
+        return false;
+    }
+    bool ok = true;
+    std::uint64_t end = incremental ? m_fileSize : HEADER_BYTES;
+    if (!incremental){
+        // A zeroed header is not valid, so a half written file never opens.
+        std::vector<unsigned char> blank(HEADER_BYTES, 0);
+        ok = WriteAll(fd, &blank[0], blank.size(), 0);
+    }
+    end = (end + TILE_ALIGN - 1) / TILE_ALIGN * TILE_ALIGN;
+
+    TileOffsets previous;
+    if (incremental){
+        previous.swap(m_saved);
+    }
+    TileOffsets saved;
+    std::vector<unsigned char> index(INDEX_MAGIC, INDEX_MAGIC + 4);
+    Put64(index, incremental ? m_index : 0);
+    Put32(index, m_layers->GetWidth());
+    Put32(index, m_layers->GetHeight());
+    Put32(index, static_cast<std::uint32_t>(m_layers->GetLayerCount()));
+    Put32(index, static_cast<std::uint32_t>(m_layers->GetActiveIndex()));
+
+    // New tiles are gathered into one buffer and written together.
+    std::vector<unsigned char> batch;
+    batch.reserve(WRITE_BATCH * TILE_BYTES);
+    std::uint64_t batchOffset = end;
+    unsigned written = 0;
+    for (std::size_t i = 0; ok && i < m_layers->GetLayerCount(); i++){
+        std::shared_ptr<Layer> layer = m_layers->GetLayer(i);
+        const TiledImage &pixels = layer->GetPixels();
+        Put32(index, static_cast<std::uint32_t>(layer->GetName().size()));
+        index.insert(index.end(), layer->GetName().begin(), layer->GetName().end());
+        index.push_back(layer->GetOpacity());
+        index.push_back(layer->IsVisible() ? 1 : 0);
+        index.push_back(static_cast<unsigned char>(layer->GetBlendMode()));
+        index.push_back(0);
+        for (unsigned t = 0; ok && t < pixels.GetTileCount(); t++){
+            TilePtr tile = pixels.GetTilePtr(t);
+            std::uint64_t offset = 0;
+            if (tile){
+                TileOffsets::iterator found = saved.find(tile.get());
+                if (found != saved.end()){
+                    offset = found->second.second;
+                } else{
+                    found = previous.find(tile.get());
+                    if (found != previous.end()){
+                        offset = found->second.second;
+                    } else{
+                        offset = end;
+                        end += TILE_BYTES;
+                        batch.insert(batch.end(), tile.get(), tile.get() + TILE_BYTES);
+                        written++;
+                        if (batch.size() == WRITE_BATCH * TILE_BYTES){
+                            ok = WriteAll(fd, &batch[0], batch.size(), batchOffset);
+                            batchOffset = end;
+                            batch.clear();
+                        }
+                    }
+                    saved[tile.get()] = std::make_pair(tile, offset);
+                }
+            }
+            Put64(index, offset);
+        }
+    }
+    if (ok && !batch.empty()){
+        ok = WriteAll(fd, &batch[0], batch.size(), batchOffset);
+    }
+    Put32(index, Crc(&index[0], index.size()));
+    std::uint64_t indexOffset = end;
+    ok = ok && WriteAll(fd, &index[0], index.size(), indexOffset);
+    end += index.size();
+
+    // The data has to be on disk before the header points at it.
+    ok = ok && fsync(fd) == 0;
+    std::vector<unsigned char> header(PROJECT_MAGIC, PROJECT_MAGIC + 8);
+    Put64(header, indexOffset);
+    Put64(header, index.size());
+    Put64(header, end);
+    Put32(header, Crc(&header[0], header.size()));
+    ok = ok && WriteAll(fd, &header[0], header.size(), 0) && fsync(fd) == 0;
+    close(fd);
+    ok = ok && (incremental || rename(target.c_str(), path.c_str()) == 0);
+
+    if (!ok){
+        // The header still points at the last good save.
+        if (incremental){
+            m_saved.swap(previous);
+        } else{
+            unlink(target.c_str());
+        }
+        m_status = "Could not save " + path;
+        return false;
+    }
+    if (!incremental){
+        m_mapping.reset();
+        m_revisions = 0;
+    }
+    m_saved.swap(saved);
+    m_path = path;
+    m_index = indexOffset;
+    m_fileSize = end;
+    m_revisions++;
+    long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    m_status = "Saved " + path + ": " + std::to_string(written) + " of " + std::to_string(m_saved.size()) +
+               " tiles written (" + std::to_string(ms) + " ms)";
+    return true;
+}
+
+/*! \brief Open a project file in place of the current layers.
+        Only the index is read, the tiles are loaded on first use.
+    \param path project file to open
+    \param revision 0 for the last save, 1 for the one before it and so on
+    \return true if the file was opened, on failure the document is unchanged
+*/
+bool Document::Open(const std::string &path, unsigned revision){
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    m_status = "Could not open " + path;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0){
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<std::uint64_t>(info.st_size) < HEADER_BYTES){
+        close(fd);
+        return false;
+    }
+    // Private and writable, so a tile written in place by mistake only
+    // changes our copy of the page and never the file.
+    std::size_t size = static_cast<std::size_t>(info.st_size);
+    void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED){
+        return false;
+    }
+    std::shared_ptr<Mapping> mapping = std::make_shared<Mapping>(address, size);
+    const unsigned char* base = static_cast<const unsigned char*>(address);
+
+    std::uint64_t newest = 0;
+    std::uint64_t end = 0;
+    if (!ReadHeader(base, size, newest, end)){
+        return false;
+    }
+    // Walk back through the saves, each index starts with the offset of the one before.
+    // Saves only append, so that offset is always smaller, which also keeps
+    // a damaged chain from going around in circles.
+    unsigned revisions = 0;
+    std::uint64_t index = 0;
+    for (std::uint64_t at = newest; at != 0; revisions++){
+        if (at < HEADER_BYTES || at + 12 > end || std::memcmp(base + at, INDEX_MAGIC, 4) != 0){
+            return false;
+        }
+        if (revisions == revision){
+            index = at;
+        }
+        Reader reader(base + at + 4, 8);
+        std::uint64_t previous = reader.Get(8);
+        if (previous >= at){
+            return false;
+        }
+        at = previous;
+    }
+    if (index == 0){
+        m_status = "No revision " + std::to_string(revision) + " in " + path;
+        return false;
+    }
+
+    Reader reader(base + index, end - index);
+    reader.Bytes(4);
+    reader.Get(8);
+    unsigned width = static_cast<unsigned>(reader.Get(4));
+    unsigned height = static_cast<unsigned>(reader.Get(4));
+    std::uint64_t count = reader.Get(4);
+    unsigned active = static_cast<unsigned>(reader.Get(4));
+    if (!reader.Ok() || width == 0 || height == 0 || count == 0){
+        return false;
+    }
+    LayerStack* layers = new LayerStack(width, height, sf::Color::Transparent);
+    unsigned placeholder = layers->GetActiveId();
+    std::vector<unsigned> ids;
+    TileOffsets saved;
+    for (std::uint64_t i = 0; reader.Ok() && i < count; i++){
+        std::size_t nameSize = static_cast<std::size_t>(reader.Get(4));
+        const unsigned char* name = reader.Bytes(nameSize);
+        sf::Uint8 opacity = static_cast<sf::Uint8>(reader.Get(1));
+        bool visible = reader.Get(1) != 0;
+        unsigned mode = static_cast<unsigned>(reader.Get(1));
+        reader.Get(1);
+        if (!reader.Ok() || mode >= BLEND_MODE_COUNT){
+            break;
+        }
+        std::shared_ptr<Layer> layer = layers->CreateLayer(std::string(reinterpret_cast<const char*>(name), nameSize));
+        TiledImage &pixels = layer->GetPixels();
+        for (unsigned t = 0; t < pixels.GetTileCount(); t++){
+            std::uint64_t offset = reader.Get(8);
+            if (offset == 0){
+                continue;
+            }
+            if (offset < HEADER_BYTES || offset + TILE_BYTES > end){
+                reader.Fail();
+                break;
+            }
+            // Points into the mapping and keeps it alive, nothing is read yet.
+            TilePtr tile(mapping, const_cast<sf::Uint8*>(base + offset));
+            pixels.SetTilePtr(t, tile);
+            saved[tile.get()] = std::make_pair(tile, offset);
+        }
+        layers->InsertLayer(layer, layers->GetLayerCount());
+        layers->SetOpacity(layer->GetId(), opacity);
+        layers->SetVisible(layer->GetId(), visible);
+        layers->SetBlendMode(layer->GetId(), static_cast<BlendMode>(mode));
+        ids.push_back(layer->GetId());
+    }
+    // The index ends with a checksum of everything before it.
+    const unsigned char* tail = reader.Bytes(4);
+    if (!reader.Ok() || ids.size() != count ||
+        Reader(tail, 4).Get(4) != Crc(base + index, static_cast<std::size_t>(tail - (base + index)))){
+        delete layers;
+        return false;
+    }
+    layers->RemoveLayer(placeholder);
+    layers->SetActive(ids[active < ids.size() ? active : ids.size() - 1]);
+    layers->MarkAllDirty();
+
+    delete m_layers;
+    m_layers = layers;
+    m_mapping = mapping;
+    m_saved.swap(saved);
+    m_path = path;
+    m_index = newest;
+    m_fileSize = end;
+    m_revisions = revisions;
+    long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    m_status = "Opened " + path + " revision " + std::to_string(revisions - revision) + " of " +
+               std::to_string(revisions) + " (" + std::to_string(ms) + " ms)";
+    return true;
+}
@@ -8,23 +8,25 @@
 // Include our Third-Party SFML header
 #include <SFML/Graphics/Color.hpp>
 // Include standard library C++ libraries.
-// #include ...
+#include <cstring>
 // Project header files
 #include "App.hpp"
 #include "Draw.hpp"
+#include "LayerStack.hpp"
+#include "Memory.hpp"
 #include <iostream>
 
 /*! \brief Draw constructor which initializes all members
     \param m_commandDescription string of command description "draw" for draw
     \param coord sf::Vector2i location of the pixel being changed
     \param color color the pixel is being changed to
-    \param background color of the background
-    \param app reference to app object holding the image and actions
+    \param app reference to app object holding the layers and actions
 */
-Draw::Draw(const std::string &m_commandDescription,
-           sf::Vector2i coord, const sf::Color &color, const sf::Color &background, App &app):
+Draw::Draw(const char* m_commandDescription,
+           sf::Vector2i coord, const sf::Color &color, App &app):
             Command(m_commandDescription), m_coords(coord), m_color(color),
-            m_background(background), m_app(app){
+            m_layer(app.GetLayers().GetActiveId()), m_reverted(false), m_app(app){
+    m_coverage = InBounds() ? app.GetSelection().GetCoverage(m_coords.x, m_coords.y) : 0;
 }
 
 /*! \brief Draw destructor
@@ -39,10 +41,11 @@ bool Draw::compare(const std::shared_ptr<Command> &c_rhs){
     const auto rhs = std::dynamic_pointer_cast<Draw>(c_rhs);
 
     if (rhs){
-        return (m_commandDescription.compare(rhs->m_commandDescription) == 0
+        return (std::strcmp(m_commandDescription, rhs->m_commandDescription) == 0
             && m_coords.x == rhs->m_coords.x
             && m_coords.y == rhs->m_coords.y
             && m_color == rhs->m_color
+            && m_layer == rhs->m_layer
             );
     } else{
         return false;
@@ -54,17 +57,33 @@ bool Draw::compare(const std::shared_ptr<Command> &c_rhs){
     \return boolean of if coordinate is in bounds of image window
 */
 bool Draw::InBounds(){
-    return (m_coords.x >= 0 && m_coords.x < m_app.GetWindowWidth() && m_coords.y >= 0 && m_coords.y < m_app.GetWindowHeight());
+    // The canvas of an opened project may be smaller than the window
+    LayerStack &layers = m_app.GetLayers();
+    return (m_coords.x >= 0 && m_coords.x < m_app.GetWindowWidth() && m_coords.y >= 0 && m_coords.y < m_app.GetWindowHeight()
+            && m_coords.x < static_cast<int>(layers.GetWidth()) && m_coords.y < static_cast<int>(layers.GetHeight()));
 }
 
 
 /*! \brief 	Execute the draw command by drawing a pixel.
+        The previous pixel is remembered so undo can put it back.
+        Pixels outside the selection are left alone, and so is a
+        layer that was removed since.
     \return boolean of if draw was valid.
 */
 bool Draw::execute(){
-    if (InBounds()){
+    if (InBounds() && m_coverage > 0 && m_app.GetLayers().FindLayer(m_layer)){
         // std::cout << "Drawing at (" << m_coords.x << ", " << m_coords.y << ")" << std::endl;
-        m_app.GetImage().setPixel(m_coords.x, m_coords.y, m_color);
+        LayerStack &layers = m_app.GetLayers();
+        m_prev = layers.GetPixel(m_layer, m_coords.x, m_coords.y);
+        sf::Color color = TiledImage::Premultiply(m_color);
+        if (m_coverage < 255){
+            color.r = m_prev.r + (color.r - m_prev.r) * m_coverage / 255;
+            color.g = m_prev.g + (color.g - m_prev.g) * m_coverage / 255;
+            color.b = m_prev.b + (color.b - m_prev.b) * m_coverage / 255;
+            color.a = m_prev.a + (color.a - m_prev.a) * m_coverage / 255;
+        }
+        layers.SetPixel(m_layer, m_coords.x, m_coords.y, color);
+        m_after = color;
         return true;
     }
     else{
@@ -73,15 +92,117 @@ bool Draw::execute(){
 
 }
 
-/*! \brief 	Undo this current draw command by making the pixel white again.
+/*! \brief 	Undo this current draw command by putting back the previous pixel.
 *
 */
 bool Draw::undo(){
 	if (InBounds()){
-        m_app.GetImage().setPixel(m_coords.x, m_coords.y, m_background);
+        m_app.GetLayers().SetPixel(m_layer, m_coords.x, m_coords.y, m_prev);
         return true;
     }
     else{
         return false;
     }
 }
+
+/*! \brief 	Put back the previous pixel if nobody drew over it since.
+*
+*/
+bool Draw::revert(){
+    m_reverted = false;
+    if (InBounds() && m_coverage > 0){
+        LayerStack &layers = m_app.GetLayers();
+        if (layers.GetPixel(m_layer, m_coords.x, m_coords.y) == m_after){
+            layers.SetPixel(m_layer, m_coords.x, m_coords.y, m_prev);
+            m_reverted = true;
+        }
+        return true;
+    }
+    return false;
+}
+
+/*! \brief 	Draw the pixel again if the last revert() put back the previous one.
+*
+*/
+bool Draw::unrevert(){
+    if (m_reverted){
+        m_app.GetLayers().SetPixel(m_layer, m_coords.x, m_coords.y, m_after);
+        m_reverted = false;
+    }
+    return true;
+}
+
+/*! \brief Get the kind of command.
+*/
+CommandType Draw::GetType() const{
+    return COMMAND_DRAW;
+}
+
+/*! \brief Write the pixel, color, layer and selection coverage of the draw.
+*/
+void Draw::Serialize(ByteWriter &out) const{
+    out.PutSigned(m_coords.x);
+    out.PutSigned(m_coords.y);
+    out.PutU8(m_color.r);
+    out.PutU8(m_color.g);
+    out.PutU8(m_color.b);
+    out.PutU8(m_color.a);
+    out.PutVarint(m_layer);
+    out.PutU8(m_coverage);
+}
+
+/*! \brief Create a draw command from the data written by Serialize().
+    \return the command, or nullptr if the data is damaged
+*/
+std::shared_ptr<Command> Draw::Deserialize(ByteReader &in, App &app){
+    sf::Vector2i coords;
+    coords.x = static_cast<int>(in.GetSigned());
+    coords.y = static_cast<int>(in.GetSigned());
+    sf::Color color;
+    color.r = in.GetU8();
+    color.g = in.GetU8();
+    color.b = in.GetU8();
+    color.a = in.GetU8();
+    unsigned layer = static_cast<unsigned>(in.GetVarint());
+    sf::Uint8 coverage = in.GetU8();
+    if (!in.Ok()){
+        return nullptr;
+    }
+    return Create(coords, color, layer, coverage, app);
+}
+
+/*! \brief Create a draw command that was made on another canvas, with
+        the layer and coverage it had there.
+    \return the command
+*/
+std::shared_ptr<Command> Draw::Create(sf::Vector2i coord, const sf::Color &color, unsigned layer,
+    sf::Uint8 coverage, App &app){
+    std::shared_ptr<Draw> draw = MakePooled<Draw>("draw", coord, color, app);
+    draw->m_layer = layer;
+    draw->m_coverage = coverage;
+    return draw;
+}
+
+/*! \brief Get the pixel the command draws.
+*/
+sf::Vector2i Draw::GetCoords() const{
+    return m_coords;
+}
+
+/*! \brief Get the color the pixel is drawn with.
+*/
+sf::Color Draw::GetColor() const{
+    return m_color;
+}
+
+/*! \brief Get the layer the pixel is drawn on.
+*/
+unsigned Draw::GetLayer() const{
+    return m_layer;
+}
+
+/*! \brief Get how much of the pixel was selected.
+*/
+sf::Uint8 Draw::GetCoverage() const{
+    return m_coverage;
+}
@@ -0,0 +1,168 @@
+/**
+ *  @file   Filter.cpp
+ *  @brief  Implementation of Filter.hpp
+ *  @author Team Avengers
+ *  @date   2020-12-04
+ ***********************************************/
+
+// Include our Third-Party SFML header
+#include <SFML/Config.hpp>
+// Include standard library C++ libraries.
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+// Project header files
+#include "Filter.hpp"
+
+namespace {
+
+// Tile with a one pixel border taken from its neighbours.
+static const unsigned PADDED = TILE_SIZE + 2;
+
+const char* const g_filterNames[FILTER_COUNT] = {
+    "Sepia", "Gray Scale", "Sharpen", "Blur"
+};
+
+inline sf::Uint8 Clamp(int value, int high){
+    return static_cast<sf::Uint8>(std::max(0, std::min(value, high)));
+}
+
+// Filters that only look at one pixel. Colors are premultiplied, which
+// keeps these linear filters exact as long as the result stays below alpha.
+void PointFilter(FilterType type, const sf::Uint8* in, sf::Uint8* out){
+    for (unsigned i = 0; i < TILE_BYTES; i += 4){
+        int r = in[i + 0], g = in[i + 1], b = in[i + 2], a = in[i + 3];
+        if (type == FILTER_GRAYSCALE){
+            sf::Uint8 y = static_cast<sf::Uint8>((77 * r + 150 * g + 29 * b + 128) >> 8);
+            out[i + 0] = y;
+            out[i + 1] = y;
+            out[i + 2] = y;
+        } else{
+            out[i + 0] = Clamp((101 * r + 197 * g + 48 * b + 128) >> 8, a);
+            out[i + 1] = Clamp((89 * r + 176 * g + 43 * b + 128) >> 8, a);
+            out[i + 2] = Clamp((70 * r + 137 * g + 34 * b + 128) >> 8, a);
+        }
+        out[i + 3] = static_cast<sf::Uint8>(a);
+    }
+}
+
+// Copy a tile and its one pixel border into a PADDED x PADDED buffer.
+void Gather(const TiledImage &src, unsigned tile, sf::Uint8* padded){
+    int tx = (tile % src.GetTilesX()) * TILE_SIZE;
+    int ty = (tile / src.GetTilesX()) * TILE_SIZE;
+    int maxX = static_cast<int>(src.GetWidth()) - 1;
+    int maxY = static_cast<int>(src.GetHeight()) - 1;
+    const sf::Uint8* center = src.GetTile(tile);
+    for (unsigned py = 0; py < PADDED; py++){
+        int y = std::min(std::max(ty + static_cast<int>(py) - 1, 0), maxY);
+        sf::Uint8* row = padded + py * PADDED * 4;
+        bool inside = py > 0 && py <= TILE_SIZE && y == ty + static_cast<int>(py) - 1;
+        if (inside){
+            // Fast path: the middle of the row comes straight from the tile.
+            if (center){
+                std::memcpy(row + 4, center + (py - 1) * TILE_SIZE * 4, TILE_SIZE * 4);
+            } else{
+                std::memset(row + 4, 0, TILE_SIZE * 4);
+            }
+            int left = std::max(tx - 1, 0);
+            int right = std::min(tx + static_cast<int>(TILE_SIZE), maxX);
+            sf::Color l = src.GetPixel(left, y);
+            sf::Color r = src.GetPixel(right, y);
+            row[0] = l.r; row[1] = l.g; row[2] = l.b; row[3] = l.a;
+            sf::Uint8* last = row + (PADDED - 1) * 4;
+            last[0] = r.r; last[1] = r.g; last[2] = r.b; last[3] = r.a;
+        } else{
+            for (unsigned px = 0; px < PADDED; px++){
+                int x = std::min(std::max(tx + static_cast<int>(px) - 1, 0), maxX);
+                sf::Color c = src.GetPixel(x, y);
+                row[px * 4 + 0] = c.r;
+                row[px * 4 + 1] = c.g;
+                row[px * 4 + 2] = c.b;
+                row[px * 4 + 3] = c.a;
+            }
+        }
+    }
+}
+
+// 3x3 filters. Blur is a box filter, sharpen is the usual cross kernel.
+void NeighbourFilter(FilterType type, const sf::Uint8* padded, sf::Uint8* out){
+    const int stride = PADDED * 4;
+    for (unsigned y = 0; y < TILE_SIZE; y++){
+        const sf::Uint8* c = padded + (y + 1) * stride + 4;
+        sf::Uint8* o = out + y * TILE_SIZE * 4;
+        for (unsigned x = 0; x < TILE_SIZE * 4; x += 4){
+            const sf::Uint8* p = c + x;
+            if (type == FILTER_BLUR){
+                for (int k = 0; k < 4; k++){
+                    int sum = p[k - stride - 4] + p[k - stride] + p[k - stride + 4]
+                            + p[k - 4] + p[k] + p[k + 4]
+                            + p[k + stride - 4] + p[k + stride] + p[k + stride + 4];
+                    o[x + k] = static_cast<sf::Uint8>((sum + 4) / 9);
+                }
+            } else{
+                int a = Clamp(5 * p[3] - p[3 - stride] - p[3 + stride] - p[3 - 4] - p[3 + 4], 255);
+                for (int k = 0; k < 3; k++){
+                    o[x + k] = Clamp(5 * p[k] - p[k - stride] - p[k + stride] - p[k - 4] - p[k + 4], a);
+                }
+                o[x + 3] = static_cast<sf::Uint8>(a);
+            }
+        }
+    }
+}
+
+}
+
+/*! \brief Get the name of a filter as shown in the toolbar.
+*/
+const char* GetFilterName(FilterType type){
+    return g_filterNames[type];
+}
+
+/*! \brief Look up a filter by name, for the command line. Case, spaces,
+        dashes and underscores are ignored, so "grayscale" finds "Gray Scale".
+    \param name name of the filter
+    \param type set to the filter if it was found
+    \return true if there is a filter by that name
+*/
+bool FindFilter(const std::string &name, FilterType &type){
+    std::string wanted;
+    for (std::size_t i = 0; i < name.size(); i++){
+        if (std::isalnum(static_cast<unsigned char>(name[i]))){
+            wanted += static_cast<char>(std::tolower(static_cast<unsigned char>(name[i])));
+        }
+    }
+    for (int f = 0; f < FILTER_COUNT; f++){
+        std::string candidate;
+        for (const char* c = g_filterNames[f]; *c; c++){
+            if (std::isalnum(static_cast<unsigned char>(*c))){
+                candidate += static_cast<char>(std::tolower(static_cast<unsigned char>(*c)));
+            }
+        }
+        if (candidate == wanted){
+            type = static_cast<FilterType>(f);
+            return true;
+        }
+    }
+    return false;
+}
+
+/*! \brief Filter one tile of an image.
+    \param type filter to apply
+    \param src image to read from
+    \param tile index of the tile to filter
+    \param out receives TILE_BYTES bytes of filtered pixels
+*/
+void FilterTile(FilterType type, const TiledImage &src, unsigned tile, sf::Uint8* out){
+    if (type == FILTER_SEPIA || type == FILTER_GRAYSCALE){
+        const sf::Uint8* in = src.GetTile(tile);
+        if (!in){
+            std::memset(out, 0, TILE_BYTES);
+            return;
+        }
+        PointFilter(type, in, out);
+    } else{
+        sf::Uint8 padded[PADDED * PADDED * 4];
+        Gather(src, tile, padded);
+        NeighbourFilter(type, padded, out);
+    }
+}
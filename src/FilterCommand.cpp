@@ -0,0 +1,199 @@
+/**
+ *  @file   FilterCommand.cpp
+ *  @brief  Implementation of FilterCommand.hpp
+ *  @author Team Avengers
+ *  @date   2020-12-04
+ ***********************************************/
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <algorithm>
+#include <string>
+// Project header files
+#include "App.hpp"
+#include "FilterCommand.hpp"
+#include "LayerStack.hpp"
+#include "Trace.hpp"
+
+/*! \brief FilterCommand constructor, works on the active layer and selection.
+    \param m_commandDescription string of command description, the filter name
+    \param type filter to apply
+    \param app reference to app object holding the layers and actions
+*/
+FilterCommand::FilterCommand(const char* m_commandDescription, FilterType type, App &app):
+ Command(m_commandDescription), m_app(app), m_type(type),
+ m_layer(app.GetLayers().GetActiveId()), m_selection(app.GetSelectionSnapshot()){
+}
+
+/*! \brief FilterCommand destructor
+*/
+FilterCommand::~FilterCommand(){
+}
+
+/*! \brief Applying a filter twice is two separate actions.
+    \return false
+*/
+bool FilterCommand::compare(const std::shared_ptr<Command> &){
+    return false;
+}
+
+namespace {
+
+// Selected tiles filtered by one task
+const std::size_t FILTER_CHUNK = 8;
+
+// Filter the selected tiles from first to last into out. Tiles that stay
+// transparent are left null.
+void FilterRange(FilterType type, const TiledImage &pixels, const SelectionMask &selection,
+                 std::size_t first, std::size_t last, std::vector<TilePtr> &out){
+    const std::vector<unsigned> &tiles = selection.GetSelectedTiles();
+    for (std::size_t i = first; i < last; i++){
+        unsigned tile = tiles[i];
+        // Color filters leave transparent tiles transparent.
+        if (!pixels.GetTile(tile) && (type == FILTER_SEPIA || type == FILTER_GRAYSCALE)){
+            continue;
+        }
+        TraceScope trace("Filter tile");
+        TilePtr filtered = TiledImage::AllocateTile();
+        FilterTile(type, pixels, tile, filtered.get());
+        if (selection.GetTileState(tile) == SelectionMask::TILE_PARTIAL){
+            SelectionMask::ApplyCoverage(selection.GetTileCoverage(tile), pixels.GetTile(tile), filtered.get());
+        }
+        out[i] = filtered;
+    }
+}
+
+}
+
+/*! \brief 	Filter the selected tiles of an image. Nothing is written
+        to the image, so neighbourhood filters never read pixels that
+        were already filtered. Also used by the batch mode.
+    \param type filter to apply
+    \param pixels image to filter
+    \param selection tiles to filter and how much of each
+    \param filtered receives the index and new pixels of every filtered tile
+    \param tasks if not null, runs of tiles are filtered on its workers
+*/
+void FilterCommand::FilterSelection(FilterType type, const TiledImage &pixels, const SelectionMask &selection,
+                                    std::vector<std::pair<unsigned, TilePtr>> &filtered, TaskPool* tasks){
+    const std::vector<unsigned> &tiles = selection.GetSelectedTiles();
+    std::vector<TilePtr> out(tiles.size());
+    if (!tasks || tiles.size() <= FILTER_CHUNK){
+        FilterRange(type, pixels, selection, 0, tiles.size(), out);
+    } else{
+        TaskGroup group;
+        for (std::size_t first = 0; first < tiles.size(); first += FILTER_CHUNK){
+            std::size_t last = std::min(first + FILTER_CHUNK, tiles.size());
+            tasks->Submit(group, [type, &pixels, &selection, first, last, &out]{
+                FilterRange(type, pixels, selection, first, last, out);
+            });
+        }
+        tasks->Wait(group);
+    }
+    for (std::size_t i = 0; i < tiles.size(); i++){
+        if (out[i]){
+            filtered.push_back(std::make_pair(tiles[i], out[i]));
+        }
+    }
+}
+
+/*! \brief 	Filter every selected tile. All tiles are filtered from the
+        unchanged layer first and only then put in place.
+    \return boolean of if anything was selected
+*/
+bool FilterCommand::execute(){
+    LayerStack &layers = m_app.GetLayers();
+    std::shared_ptr<Layer> layer = layers.FindLayer(m_layer);
+    if (!layer || m_selection->GetSelectedTiles().empty()){
+        return false;
+    }
+    const TiledImage &pixels = layer->GetPixels();
+    std::vector<std::pair<unsigned, TilePtr>> filtered;
+    FilterSelection(m_type, pixels, *m_selection, filtered, &m_app.GetTasks());
+    m_prevTiles.clear();
+    m_afterTiles.clear();
+    for (std::size_t i = 0; i < filtered.size(); i++){
+        m_prevTiles.push_back(std::make_pair(filtered[i].first, pixels.GetTilePtr(filtered[i].first)));
+        m_afterTiles.push_back(filtered[i].second);
+    }
+    for (std::size_t i = 0; i < filtered.size(); i++){
+        layers.SetTile(m_layer, filtered[i].first, filtered[i].second);
+    }
+    return true;
+}
+
+/*! \brief 	Undo the filter by putting back the tiles it replaced.
+    \return boolean of if undo was completed
+*/
+bool FilterCommand::undo(){
+    LayerStack &layers = m_app.GetLayers();
+    for (std::size_t i = 0; i < m_prevTiles.size(); i++){
+        layers.SetTile(m_layer, m_prevTiles[i].first, m_prevTiles[i].second);
+    }
+    return true;
+}
+
+/*! \brief 	Put back the unfiltered pixels that nobody drew over since.
+    \return true
+*/
+bool FilterCommand::revert(){
+    LayerStack &layers = m_app.GetLayers();
+    m_revertTiles.clear();
+    for (std::size_t i = 0; i < m_afterTiles.size(); i++){
+        unsigned tile = m_prevTiles[i].first;
+        TilePtr current = layers.RevertTile(m_layer, tile, m_prevTiles[i].second, m_afterTiles[i]);
+        m_revertTiles.push_back(std::make_pair(tile, current));
+    }
+    return true;
+}
+
+/*! \brief 	Put back the tiles the last revert() replaced.
+    \return true
+*/
+bool FilterCommand::unrevert(){
+    LayerStack &layers = m_app.GetLayers();
+    for (std::size_t i = 0; i < m_revertTiles.size(); i++){
+        layers.SetTile(m_layer, m_revertTiles[i].first, m_revertTiles[i].second);
+    }
+    m_revertTiles.clear();
+    return true;
+}
+
+/*! \brief Get the layer that is filtered.
+*/
+unsigned FilterCommand::GetLayer() const{
+    return m_layer;
+}
+
+/*! \brief Get the kind of command.
+*/
+CommandType FilterCommand::GetType() const{
+    return COMMAND_FILTER;
+}
+
+/*! \brief Write the filter, the layer and the selection it runs on.
+*/
+void FilterCommand::Serialize(ByteWriter &out) const{
+    out.PutU8(static_cast<std::uint8_t>(m_type));
+    out.PutVarint(m_layer);
+    m_selection->Serialize(out);
+}
+
+/*! \brief Create a filter command from the data written by Serialize().
+    \return the command, or nullptr if the data is damaged
+*/
+std::shared_ptr<Command> FilterCommand::Deserialize(ByteReader &in, App &app){
+    std::uint8_t type = in.GetU8();
+    unsigned layer = static_cast<unsigned>(in.GetVarint());
+    std::shared_ptr<SelectionMask> selection = std::make_shared<SelectionMask>(app.GetLayers().GetWidth(),
+                                                                               app.GetLayers().GetHeight());
+    if (!selection->Deserialize(in) || !in.Ok() || type >= FILTER_COUNT){
+        return nullptr;
+    }
+    FilterType filter = static_cast<FilterType>(type);
+    std::shared_ptr<FilterCommand> command = std::make_shared<FilterCommand>(GetFilterName(filter), filter, app);
+    command->m_layer = layer;
+    command->m_selection = selection;
+    return command;
+}
@@ -0,0 +1,206 @@
+/**
+ *  @file   FontCache.cpp
+ *  @brief  Implementation of FontCache.hpp
+ *  @author Team Avengers
+ *  @date   2020-12-17
+ ***********************************************/
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+// Project header files
+#include "FontCache.hpp"
+
+namespace {
+
+const char CACHE_MAGIC[8] = {'F', 'S', 'D', 'F', 'O', 'N', 'T', '1'};
+
+// Fixed part of the file, followed by the key. Pixels start at the next
+// multiple of DATA_ALIGN, the tables right after them.
+struct Header{
+    char magic[8];
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t tablesSize;
+    std::uint32_t keySize;
+    // Of the pixels and the tables
+    std::uint32_t crc;
+    std::uint32_t reserved;
+};
+
+const std::size_t DATA_ALIGN = 16;
+
+std::size_t GetDataOffset(std::size_t keySize){
+    return (sizeof(Header) + keySize + DATA_ALIGN - 1) & ~(DATA_ALIGN - 1);
+}
+
+}
+
+/*! \brief Construct a cache with nothing loaded.
+*/
+FontCache::FontCache(): m_mapping(nullptr), m_size(0), m_pixels(nullptr), m_width(0), m_height(0),
+ m_tables(nullptr), m_tablesSize(0){
+}
+
+/*! \brief Unmap the cache file.
+*/
+FontCache::~FontCache(){
+    Close();
+}
+
+/*! \brief Map a cache file into memory.
+    \param path cache file to read
+    \param key font and size the atlas has to be baked for
+    \return false if there is no valid cache for the key
+*/
+bool FontCache::Open(const std::string &path, const std::string &key){
+    Close();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0){
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(Header)){
+        close(fd);
+        return false;
+    }
+    std::size_t size = static_cast<std::size_t>(info.st_size);
+    void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED){
+        return false;
+    }
+    m_mapping = address;
+    m_size = size;
+    const unsigned char* base = static_cast<const unsigned char*>(address);
+    Header header;
+    std::memcpy(&header, base, sizeof(header));
+    std::size_t offset = GetDataOffset(header.keySize);
+    std::size_t pixelBytes = static_cast<std::size_t>(header.width) * header.height * 4;
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.keySize != key.size() ||
+        offset > size || size - offset != pixelBytes + header.tablesSize ||
+        std::memcmp(base + sizeof(Header), key.data(), key.size()) != 0 ||
+        crc32(0L, base + offset, static_cast<uInt>(size - offset)) != header.crc){
+        Close();
+        return false;
+    }
+    m_pixels = base + offset;
+    m_width = static_cast<int>(header.width);
+    m_height = static_cast<int>(header.height);
+    m_tables = base + offset + pixelBytes;
+    m_tablesSize = header.tablesSize;
+    return true;
+}
+
+/*! \brief Unmap the cache file. The pixels and tables are gone after this.
+*/
+void FontCache::Close(){
+    if (m_mapping){
+        munmap(m_mapping, m_size);
+    }
+    m_mapping = nullptr;
+    m_size = 0;
+    m_pixels = nullptr;
+    m_width = 0;
+    m_height = 0;
+    m_tables = nullptr;
+    m_tablesSize = 0;
+}
+
+/*! \brief Get the RGBA pixels of the atlas, rows top to bottom.
+*/
+const void* FontCache::GetPixels() const{
+    return m_pixels;
+}
+
+/*! \brief Get the width of the atlas in pixels.
+*/
+int FontCache::GetWidth() const{
+    return m_width;
+}
+
+/*! \brief Get the height of the atlas in pixels.
+*/
+int FontCache::GetHeight() const{
+    return m_height;
+}
+
+/*! \brief Get the glyph tables, aligned to 4 bytes.
+*/
+const void* FontCache::GetTables() const{
+    return m_tables;
+}
+
+/*! \brief Get the size of the glyph tables in bytes.
+*/
+std::size_t FontCache::GetTablesSize() const{
+    return m_tablesSize;
+}
+
+/*! \brief Write a cache file. It is written next to the path and renamed
+        over it, so a cache that is being read is never half written.
+    \param path cache file to write
+    \param key font and size the atlas was baked for
+    \param pixels RGBA pixels of the atlas
+    \param width width of the atlas in pixels
+    \param height height of the atlas in pixels
+    \param tables glyph tables of the GUI backend
+    \param tablesSize size of the tables in bytes
+    \return true if the cache is on disk
+*/
+bool FontCache::Write(const std::string &path, const std::string &key, const void* pixels, int width,
+                      int height, const void* tables, std::size_t tablesSize){
+    if (width <= 0 || height <= 0){
+        return false;
+    }
+    std::size_t pixelBytes = static_cast<std::size_t>(width) * height * 4;
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.width = static_cast<std::uint32_t>(width);
+    header.height = static_cast<std::uint32_t>(height);
+    header.tablesSize = static_cast<std::uint32_t>(tablesSize);
+    header.keySize = static_cast<std::uint32_t>(key.size());
+    uLong crc = crc32(0L, static_cast<const Bytef*>(pixels), static_cast<uInt>(pixelBytes));
+    header.crc = static_cast<std::uint32_t>(crc32(crc, static_cast<const Bytef*>(tables), static_cast<uInt>(tablesSize)));
+    static const char padding[DATA_ALIGN] = {0};
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary.c_str(), std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(key.data(), key.size());
+        out.write(padding, GetDataOffset(key.size()) - sizeof(header) - key.size());
+        out.write(static_cast<const char*>(pixels), pixelBytes);
+        out.write(static_cast<const char*>(tables), tablesSize);
+        out.close();
+        if (!out){
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+/*! \brief Get the cache file of a font, in the working directory like the
+        journal.
+    \param font name of the font
+    \param size height of the font in pixels
+*/
+std::string FontCache::GetPath(const std::string &font, float size){
+    std::string path = "fsd-font-";
+    for (std::size_t i = 0; i < font.size(); i++){
+        char c = font[i];
+        bool plain = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9');
+        path += plain ? c : '_';
+    }
+    return path + "-" + std::to_string(static_cast<int>(size * 10)) + ".cache";
+}
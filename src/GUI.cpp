@@ -23,23 +23,35 @@
 #define NK_INCLUDE_FIXED_TYPES
 #define NK_INCLUDE_STANDARD_IO
 #define NK_INCLUDE_STANDARD_VARARGS
-#define NK_INCLUDE_DEFAULT_ALLOCATOR
 #define NK_INCLUDE_VERTEX_BUFFER_OUTPUT
 #define NK_INCLUDE_FONT_BAKING
 #define NK_INCLUDE_DEFAULT_FONT
 #define NK_IMPLEMENTATION
 #define NK_SFML_GL2_IMPLEMENTATION
+#define NK_RAWFB_IMPLEMENTATION
 #include "nuklear.h"
 #include "nuklear_sfml_gl2.h"
+#include "nuklear_rawfb.h"
 
 // Include standard library C++ libraries.
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include "GUI.hpp"
 // Project header files
 #include "App.hpp"
 #include "Command.hpp"
+#include "FontCache.hpp"
 #include "Draw.hpp"
 #include "ClearCanvas.hpp"
+#include "FilterCommand.hpp"
+#include "ImageExport.hpp"
+#include "ImageImport.hpp"
+#include "Latency.hpp"
+#include "LayerCommand.hpp"
+#include "LayerStack.hpp"
+#include "Profiler.hpp"
+#include "Trace.hpp"
 #include <memory>
 
 // Global commbo box color value
@@ -47,10 +59,71 @@
 // If you store it as an attribute of GUI, it will crash the program.
 // Not worth the headache of enccapulating it.
 static struct nk_colorf combo_box_color = {0.25f, 0.75f, 0.25f, 1.0f};
+// Color the toolbar window is cleared with
+static struct nk_colorf background_color = {0.0f, 0.0f, 0.0f, 1.0f};
+// File name typed into the save field, same reason as above
+static char save_name[256] = "canvas";
+// Files typed into the open field, separated by ';'
+static char open_names[1024] = "";
+// Project file typed into the project field
+static char project_name[256] = "canvas.fsd";
+// Server to draw together on, host:port
+static char server_address[256] = "localhost:7777";
+
+// Nuklear runs in a fixed block of memory: the context with its windows
+// and the widgets of a frame, the draw calls of a frame and the font.
+// A layout bigger than the toolbar needs 62 KB of context and under 1 KB
+// of draw calls, the default font takes 52 KB.
+static const nk_size GUI_CONTEXT_BYTES = 256 * 1024;
+static const nk_size GUI_COMMAND_BYTES = 16 * 1024;
+static const nk_size GUI_FONT_BYTES = 64 * 1024;
+// Without a window there is no command buffer, but the state of the
+// software renderer, 17 KB, and its ALPHA8 font texture, 64 KB.
+static const nk_size GUI_RAWFB_BYTES = 96 * 1024;
+
+// What Nuklear keeps comes from the fixed memory of the GUI.
+static void* permanent_alloc(nk_handle handle, void* old, nk_size size) {
+    (void)old;
+    return static_cast<FixedArena*>(handle.ptr)->Allocate(size);
+}
+
+// Nuklear's vertex and element buffers, and the memory used while baking
+// the font, come from the frame arena of the app and are given back with
+// the rest of the frame.
+static void* frame_alloc(nk_handle handle, void* old, nk_size size) {
+    (void)old;
+    return static_cast<App*>(handle.ptr)->GetFrameArena().Allocate(size);
+}
+
+// Arena memory is given back all at once, never one allocation at a time
+static void arena_free(nk_handle handle, void* old) {
+    (void)handle;
+    (void)old;
+}
 
 GUI::GUI(App* a) {
+    setDefaults(a);
+    // Initializes GUI window
+    this->Init();
+}
+
+/*! \brief Construct a GUI without a window, drawing into memory.
+    \param a app the toolbar works on
+    \param width width of the framebuffer
+    \param height height of the framebuffer
+*/
+GUI::GUI(App* a, unsigned width, unsigned height) {
+    setDefaults(a);
+    this->InitHeadless(width, height);
+}
+
+void GUI::setDefaults(App* a) {
     // Canvas to draw GUI on
     app = a;
+    window = nullptr;
+    memory = nullptr;
+    rawfb = nullptr;
+    ctx = nullptr;
 
     // Pixel size of brush
     brush_size = 1;
@@ -63,13 +136,14 @@ GUI::GUI(App* a) {
     preset_index = 1;
     // List to store preset color options
     this->setPresetColors();
-    struct nk_colorf bg_pointer = {0.0f, 0.0f, 0.0f, 1.0f}; 
-    bg = &bg_pointer;
-    // Initializes GUI window
-    this->Init();
+    bg = &background_color;
 }
 
 GUI::~GUI() {
+    if (rawfb) {
+        nk_rawfb_shutdown(rawfb);
+    }
+    delete memory;
 }
 
 void GUI::setPresetColors(){
@@ -97,46 +171,146 @@ void GUI::Init() {
     window->setVerticalSyncEnabled(true);
     window->setActive(true);
     glViewport(0, 0, window->getSize().x, window->getSize().y);
-    ctx = nk_sfml_init(window);
-    struct nk_font_atlas *atlas;
-    nk_sfml_font_stash_begin(&atlas);
-    nk_sfml_font_stash_end();
+    memory = new FixedArena(GUI_CONTEXT_BYTES + GUI_COMMAND_BYTES + GUI_FONT_BYTES);
+    struct nk_allocator permanent;
+    permanent.userdata = nk_handle_ptr(memory);
+    permanent.alloc = permanent_alloc;
+    permanent.free = arena_free;
+    struct nk_allocator frame;
+    frame.userdata = nk_handle_ptr(app);
+    frame.alloc = frame_alloc;
+    frame.free = arena_free;
+    ctx = nk_sfml_init_fixed(window, &permanent, &frame, GUI_CONTEXT_BYTES, GUI_COMMAND_BYTES);
+    this->loadFont();
+    std::cout << "GUI memory: " << memory->GetCapacity() / 1024 << " KB, font "
+              << (memory->GetUsed() - GUI_CONTEXT_BYTES - GUI_COMMAND_BYTES) / 1024 << " KB" << std::endl;
     if (window->isOpen()) {
         std::cout << "Gui window works" << std::endl;
     }
 }
 
+/*! \brief Set up the software renderer instead of a window. Nuklear runs
+        in the same fixed memory, the renderer bakes the default font.
+    \param width width of the framebuffer
+    \param height height of the framebuffer
+*/
+void GUI::InitHeadless(unsigned width, unsigned height) {
+    framebuffer_size = sf::Vector2u(width, height);
+    framebuffer.assign(static_cast<std::size_t>(width) * height * 4, 0);
+    memory = new FixedArena(GUI_CONTEXT_BYTES + GUI_FONT_BYTES + GUI_RAWFB_BYTES);
+    struct nk_allocator permanent;
+    permanent.userdata = nk_handle_ptr(memory);
+    permanent.alloc = permanent_alloc;
+    permanent.free = arena_free;
+    struct nk_allocator frame;
+    frame.userdata = nk_handle_ptr(app);
+    frame.alloc = frame_alloc;
+    frame.free = arena_free;
+    rawfb = nk_rawfb_init_fixed(&framebuffer[0], width, height, width * 4, PIXEL_LAYOUT_XBGR_8888,
+                                &permanent, &frame, GUI_CONTEXT_BYTES);
+    ctx = rawfb ? nk_rawfb_context(rawfb) : nullptr;
+}
+
+// Font of the GUI, the cache of its baked atlas is named after it
+static const char* const GUI_FONT_NAME = "ProggyClean";
+static const float GUI_FONT_SIZE = 13.0f;
+
+void GUI::loadFont() {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::string key = std::string(GUI_FONT_NAME) + " " + std::to_string(GUI_FONT_SIZE) + " RGBA32";
+    std::string path = FontCache::GetPath(GUI_FONT_NAME, GUI_FONT_SIZE);
+    // The atlas is uploaded and its tables copied, so the file is only
+    // mapped while loading
+    FontCache cache;
+    struct nk_sfml_baked_atlas baked;
+    bool cached = false;
+    if (cache.Open(path, key)) {
+        baked.pixels = cache.GetPixels();
+        baked.width = cache.GetWidth();
+        baked.height = cache.GetHeight();
+        baked.tables = cache.GetTables();
+        baked.tables_size = cache.GetTablesSize();
+        cached = nk_sfml_font_stash_load(&baked) != 0;
+    }
+    cache.Close();
+    if (!cached) {
+        struct nk_font_atlas *atlas;
+        nk_sfml_font_stash_begin(&atlas);
+        atlas->default_font = nk_font_atlas_add_default(atlas, GUI_FONT_SIZE, 0);
+        nk_sfml_font_stash_end_baked(&baked);
+        if (baked.pixels) {
+            FontCache::Write(path, key, baked.pixels, baked.width, baked.height, baked.tables, baked.tables_size);
+        }
+    }
+    long long us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    std::cout << (cached ? "Font atlas read from " + path : std::string("Font atlas baked")) << " in "
+              << us / 1000.0 << " ms" << std::endl;
+}
+
 void GUI::loop() {
     sf::Event event;
+    // When the first event of this frame was polled. The widgets only act
+    // on the input of the whole frame, so what they do is timed from it.
+    InputClock::time_point polled;
     // Load Fonts: if none of these are loaded a default font will be used
     //Load Cursor: if you uncomment cursor loading please hide the cursor
-    nk_input_begin(ctx);
-    while(window->pollEvent(event)){
-        // Capture any keys that are released
-        if(event.type == sf::Event::KeyReleased){
-                //std::cout << "Key Pressed" << std::endl;
-                // Check if the escape key is pressed.
-            if(event.key.code == sf::Keyboard::Escape){
-                nk_sfml_shutdown();
-                window->close();
-                exit(EXIT_SUCCESS);
+    {
+        ProfileScope profile(PROFILE_GUI_INPUT);
+        nk_input_begin(ctx);
+        while(!window && !events.empty()){
+            if (polled == InputClock::time_point()) {
+                polled = InputClock::now();
+            }
+            nk_sfml_input_event(ctx, &events.front());
+            events.pop_front();
+        }
+        while(window && window->pollEvent(event)){
+            if (polled == InputClock::time_point()) {
+                polled = InputClock::now();
+            }
+            // Capture any keys that are released
+            if(event.type == sf::Event::KeyReleased){
+                    //std::cout << "Key Pressed" << std::endl;
+                    // Check if the escape key is pressed.
+                if(event.key.code == sf::Keyboard::Escape){
+                    // Closing the window ends the main loop, which tears
+                    // down the app normally.
+                    nk_sfml_shutdown();
+                    window->close();
+                    return;
+                }
             }
+            nk_sfml_handle_event(&event);
         }
-        nk_sfml_handle_event(&event);
+        // Complete input from nuklear GUI
+        nk_input_end(ctx);
     }
-    // Complete input from nuklear GUI
-    nk_input_end(ctx);
 
     // Draw our GUI
-    this->drawLayout();
+    {
+        ProfileScope profile(PROFILE_GUI_LAYOUT);
+        app->SetInputTime(polled);
+        this->drawLayout();
+        app->SetInputTime(InputClock::time_point());
+    }
     
     // OpenGL is the background rendering engine,
     // so we are going to clear our GUI graphics system.
-    window->setActive(true);
-    window->clear();
-    glClearColor(bg->r, bg->g, bg->b, bg->a);
-    glClear(GL_COLOR_BUFFER_BIT);
-    nk_sfml_render(NK_ANTI_ALIASING_ON);
+    // The backend converts the commands to vertices and draws them in
+    // one call, so both are timed together.
+    {
+        ProfileScope profile(PROFILE_GUI_RENDER);
+        if (!window) {
+            nk_rawfb_render(rawfb, nk_rgb_cf(*bg), 1);
+            return;
+        }
+        window->setActive(true);
+        window->clear();
+        glClearColor(bg->r, bg->g, bg->b, bg->a);
+        glClear(GL_COLOR_BUFFER_BIT);
+        nk_sfml_render(NK_ANTI_ALIASING_ON);
+    }
+    ProfileScope profile(PROFILE_GUI_PRESENT);
     window->display();
 
 }
@@ -148,6 +322,27 @@ sf::RenderWindow* GUI::getWindow() {
     return window;
 }
 
+/*! \brief Queue an event for a GUI without a window. It is handled by
+        the next loop(), like the events of a window.
+    \param event event as SFML would report it
+*/
+void GUI::pushEvent(const sf::Event& event) {
+    events.push_back(event);
+}
+
+/*! \brief Get the RGBA pixels the last loop() drew, rows top to bottom.
+        Only without a window.
+*/
+const sf::Uint8* GUI::getFramebuffer() const {
+    return framebuffer.empty() ? nullptr : &framebuffer[0];
+}
+
+/*! \brief Get the size of the framebuffer, 0 by 0 with a window.
+*/
+sf::Vector2u GUI::getFramebufferSize() const {
+    return framebuffer_size;
+}
+
 sf::Color GUI::GetInputColor(){
     sf::Color color;
     switch (preset_index)
@@ -211,7 +406,7 @@ void GUI::drawLayout(){
 
     /* GUI window inside of canvas*/
     if (nk_begin(ctx, "Toolbar", nk_rect(0, 0, 250, app->GetWindowHeight()*3), NK_WINDOW_BORDER|NK_WINDOW_TITLE)) {
-        // Mock design for filters
+        // Filters run on the active layer, limited to the selection
         nk_layout_row_begin(ctx, NK_STATIC, 30, 1);
         {
             nk_layout_row_push(ctx, 100);
@@ -219,17 +414,28 @@ void GUI::drawLayout(){
         }
         nk_layout_row_end(ctx);
         nk_layout_row_static(ctx, 25, 100, 2);
-        if (nk_button_label(ctx, "Sepia")){
-             fprintf(stdout, "button pressed\n");
-        }
-        if (nk_button_label(ctx, "Gray Scale")){
-            fprintf(stdout, "button pressed\n");
+        for (int f = 0; f < FILTER_COUNT; f++){
+            FilterType type = static_cast<FilterType>(f);
+            if (nk_button_label(ctx, GetFilterName(type))){
+                std::shared_ptr<Command> filter_command = std::make_shared<FilterCommand>(GetFilterName(type), type, *app);
+                app->AddCommand(filter_command);
+                app->ExecuteCommand();
+            }
         }
-        if (nk_button_label(ctx, "Sharpen")){
-            fprintf(stdout, "button pressed\n");
+
+        // Tool used on the canvas and selection controls
+        nk_layout_row_dynamic(ctx, 20, 1);
+        nk_label(ctx, "Tool:", NK_TEXT_LEFT);
+        static const char *tools[TOOL_COUNT] = {"Brush", "Select Rectangle", "Select Ellipse", "Select Lasso"};
+        nk_layout_row_dynamic(ctx, 25, 1);
+        app->SetTool(static_cast<Tool>(nk_combo(ctx, tools, TOOL_COUNT, app->GetTool(), 25, nk_vec2(200,200))));
+        nk_layout_row_static(ctx, 20, 100, 2);
+        // No selection means everything is selected, so both just drop it
+        if (nk_button_label(ctx, "Select All")){
+            app->GetSelection().Clear();
         }
-        if (nk_button_label(ctx, "Blur")){
-            fprintf(stdout, "button pressed\n");
+        if (nk_button_label(ctx, "Deselect")){
+            app->GetSelection().Clear();
         }
         nk_spacing(ctx, 1);
 
@@ -275,6 +481,55 @@ void GUI::drawLayout(){
             app->ExecuteCommand();
         }
 
+        // Layers, listed from the top of the stack to the bottom
+        nk_layout_row_dynamic(ctx, 20, 1);
+        nk_label(ctx, "Layers:", NK_TEXT_LEFT);
+        LayerStack &layers = app->GetLayers();
+        for (int i = static_cast<int>(layers.GetLayerCount()) - 1; i >= 0; i--){
+            std::shared_ptr<Layer> layer = layers.GetLayer(i);
+            nk_layout_row_begin(ctx, NK_STATIC, 20, 2);
+            nk_layout_row_push(ctx, 30);
+            int visible = layer->IsVisible();
+            if (nk_checkbox_label(ctx, "", &visible)){
+                app->SetLayerSettings(layer->GetId(), layer->GetOpacity(), visible != 0, layer->GetBlendMode());
+            }
+            nk_layout_row_push(ctx, 170);
+            int selected = layer->GetId() == layers.GetActiveId();
+            if (nk_selectable_label(ctx, layer->GetName().c_str(), NK_TEXT_LEFT, &selected) && selected){
+                app->SetActiveLayer(layer->GetId());
+            }
+            nk_layout_row_end(ctx);
+        }
+        std::shared_ptr<Layer> active = layers.FindLayer(layers.GetActiveId());
+        nk_layout_row_dynamic(ctx, 25, 1);
+        int opacity = active->GetOpacity();
+        nk_property_int(ctx, "Opacity:", 0, &opacity, 255, 1, 1);
+        const char* blend_modes[BLEND_MODE_COUNT];
+        for (int i = 0; i < BLEND_MODE_COUNT; i++){
+            blend_modes[i] = GetBlendModeName(static_cast<BlendMode>(i));
+        }
+        int blend_mode = nk_combo(ctx, blend_modes, BLEND_MODE_COUNT, active->GetBlendMode(), 25, nk_vec2(200,200));
+        // Only changes are applied and journaled
+        app->SetLayerSettings(active->GetId(), static_cast<sf::Uint8>(opacity), active->IsVisible(),
+            static_cast<BlendMode>(blend_mode));
+        nk_layout_row_static(ctx, 20, 48, 4);
+        if (nk_button_label(ctx, "Add")){
+            app->AddCommand(std::make_shared<LayerCommand>("layer add", LayerCommand::ADD, *app));
+            app->ExecuteCommand();
+        }
+        if (nk_button_label(ctx, "Del")){
+            app->AddCommand(std::make_shared<LayerCommand>("layer remove", LayerCommand::REMOVE, *app));
+            app->ExecuteCommand();
+        }
+        if (nk_button_label(ctx, "Up")){
+            app->AddCommand(std::make_shared<LayerCommand>("layer up", LayerCommand::MOVE_UP, *app));
+            app->ExecuteCommand();
+        }
+        if (nk_button_label(ctx, "Down")){
+            app->AddCommand(std::make_shared<LayerCommand>("layer down", LayerCommand::MOVE_DOWN, *app));
+            app->ExecuteCommand();
+        }
+
         // Brush
         nk_spacing(ctx, 1);
         nk_layout_row_dynamic(ctx, 25, 1);
@@ -290,24 +545,189 @@ void GUI::drawLayout(){
         if (nk_button_label(ctx, "Redo")){
             app->Redo();
         }
+
+        // Native project file with every layer, saved incrementally
+        nk_layout_row_dynamic(ctx, 20, 1);
+        nk_spacing(ctx, 1);
+        nk_label(ctx, "Project:", NK_TEXT_LEFT);
+        nk_layout_row_dynamic(ctx, 25, 1);
+        nk_edit_string_zero_terminated(ctx, NK_EDIT_FIELD, project_name, sizeof(project_name), nk_filter_default);
+        nk_layout_row_static(ctx, 20, 100, 2);
+        if (nk_button_label(ctx, "Save Project")){
+            app->SaveProject(project_name);
+        }
+        if (nk_button_label(ctx, "Open Project")){
+            app->OpenProject(project_name);
+        }
+        nk_layout_row_dynamic(ctx, 20, 1);
+        nk_label(ctx, app->GetDocument().GetStatus().c_str(), NK_TEXT_LEFT);
+
+        // Open images as new layers, several files load in parallel
+        nk_layout_row_dynamic(ctx, 20, 1);
+        nk_spacing(ctx, 1);
+        nk_label(ctx, "Open:", NK_TEXT_LEFT);
+        nk_layout_row_dynamic(ctx, 25, 1);
+        nk_edit_string_zero_terminated(ctx, NK_EDIT_FIELD, open_names, sizeof(open_names), nk_filter_default);
+        nk_layout_row_static(ctx, 20, 100, 2);
+        if (nk_button_label(ctx, "Open")){
+            std::string names(open_names);
+            std::size_t begin = 0;
+            while (begin <= names.size()){
+                std::size_t end = names.find(';', begin);
+                if (end == std::string::npos){
+                    end = names.size();
+                }
+                if (end > begin){
+                    app->Import(names.substr(begin, end - begin));
+                }
+                begin = end + 1;
+            }
+        }
+        ImageImporter &importer = app->GetImporter();
+        nk_label(ctx, importer.IsBusy() ? "Loading..." : "", NK_TEXT_LEFT);
+        nk_layout_row_dynamic(ctx, 20, 1);
+        nk_label(ctx, importer.GetStatus().c_str(), NK_TEXT_LEFT);
+
+        // Save the canvas, the file name is typed without extension
+        nk_layout_row_dynamic(ctx, 20, 1);
+        nk_spacing(ctx, 1);
+        nk_label(ctx, "Save As:", NK_TEXT_LEFT);
+        nk_layout_row_dynamic(ctx, 25, 1);
+        nk_edit_string_zero_terminated(ctx, NK_EDIT_FIELD, save_name, sizeof(save_name), nk_filter_default);
+        ImageExporter &exporter = app->GetExporter();
+        nk_layout_row_static(ctx, 20, 100, 2);
+        for (int f = 0; f < EXPORT_FORMAT_COUNT; f++){
+            ExportFormat format = static_cast<ExportFormat>(f);
+            if (nk_button_label(ctx, format == EXPORT_PNG ? "Save PNG" : "Save TGA") && !exporter.IsBusy()){
+                app->Export(std::string(save_name) + GetExportExtension(format), format);
+            }
+        }
+        // Progress of the save running in the background
+        nk_layout_row_dynamic(ctx, 20, 1);
+        if (exporter.IsBusy()){
+            nk_size progress = static_cast<nk_size>(exporter.GetProgress() * 100);
+            nk_progress(ctx, &progress, 100, NK_FIXED);
+        } else{
+            nk_label(ctx, exporter.GetStatus().c_str(), NK_TEXT_LEFT);
+        }
         
-        // Place holder for connection interface:
+        // Draw together with the other users of a server
         nk_layout_row_static(ctx, 20, 200, 1);
         nk_spacing(ctx, 1);
         nk_label(ctx, "Connection:", NK_TEXT_LEFT);
+        nk_layout_row_dynamic(ctx, 25, 1);
+        nk_edit_string_zero_terminated(ctx, NK_EDIT_FIELD, server_address, sizeof(server_address), nk_filter_default);
+        NetworkClient &network = app->GetNetwork();
+        connection = network.IsConnected();
         nk_layout_row_static(ctx, 50, 50, 1);
         if (connection == 0){
             if (nk_button_symbol(ctx, NK_SYMBOL_CIRCLE_OUTLINE)){
-                fprintf(stdout, "Connected\n");
-                connection = 1;
+                network.Connect(server_address);
             }
         }
         else{
             if (nk_button_symbol(ctx, NK_SYMBOL_CIRCLE_SOLID)){
-                fprintf(stdout, "Disconnect\n");
-                connection = 0;
+                network.Disconnect();
             }            
         }
+        nk_layout_row_dynamic(ctx, 20, 1);
+        nk_label(ctx, network.GetStatus().c_str(), NK_TEXT_LEFT);
+
+        // Where the time of a frame goes. Frames are only timed while
+        // the panel is open.
+        nk_layout_row_dynamic(ctx, 20, 1);
+        nk_spacing(ctx, 1);
+        bool profiling = nk_tree_push(ctx, NK_TREE_TAB, "Profiler", NK_MINIMIZED) != 0;
+        Profiler::SetEnabled(profiling);
+        if (profiling){
+            std::size_t frames = Profiler::GetFrameCount();
+            float p99 = Profiler::GetPercentile(PROFILE_FRAME, 0.99f);
+            nk_layout_row_dynamic(ctx, 80, 1);
+            if (nk_chart_begin(ctx, NK_CHART_LINES, static_cast<int>(frames), 0, std::max(p99 * 1.25f, 1.0f))){
+                for (std::size_t i = 0; i < frames; i++){
+                    nk_chart_push(ctx, Profiler::GetMilliseconds(PROFILE_FRAME, i));
+                }
+                nk_chart_end(ctx);
+            }
+            nk_layout_row_begin(ctx, NK_STATIC, 16, 3);
+            nk_layout_row_push(ctx, 90);
+            nk_label(ctx, "ms", NK_TEXT_LEFT);
+            nk_layout_row_push(ctx, 55);
+            nk_label(ctx, "p50", NK_TEXT_RIGHT);
+            nk_layout_row_push(ctx, 55);
+            nk_label(ctx, "p99", NK_TEXT_RIGHT);
+            nk_layout_row_end(ctx);
+            for (int z = 0; z < PROFILE_ZONE_COUNT; z++){
+                ProfileZone zone = static_cast<ProfileZone>(z);
+                nk_layout_row_begin(ctx, NK_STATIC, 16, 3);
+                nk_layout_row_push(ctx, 90);
+                nk_label(ctx, GetProfileZoneName(zone), NK_TEXT_LEFT);
+                nk_layout_row_push(ctx, 55);
+                nk_labelf(ctx, NK_TEXT_RIGHT, "%.2f", Profiler::GetPercentile(zone, 0.5f));
+                nk_layout_row_push(ctx, 55);
+                nk_labelf(ctx, NK_TEXT_RIGHT, "%.2f", Profiler::GetPercentile(zone, 0.99f));
+                nk_layout_row_end(ctx);
+            }
+            // Painting should not go to the heap once it is warmed up
+            nk_layout_row_dynamic(ctx, 16, 1);
+            nk_labelf(ctx, NK_TEXT_LEFT, "Heap allocations per frame: %llu",
+                      static_cast<unsigned long long>(app->GetFrameAllocations()));
+            // Most of its fixed memory the GUI used so far
+            nk_size context_peak = 0;
+            nk_size commands_peak = 0;
+            nk_sfml_memory_peak(&context_peak, &commands_peak);
+            nk_size font_used = memory->GetUsed() - GUI_CONTEXT_BYTES - GUI_COMMAND_BYTES;
+            // The software renderer does not keep peaks, so all it took
+            nk_size used = window ? context_peak + commands_peak + font_used : memory->GetUsed();
+            nk_labelf(ctx, NK_TEXT_LEFT, "GUI memory: %lu of %lu KB",
+                      static_cast<unsigned long>(used / 1024),
+                      static_cast<unsigned long>(memory->GetCapacity() / 1024));
+            // Waits for a pixel buffer the GPU was still copying from
+            TextureStreamer &streamer = app->GetTextureStreamer();
+            if (streamer.IsStreaming()){
+                nk_labelf(ctx, NK_TEXT_LEFT, "Texture uploads: pixel buffers, %llu stalls",
+                          static_cast<unsigned long long>(streamer.GetStalls()));
+            } else{
+                nk_label(ctx, "Texture uploads: sf::Texture::update", NK_TEXT_LEFT);
+            }
+            // Time from an input to the frame that shows it, in buckets of
+            // LatencyHistogram::BUCKET_MS. Counted with the panel closed too,
+            // reset to compare a change from a clean start.
+            LatencyHistogram &latency = app->GetLatency().GetHistogram();
+            nk_labelf(ctx, NK_TEXT_LEFT, "Input to display: %llu inputs",
+                      static_cast<unsigned long long>(latency.GetCount()));
+            nk_labelf(ctx, NK_TEXT_LEFT, "p50 %.0f, p99 %.0f, max %.1f ms",
+                      latency.GetPercentile(0.5f), latency.GetPercentile(0.99f), latency.GetMax());
+            std::uint64_t largest = 1;
+            for (unsigned b = 0; b < LatencyHistogram::BUCKETS; b++){
+                largest = std::max(largest, latency.GetBucket(b));
+            }
+            nk_layout_row_dynamic(ctx, 60, 1);
+            if (nk_chart_begin(ctx, NK_CHART_COLUMN, LatencyHistogram::BUCKETS, 0, static_cast<float>(largest))){
+                for (unsigned b = 0; b < LatencyHistogram::BUCKETS; b++){
+                    nk_chart_push(ctx, static_cast<float>(latency.GetBucket(b)));
+                }
+                nk_chart_end(ctx);
+            }
+            nk_layout_row_static(ctx, 20, 100, 1);
+            if (nk_button_label(ctx, "Reset Latency")){
+                latency.Reset();
+            }
+            // A trace of every thread for chrome://tracing, which goes on
+            // when the panel is closed
+            nk_layout_row_static(ctx, 20, 100, 1);
+            bool tracing = Trace::IsCapturing();
+            if (nk_button_label(ctx, tracing ? "Stop Trace" : "Start Trace")){
+                if (tracing){
+                    Trace::Stop();
+                } else{
+                    Trace::Start(DEFAULT_TRACE_PATH);
+                }
+            }
+            nk_layout_row_dynamic(ctx, 20, 1);
+            nk_label(ctx, Trace::GetStatus().c_str(), NK_TEXT_LEFT);
+            nk_tree_pop(ctx);
+        }
 
     }
     nk_end(ctx);
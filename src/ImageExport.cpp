@@ -0,0 +1,291 @@
+/**
+ *  @file   ImageExport.cpp
+ *  @brief  Implementation of ImageExport.hpp
+ *  @author Team Avengers
+ *  @date   2020-12-05
+ ***********************************************/
+
+// Include our Third-Party SFML header
+#include <SFML/Graphics/Color.hpp>
+// Include standard library C++ libraries.
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <vector>
+#include <zlib.h>
+// Project header files
+#include "ImageExport.hpp"
+#include "Trace.hpp"
+
+namespace {
+
+// Size of the deflate output buffer, every full buffer becomes one IDAT chunk
+const std::size_t PNG_CHUNK_BYTES = 1 << 16;
+
+void PutBE32(unsigned char* out, unsigned value){
+    out[0] = static_cast<unsigned char>(value >> 24);
+    out[1] = static_cast<unsigned char>(value >> 16);
+    out[2] = static_cast<unsigned char>(value >> 8);
+    out[3] = static_cast<unsigned char>(value);
+}
+
+void PutLE16(unsigned char* out, unsigned value){
+    out[0] = static_cast<unsigned char>(value);
+    out[1] = static_cast<unsigned char>(value >> 8);
+}
+
+// Gather one row of the image as straight alpha RGBA8.
+void ReadRow(const TiledImage &image, unsigned y, sf::Uint8* row){
+    unsigned ty = y / TILE_SIZE;
+    unsigned offset = (y % TILE_SIZE) * TILE_SIZE * 4;
+    for (unsigned tx = 0; tx < image.GetTilesX(); tx++){
+        unsigned count = std::min(TILE_SIZE, image.GetWidth() - tx * TILE_SIZE);
+        sf::Uint8* dst = row + tx * TILE_SIZE * 4;
+        const sf::Uint8* tile = image.GetTile(ty * image.GetTilesX() + tx);
+        if (!tile){
+            std::memset(dst, 0, count * 4);
+            continue;
+        }
+        const sf::Uint8* src = tile + offset;
+        for (unsigned i = 0; i < count; i++, src += 4, dst += 4){
+            if (src[3] == 255 || src[3] == 0){
+                std::memcpy(dst, src, 4);
+            } else{
+                sf::Color c = TiledImage::Unpremultiply(sf::Color(src[0], src[1], src[2], src[3]));
+                dst[0] = c.r;
+                dst[1] = c.g;
+                dst[2] = c.b;
+                dst[3] = c.a;
+            }
+        }
+    }
+}
+
+void WriteChunk(std::ofstream &out, const char* type, const unsigned char* data, unsigned length){
+    unsigned char header[8];
+    PutBE32(header, length);
+    std::memcpy(header + 4, type, 4);
+    uLong crc = crc32(0L, header + 4, 4);
+    if (length > 0){
+        crc = crc32(crc, data, length);
+    }
+    unsigned char footer[4];
+    PutBE32(footer, static_cast<unsigned>(crc));
+    out.write(reinterpret_cast<const char*>(header), 8);
+    out.write(reinterpret_cast<const char*>(data), length);
+    out.write(reinterpret_cast<const char*>(footer), 4);
+}
+
+// Compresses the filtered rows and writes them out as IDAT chunks.
+class IdatStream{
+public:
+    explicit IdatStream(std::ofstream &out): m_out(out), m_buffer(PNG_CHUNK_BYTES), m_ok(false){
+        std::memset(&m_stream, 0, sizeof(m_stream));
+        // Favour speed, a canvas is mostly flat color and compresses well anyway.
+        m_ok = deflateInit(&m_stream, 3) == Z_OK;
+        m_stream.next_out = &m_buffer[0];
+        m_stream.avail_out = static_cast<uInt>(m_buffer.size());
+    }
+
+    ~IdatStream(){
+        deflateEnd(&m_stream);
+    }
+
+    bool Write(const unsigned char* data, std::size_t length, bool last){
+        if (!m_ok){
+            return false;
+        }
+        int flush = last ? Z_FINISH : Z_NO_FLUSH;
+        m_stream.next_in = const_cast<unsigned char*>(data);
+        m_stream.avail_in = static_cast<uInt>(length);
+        int result;
+        do{
+            result = deflate(&m_stream, flush);
+            if (result == Z_STREAM_ERROR){
+                return m_ok = false;
+            }
+            if (m_stream.avail_out == 0){
+                Emit();
+            }
+        } while (m_stream.avail_in > 0 || (last && result != Z_STREAM_END));
+        if (last){
+            Emit();
+        }
+        return m_out.good();
+    }
+
+private:
+    std::ofstream &m_out;
+    std::vector<unsigned char> m_buffer;
+    z_stream m_stream;
+    bool m_ok;
+
+    void Emit(){
+        unsigned length = static_cast<unsigned>(m_buffer.size() - m_stream.avail_out);
+        if (length > 0){
+            WriteChunk(m_out, "IDAT", &m_buffer[0], length);
+        }
+        m_stream.next_out = &m_buffer[0];
+        m_stream.avail_out = static_cast<uInt>(m_buffer.size());
+    }
+};
+
+bool WritePng(std::ofstream &out, const TiledImage &image, std::atomic<unsigned>* rowsDone){
+    static const unsigned char signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    out.write(reinterpret_cast<const char*>(signature), 8);
+    unsigned char ihdr[13];
+    PutBE32(ihdr, image.GetWidth());
+    PutBE32(ihdr + 4, image.GetHeight());
+    ihdr[8] = 8;    // bits per channel
+    ihdr[9] = 6;    // RGBA
+    ihdr[10] = 0;   // deflate
+    ihdr[11] = 0;   // adaptive filtering
+    ihdr[12] = 0;   // not interlaced
+    WriteChunk(out, "IHDR", ihdr, sizeof(ihdr));
+
+    // Rows are read with some padding, since the last tile may stick out.
+    std::size_t stride = image.GetWidth() * 4;
+    std::vector<sf::Uint8> row(image.GetTilesX() * TILE_BYTES / TILE_SIZE);
+    std::vector<sf::Uint8> prev(row.size(), 0);
+    std::vector<sf::Uint8> filtered(1 + stride);
+    IdatStream idat(out);
+    for (unsigned y = 0; y < image.GetHeight(); y++){
+        ReadRow(image, y, &row[0]);
+        // The 'up' filter turns flat areas into runs of zeros.
+        filtered[0] = 2;
+        for (std::size_t i = 0; i < stride; i++){
+            filtered[1 + i] = static_cast<sf::Uint8>(row[i] - prev[i]);
+        }
+        row.swap(prev);
+        if (!idat.Write(&filtered[0], filtered.size(), y + 1 == image.GetHeight())){
+            return false;
+        }
+        if (rowsDone){
+            rowsDone->store(y + 1);
+        }
+    }
+    WriteChunk(out, "IEND", nullptr, 0);
+    return out.good();
+}
+
+bool WriteTga(std::ofstream &out, const TiledImage &image, std::atomic<unsigned>* rowsDone){
+    if (image.GetWidth() > 0xFFFF || image.GetHeight() > 0xFFFF){
+        return false;
+    }
+    unsigned char header[18] = {0};
+    header[2] = 2;      // uncompressed true color
+    PutLE16(header + 12, image.GetWidth());
+    PutLE16(header + 14, image.GetHeight());
+    header[16] = 32;    // bits per pixel
+    header[17] = 0x28;  // 8 alpha bits, rows go top to bottom
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+    std::size_t stride = image.GetWidth() * 4;
+    std::vector<sf::Uint8> row(image.GetTilesX() * TILE_BYTES / TILE_SIZE);
+    for (unsigned y = 0; y < image.GetHeight(); y++){
+        ReadRow(image, y, &row[0]);
+        for (std::size_t i = 0; i < stride; i += 4){
+            std::swap(row[i], row[i + 2]);
+        }
+        out.write(reinterpret_cast<const char*>(&row[0]), stride);
+        if (rowsDone){
+            rowsDone->store(y + 1);
+        }
+    }
+    return out.good();
+}
+
+}
+
+/*! \brief Get the file extension of a format, including the dot.
+*/
+const char* GetExportExtension(ExportFormat format){
+    return format == EXPORT_TGA ? ".tga" : ".png";
+}
+
+/*! \brief Construct an idle exporter.
+    \param tasks pool that runs the exports
+*/
+ImageExporter::ImageExporter(TaskPool &tasks): m_tasks(tasks), m_task(TASK_BACKGROUND), m_busy(false),
+ m_rowsDone(0), m_rows(0){
+}
+
+/*! \brief Finish any export that is still running.
+*/
+ImageExporter::~ImageExporter(){
+    Wait();
+}
+
+/*! \brief Start writing an image in the background.
+        Returns right away, the progress can be polled with GetProgress().
+    \param snapshot image to write, only its tile pointers are copied
+    \param path file to write
+    \param format file format
+    \return false if an export is already running
+*/
+bool ImageExporter::Start(const TiledImage &snapshot, const std::string &path, ExportFormat format){
+    if (m_busy){
+        return false;
+    }
+    Wait();
+    m_rows = snapshot.GetHeight();
+    m_rowsDone = 0;
+    m_busy = true;
+    m_status = "Saving " + path;
+    m_tasks.Submit(m_task, std::bind(&ImageExporter::Run, this, snapshot, path, format));
+    return true;
+}
+
+/*! \brief Block until the running export is done.
+*/
+void ImageExporter::Wait(){
+    m_tasks.Wait(m_task);
+}
+
+/*! \brief Check if an export is running.
+*/
+bool ImageExporter::IsBusy() const{
+    return m_busy;
+}
+
+/*! \brief Get how far the running export is, from 0 to 1.
+*/
+float ImageExporter::GetProgress() const{
+    return m_rows > 0 ? static_cast<float>(m_rowsDone) / m_rows : 1.0f;
+}
+
+/*! \brief Get a message describing the last export. Only valid while
+        no export is running.
+*/
+const std::string& ImageExporter::GetStatus() const{
+    return m_status;
+}
+
+/*! \brief Write an image on the calling thread.
+    \param image image to write
+    \param path file to write
+    \param format file format
+    \param rowsDone if not null, updated with the number of rows written so far
+    \return true if the whole file was written
+*/
+bool ImageExporter::Write(const TiledImage &image, const std::string &path, ExportFormat format,
+                          std::atomic<unsigned>* rowsDone){
+    std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out || image.GetWidth() == 0 || image.GetHeight() == 0){
+        return false;
+    }
+    return format == EXPORT_TGA ? WriteTga(out, image, rowsDone) : WritePng(out, image, rowsDone);
+}
+
+/*! \brief Body of the background task.
+*/
+void ImageExporter::Run(TiledImage snapshot, std::string path, ExportFormat format){
+    TraceScope trace("Save image");
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool written = Write(snapshot, path, format, &m_rowsDone);
+    long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    m_status = written ? "Saved " + path + " (" + std::to_string(ms) + " ms)" : "Could not save " + path;
+    m_busy = false;
+}
@@ -0,0 +1,210 @@
+/**
+ *  @file   ImageImport.cpp
+ *  @brief  Implementation of ImageImport.hpp
+ *  @author Team Avengers
+ *  @date   2020-12-06
+ ***********************************************/
+
+// Include our Third-Party SFML header
+#include <SFML/Graphics/Color.hpp>
+// Include standard library C++ libraries.
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <iostream>
+// stb_image from the Nuklear examples, only the formats we open
+#define STB_IMAGE_IMPLEMENTATION
+#define STBI_ONLY_PNG
+#define STBI_ONLY_JPEG
+#define STBI_ONLY_BMP
+#define STBI_ONLY_TGA
+#include "stb_image.h"
+// Project header files
+#include "ImageImport.hpp"
+#include "Trace.hpp"
+
+namespace {
+
+// Convert one tile of decoded straight alpha RGBA pixels to premultiplied.
+// Returns null if the tile is fully transparent, those cost nothing.
+TilePtr ConvertTile(const stbi_uc* pixels, int width, unsigned x0, unsigned y0, unsigned tw, unsigned th){
+    TilePtr tile = TiledImage::AllocateTile();
+    if (tw < TILE_SIZE || th < TILE_SIZE){
+        std::memset(tile.get(), 0, TILE_BYTES);
+    }
+    bool visible = false;
+    for (unsigned y = 0; y < th; y++){
+        const stbi_uc* src = pixels + ((y0 + y) * static_cast<std::size_t>(width) + x0) * 4;
+        sf::Uint8* dst = tile.get() + y * TILE_SIZE * 4;
+        for (unsigned x = 0; x < tw; x++, src += 4, dst += 4){
+            if (src[3] == 255){
+                std::memcpy(dst, src, 4);
+            } else{
+                sf::Color c = TiledImage::Premultiply(sf::Color(src[0], src[1], src[2], src[3]));
+                dst[0] = c.r;
+                dst[1] = c.g;
+                dst[2] = c.b;
+                dst[3] = c.a;
+            }
+            visible = visible || src[3] != 0;
+        }
+    }
+    return visible ? tile : TilePtr();
+}
+
+}
+
+/*! \brief Construct an importer with nothing to load.
+    \param tasks pool that runs the decoding
+*/
+ImageImporter::ImageImporter(TaskPool &tasks): m_tasks(tasks){
+}
+
+/*! \brief Wait for the files that are still loading.
+*/
+ImageImporter::~ImageImporter(){
+    Wait();
+}
+
+/*! \brief Start loading a file in the background.
+        The image is placed at the top left corner of the layer and
+        whatever does not fit on the canvas is cut off.
+    \param path file to load
+    \param layerId layer that receives the pixels
+    \param width width of the canvas
+    \param height height of the canvas
+*/
+void ImageImporter::Start(const std::string &path, unsigned layerId, unsigned width, unsigned height){
+    std::unique_ptr<Job> job(new Job);
+    job->path = path;
+    job->layer = layerId;
+    job->width = width;
+    job->height = height;
+    job->start = Clock::now();
+    job->firstPixel = -1;
+    job->done = false;
+    job->failed = false;
+    m_tasks.Submit(job->task, std::bind(&ImageImporter::Decode, job.get()));
+    m_jobs.push_back(std::move(job));
+    m_status = "Loading " + path;
+}
+
+/*! \brief Place the tiles that were decoded since the last call.
+        Called once per frame from the main thread.
+    \param layers stack holding the layers being loaded into
+*/
+void ImageImporter::Poll(LayerStack &layers){
+    std::vector<std::pair<unsigned, TilePtr>> tiles;
+    for (std::size_t i = 0; i < m_jobs.size();){
+        Job &job = *m_jobs[i];
+        // Read 'done' first, so no tile can arrive after the last swap.
+        bool done = job.done;
+        {
+            std::lock_guard<std::mutex> lock(job.mutex);
+            tiles.swap(job.ready);
+        }
+        if (!tiles.empty() && job.firstPixel < 0){
+            job.firstPixel = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - job.start).count();
+        }
+        // The layer may have been deleted while loading, then the tiles are dropped.
+        for (std::size_t t = 0; t < tiles.size(); t++){
+            layers.SetTile(job.layer, tiles[t].first, tiles[t].second);
+        }
+        tiles.clear();
+        if (!done){
+            i++;
+            continue;
+        }
+        m_tasks.Wait(job.task);
+        long long total = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - job.start).count();
+        if (job.failed){
+            m_status = "Could not open " + job.path;
+        } else{
+            m_status = "Opened " + job.path + " (first pixel " + std::to_string(std::max(job.firstPixel, 0LL)) +
+                       " ms, done " + std::to_string(total) + " ms)";
+        }
+        std::cout << m_status << std::endl;
+        m_jobs.erase(m_jobs.begin() + i);
+    }
+}
+
+/*! \brief Block until every file has been decoded. The tiles still
+        have to be placed with Poll().
+*/
+void ImageImporter::Wait(){
+    for (std::size_t i = 0; i < m_jobs.size(); i++){
+        m_tasks.Wait(m_jobs[i]->task);
+    }
+}
+
+/*! \brief Decode a whole file on the calling thread, for the batch mode.
+    \param path file to load
+    \param image set to the image, the size of the file
+    \return true if the file could be decoded
+*/
+bool ImageImporter::Read(const std::string &path, TiledImage &image){
+    int w = 0;
+    int h = 0;
+    int channels = 0;
+    stbi_uc* pixels = stbi_load(path.c_str(), &w, &h, &channels, 4);
+    if (!pixels){
+        return false;
+    }
+    image = TiledImage(w, h);
+    for (unsigned y0 = 0; y0 < static_cast<unsigned>(h); y0 += TILE_SIZE){
+        for (unsigned x0 = 0; x0 < static_cast<unsigned>(w); x0 += TILE_SIZE){
+            unsigned tw = std::min(TILE_SIZE, w - x0);
+            unsigned th = std::min(TILE_SIZE, h - y0);
+            image.SetTilePtr(image.TileIndex(x0, y0), ConvertTile(pixels, w, x0, y0, tw, th));
+        }
+    }
+    stbi_image_free(pixels);
+    return true;
+}
+
+/*! \brief Check if any file is still loading.
+*/
+bool ImageImporter::IsBusy() const{
+    return !m_jobs.empty();
+}
+
+/*! \brief Get a message describing the last file that finished loading.
+*/
+const std::string& ImageImporter::GetStatus() const{
+    return m_status;
+}
+
+/*! \brief Body of a background task. Decodes the file and converts it to
+        premultiplied tiles one row of tiles at a time.
+*/
+void ImageImporter::Decode(Job* job){
+    TraceScope trace("Decode image");
+    int w = 0;
+    int h = 0;
+    int channels = 0;
+    stbi_uc* pixels = stbi_load(job->path.c_str(), &w, &h, &channels, 4);
+    if (!pixels){
+        job->failed = true;
+        job->done = true;
+        return;
+    }
+    unsigned tilesX = (job->width + TILE_SIZE - 1) / TILE_SIZE;
+    unsigned cols = std::min(job->width, static_cast<unsigned>(w));
+    unsigned rows = std::min(job->height, static_cast<unsigned>(h));
+    std::vector<std::pair<unsigned, TilePtr>> batch;
+    for (unsigned y0 = 0; y0 < rows; y0 += TILE_SIZE){
+        unsigned th = std::min(TILE_SIZE, rows - y0);
+        for (unsigned x0 = 0; x0 < cols; x0 += TILE_SIZE){
+            unsigned tw = std::min(TILE_SIZE, cols - x0);
+            TilePtr tile = ConvertTile(pixels, w, x0, y0, tw, th);
+            if (tile){
+                batch.push_back(std::make_pair((y0 / TILE_SIZE) * tilesX + x0 / TILE_SIZE, tile));
+            }
+        }
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->ready.insert(job->ready.end(), batch.begin(), batch.end());
+        batch.clear();
+    }
+    stbi_image_free(pixels);
+    job->done = true;
+}
@@ -0,0 +1,94 @@
+/**
+ *  @file   ImportCommand.cpp
+ *  @brief  Implementation of ImportCommand.hpp
+ *  @author Team Avengers
+ *  @date   2020-12-06
+ ***********************************************/
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <string>
+// Project header files
+#include "App.hpp"
+#include "ImportCommand.hpp"
+#include "LayerStack.hpp"
+
+/*! \brief ImportCommand constructor. Nothing is loaded until it executes.
+    \param m_commandDescription string of command description
+    \param path image file to open
+    \param app reference to app object holding the layers and the importer
+*/
+ImportCommand::ImportCommand(const char* m_commandDescription, const std::string &path, App &app):
+ Command(m_commandDescription), m_app(app), m_path(path), m_prevActive(0){
+}
+
+/*! \brief ImportCommand destructor
+*/
+ImportCommand::~ImportCommand(){
+}
+
+/*! \brief Import commands are never merged with each other.
+    \return false, opening the same file twice gives two layers
+*/
+bool ImportCommand::compare(const std::shared_ptr<Command> &){
+    return false;
+}
+
+/*! \brief 	Add the layer on top of the stack. The first time the image
+        starts loading into it, after an undo the loaded layer is put back.
+    \return boolean of if the layer was added
+*/
+bool ImportCommand::execute(){
+    LayerStack &layers = m_app.GetLayers();
+    m_prevActive = layers.GetActiveId();
+    if (m_layer){
+        layers.InsertLayer(m_layer, layers.GetLayerCount());
+        return true;
+    }
+    std::size_t slash = m_path.find_last_of("/\\");
+    m_layer = layers.CreateLayer(slash == std::string::npos ? m_path : m_path.substr(slash + 1));
+    layers.InsertLayer(m_layer, layers.GetLayerCount());
+    m_app.GetImporter().Start(m_path, m_layer->GetId(), layers.GetWidth(), layers.GetHeight());
+    return true;
+}
+
+/*! \brief 	Remove the layer and restore the previous active layer. An
+        image that is still loading is finished first, so redo puts the
+        whole image back.
+    \return boolean of if undo was completed
+*/
+bool ImportCommand::undo(){
+    LayerStack &layers = m_app.GetLayers();
+    ImageImporter &importer = m_app.GetImporter();
+    if (importer.IsBusy()){
+        importer.Wait();
+        importer.Poll(layers);
+    }
+    bool success = layers.RemoveLayer(m_layer->GetId()) != nullptr;
+    layers.SetActive(m_prevActive);
+    return success;
+}
+
+/*! \brief Get the kind of command.
+*/
+CommandType ImportCommand::GetType() const{
+    return COMMAND_IMPORT;
+}
+
+/*! \brief Write the path of the image, for the journal.
+*/
+void ImportCommand::Serialize(ByteWriter &out) const{
+    out.PutString(m_path);
+}
+
+/*! \brief Create an import command from the data written by Serialize().
+    \return the command, or nullptr if the data is damaged
+*/
+std::shared_ptr<Command> ImportCommand::Deserialize(ByteReader &in, App &app){
+    std::string path = in.GetString();
+    if (!in.Ok() || path.empty()){
+        return nullptr;
+    }
+    return std::make_shared<ImportCommand>("import", path, app);
+}
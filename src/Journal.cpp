@@ -0,0 +1,452 @@
+/**
+ *  @file   Journal.cpp
+ *  @brief  Implementation of Journal.hpp
+ *  @author Team Avengers
+ *  @date   2020-12-08
+ ***********************************************/
+
+// Include our Third-Party SFML header
+#include <SFML/Config.hpp>
+// Include standard library C++ libraries.
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <utility>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+// Project header files
+#include "App.hpp"
+#include "Journal.hpp"
+#include "Network.hpp"
+#include "RevertCommand.hpp"
+
+namespace {
+
+// The last commands of a user, with the numbers of their records
+typedef std::deque<std::pair<std::uint64_t, std::shared_ptr<Command>>> RecordHistory;
+
+const char JOURNAL_MAGIC[5] = {'F', 'S', 'D', 'J', 1};
+// Wake the background thread early once this much is waiting
+const std::size_t FLUSH_BYTES = 1 << 16;
+
+std::uint32_t Crc(const std::uint8_t* data, std::size_t size){
+    return static_cast<std::uint32_t>(crc32(0L, data, static_cast<uInt>(size)));
+}
+
+void Remember(RecordHistory &history, std::uint64_t number, const std::shared_ptr<Command> &command){
+    history.push_back(std::make_pair(number, command));
+    if (history.size() > UNDO_HISTORY){
+        history.pop_front();
+    }
+}
+
+std::shared_ptr<Command> Find(const RecordHistory &history, std::uint64_t number){
+    for (std::size_t i = history.size(); i-- > 0;){
+        if (history[i].first == number){
+            return history[i].second;
+        }
+    }
+    return nullptr;
+}
+
+bool WriteAll(int fd, const std::uint8_t* data, std::size_t size){
+    while (size > 0){
+        ssize_t written = write(fd, data, size);
+        if (written <= 0){
+            return false;
+        }
+        data += written;
+        size -= written;
+    }
+    return true;
+}
+
+}
+
+const unsigned Journal::FLUSH_MS;
+
+/*! \brief Construct a closed journal, logging does nothing until Open().
+*/
+Journal::Journal(): m_fd(-1), m_commands(0), m_opened(0), m_stop(false){
+}
+
+/*! \brief Flush and close the journal, but keep the file.
+*/
+Journal::~Journal(){
+    Close(false);
+}
+
+/*! \brief Open the journal file and start the background thread.
+    \param path journal file
+    \param keep number of bytes of an existing journal to keep and append
+        to, 0 to start an empty journal
+    \return true if the file could be opened
+*/
+bool Journal::Open(const std::string &path, std::uint64_t keep){
+    Close(false);
+    m_fd = open(path.c_str(), O_WRONLY | O_CREAT | (keep > 0 ? 0 : O_TRUNC), 0644);
+    if (m_fd < 0){
+        return false;
+    }
+    if (keep > 0){
+        // Drop whatever was torn off the end by the crash.
+        if (ftruncate(m_fd, static_cast<off_t>(keep)) != 0 || lseek(m_fd, 0, SEEK_END) < 0){
+            close(m_fd);
+            m_fd = -1;
+            return false;
+        }
+    } else{
+        WriteAll(m_fd, reinterpret_cast<const std::uint8_t*>(JOURNAL_MAGIC), sizeof(JOURNAL_MAGIC));
+    }
+    m_path = path;
+    m_opened = m_commands;
+    m_stop = false;
+    m_thread = std::thread(&Journal::Run, this);
+    return true;
+}
+
+/*! \brief Write out everything logged so far and close the file.
+    \param clean true if the program is exiting normally, which removes the file
+*/
+void Journal::Close(bool clean){
+    if (m_fd < 0){
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+    close(m_fd);
+    m_fd = -1;
+    if (clean){
+        unlink(m_path.c_str());
+    }
+}
+
+/*! \brief Check if records are being written.
+*/
+bool Journal::IsOpen() const{
+    return m_fd >= 0;
+}
+
+/*! \brief Throw away the records so far and start again from a project file.
+        Called once the canvas is safe in that file.
+    \param base project file the new records apply to
+*/
+void Journal::Restart(const std::string &base){
+    if (m_fd < 0){
+        return;
+    }
+    std::string path = m_path;
+    Close(false);
+    if (Open(path)){
+        Begin(RECORD_BASE);
+        m_record.PutString(base);
+        Append();
+    }
+}
+
+/*! \brief Record a command that executed, and number it so a revert
+        can name it.
+*/
+void Journal::LogCommand(Command &command){
+    if (m_fd < 0){
+        return;
+    }
+    Begin(RECORD_COMMAND);
+    WriteCommand(command, m_record);
+    Append();
+    command.SetRecord(++m_commands);
+}
+
+/*! \brief Record a command of another user that executed, and number it
+        so a revert can name it.
+    \param user user who drew it
+*/
+void Journal::LogRemoteCommand(Command &command, unsigned user){
+    if (m_fd < 0){
+        return;
+    }
+    Begin(RECORD_REMOTE);
+    m_record.PutVarint(user);
+    WriteCommand(command, m_record);
+    Append();
+    command.SetRecord(++m_commands);
+}
+
+/*! \brief Record that a command was taken back on a shared canvas, only
+        where nobody drew over it. Nothing is recorded for a command that
+        is not in the file, replay can not take it back.
+    \param target command taken back
+    \param user user who drew it, 0 for ours
+*/
+void Journal::LogRevert(const Command &target, unsigned user){
+    if (m_fd < 0 || target.GetRecord() <= m_opened){
+        return;
+    }
+    Begin(RECORD_REVERT);
+    m_record.PutVarint(user);
+    m_record.PutVarint(m_commands - target.GetRecord());
+    Append();
+}
+
+/*! \brief Record that the last command was undone.
+*/
+void Journal::LogUndo(){
+    if (m_fd < 0){
+        return;
+    }
+    Begin(RECORD_UNDO);
+    Append();
+}
+
+/*! \brief Record that the last undone command was redone.
+*/
+void Journal::LogRedo(){
+    if (m_fd < 0){
+        return;
+    }
+    Begin(RECORD_REDO);
+    Append();
+}
+
+/*! \brief Record new settings of a layer.
+*/
+void Journal::LogLayer(unsigned id, sf::Uint8 opacity, bool visible, BlendMode mode){
+    if (m_fd < 0){
+        return;
+    }
+    Begin(RECORD_LAYER);
+    m_record.PutVarint(id);
+    m_record.PutU8(opacity);
+    m_record.PutU8(visible ? 1 : 0);
+    m_record.PutU8(static_cast<std::uint8_t>(mode));
+    Append();
+}
+
+/*! \brief Record that another layer became the active one.
+*/
+void Journal::LogActive(unsigned id){
+    if (m_fd < 0){
+        return;
+    }
+    Begin(RECORD_ACTIVE);
+    m_record.PutVarint(id);
+    Append();
+}
+
+/*! \brief Check if a journal was left behind by a run that did not exit cleanly.
+*/
+bool Journal::Exists(const std::string &path){
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && info.st_size > 0;
+}
+
+/*! \brief Apply the records of a journal to the app.
+        Reading stops at the first record that is damaged, which is
+        where the crash cut the journal off.
+    \param path journal file
+    \param app app to apply the records to, with a fresh canvas
+    \param records if not null, set to the number of records applied
+    \param callback if not null, called after each record
+    \param user passed on to the callback
+    \return number of bytes of the journal that are good, 0 if it is unreadable
+*/
+std::uint64_t Journal::Replay(const std::string &path, App &app, unsigned* records,
+                              ReplayCallback callback, void* user){
+    if (records){
+        *records = 0;
+    }
+    std::ifstream file(path.c_str(), std::ios::binary);
+    std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (data.size() < sizeof(JOURNAL_MAGIC) || std::memcmp(&data[0], JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0){
+        return 0;
+    }
+    ByteReader in(&data[0] + sizeof(JOURNAL_MAGIC), data.size() - sizeof(JOURNAL_MAGIC));
+    std::uint64_t good = sizeof(JOURNAL_MAGIC);
+    // Command records so far, and the last ones of every user a revert
+    // can name
+    std::uint64_t commands = 0;
+    std::map<unsigned, RecordHistory> recent;
+    while (!in.AtEnd()){
+        std::size_t size = static_cast<std::size_t>(in.GetVarint());
+        const std::uint8_t* body = in.GetBytes(size);
+        const std::uint8_t* crc = in.GetBytes(4);
+        if (!in.Ok() || size == 0 ||
+            (crc[0] | crc[1] << 8 | crc[2] << 16 | static_cast<std::uint32_t>(crc[3]) << 24) != Crc(body, size)){
+            break;
+        }
+        ByteReader record(body + 1, size - 1);
+        const char* kind = "unknown";
+        switch (body[0]){
+            case RECORD_BASE:
+            {
+                kind = "base";
+                std::string base = record.GetString();
+                if (!base.empty()){
+                    app.OpenProject(base);
+                }
+                break;
+            }
+            case RECORD_COMMAND:
+            {
+                std::shared_ptr<Command> command = ReadCommand(record, app);
+                commands++;
+                if (command){
+                    kind = GetCommandTypeName(command->GetType());
+                    Remember(recent[0], commands, command);
+                    app.RunCommand(command);
+                    // Load the whole image before the records that follow it.
+                    if (command->GetType() == COMMAND_IMPORT){
+                        app.GetImporter().Wait();
+                        app.GetImporter().Poll(app.GetLayers());
+                    }
+                }
+                break;
+            }
+            case RECORD_REMOTE:
+            {
+                unsigned from = static_cast<unsigned>(record.GetVarint());
+                std::shared_ptr<Command> command = ReadCommand(record, app);
+                commands++;
+                if (command){
+                    kind = "remote";
+                    Remember(recent[from], commands, command);
+                    app.ApplyRemoteCommand(command, from);
+                }
+                break;
+            }
+            case RECORD_REVERT:
+            {
+                kind = "revert";
+                unsigned from = static_cast<unsigned>(record.GetVarint());
+                std::uint64_t back = record.GetVarint();
+                if (!record.Ok() || back >= commands){
+                    break;
+                }
+                std::shared_ptr<Command> target = Find(recent[from], commands - back);
+                if (!target){
+                    break;
+                }
+                if (from == 0){
+                    app.Revert(target);
+                } else{
+                    // The target is known, how many commands back it is
+                    // does not matter
+                    app.ApplyRemoteCommand(std::make_shared<RevertCommand>("revert", 0, target), from);
+                }
+                break;
+            }
+            case RECORD_UNDO:
+                kind = "undo";
+                app.Undo();
+                break;
+            case RECORD_REDO:
+                kind = "redo";
+                app.Redo();
+                break;
+            case RECORD_LAYER:
+            {
+                kind = "layer settings";
+                unsigned id = static_cast<unsigned>(record.GetVarint());
+                sf::Uint8 opacity = record.GetU8();
+                bool visible = record.GetU8() != 0;
+                std::uint8_t mode = record.GetU8();
+                if (record.Ok() && mode < BLEND_MODE_COUNT){
+                    app.SetLayerSettings(id, opacity, visible, static_cast<BlendMode>(mode));
+                }
+                break;
+            }
+            case RECORD_ACTIVE:
+                kind = "active layer";
+                app.SetActiveLayer(static_cast<unsigned>(record.GetVarint()));
+                break;
+            case RECORD_IMPORT:
+            {
+                // Journals from before imports were commands
+                kind = "import";
+                app.Import(record.GetString());
+                app.GetImporter().Wait();
+                app.GetImporter().Poll(app.GetLayers());
+                break;
+            }
+            default:
+                break;
+        }
+        good = data.size() - in.GetRemaining();
+        if (records){
+            (*records)++;
+        }
+        if (callback){
+            callback(kind, user);
+        }
+    }
+    return good;
+}
+
+/*! \brief Start encoding a record in m_record.
+*/
+void Journal::Begin(Record type){
+    m_record.Clear();
+    m_record.PutU8(static_cast<std::uint8_t>(type));
+}
+
+/*! \brief Queue the record in m_record for the background thread.
+        Each record is framed by its length and a checksum.
+*/
+void Journal::Append(){
+    std::uint8_t frame[14];
+    std::size_t length = 0;
+    std::size_t size = m_record.GetSize();
+    do{
+        frame[length++] = static_cast<std::uint8_t>((size & 0x7F) | (size >= 0x80 ? 0x80 : 0));
+        size >>= 7;
+    } while (size > 0);
+    std::uint32_t crc = Crc(m_record.GetData(), m_record.GetSize());
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.insert(m_pending.end(), frame, frame + length);
+        m_pending.insert(m_pending.end(), m_record.GetData(), m_record.GetData() + m_record.GetSize());
+        for (int i = 0; i < 4; i++){
+            m_pending.push_back(static_cast<std::uint8_t>(crc >> (8 * i)));
+        }
+        wake = m_pending.size() >= FLUSH_BYTES;
+    }
+    if (wake){
+        m_wake.notify_one();
+    }
+}
+
+/*! \brief Body of the background thread. Writes out the queued records
+        and syncs them to disk in batches.
+*/
+void Journal::Run(){
+    std::vector<std::uint8_t> writing;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true){
+        m_wake.wait_for(lock, std::chrono::milliseconds(FLUSH_MS), [this]{
+            return m_stop || m_pending.size() >= FLUSH_BYTES;
+        });
+        bool stop = m_stop;
+        writing.swap(m_pending);
+        lock.unlock();
+        if (!writing.empty()){
+            WriteAll(m_fd, &writing[0], writing.size());
+            fsync(m_fd);
+            writing.clear();
+        }
+        lock.lock();
+        if (stop && m_pending.empty()){
+            break;
+        }
+    }
+}
@@ -0,0 +1,156 @@
+/**
+ *  @file   Latency.cpp
+ *  @brief  Implementation of Latency.hpp
+ *  @author Team Avengers
+ *  @date   2020-12-17
+ ***********************************************/
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <algorithm>
+// Project header files
+#include "Latency.hpp"
+
+const unsigned LatencyHistogram::BUCKETS;
+const unsigned LatencyHistogram::BUCKET_MS;
+
+/*! \brief Create an empty histogram.
+*/
+LatencyHistogram::LatencyHistogram(){
+    Reset();
+}
+
+/*! \brief Count one latency.
+*/
+void LatencyHistogram::Add(InputClock::duration latency){
+    std::uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count();
+    unsigned bucket = static_cast<unsigned>(std::min<std::uint64_t>(nanoseconds / (BUCKET_MS * 1000000ull), BUCKETS - 1));
+    m_buckets[bucket]++;
+    m_count++;
+    m_total += nanoseconds;
+    m_max = std::max(m_max, nanoseconds);
+}
+
+/*! \brief Forget every latency counted so far, to measure a change from
+        a clean start.
+*/
+void LatencyHistogram::Reset(){
+    std::fill(m_buckets, m_buckets + BUCKETS, 0);
+    m_count = 0;
+    m_total = 0;
+    m_max = 0;
+}
+
+/*! \brief Get the number of latencies counted.
+*/
+std::uint64_t LatencyHistogram::GetCount() const{
+    return m_count;
+}
+
+/*! \brief Get the latencies counted in a bucket.
+    \param bucket 0 for the ones under BUCKET_MS milliseconds
+*/
+std::uint64_t LatencyHistogram::GetBucket(unsigned bucket) const{
+    return bucket < BUCKETS ? m_buckets[bucket] : 0;
+}
+
+/*! \brief Get the average latency in milliseconds.
+*/
+float LatencyHistogram::GetMean() const{
+    return m_count ? m_total / 1e6f / m_count : 0;
+}
+
+/*! \brief Get the longest latency in milliseconds.
+*/
+float LatencyHistogram::GetMax() const{
+    return m_max / 1e6f;
+}
+
+/*! \brief Get the latency the given share of the inputs stayed under, in
+        milliseconds. It is the upper end of a bucket, so it is up to
+        BUCKET_MS too long, and never longer than the longest. In
+        the last bucket it is the longest.
+    \param percentile 0.5 for the median
+*/
+float LatencyHistogram::GetPercentile(float percentile) const{
+    if (m_count == 0){
+        return 0;
+    }
+    std::uint64_t rank = std::min(static_cast<std::uint64_t>(percentile * m_count), m_count - 1);
+    std::uint64_t seen = 0;
+    unsigned bucket = 0;
+    for (; bucket < BUCKETS - 1; bucket++){
+        seen += m_buckets[bucket];
+        if (seen > rank){
+            break;
+        }
+    }
+    // The last bucket has no upper end
+    if (bucket == BUCKETS - 1){
+        return GetMax();
+    }
+    return std::min(static_cast<float>((bucket + 1) * BUCKET_MS), GetMax());
+}
+
+/*! \brief Write a summary and every bucket that is not empty, one per line.
+*/
+void LatencyHistogram::Write(std::ostream &out) const{
+    out << "Input to display latency: " << m_count << " inputs, mean " << GetMean() << " ms, p50 "
+        << GetPercentile(0.5f) << " ms, p90 " << GetPercentile(0.9f) << " ms, p99 " << GetPercentile(0.99f)
+        << " ms, max " << GetMax() << " ms" << std::endl;
+    for (unsigned bucket = 0; bucket < BUCKETS; bucket++){
+        if (m_buckets[bucket] == 0){
+            continue;
+        }
+        out << "  " << bucket * BUCKET_MS;
+        if (bucket == BUCKETS - 1){
+            out << "+ ms: ";
+        } else{
+            out << "-" << (bucket + 1) * BUCKET_MS << " ms: ";
+        }
+        out << m_buckets[bucket] << std::endl;
+    }
+}
+
+/*! \brief Record that a command made by input was executed.
+    \param input when the input was polled
+*/
+void LatencyTracker::Executed(InputClock::time_point input){
+    m_executed.push_back(input);
+}
+
+/*! \brief Record that the texture was updated.
+    \param complete true if no changed tile was left for a later frame,
+    *       so the texture contains every command executed so far
+*/
+void LatencyTracker::Uploaded(bool complete){
+    if (!complete){
+        return;
+    }
+    m_uploaded.insert(m_uploaded.end(), m_executed.begin(), m_executed.end());
+    m_executed.clear();
+}
+
+/*! \brief Record that the frame with the last complete upload was shown,
+        and count the latency of every input it contains.
+    \param now when display() returned
+*/
+void LatencyTracker::Presented(InputClock::time_point now){
+    for (std::size_t i = 0; i < m_uploaded.size(); i++){
+        m_histogram.Add(now - m_uploaded[i]);
+    }
+    m_uploaded.clear();
+}
+
+/*! \brief Get the number of inputs executed but not shown yet.
+*/
+std::size_t LatencyTracker::GetWaiting() const{
+    return m_executed.size() + m_uploaded.size();
+}
+
+/*! \brief Get the latencies of the inputs shown so far.
+*/
+LatencyHistogram& LatencyTracker::GetHistogram(){
+    return m_histogram;
+}
@@ -0,0 +1,68 @@
+/**
+ *  @file   Layer.cpp
+ *  @brief  Implementation of Layer.hpp
+ *  @author Team Avengers
+ *  @date   2020-11-30
+ ***********************************************/
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <string>
+// Project header files
+#include "Layer.hpp"
+
+/*! \brief Layer constructor. New layers are fully transparent, visible
+        and blend normally.
+    \param id unique id of the layer within its stack
+    \param name name shown in the GUI
+    \param width width of the canvas in pixels
+    \param height height of the canvas in pixels
+*/
+Layer::Layer(unsigned id, const std::string &name, unsigned width, unsigned height):
+ m_id(id), m_name(name), m_opacity(255), m_visible(true), m_blendMode(BLEND_NORMAL),
+ m_pixels(width, height){
+}
+
+/*! \brief Get the unique id of the layer.
+*/
+unsigned Layer::GetId() const{
+    return m_id;
+}
+
+/*! \brief Get the name of the layer.
+*/
+const std::string& Layer::GetName() const{
+    return m_name;
+}
+
+/*! \brief Get the opacity the layer is composited with.
+    \return opacity from 0 (invisible) to 255 (opaque)
+*/
+sf::Uint8 Layer::GetOpacity() const{
+    return m_opacity;
+}
+
+/*! \brief Check if the layer takes part in compositing.
+*/
+bool Layer::IsVisible() const{
+    return m_visible;
+}
+
+/*! \brief Get the blend mode the layer is composited with.
+*/
+BlendMode Layer::GetBlendMode() const{
+    return m_blendMode;
+}
+
+/*! \brief Get the pixels of the layer.
+*/
+TiledImage& Layer::GetPixels(){
+    return m_pixels;
+}
+
+/*! \brief Get the pixels of the layer.
+*/
+const TiledImage& Layer::GetPixels() const{
+    return m_pixels;
+}
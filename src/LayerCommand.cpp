@@ -0,0 +1,127 @@
+/**
+ *  @file   LayerCommand.cpp
+ *  @brief  Implementation of LayerCommand.hpp
+ *  @author Team Avengers
+ *  @date   2020-11-30
+ ***********************************************/
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <string>
+// Project header files
+#include "App.hpp"
+#include "LayerCommand.hpp"
+#include "LayerStack.hpp"
+
+/*! \brief LayerCommand constructor. ADD works on a new layer, every other
+        action works on the active layer at the time of construction.
+    \param m_commandDescription string of command description
+    \param action what to do with the layer
+    \param app reference to app object holding the layers and actions
+*/
+LayerCommand::LayerCommand(const char* m_commandDescription, Action action, App &app):
+ Command(m_commandDescription), m_app(app), m_action(action), m_index(0), m_prevActive(0){
+    LayerStack &layers = m_app.GetLayers();
+    if (m_action != ADD){
+        m_layer = layers.FindLayer(layers.GetActiveId());
+    }
+}
+
+/*! \brief LayerCommand destructor
+*/
+LayerCommand::~LayerCommand(){
+}
+
+/*! \brief Layer commands are never merged with each other.
+    \return false, adding the same layer twice is two separate actions
+*/
+bool LayerCommand::compare(const std::shared_ptr<Command> &){
+    return false;
+}
+
+/*! \brief 	Execute the layer change. Executing again after an undo
+        puts back the very same layer object.
+    \return boolean of if the layer stack changed
+*/
+bool LayerCommand::execute(){
+    LayerStack &layers = m_app.GetLayers();
+    m_prevActive = layers.GetActiveId();
+    switch (m_action){
+        case ADD:
+            if (!m_layer){
+                m_layer = layers.CreateLayer("");
+            }
+            m_index = layers.GetActiveIndex() + 1;
+            layers.InsertLayer(m_layer, m_index);
+            return true;
+        case REMOVE:
+            if (!m_layer || layers.IndexOf(m_layer->GetId()) < 0){
+                return false;
+            }
+            m_index = layers.IndexOf(m_layer->GetId());
+            return layers.RemoveLayer(m_layer->GetId()) != nullptr;
+        case MOVE_UP:
+        case MOVE_DOWN:
+        {
+            if (!m_layer || layers.IndexOf(m_layer->GetId()) < 0){
+                return false;
+            }
+            m_index = layers.IndexOf(m_layer->GetId());
+            if (m_action == MOVE_DOWN && m_index == 0){
+                return false;
+            }
+            std::size_t target = m_action == MOVE_UP ? m_index + 1 : m_index - 1;
+            return layers.MoveLayer(m_layer->GetId(), target);
+        }
+    }
+    return false;
+}
+
+/*! \brief 	Undo the layer change and restore the previous active layer.
+    \return boolean of if undo was completed
+*/
+bool LayerCommand::undo(){
+    LayerStack &layers = m_app.GetLayers();
+    bool success = false;
+    switch (m_action){
+        case ADD:
+            success = layers.RemoveLayer(m_layer->GetId()) != nullptr;
+            break;
+        case REMOVE:
+            layers.InsertLayer(m_layer, m_index);
+            success = true;
+            break;
+        case MOVE_UP:
+        case MOVE_DOWN:
+            success = layers.MoveLayer(m_layer->GetId(), m_index);
+            break;
+    }
+    layers.SetActive(m_prevActive);
+    return success;
+}
+
+/*! \brief Get the kind of command.
+*/
+CommandType LayerCommand::GetType() const{
+    return COMMAND_LAYER;
+}
+
+/*! \brief Write the action. It works on the active layer, which the
+        journal keeps track of by itself.
+*/
+void LayerCommand::Serialize(ByteWriter &out) const{
+    out.PutU8(static_cast<std::uint8_t>(m_action));
+}
+
+/*! \brief Create a layer command from the data written by Serialize().
+    \return the command, or nullptr if the data is damaged
+*/
+std::shared_ptr<Command> LayerCommand::Deserialize(ByteReader &in, App &app){
+    static const char* const descriptions[] = {"layer add", "layer remove", "layer up", "layer down"};
+    std::uint8_t action = in.GetU8();
+    if (!in.Ok() || action > MOVE_DOWN){
+        return nullptr;
+    }
+    return std::make_shared<LayerCommand>(descriptions[action], static_cast<Action>(action), app);
+}
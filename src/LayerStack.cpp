@@ -0,0 +1,528 @@
+/**
+ *  @file   LayerStack.cpp
+ *  @brief  Implementation of LayerStack.hpp
+ *  @author Team Avengers
+ *  @date   2020-11-30
+ ***********************************************/
+
+// Include our Third-Party SFML header
+#include <SFML/Graphics/Color.hpp>
+// Include standard library C++ libraries.
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+// Project header files
+#include "LayerStack.hpp"
+#include "Trace.hpp"
+
+namespace {
+
+// Dirty tiles composited by one task
+const std::size_t COMPOSITE_CHUNK = 16;
+
+// Accumulates tiles from bottom to top into a single tile.
+// Blending anything onto a transparent tile gives the tile itself, so
+// the first opaque contribution is shared instead of copied. The
+// previous result is reused as scratch memory when nobody else holds it.
+class TileAccumulator{
+public:
+    explicit TileAccumulator(TilePtr &previous): m_owned(false){
+        if (previous && previous.use_count() == 1){
+            m_scratch = previous;
+        }
+        previous.reset();
+    }
+
+    void Add(const TilePtr &src, unsigned opacity, BlendMode mode = BLEND_NORMAL){
+        if (!src || opacity == 0){
+            return;
+        }
+        if (!m_result && opacity == 255){
+            m_result = src;
+            return;
+        }
+        if (!m_owned){
+            TilePtr dst = m_scratch ? m_scratch : TiledImage::AllocateTile();
+            if (m_result){
+                std::memcpy(dst.get(), m_result.get(), TILE_BYTES);
+            } else{
+                std::memset(dst.get(), 0, TILE_BYTES);
+            }
+            m_result = dst;
+            m_owned = true;
+        }
+        // A tile is one contiguous run of pixels, so it blends as a single row.
+        GetBlendRow(mode)(m_result.get(), src.get(), TILE_SIZE * TILE_SIZE, opacity);
+    }
+
+    TilePtr Result() const{
+        return m_result;
+    }
+
+private:
+    TilePtr m_scratch;
+    TilePtr m_result;
+    bool m_owned;
+};
+
+}
+
+/*! \brief LayerStack constructor. The stack starts with a single opaque
+        background layer.
+    \param width width of the canvas in pixels
+    \param height height of the canvas in pixels
+    \param background straight alpha color of the background layer
+*/
+LayerStack::LayerStack(unsigned width, unsigned height, const sf::Color &background):
+ m_width(width), m_height(height), m_nextId(1), m_activeId(0), m_flattened(width, height){
+    m_below.resize(m_flattened.GetTileCount());
+    m_above.resize(m_flattened.GetTileCount());
+    m_tileState.resize(m_flattened.GetTileCount(), 0);
+    std::shared_ptr<Layer> layer = CreateLayer("Background");
+    layer->m_pixels.Fill(TiledImage::Premultiply(background));
+    InsertLayer(layer, 0);
+    MarkAllDirty();
+}
+
+/*! \brief Get the width of the canvas.
+*/
+unsigned LayerStack::GetWidth() const{
+    return m_width;
+}
+
+/*! \brief Get the height of the canvas.
+*/
+unsigned LayerStack::GetHeight() const{
+    return m_height;
+}
+
+/*! \brief Get the number of layers in the stack.
+*/
+std::size_t LayerStack::GetLayerCount() const{
+    return m_layers.size();
+}
+
+/*! \brief Get a layer by its position in the stack.
+    \param index position of the layer, 0 is the bottom
+*/
+std::shared_ptr<Layer> LayerStack::GetLayer(std::size_t index) const{
+    return m_layers[index];
+}
+
+/*! \brief Get a layer by its id.
+    \return the layer or nullptr if no layer has that id
+*/
+std::shared_ptr<Layer> LayerStack::FindLayer(unsigned id) const{
+    int index = IndexOf(id);
+    return index < 0 ? std::shared_ptr<Layer>() : m_layers[index];
+}
+
+/*! \brief Get the position of a layer in the stack.
+    \return position of the layer or -1 if no layer has that id
+*/
+int LayerStack::IndexOf(unsigned id) const{
+    for (std::size_t i = 0; i < m_layers.size(); i++){
+        if (m_layers[i]->m_id == id){
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+/*! \brief Get the id of the layer that tools draw on.
+*/
+unsigned LayerStack::GetActiveId() const{
+    return m_activeId;
+}
+
+/*! \brief Get the position of the layer that tools draw on.
+*/
+int LayerStack::GetActiveIndex() const{
+    return IndexOf(m_activeId);
+}
+
+/*! \brief Change the layer that tools draw on. This does not change the
+        flattened image, but the cached composites are rebuilt around the
+        new active layer as tiles get dirty.
+    \param id id of the new active layer
+*/
+void LayerStack::SetActive(unsigned id){
+    if (id != m_activeId && IndexOf(id) >= 0){
+        m_activeId = id;
+        InvalidateCaches();
+    }
+}
+
+/*! \brief Create a new transparent layer. The layer is not added to the stack.
+    \param name name of the layer, a default name is used if empty
+*/
+std::shared_ptr<Layer> LayerStack::CreateLayer(const std::string &name){
+    unsigned id = m_nextId++;
+    std::string layerName = name;
+    if (layerName.empty()){
+        std::ostringstream stream;
+        stream << "Layer " << id;
+        layerName = stream.str();
+    }
+    return std::make_shared<Layer>(id, layerName, m_width, m_height);
+}
+
+/*! \brief Insert a layer into the stack and make it the active layer.
+    \param layer layer created by CreateLayer or removed by RemoveLayer
+    \param index position of the new layer, clamped to the top of the stack
+*/
+void LayerStack::InsertLayer(const std::shared_ptr<Layer> &layer, std::size_t index){
+    if (index > m_layers.size()){
+        index = m_layers.size();
+    }
+    m_layers.insert(m_layers.begin() + index, layer);
+    m_activeId = layer->m_id;
+    InvalidateCaches();
+    MarkLayer(static_cast<int>(index));
+}
+
+/*! \brief Remove a layer from the stack. The last layer can not be removed.
+    \param id id of the layer to remove
+    \return the removed layer, so that it can be inserted again on undo
+*/
+std::shared_ptr<Layer> LayerStack::RemoveLayer(unsigned id){
+    int index = IndexOf(id);
+    if (index < 0 || m_layers.size() <= 1){
+        return std::shared_ptr<Layer>();
+    }
+    std::shared_ptr<Layer> layer = m_layers[index];
+    MarkLayer(index);
+    m_layers.erase(m_layers.begin() + index);
+    if (id == m_activeId){
+        m_activeId = m_layers[index > 0 ? index - 1 : 0]->m_id;
+    }
+    InvalidateCaches();
+    return layer;
+}
+
+/*! \brief Move a layer to a new position in the stack.
+    \param id id of the layer to move
+    \param index new position of the layer
+    \return true if the layer was moved
+*/
+bool LayerStack::MoveLayer(unsigned id, std::size_t index){
+    int from = IndexOf(id);
+    if (from < 0 || index >= m_layers.size() || index == static_cast<std::size_t>(from)){
+        return false;
+    }
+    std::shared_ptr<Layer> layer = m_layers[from];
+    m_layers.erase(m_layers.begin() + from);
+    m_layers.insert(m_layers.begin() + index, layer);
+    InvalidateCaches();
+    MarkAllDirty();
+    return true;
+}
+
+/*! \brief Change the opacity of a layer.
+    \param opacity from 0 (invisible) to 255 (opaque)
+*/
+void LayerStack::SetOpacity(unsigned id, sf::Uint8 opacity){
+    int index = IndexOf(id);
+    if (index >= 0 && m_layers[index]->m_opacity != opacity){
+        m_layers[index]->m_opacity = opacity;
+        MarkLayer(index);
+    }
+}
+
+/*! \brief Show or hide a layer.
+*/
+void LayerStack::SetVisible(unsigned id, bool visible){
+    int index = IndexOf(id);
+    if (index >= 0 && m_layers[index]->m_visible != visible){
+        m_layers[index]->m_visible = visible;
+        MarkLayer(index);
+    }
+}
+
+/*! \brief Change the blend mode of a layer.
+*/
+void LayerStack::SetBlendMode(unsigned id, BlendMode mode){
+    int index = IndexOf(id);
+    if (index >= 0 && m_layers[index]->m_blendMode != mode){
+        m_layers[index]->m_blendMode = mode;
+        MarkLayer(index);
+    }
+}
+
+/*! \brief Read a pixel of a layer.
+    \return premultiplied color, transparent if the layer does not exist
+*/
+sf::Color LayerStack::GetPixel(unsigned id, unsigned x, unsigned y) const{
+    int index = IndexOf(id);
+    if (index < 0){
+        return sf::Color::Transparent;
+    }
+    return m_layers[index]->m_pixels.GetPixel(x, y);
+}
+
+/*! \brief Write a pixel of a layer and mark its tile for compositing.
+    \param color premultiplied color
+*/
+void LayerStack::SetPixel(unsigned id, unsigned x, unsigned y, const sf::Color &color){
+    int index = IndexOf(id);
+    if (index >= 0){
+        TiledImage &pixels = m_layers[index]->m_pixels;
+        pixels.SetPixel(x, y, color);
+        MarkTile(index, pixels.TileIndex(x, y));
+    }
+}
+
+/*! \brief Fill a whole layer with one color.
+    \param color premultiplied color
+*/
+void LayerStack::Fill(unsigned id, const sf::Color &color){
+    int index = IndexOf(id);
+    if (index >= 0){
+        m_layers[index]->m_pixels.Fill(color);
+        MarkLayer(index);
+    }
+}
+
+/*! \brief Get one tile of a layer. The tile is shared and must not be written to.
+    \return the tile, or nullptr if it is transparent or the layer does not exist
+*/
+TilePtr LayerStack::GetTile(unsigned id, unsigned tile) const{
+    int index = IndexOf(id);
+    return index < 0 ? TilePtr() : m_layers[index]->m_pixels.GetTilePtr(tile);
+}
+
+/*! \brief Replace one tile of a layer and mark it for compositing.
+    \param pixels new tile, which from now on is shared with the layer
+*/
+void LayerStack::SetTile(unsigned id, unsigned tile, const TilePtr &pixels){
+    int index = IndexOf(id);
+    if (index >= 0){
+        m_layers[index]->m_pixels.SetTilePtr(tile, pixels);
+        MarkTile(index, tile);
+    }
+}
+
+/*! \brief Put back the pixels of a tile a command replaced, only where
+        they are still what the command left.
+    \param before tile before the command
+    \param after tile the command left
+    \return the tile before this call, to put it back with SetTile()
+*/
+TilePtr LayerStack::RevertTile(unsigned id, unsigned tile, const TilePtr &before, const TilePtr &after){
+    TilePtr current = GetTile(id, tile);
+    // Tiles are copied on write, the same tile was not drawn on since
+    if (current == after){
+        SetTile(id, tile, before);
+        return current;
+    }
+    static const sf::Uint8 transparent[4] = {0, 0, 0, 0};
+    TilePtr out = TiledImage::AllocateTile();
+    bool changed = false;
+    for (std::size_t i = 0; i < TILE_BYTES; i += 4){
+        const sf::Uint8* now = current ? current.get() + i : transparent;
+        const sf::Uint8* left = after ? after.get() + i : transparent;
+        const sf::Uint8* back = before ? before.get() + i : transparent;
+        bool untouched = std::memcmp(now, left, 4) == 0;
+        std::memcpy(out.get() + i, untouched ? back : now, 4);
+        changed = changed || (untouched && std::memcmp(back, now, 4) != 0);
+    }
+    if (changed){
+        SetTile(id, tile, out);
+    }
+    return current;
+}
+
+/*! \brief Take a copy-on-write snapshot of the pixels of a layer.
+*/
+TiledImage LayerStack::Snapshot(unsigned id) const{
+    int index = IndexOf(id);
+    return index < 0 ? TiledImage(m_width, m_height) : m_layers[index]->m_pixels;
+}
+
+/*! \brief Put back the pixels of a layer from a snapshot.
+        Only tiles that differ from the snapshot are composited again.
+*/
+void LayerStack::Restore(unsigned id, const TiledImage &snapshot){
+    int index = IndexOf(id);
+    if (index < 0){
+        return;
+    }
+    TiledImage &pixels = m_layers[index]->m_pixels;
+    for (unsigned i = 0; i < pixels.GetTileCount(); i++){
+        if (pixels.GetTile(i) != snapshot.GetTile(i)){
+            MarkTile(index, i);
+        }
+    }
+    pixels = snapshot;
+}
+
+/*! \brief Composite every tile that changed since the last call.
+    \param updated if not null, the indices of the recomposited tiles are appended
+    \param tasks if not null, runs of tiles are composited on its workers
+    \param deadline tiles that were not started by then stay dirty, only
+           used with a task pool
+    \return the flattened image
+*/
+const TiledImage& LayerStack::Flatten(std::vector<unsigned>* updated, TaskPool* tasks,
+                                      TaskClock::time_point deadline){
+    if (!tasks || m_dirtyList.size() <= COMPOSITE_CHUNK){
+        for (std::size_t i = 0; i < m_dirtyList.size(); i++){
+            unsigned tile = m_dirtyList[i];
+            CompositeTile(tile);
+            m_tileState[tile] &= ~TILE_DIRTY;
+            if (updated){
+                updated->push_back(tile);
+            }
+        }
+        m_dirtyList.clear();
+        return m_flattened;
+    }
+    // Every tile has its own state, caches and flattened tile, so tiles can
+    // be composited side by side
+    std::size_t chunks = (m_dirtyList.size() + COMPOSITE_CHUNK - 1) / COMPOSITE_CHUNK;
+    std::vector<char> done(chunks, 0);
+    {
+        TaskGroup group(TASK_FRAME, deadline);
+        for (std::size_t c = 0; c < chunks; c++){
+            tasks->Submit(group, [this, c, &done]{
+                TraceScope trace("Composite tiles");
+                std::size_t last = std::min(m_dirtyList.size(), (c + 1) * COMPOSITE_CHUNK);
+                for (std::size_t i = c * COMPOSITE_CHUNK; i < last; i++){
+                    CompositeTile(m_dirtyList[i]);
+                }
+                done[c] = 1;
+            });
+        }
+        tasks->Wait(group);
+    }
+    std::vector<unsigned> left;
+    for (std::size_t i = 0; i < m_dirtyList.size(); i++){
+        unsigned tile = m_dirtyList[i];
+        if (!done[i / COMPOSITE_CHUNK]){
+            left.push_back(tile);
+            continue;
+        }
+        m_tileState[tile] &= ~TILE_DIRTY;
+        if (updated){
+            updated->push_back(tile);
+        }
+    }
+    m_dirtyList.swap(left);
+    return m_flattened;
+}
+
+/*! \brief Get the flattened image as of the last call to Flatten().
+*/
+const TiledImage& LayerStack::GetFlattened() const{
+    return m_flattened;
+}
+
+/*! \brief Composite every tile again on the next Flatten().
+*/
+void LayerStack::MarkAllDirty(){
+    for (unsigned i = 0; i < m_tileState.size(); i++){
+        if (!(m_tileState[i] & TILE_DIRTY)){
+            m_tileState[i] |= TILE_DIRTY;
+            m_dirtyList.push_back(i);
+        }
+    }
+}
+
+/*! \brief Check if tiles are waiting for the next Flatten(), because
+        they changed since or did not fit before the deadline.
+*/
+bool LayerStack::HasDirtyTiles() const{
+    return !m_dirtyList.empty();
+}
+
+/*! \brief Record that a tile of a layer changed. Depending on where the layer
+        sits relative to the active layer, the matching cache is invalidated.
+*/
+void LayerStack::MarkTile(int layerIndex, unsigned tile){
+    int active = GetActiveIndex();
+    if (layerIndex < active){
+        m_tileState[tile] &= ~TILE_BELOW_VALID;
+    } else if (layerIndex > active){
+        m_tileState[tile] &= ~TILE_ABOVE_VALID;
+    }
+    if (!(m_tileState[tile] & TILE_DIRTY)){
+        m_tileState[tile] |= TILE_DIRTY;
+        m_dirtyList.push_back(tile);
+    }
+}
+
+/*! \brief Record that every tile of a layer changed.
+*/
+void LayerStack::MarkLayer(int layerIndex){
+    for (unsigned i = 0; i < m_tileState.size(); i++){
+        MarkTile(layerIndex, i);
+    }
+}
+
+/*! \brief Drop the cached composites above and below the active layer.
+*/
+void LayerStack::InvalidateCaches(){
+    for (unsigned i = 0; i < m_tileState.size(); i++){
+        m_tileState[i] &= ~(TILE_BELOW_VALID | TILE_ABOVE_VALID);
+    }
+}
+
+/*! \brief Composite one tile of a range of layers.
+    \param first position of the lowest layer
+    \param last position one past the highest layer
+    \param tile tile index
+    \param out receives the composite, nullptr if it is fully transparent
+*/
+void LayerStack::CompositeRange(std::size_t first, std::size_t last, unsigned tile, TilePtr &out) const{
+    TileAccumulator accumulator(out);
+    for (std::size_t i = first; i < last; i++){
+        const Layer &layer = *m_layers[i];
+        if (layer.m_visible){
+            accumulator.Add(layer.m_pixels.GetTilePtr(tile), layer.m_opacity, layer.m_blendMode);
+        }
+    }
+    out = accumulator.Result();
+}
+
+/*! \brief Check if every visible layer above the active one blends normally,
+        which is what allows them to be cached as a single composite.
+*/
+bool LayerStack::AboveIsNormal(std::size_t active) const{
+    for (std::size_t i = active + 1; i < m_layers.size(); i++){
+        if (m_layers[i]->m_visible && m_layers[i]->m_blendMode != BLEND_NORMAL){
+            return false;
+        }
+    }
+    return true;
+}
+
+/*! \brief Rebuild one tile of the flattened image from the cached composites.
+*/
+void LayerStack::CompositeTile(unsigned tile){
+    std::size_t active = static_cast<std::size_t>(GetActiveIndex());
+    bool aboveCached = AboveIsNormal(active);
+    if (!(m_tileState[tile] & TILE_BELOW_VALID)){
+        CompositeRange(0, active, tile, m_below[tile]);
+        m_tileState[tile] |= TILE_BELOW_VALID;
+    }
+    if (aboveCached && !(m_tileState[tile] & TILE_ABOVE_VALID)){
+        CompositeRange(active + 1, m_layers.size(), tile, m_above[tile]);
+        m_tileState[tile] |= TILE_ABOVE_VALID;
+    }
+
+    TilePtr previous = m_flattened.GetTilePtr(tile);
+    m_flattened.SetTilePtr(tile, TilePtr());
+    TileAccumulator accumulator(previous);
+    accumulator.Add(m_below[tile], 255);
+    std::size_t last = aboveCached ? active + 1 : m_layers.size();
+    for (std::size_t i = active; i < last; i++){
+        const Layer &layer = *m_layers[i];
+        if (layer.m_visible){
+            accumulator.Add(layer.m_pixels.GetTilePtr(tile), layer.m_opacity, layer.m_blendMode);
+        }
+    }
+    if (aboveCached){
+        accumulator.Add(m_above[tile], 255);
+    }
+    m_flattened.SetTilePtr(tile, accumulator.Result());
+}
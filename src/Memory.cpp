@@ -0,0 +1,298 @@
+/**
+ *  @file   Memory.cpp
+ *  @brief  Frame arena, block pools and a count of heap allocations.
+ *  @author Team Avengers
+ *  @date   2020-12-16
+ ***********************************************/
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+// Project header files
+#include "Memory.hpp"
+
+namespace {
+
+// Heap allocations of the calling thread
+thread_local std::uint64_t heapAllocations = 0;
+
+// Bytes of free blocks a pool keeps at most, and blocks it keeps at least
+const std::size_t POOL_FREE_BYTES = 8 * 1024 * 1024;
+const std::size_t POOL_MIN_FREE = 64;
+
+// Smallest size class of PoolAllocate(), the others double up to POOL_MAX_BYTES
+const std::size_t POOL_MIN_BYTES = 16;
+const int POOL_CLASSES = 7;
+
+void* HeapAllocate(std::size_t size){
+    heapAllocations++;
+    if (size == 0){
+        size = 1;
+    }
+    for (;;){
+        void* memory = std::malloc(size);
+        if (memory){
+            return memory;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler){
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+// Pool of a size class, created on first use and never destroyed
+BlockPool& GetClassPool(int index){
+    static BlockPool* pools[POOL_CLASSES] = {
+        new BlockPool(16), new BlockPool(32), new BlockPool(64), new BlockPool(128),
+        new BlockPool(256), new BlockPool(512), new BlockPool(1024)
+    };
+    return *pools[index];
+}
+
+// Size class of an allocation that fits in the pools
+int GetClass(std::size_t size){
+    int index = 0;
+    for (std::size_t bytes = POOL_MIN_BYTES; bytes < size; bytes *= 2){
+        index++;
+    }
+    return index;
+}
+
+}
+
+// The global allocation functions, replaced to count heap allocations
+void* operator new(std::size_t size){
+    return HeapAllocate(size);
+}
+
+void* operator new[](std::size_t size){
+    return HeapAllocate(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept{
+    try{
+        return HeapAllocate(size);
+    } catch (...){
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept{
+    try{
+        return HeapAllocate(size);
+    } catch (...){
+        return nullptr;
+    }
+}
+
+void operator delete(void* memory) noexcept{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept{
+    std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept{
+    std::free(memory);
+}
+
+/*! \brief Get the number of heap allocations the calling thread made.
+*/
+std::uint64_t GetHeapAllocations(){
+    return heapAllocations;
+}
+
+/*! \brief Construct an arena.
+    \param size bytes to start with
+*/
+FrameArena::FrameArena(std::size_t size): m_memory(static_cast<char*>(::operator new(size))), m_size(size),
+ m_used(0), m_overflow(nullptr), m_overflowBytes(0){
+}
+
+/*! \brief Free the arena and whatever overflowed it.
+*/
+FrameArena::~FrameArena(){
+    Reset();
+    ::operator delete(m_memory);
+}
+
+/*! \brief Allocate memory that stays valid until the next Reset().
+    \param size bytes to allocate
+    \param alignment power of two the address is a multiple of, at most
+           the alignment of std::max_align_t
+*/
+void* FrameArena::Allocate(std::size_t size, std::size_t alignment){
+    std::size_t start = (m_used + alignment - 1) & ~(alignment - 1);
+    if (start + size <= m_size){
+        m_used = start + size;
+        return m_memory + start;
+    }
+    // The header is a multiple of the alignment of any type
+    const std::size_t header = (sizeof(Overflow) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+    Overflow* block = static_cast<Overflow*>(::operator new(header + size));
+    block->next = m_overflow;
+    m_overflow = block;
+    m_overflowBytes += size + alignment;
+    return reinterpret_cast<char*>(block) + header;
+}
+
+/*! \brief Give back everything allocated since the last reset. If the
+        arena overflowed, it grows to hold that much next time.
+*/
+void FrameArena::Reset(){
+    while (m_overflow){
+        Overflow* next = m_overflow->next;
+        ::operator delete(m_overflow);
+        m_overflow = next;
+    }
+    if (m_overflowBytes > 0){
+        std::size_t size = std::max(m_size * 2, m_size + m_overflowBytes);
+        ::operator delete(m_memory);
+        m_memory = static_cast<char*>(::operator new(size));
+        m_size = size;
+        m_overflowBytes = 0;
+    }
+    m_used = 0;
+}
+
+/*! \brief Get the number of bytes the arena holds without overflowing.
+*/
+std::size_t FrameArena::GetCapacity() const{
+    return m_size;
+}
+
+/*! \brief Get the number of bytes allocated from the arena since the last
+        reset, not counting what overflowed.
+*/
+std::size_t FrameArena::GetUsed() const{
+    return m_used;
+}
+
+/*! \brief Construct an arena.
+    \param size bytes it holds, allocated right away
+*/
+FixedArena::FixedArena(std::size_t size): m_memory(static_cast<char*>(::operator new(size))), m_size(size),
+ m_used(0), m_failures(0){
+}
+
+/*! \brief Free the arena.
+*/
+FixedArena::~FixedArena(){
+    ::operator delete(m_memory);
+}
+
+/*! \brief Allocate memory that stays valid as long as the arena.
+    \param size bytes to allocate
+    \param alignment power of two the address is a multiple of, at most
+           the alignment of std::max_align_t
+    \return nullptr if the arena is used up
+*/
+void* FixedArena::Allocate(std::size_t size, std::size_t alignment){
+    std::size_t start = (m_used + alignment - 1) & ~(alignment - 1);
+    if (start > m_size || size > m_size - start){
+        m_failures++;
+        return nullptr;
+    }
+    m_used = start + size;
+    return m_memory + start;
+}
+
+/*! \brief Get the number of bytes the arena holds.
+*/
+std::size_t FixedArena::GetCapacity() const{
+    return m_size;
+}
+
+/*! \brief Get the number of bytes allocated from the arena.
+*/
+std::size_t FixedArena::GetUsed() const{
+    return m_used;
+}
+
+/*! \brief Get the number of allocations that did not fit.
+*/
+unsigned FixedArena::GetFailures() const{
+    return m_failures;
+}
+
+/*! \brief Construct an empty pool.
+    \param size bytes of every block
+*/
+BlockPool::BlockPool(std::size_t size): m_free(nullptr), m_freeCount(0),
+ m_maxFree(std::max(POOL_MIN_FREE, POOL_FREE_BYTES / std::max(size, sizeof(FreeBlock)))),
+ m_size(std::max(size, sizeof(FreeBlock))){
+}
+
+/*! \brief Take a block of the pool, or a new one from the heap if the
+        pool is empty.
+*/
+void* BlockPool::Allocate(){
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_free){
+            FreeBlock* block = m_free;
+            m_free = block->next;
+            m_freeCount--;
+            return block;
+        }
+    }
+    return ::operator new(m_size);
+}
+
+/*! \brief Give a block back to the pool, or to the heap if the pool
+        already keeps enough.
+*/
+void BlockPool::Free(void* block){
+    if (!block){
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_freeCount < m_maxFree){
+            FreeBlock* free = static_cast<FreeBlock*>(block);
+            free->next = m_free;
+            m_free = free;
+            m_freeCount++;
+            return;
+        }
+    }
+    ::operator delete(block);
+}
+
+/*! \brief Get the number of bytes of every block.
+*/
+std::size_t BlockPool::GetBlockSize() const{
+    return m_size;
+}
+
+/*! \brief Allocate from the pool of a size class.
+    \param size bytes needed
+*/
+void* PoolAllocate(std::size_t size){
+    if (size > POOL_MAX_BYTES){
+        return ::operator new(size);
+    }
+    return GetClassPool(GetClass(size)).Allocate();
+}
+
+/*! \brief Free memory from PoolAllocate().
+    \param block memory to free
+    \param size bytes that were asked for
+*/
+void PoolFree(void* block, std::size_t size){
+    if (size > POOL_MAX_BYTES){
+        ::operator delete(block);
+        return;
+    }
+    GetClassPool(GetClass(size)).Free(block);
+}
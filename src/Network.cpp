@@ -0,0 +1,1041 @@
+/**
+ *  @file   Network.cpp
+ *  @brief  Implementation of Network.hpp
+ *  @author Team Avengers
+ *  @date   2020-12-11
+ ***********************************************/
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <zlib.h>
+// Project header files
+#include "App.hpp"
+#include "ClearCanvas.hpp"
+#include "Draw.hpp"
+#include "FilterCommand.hpp"
+#include "Memory.hpp"
+#include "Network.hpp"
+#include "RevertCommand.hpp"
+
+namespace {
+
+// Bytes read from the socket at a time
+const std::size_t READ_SIZE = 1 << 16;
+// Larger messages mean the other side is broken
+const std::size_t MAX_MESSAGE = 1 << 24;
+// Messages are appended to the last chunk until it is this big
+const std::size_t CHUNK_SIZE = 1 << 16;
+// Most chunks written by one call
+const int MAX_IOV = 64;
+
+// Tags of the entries of a command batch
+enum BatchEntry{
+    ENTRY_COMMAND,
+    ENTRY_STROKE
+};
+
+// Footprints of commands that change more than one pixel, or nothing
+const std::uint64_t FOOTPRINT_ALL = ~std::uint64_t(0);
+const std::uint64_t FOOTPRINT_NONE = FOOTPRINT_ALL - 1;
+
+// Key of the pixel a command changes, to find commands that conflict
+std::uint64_t GetFootprint(const Command &command){
+    if (command.GetType() == COMMAND_REVERT){
+        const std::shared_ptr<Command> &target = static_cast<const RevertCommand&>(command).GetTarget();
+        return target ? GetFootprint(*target) : FOOTPRINT_NONE;
+    }
+    if (command.GetType() != COMMAND_DRAW){
+        return FOOTPRINT_ALL;
+    }
+    const Draw &draw = static_cast<const Draw&>(command);
+    sf::Vector2i coords = draw.GetCoords();
+    return static_cast<std::uint64_t>(draw.GetLayer()) << 48 |
+           static_cast<std::uint64_t>(coords.y & 0xFFFFFF) << 24 | static_cast<std::uint64_t>(coords.x & 0xFFFFFF);
+}
+
+// Find the layer a command changes, false if it names none
+bool GetCommandLayer(const Command &command, unsigned &layer){
+    switch (command.GetType()){
+    case COMMAND_DRAW:
+        layer = static_cast<const Draw&>(command).GetLayer();
+        return true;
+    case COMMAND_CLEAR:
+        layer = static_cast<const ClearCanvas&>(command).GetLayer();
+        return true;
+    case COMMAND_FILTER:
+        layer = static_cast<const FilterCommand&>(command).GetLayer();
+        return true;
+    case COMMAND_REVERT:{
+        const std::shared_ptr<Command> &target = static_cast<const RevertCommand&>(command).GetTarget();
+        return target && GetCommandLayer(*target, layer);
+    }
+    default:
+        return false;
+    }
+}
+
+void AppendVarint(std::vector<std::uint8_t> &out, std::uint64_t value){
+    while (value >= 0x80){
+        out.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+}
+
+/*! \brief Construct a closed connection.
+*/
+Connection::Connection(): m_fd(-1), m_inStart(0), m_outStart(0), m_pending(0){
+}
+
+/*! \brief Take over a socket accepted by a server.
+*/
+Connection::Connection(int fd): m_fd(fd), m_inStart(0), m_outStart(0), m_pending(0){
+    Setup();
+}
+
+/*! \brief Close the socket.
+*/
+Connection::~Connection(){
+    Close();
+}
+
+/*! \brief Connect to a server. Blocks until the connection is made.
+    \param host name or address of the server
+    \param port TCP port of the server
+    \return true if connected
+*/
+bool Connection::Connect(const std::string &host, unsigned short port){
+    Close();
+    struct addrinfo hints;
+    std::memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* addresses = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0){
+        return false;
+    }
+    for (struct addrinfo* a = addresses; a && m_fd < 0; a = a->ai_next){
+        m_fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (m_fd >= 0 && connect(m_fd, a->ai_addr, a->ai_addrlen) != 0){
+            close(m_fd);
+            m_fd = -1;
+        }
+    }
+    freeaddrinfo(addresses);
+    if (m_fd >= 0){
+        Setup();
+    }
+    return m_fd >= 0;
+}
+
+/*! \brief Close the socket and drop anything not sent or handed out.
+*/
+void Connection::Close(){
+    if (m_fd >= 0){
+        close(m_fd);
+        m_fd = -1;
+    }
+    m_in.clear();
+    m_inStart = 0;
+    m_out.clear();
+    m_outStart = 0;
+    m_pending = 0;
+}
+
+/*! \brief Check if the socket is open.
+*/
+bool Connection::IsOpen() const{
+    return m_fd >= 0;
+}
+
+/*! \brief Get the socket, to wait for it with poll().
+*/
+int Connection::GetFd() const{
+    return m_fd;
+}
+
+/*! \brief Queue a message.
+    \param type kind of message
+    \param payload bytes after the type
+    \param size number of payload bytes
+*/
+void Connection::Send(MessageType type, const std::uint8_t* payload, std::size_t size){
+    std::vector<std::uint8_t> &out = Append();
+    std::size_t before = out.size();
+    AppendVarint(out, size + 1);
+    out.push_back(static_cast<std::uint8_t>(type));
+    out.insert(out.end(), payload, payload + size);
+    m_pending += out.size() - before;
+}
+
+/*! \brief Queue messages that were already framed with Frame().
+*/
+void Connection::SendFramed(const std::uint8_t* messages, std::size_t size){
+    std::vector<std::uint8_t> &out = Append();
+    out.insert(out.end(), messages, messages + size);
+    m_pending += size;
+}
+
+/*! \brief Queue framed messages without copying them, so messages going
+        to many connections are only encoded and stored once.
+*/
+void Connection::SendShared(const SharedMessages &messages){
+    if (messages->empty()){
+        return;
+    }
+    Chunk chunk = {messages, nullptr};
+    m_out.push_back(chunk);
+    m_pending += messages->size();
+}
+
+/*! \brief Write as much of the queued messages as the socket takes
+        without blocking, up to MAX_IOV chunks per call.
+    \return false if the connection failed
+*/
+bool Connection::Flush(){
+    struct iovec iov[MAX_IOV];
+    while (m_fd >= 0 && !m_out.empty()){
+        int count = 0;
+        for (std::size_t i = 0; i < m_out.size() && count < MAX_IOV; i++, count++){
+            std::size_t skip = i == 0 ? m_outStart : 0;
+            iov[count].iov_base = const_cast<std::uint8_t*>(m_out[i].data->data() + skip);
+            iov[count].iov_len = m_out[i].data->size() - skip;
+        }
+        // sendmsg() is writev() with MSG_NOSIGNAL
+        struct msghdr message;
+        std::memset(&message, 0, sizeof(message));
+        message.msg_iov = iov;
+        message.msg_iovlen = count;
+        ssize_t sent = sendmsg(m_fd, &message, MSG_NOSIGNAL);
+        if (sent < 0){
+            if (errno == EAGAIN || errno == EWOULDBLOCK){
+                break;
+            }
+            if (errno == EINTR){
+                continue;
+            }
+            return false;
+        }
+        m_pending -= sent;
+        std::size_t left = static_cast<std::size_t>(sent);
+        while (left > 0){
+            std::size_t rest = m_out.front().data->size() - m_outStart;
+            if (left < rest){
+                m_outStart += left;
+                break;
+            }
+            left -= rest;
+            m_out.pop_front();
+            m_outStart = 0;
+        }
+    }
+    return m_fd >= 0;
+}
+
+/*! \brief Check if there are messages the socket did not take yet.
+*/
+bool Connection::HasPending() const{
+    return m_pending > 0;
+}
+
+/*! \brief Get the number of bytes the socket did not take yet, so a
+        server can tell a client that stopped reading.
+*/
+std::size_t Connection::GetPendingSize() const{
+    return m_pending;
+}
+
+/*! \brief Drop the queued messages the socket did not start on. A chunk
+        that was partly sent is kept, so no message is cut in half.
+    \return number of bytes dropped
+*/
+std::size_t Connection::DropPending(){
+    std::size_t keep = m_outStart > 0 ? 1 : 0;
+    std::size_t dropped = 0;
+    while (m_out.size() > keep){
+        dropped += m_out.back().data->size();
+        m_out.pop_back();
+    }
+    m_pending -= dropped;
+    return dropped;
+}
+
+/*! \brief Read everything that arrived without blocking.
+    \return false if the other side closed the connection or it failed.
+        Messages that arrived before can still be taken.
+*/
+bool Connection::Receive(){
+    if (m_fd < 0){
+        return false;
+    }
+    // Move the unread bytes to the front once most of the buffer is used up
+    if (m_inStart > 0 && m_inStart * 2 >= m_in.size()){
+        m_in.erase(m_in.begin(), m_in.begin() + m_inStart);
+        m_inStart = 0;
+    }
+    while (true){
+        std::size_t used = m_in.size();
+        m_in.resize(used + READ_SIZE);
+        ssize_t received = recv(m_fd, &m_in[used], READ_SIZE, 0);
+        m_in.resize(used + std::max<ssize_t>(received, 0));
+        if (received > 0){
+            continue;
+        }
+        if (received < 0 && errno == EINTR){
+            continue;
+        }
+        return received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+}
+
+/*! \brief Take the next complete message.
+    \param type set to the kind of message
+    \param payload set to the bytes after the type, valid until the next Receive()
+    \param size set to the number of payload bytes
+    \return false if no complete message arrived yet
+*/
+bool Connection::NextMessage(std::uint8_t &type, const std::uint8_t* &payload, std::size_t &size){
+    ByteReader in(m_in.data() + m_inStart, m_in.size() - m_inStart);
+    std::uint64_t length = in.GetVarint();
+    if (!in.Ok()){
+        return false;
+    }
+    if (length == 0 || length > MAX_MESSAGE){
+        Close();
+        return false;
+    }
+    const std::uint8_t* body = in.GetBytes(static_cast<std::size_t>(length));
+    if (!in.Ok()){
+        return false;
+    }
+    type = body[0];
+    payload = body + 1;
+    size = static_cast<std::size_t>(length) - 1;
+    m_inStart = m_in.size() - in.GetRemaining();
+    return true;
+}
+
+/*! \brief Frame a message into a buffer, to send it with SendFramed().
+*/
+void Connection::Frame(MessageType type, const std::uint8_t* payload, std::size_t size, ByteWriter &out){
+    out.PutVarint(size + 1);
+    out.PutU8(static_cast<std::uint8_t>(type));
+    out.PutBytes(payload, size);
+}
+
+/*! \brief Get the chunk to append messages to, a new one if the last is
+        shared or full.
+*/
+std::vector<std::uint8_t>& Connection::Append(){
+    if (m_out.empty() || !m_out.back().own || m_out.back().own->size() >= CHUNK_SIZE){
+        std::shared_ptr<std::vector<std::uint8_t>> data = std::make_shared<std::vector<std::uint8_t>>();
+        Chunk chunk = {data, data.get()};
+        m_out.push_back(chunk);
+    }
+    return *m_out.back().own;
+}
+
+/*! \brief Make the socket non-blocking and send small messages right away.
+*/
+void Connection::Setup(){
+    fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL, 0) | O_NONBLOCK);
+    int on = 1;
+    setsockopt(m_fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+/*! \brief Write the pixels of a tile for a MESSAGE_TILE, deflated if that
+        makes them smaller.
+    \param pixels TILE_BYTES bytes, or nullptr for a transparent tile
+    \param out receives the encoding and the pixels
+    \param scratch reused buffer for the deflated pixels
+*/
+void WriteTilePixels(const sf::Uint8* pixels, ByteWriter &out, std::vector<std::uint8_t> &scratch){
+    if (!pixels){
+        out.PutU8(TILE_EMPTY);
+        return;
+    }
+    scratch.resize(compressBound(TILE_BYTES));
+    uLongf size = static_cast<uLongf>(scratch.size());
+    // The fastest level, most tiles are flat color or mostly empty
+    if (compress2(&scratch[0], &size, pixels, TILE_BYTES, 1) == Z_OK && size < TILE_BYTES){
+        out.PutU8(TILE_DEFLATE);
+        out.PutVarint(size);
+        out.PutBytes(&scratch[0], size);
+    } else{
+        out.PutU8(TILE_RAW);
+        out.PutBytes(pixels, TILE_BYTES);
+    }
+}
+
+/*! \brief Read the pixels written by WriteTilePixels().
+    \param tile set to a new tile, or nullptr for a transparent one
+    \return false if the data is damaged
+*/
+bool ReadTilePixels(ByteReader &in, TilePtr &tile){
+    std::uint8_t encoding = in.GetU8();
+    if (encoding == TILE_EMPTY){
+        tile.reset();
+        return in.Ok();
+    }
+    if (encoding == TILE_RAW){
+        const std::uint8_t* pixels = in.GetBytes(TILE_BYTES);
+        if (!in.Ok()){
+            return false;
+        }
+        tile = TiledImage::AllocateTile();
+        std::memcpy(tile.get(), pixels, TILE_BYTES);
+        return true;
+    }
+    if (encoding != TILE_DEFLATE){
+        return false;
+    }
+    std::size_t size = static_cast<std::size_t>(in.GetVarint());
+    const std::uint8_t* data = in.GetBytes(size);
+    if (!in.Ok()){
+        return false;
+    }
+    tile = TiledImage::AllocateTile();
+    uLongf length = TILE_BYTES;
+    return uncompress(tile.get(), &length, data, static_cast<uLong>(size)) == Z_OK && length == TILE_BYTES;
+}
+
+/*! \brief Construct an empty batch.
+*/
+CommandBatchWriter::CommandBatchWriter(): m_count(0), m_points(MAX_STROKE_SAMPLES),
+ m_coverage(MAX_STROKE_SAMPLES), m_samples(0), m_encoded(GetMaxStrokeSize(MAX_STROKE_SAMPLES)){
+}
+
+/*! \brief Add a command to the batch.
+*/
+void CommandBatchWriter::Add(const Command &command){
+    if (command.GetType() != COMMAND_DRAW){
+        FlushStroke();
+        m_entries.PutU8(ENTRY_COMMAND);
+        WriteCommand(command, m_entries);
+        m_count++;
+        return;
+    }
+    const Draw &draw = static_cast<const Draw&>(command);
+    if (m_samples > 0 && (draw.GetColor() != m_header.color || draw.GetLayer() != m_header.layer ||
+        m_samples == MAX_STROKE_SAMPLES)){
+        FlushStroke();
+    }
+    if (m_samples == 0){
+        m_header.color = draw.GetColor();
+        m_header.layer = draw.GetLayer();
+        m_header.brushSize = 1;
+    }
+    m_points[m_samples] = draw.GetCoords();
+    m_coverage[m_samples] = draw.GetCoverage();
+    m_samples++;
+}
+
+/*! \brief Check if nothing was added since the last Finish().
+*/
+bool CommandBatchWriter::IsEmpty() const{
+    return m_count == 0 && m_samples == 0;
+}
+
+/*! \brief Write the batch and start a new one.
+    \param out receives the payload
+*/
+void CommandBatchWriter::Finish(ByteWriter &out){
+    FlushStroke();
+    out.PutVarint(m_count);
+    out.PutBytes(m_entries.GetData(), m_entries.GetSize());
+    m_entries.Clear();
+    m_count = 0;
+}
+
+/*! \brief Encode the draws collected so far as one stroke entry.
+*/
+void CommandBatchWriter::FlushStroke(){
+    if (m_samples == 0){
+        return;
+    }
+    std::size_t size = EncodeStroke(m_header, &m_points[0], &m_coverage[0], m_samples, &m_encoded[0], m_encoded.size());
+    m_entries.PutU8(ENTRY_STROKE);
+    m_entries.PutBytes(&m_encoded[0], size);
+    m_count++;
+    m_samples = 0;
+}
+
+/*! \brief Construct a reader with room for the longest stroke.
+*/
+CommandBatchReader::CommandBatchReader(): m_points(MAX_STROKE_SAMPLES), m_coverage(MAX_STROKE_SAMPLES){
+}
+
+/*! \brief Read the commands of a batch.
+    \param in payload of the message, positioned at the batch
+    \param app app the commands are created for
+    \param commands receives the commands in order
+    \return false if the batch is damaged
+*/
+bool CommandBatchReader::Read(ByteReader &in, App &app, std::vector<std::shared_ptr<Command>> &commands){
+    std::uint64_t count = in.GetVarint();
+    for (std::uint64_t i = 0; i < count && in.Ok(); i++){
+        std::uint8_t tag = in.GetU8();
+        if (tag == ENTRY_COMMAND){
+            std::shared_ptr<Command> command = ReadCommand(in, app);
+            // An import names a file on the machine of the sender
+            if (!command || command->GetType() == COMMAND_IMPORT){
+                return false;
+            }
+            commands.push_back(command);
+        } else if (tag == ENTRY_STROKE){
+            StrokeHeader header;
+            std::size_t samples = 0;
+            // GetBytes(0) gives the position without moving it
+            std::size_t used = DecodeStroke(in.GetBytes(0), in.GetRemaining(), header, &m_points[0],
+                                            &m_coverage[0], m_points.size(), samples);
+            if (used == 0){
+                return false;
+            }
+            in.GetBytes(used);
+            for (std::size_t s = 0; s < samples; s++){
+                commands.push_back(Draw::Create(m_points[s], header.color, header.layer, m_coverage[s], app));
+            }
+        } else{
+            return false;
+        }
+    }
+    return in.Ok();
+}
+
+/*! \brief Add a command of the user, or if it is a RevertCommand, set
+        the command it takes back.
+    \param sequence kept with the command
+    \param targetSequence if not null, set to the sequence number of the
+        command a revert takes back
+*/
+void CommandHistory::Record(const std::shared_ptr<Command> &command, std::uint64_t sequence,
+                            std::uint64_t* targetSequence){
+    if (command->GetType() == COMMAND_REVERT){
+        RevertCommand &revert = static_cast<RevertCommand&>(*command);
+        revert.SetTarget(Find(revert.GetBack(), targetSequence));
+        return;
+    }
+    m_entries.push_back(std::make_pair(sequence, command));
+    if (m_entries.size() > UNDO_HISTORY){
+        m_entries.pop_front();
+    }
+}
+
+/*! \brief Find a command of the user.
+    \param back 1 for the last command, 2 for the one before...
+    \param sequence if not null and the command is found, set to its sequence number
+    \return the command, nullptr if it is not kept
+*/
+std::shared_ptr<Command> CommandHistory::Find(std::uint64_t back, std::uint64_t* sequence) const{
+    if (back == 0 || back > m_entries.size()){
+        return nullptr;
+    }
+    const std::pair<std::uint64_t, std::shared_ptr<Command>> &entry = m_entries[m_entries.size() - back];
+    if (sequence){
+        *sequence = entry.first;
+    }
+    return entry.second;
+}
+
+/*! \brief Get how many commands back the last time a command was added is.
+    \return 1 for the last command, 0 if it is not kept
+*/
+std::uint64_t CommandHistory::GetBack(const Command* command) const{
+    for (std::size_t i = m_entries.size(); i-- > 0;){
+        if (m_entries[i].second.get() == command){
+            return m_entries.size() - i;
+        }
+    }
+    return 0;
+}
+
+/*! \brief Forget every command.
+*/
+void CommandHistory::Clear(){
+    m_entries.clear();
+}
+
+/*! \brief Construct a client that is not connected.
+*/
+NetworkClient::NetworkClient(): m_helloSent(false), m_unsent(0), m_footprintAll(false), m_footprintStale(false),
+ m_batchesSent(0), m_batchesAcked(0), m_userId(0), m_status("Not connected"),
+ m_snapshotTiles(0), m_snapshotReceived(0), m_viewportLoaded(false), m_canvasLoaded(false), m_lastHash(0),
+ m_cursorVisible(false), m_cursorSentVisible(false){
+}
+
+/*! \brief Connect to a server and say hello.
+    \param address "host", "host:port" or either followed by "/room" to
+        join a room other than the default one
+    \return true if connected, the server still has to welcome us
+*/
+bool NetworkClient::Connect(const std::string &address){
+    std::string host = address;
+    unsigned short port = DEFAULT_PORT;
+    std::size_t slash = host.find('/');
+    m_room.clear();
+    if (slash != std::string::npos){
+        m_room = host.substr(slash + 1);
+        host.erase(slash);
+    }
+    std::size_t colon = host.rfind(':');
+    if (colon != std::string::npos){
+        port = static_cast<unsigned short>(std::atoi(host.c_str() + colon + 1));
+        host.erase(colon);
+    }
+    m_userId = 0;
+    m_message.Clear();
+    m_batch.Finish(m_message);
+    if (!m_connection.Connect(host, port)){
+        m_status = "Could not connect to " + address;
+        std::cout << m_status << std::endl;
+        return false;
+    }
+    // Hello goes out with the first Poll(), which has the canvas to hash
+    m_helloSent = false;
+    m_snapshotTiles = 0;
+    m_snapshotReceived = 0;
+    m_viewportLoaded = false;
+    m_canvasLoaded = false;
+    m_lastTile.reset();
+    m_lastHash = 0;
+    m_cursorSentVisible = false;
+    m_cursors.clear();
+    ResetShared();
+    m_status = "Connecting to " + address;
+    return true;
+}
+
+/*! \brief Leave the server.
+*/
+void NetworkClient::Disconnect(){
+    m_connection.Close();
+    m_userId = 0;
+    m_cursors.clear();
+    m_status = "Not connected";
+}
+
+/*! \brief Check if the client is connected to a server.
+*/
+bool NetworkClient::IsConnected() const{
+    return m_connection.IsOpen();
+}
+
+/*! \brief Get the id the server gave us, 0 until then.
+*/
+unsigned NetworkClient::GetUserId() const{
+    return m_userId;
+}
+
+/*! \brief Get a message describing the connection, shown in the GUI.
+*/
+const std::string& NetworkClient::GetStatus() const{
+    if (m_userId != 0 && !m_canvasLoaded && m_snapshotTiles > 0){
+        m_statusLine = m_status;
+        m_statusLine += ", loading ";
+        m_statusLine += std::to_string(m_snapshotReceived * 100 / m_snapshotTiles);
+        m_statusLine += "%";
+        return m_statusLine;
+    }
+    return m_status;
+}
+
+/*! \brief Set the part of the canvas on screen, which the server sends first
+        when we join. Only used by the next Connect().
+    \param viewport rectangle in canvas pixels, empty for the whole window
+*/
+void NetworkClient::SetViewport(const sf::IntRect &viewport){
+    m_viewport = viewport;
+}
+
+/*! \brief Check if every tile of the viewport arrived since we joined.
+*/
+bool NetworkClient::IsViewportLoaded() const{
+    return m_viewportLoaded;
+}
+
+/*! \brief Check if the canvas is the same as the server's since we joined.
+*/
+bool NetworkClient::IsCanvasLoaded() const{
+    return m_canvasLoaded;
+}
+
+/*! \brief Queue a command that executed on this canvas for the other users.
+        Layers and imported images stay on this canvas.
+*/
+void NetworkClient::Queue(const std::shared_ptr<Command> &command){
+    if (!m_connection.IsOpen() || command->GetType() == COMMAND_LAYER ||
+        command->GetType() == COMMAND_IMPORT){
+        return;
+    }
+    // Until the welcome it is not known which layers are shared, the others
+    // skip what they do not share
+    if (m_userId != 0 && !IsShared(*command)){
+        return;
+    }
+    m_batch.Add(*command);
+    m_own.Record(command);
+    AddPending(command);
+}
+
+/*! \brief Undo one of our commands on the shared canvas. Only its pixels
+        that nobody drew over since go back, here and on every other canvas.
+    \param command a command queued since we connected
+    \return false if not connected or the command was not shared
+*/
+bool NetworkClient::Undo(const std::shared_ptr<Command> &command){
+    std::uint64_t back = m_connection.IsOpen() ? m_own.GetBack(command.get()) : 0;
+    if (back == 0){
+        return false;
+    }
+    std::shared_ptr<Command> revert = MakePooled<RevertCommand>("revert", back, command);
+    revert->execute();
+    m_batch.Add(*revert);
+    AddPending(revert);
+    return true;
+}
+
+/*! \brief Set where our mouse is, shown to the other users.
+    \param position mouse position in canvas pixels
+    \param visible false if the mouse is not over the canvas
+*/
+void NetworkClient::SetCursor(const sf::Vector2i &position, bool visible){
+    m_cursor = position;
+    m_cursorVisible = visible;
+}
+
+/*! \brief Get the cursors of the other users that are on the canvas.
+*/
+const std::vector<RemoteCursor>& NetworkClient::GetCursors() const{
+    return m_cursors;
+}
+
+/*! \brief Send the queued commands and apply the ones of the other users.
+        Called once per frame.
+    \param app app to apply the commands to
+*/
+void NetworkClient::Poll(App &app){
+    if (!m_connection.IsOpen()){
+        return;
+    }
+    if (!m_helloSent){
+        SendHello(app);
+    }
+    SendBatch();
+    SendCursor();
+    bool alive = m_connection.Flush() && m_connection.Receive();
+    std::uint8_t type;
+    const std::uint8_t* payload;
+    std::size_t size;
+    while (m_connection.NextMessage(type, payload, size)){
+        ByteReader in(payload, size);
+        if (type == MESSAGE_WELCOME){
+            m_userId = static_cast<unsigned>(in.GetVarint());
+            unsigned width = static_cast<unsigned>(in.GetVarint());
+            unsigned height = static_cast<unsigned>(in.GetVarint());
+            m_snapshotTiles = static_cast<unsigned>(in.GetVarint());
+            std::uint64_t shared = in.GetVarint();
+            m_sharedLayers.clear();
+            for (std::uint64_t i = 0; i < shared && in.Ok(); i++){
+                m_sharedLayers.push_back(static_cast<unsigned>(in.GetVarint()));
+            }
+            if (!in.Ok() || width != app.GetLayers().GetWidth() || height != app.GetLayers().GetHeight()){
+                Fail("The canvas of the server is " + std::to_string(width) + "x" + std::to_string(height));
+                return;
+            }
+            m_status = "Connected as user " + std::to_string(m_userId);
+            std::cout << m_status << std::endl;
+        } else if (type == MESSAGE_TILE){
+            if (!ReceiveTile(in, app)){
+                Fail("The server sent a damaged tile");
+                return;
+            }
+        } else if (type == MESSAGE_SNAPSHOT){
+            std::uint64_t stage = in.GetVarint();
+            if (stage == SNAPSHOT_CATCH_UP){
+                // Commands of the others were dropped, the ones we have are
+                // not the last ones anymore
+                m_users.clear();
+                continue;
+            }
+            m_viewportLoaded = true;
+            if (stage == SNAPSHOT_DONE){
+                m_canvasLoaded = true;
+                m_lastTile.reset();
+                // Confirm after our own commands, so the server knows which
+                // of them we drew before the last tile came in
+                SendBatch();
+                std::uint64_t done = in.GetVarint();
+                m_message.Clear();
+                m_message.PutVarint(SNAPSHOT_DONE);
+                m_message.PutVarint(done);
+                m_connection.Send(MESSAGE_SNAPSHOT, m_message.GetData(), m_message.GetSize());
+            }
+        } else if (type == MESSAGE_ACK){
+            Acknowledge(in.GetVarint());
+        } else if (type == MESSAGE_CURSORS){
+            if (!ReceiveCursors(in)){
+                Fail("The server sent damaged cursors");
+                return;
+            }
+        } else if (type == MESSAGE_COMMANDS){
+            unsigned user = static_cast<unsigned>(in.GetVarint());
+            m_received.clear();
+            if (!m_reader.Read(in, app, m_received)){
+                Fail("The server sent a damaged message");
+                return;
+            }
+            CommandHistory &history = m_users[user];
+            for (std::size_t i = 0; i < m_received.size(); i++){
+                history.Record(m_received[i]);
+            }
+            // The batch came first on the server, so our pending commands
+            // go on top of it
+            bool rebase = Conflicts(m_received);
+            for (std::size_t i = m_pending.size(); rebase && i-- > 0;){
+                m_pending[i]->undo();
+            }
+            for (std::size_t i = 0; i < m_received.size(); i++){
+                if (IsShared(*m_received[i])){
+                    app.ApplyRemoteCommand(m_received[i], user);
+                }
+            }
+            for (std::size_t i = 0; rebase && i < m_pending.size(); i++){
+                m_pending[i]->execute();
+            }
+        }
+    }
+    if (!alive || !m_connection.IsOpen()){
+        Fail("Lost the connection to the server");
+    }
+}
+
+/*! \brief Send the commands queued since the last call as one batch.
+*/
+void NetworkClient::SendBatch(){
+    if (m_batch.IsEmpty()){
+        return;
+    }
+    m_message.Clear();
+    m_batch.Finish(m_message);
+    m_connection.Send(MESSAGE_COMMANDS, m_message.GetData(), m_message.GetSize());
+    m_pendingBatches.push_back(m_unsent);
+    m_unsent = 0;
+    m_batchesSent++;
+}
+
+/*! \brief Tell the server where our mouse is if it moved to another cell
+        of PRESENCE_QUANTUM pixels, at most once every PRESENCE_MS.
+*/
+void NetworkClient::SendCursor(){
+    if (m_userId == 0){
+        return;
+    }
+    sf::Vector2i cell(m_cursor.x / PRESENCE_QUANTUM, m_cursor.y / PRESENCE_QUANTUM);
+    if (m_cursorVisible == m_cursorSentVisible && (!m_cursorVisible || cell == m_cursorSent)){
+        return;
+    }
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    if (now - m_cursorTime < std::chrono::milliseconds(PRESENCE_MS)){
+        return;
+    }
+    m_cursorTime = now;
+    m_cursorSent = cell;
+    m_cursorSentVisible = m_cursorVisible;
+    m_message.Clear();
+    m_message.PutU8(m_cursorVisible ? 1 : 0);
+    if (m_cursorVisible){
+        m_message.PutSigned(cell.x);
+        m_message.PutSigned(cell.y);
+    }
+    m_connection.Send(MESSAGE_CURSOR, m_message.GetData(), m_message.GetSize());
+}
+
+/*! \brief Take the cursors of a MESSAGE_CURSORS, which has all of them.
+    \return false if the message is damaged
+*/
+bool NetworkClient::ReceiveCursors(ByteReader &in){
+    std::uint64_t count = in.GetVarint();
+    if (!in.Ok() || count > in.GetRemaining()){
+        return false;
+    }
+    m_cursors.clear();
+    for (std::uint64_t i = 0; i < count; i++){
+        RemoteCursor cursor;
+        cursor.id = static_cast<unsigned>(in.GetVarint());
+        cursor.position.x = static_cast<int>(in.GetSigned()) * PRESENCE_QUANTUM + PRESENCE_QUANTUM / 2;
+        cursor.position.y = static_cast<int>(in.GetSigned()) * PRESENCE_QUANTUM + PRESENCE_QUANTUM / 2;
+        if (cursor.id != m_userId){
+            m_cursors.push_back(cursor);
+        }
+    }
+    return in.Ok();
+}
+
+/*! \brief Keep a command that executed here until the server applied it.
+*/
+void NetworkClient::AddPending(const std::shared_ptr<Command> &command){
+    m_pending.push_back(command);
+    m_unsent++;
+    if (!m_footprintStale){
+        AddFootprint(*command);
+    }
+}
+
+/*! \brief Add the pixel a pending command changes to the footprint.
+*/
+void NetworkClient::AddFootprint(const Command &command){
+    std::uint64_t footprint = GetFootprint(command);
+    if (footprint == FOOTPRINT_ALL){
+        m_footprintAll = true;
+    } else if (footprint != FOOTPRINT_NONE){
+        m_footprint.insert(footprint);
+    }
+}
+
+/*! \brief Forget the pending commands of the batches the server applied.
+    \param batches number of our batches the server applied so far
+*/
+void NetworkClient::Acknowledge(std::uint64_t batches){
+    while (m_batchesAcked < batches && !m_pendingBatches.empty()){
+        m_pending.erase(m_pending.begin(), m_pending.begin() + m_pendingBatches.front());
+        m_pendingBatches.pop_front();
+        m_batchesAcked++;
+        m_footprintStale = true;
+    }
+}
+
+/*! \brief Check if commands of another user change a pixel one of our
+        pending commands changes.
+*/
+bool NetworkClient::Conflicts(const std::vector<std::shared_ptr<Command>> &commands){
+    if (m_pending.empty()){
+        return false;
+    }
+    if (m_footprintStale){
+        m_footprint.clear();
+        m_footprintAll = false;
+        m_footprintStale = false;
+        for (std::size_t i = 0; i < m_pending.size(); i++){
+            AddFootprint(*m_pending[i]);
+        }
+    }
+    for (std::size_t i = 0; i < commands.size(); i++){
+        std::uint64_t footprint = GetFootprint(*commands[i]);
+        if (footprint != FOOTPRINT_NONE &&
+            (footprint == FOOTPRINT_ALL || m_footprintAll || m_footprint.count(footprint))){
+            return true;
+        }
+    }
+    return false;
+}
+
+/*! \brief Check if a command changes a layer everyone has, or no layer.
+*/
+bool NetworkClient::IsShared(const Command &command) const{
+    unsigned layer;
+    return !GetCommandLayer(command, layer) ||
+           std::find(m_sharedLayers.begin(), m_sharedLayers.end(), layer) != m_sharedLayers.end();
+}
+
+/*! \brief Forget the pending commands and the commands of every user.
+*/
+void NetworkClient::ResetShared(){
+    m_pending.clear();
+    m_pendingBatches.clear();
+    m_unsent = 0;
+    m_footprint.clear();
+    m_footprintAll = false;
+    m_footprintStale = false;
+    m_batchesSent = 0;
+    m_batchesAcked = 0;
+    m_own.Clear();
+    m_users.clear();
+    m_sharedLayers.clear();
+}
+
+/*! \brief Say hello with the viewport and the hash of every tile, so
+        the server only sends the tiles that differ from ours.
+*/
+void NetworkClient::SendHello(App &app){
+    LayerStack &layers = app.GetLayers();
+    sf::IntRect viewport = m_viewport;
+    if (viewport.width <= 0 || viewport.height <= 0){
+        viewport = sf::IntRect(0, 0, app.GetWindowWidth(), app.GetWindowHeight());
+    }
+    m_message.Clear();
+    m_message.PutVarint(PROTOCOL_VERSION);
+    m_message.PutString(m_room);
+    m_message.PutSigned(viewport.left);
+    m_message.PutSigned(viewport.top);
+    m_message.PutVarint(std::max(viewport.width, 0));
+    m_message.PutVarint(std::max(viewport.height, 0));
+    m_message.PutVarint(layers.GetLayerCount());
+    // A filled layer shares one tile everywhere, hash it once
+    std::unordered_map<const sf::Uint8*, std::uint64_t> hashes;
+    for (std::size_t i = 0; i < layers.GetLayerCount(); i++){
+        const TiledImage &pixels = layers.GetLayer(i)->GetPixels();
+        m_message.PutVarint(layers.GetLayer(i)->GetId());
+        m_message.PutVarint(pixels.GetTileCount());
+        for (unsigned t = 0; t < pixels.GetTileCount(); t++){
+            const sf::Uint8* tile = pixels.GetTile(t);
+            std::unordered_map<const sf::Uint8*, std::uint64_t>::iterator found = hashes.find(tile);
+            if (found == hashes.end()){
+                found = hashes.insert(std::make_pair(tile, TiledImage::HashTile(tile))).first;
+            }
+            m_message.PutVarint(found->second);
+        }
+    }
+    m_connection.Send(MESSAGE_HELLO, m_message.GetData(), m_message.GetSize());
+    m_helloSent = true;
+}
+
+/*! \brief Put a tile of the snapshot on our canvas. Tiles of layers we do
+        not have are skipped.
+    \return false if the tile is damaged
+*/
+bool NetworkClient::ReceiveTile(ByteReader &in, App &app){
+    unsigned id = static_cast<unsigned>(in.GetVarint());
+    unsigned index = static_cast<unsigned>(in.GetVarint());
+    std::uint64_t hash = in.GetVarint();
+    TilePtr tile;
+    if (!ReadTilePixels(in, tile) || TiledImage::HashTile(tile.get()) != hash){
+        return false;
+    }
+    m_snapshotReceived++;
+    // Runs of the same tile, like a filled background, share one block
+    if (hash == m_lastHash && m_lastTile){
+        tile = m_lastTile;
+    }
+    m_lastTile = tile;
+    m_lastHash = hash;
+    std::shared_ptr<Layer> layer = app.GetLayers().FindLayer(id);
+    if (layer && index < layer->GetPixels().GetTileCount()){
+        app.GetLayers().SetTile(id, index, tile);
+    }
+    return true;
+}
+
+/*! \brief Drop the connection and say why.
+*/
+void NetworkClient::Fail(const std::string &reason){
+    m_connection.Close();
+    m_userId = 0;
+    m_status = reason;
+    std::cout << m_status << std::endl;
+}
@@ -0,0 +1,99 @@
+/**
+ *  @file   Profiler.cpp
+ *  @brief  Implementation of Profiler.hpp
+ *  @author Team Avengers
+ *  @date   2020-12-14
+ ***********************************************/
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <algorithm>
+// Project header files
+#include "Profiler.hpp"
+
+namespace {
+
+// The frames of one thread, in milliseconds per zone
+struct FrameRing{
+    float frames[Profiler::FRAMES][PROFILE_ZONE_COUNT];
+    // Nanoseconds of the frame that is running
+    std::uint64_t current[PROFILE_ZONE_COUNT];
+    // Where the next frame goes and how many frames are kept
+    std::size_t next;
+    std::size_t count;
+    // Times of one zone sorted by GetPercentile(), which the toolbar calls
+    // for every zone on every frame
+    float sorted[Profiler::FRAMES];
+};
+
+thread_local FrameRing ring;
+
+}
+
+const std::size_t Profiler::FRAMES;
+std::atomic<bool> Profiler::s_enabled(false);
+
+/*! \brief Get the name of a zone, as shown in the toolbar.
+*/
+const char* GetProfileZoneName(ProfileZone zone){
+    static const char* const names[PROFILE_ZONE_COUNT] = {"Frame", "Input", "Commands", "Network", "Upload",
+        "Present", "GUI input", "GUI layout", "GUI render", "GUI present"};
+    return zone < PROFILE_ZONE_COUNT ? names[zone] : "";
+}
+
+/*! \brief Start or stop timing. The frames timed so far are kept.
+*/
+void Profiler::SetEnabled(bool enabled){
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+/*! \brief Add time to a zone of the current frame of the calling thread.
+*/
+void Profiler::Add(ProfileZone zone, std::uint64_t nanoseconds){
+    ring.current[zone] += nanoseconds;
+}
+
+/*! \brief Keep the current frame of the calling thread and start the next.
+        A frame whose PROFILE_FRAME was not timed, because the profiler
+        was turned on in the middle of it, is dropped.
+*/
+void Profiler::EndFrame(){
+    if (ring.current[PROFILE_FRAME] != 0){
+        for (unsigned zone = 0; zone < PROFILE_ZONE_COUNT; zone++){
+            ring.frames[ring.next][zone] = ring.current[zone] / 1e6f;
+        }
+        ring.next = (ring.next + 1) % FRAMES;
+        ring.count = std::min(ring.count + 1, FRAMES);
+    }
+    std::fill(ring.current, ring.current + PROFILE_ZONE_COUNT, 0);
+}
+
+/*! \brief Get the number of frames of the calling thread that are kept.
+*/
+std::size_t Profiler::GetFrameCount(){
+    return ring.count;
+}
+
+/*! \brief Get the time a zone took in one frame of the calling thread.
+    \param frame 0 for the oldest frame kept
+*/
+float Profiler::GetMilliseconds(ProfileZone zone, std::size_t frame){
+    return ring.frames[(ring.next + FRAMES - ring.count + frame) % FRAMES][zone];
+}
+
+/*! \brief Get the time a zone took in the given share of the frames kept.
+    \param percentile 0.5 for the median
+*/
+float Profiler::GetPercentile(ProfileZone zone, float percentile){
+    if (ring.count == 0){
+        return 0;
+    }
+    float* times = ring.sorted;
+    for (std::size_t i = 0; i < ring.count; i++){
+        times[i] = ring.frames[i][zone];
+    }
+    std::size_t rank = std::min(static_cast<std::size_t>(percentile * ring.count), ring.count - 1);
+    std::nth_element(times, times + rank, times + ring.count);
+    return times[rank];
+}
@@ -0,0 +1,91 @@
+/**
+ *  @file   RevertCommand.cpp
+ *  @brief  Implementation of RevertCommand.hpp
+ *  @author Team Avengers
+ *  @date   2020-12-13
+ ***********************************************/
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <string>
+// Project header files
+#include "RevertCommand.hpp"
+
+/*! \brief RevertCommand constructor.
+    \param m_commandDescription string of command description, "revert"
+    \param back how many commands of the user back the command is, 1 for the last
+    \param target the command, nullptr until it is looked up
+*/
+RevertCommand::RevertCommand(const char* m_commandDescription, std::uint64_t back,
+    const std::shared_ptr<Command> &target):
+ Command(m_commandDescription), m_back(back), m_target(target){
+}
+
+/*! \brief RevertCommand destructor
+*/
+RevertCommand::~RevertCommand(){
+}
+
+/*! \brief Undoing twice is two separate actions.
+    \return false
+*/
+bool RevertCommand::compare(const std::shared_ptr<Command> &){
+    return false;
+}
+
+/*! \brief 	Take back the pixels of the command that nobody drew over.
+    \return false if this canvas does not have the command
+*/
+bool RevertCommand::execute(){
+    return m_target && m_target->revert();
+}
+
+/*! \brief 	Put back what execute() took back.
+*
+*/
+bool RevertCommand::undo(){
+    return m_target && m_target->unrevert();
+}
+
+/*! \brief Get the kind of command.
+*/
+CommandType RevertCommand::GetType() const{
+    return COMMAND_REVERT;
+}
+
+/*! \brief Write which command of the user is taken back.
+*/
+void RevertCommand::Serialize(ByteWriter &out) const{
+    out.PutVarint(m_back);
+}
+
+/*! \brief Create a revert from the data written by Serialize(). The
+        command it takes back is set by whoever knows the user.
+    \return the command, or nullptr if the data is damaged
+*/
+std::shared_ptr<Command> RevertCommand::Deserialize(ByteReader &in, App &){
+    std::uint64_t back = in.GetVarint();
+    if (!in.Ok() || back == 0){
+        return nullptr;
+    }
+    return std::make_shared<RevertCommand>("revert", back, nullptr);
+}
+
+/*! \brief Get how many commands of the user back the command is.
+*/
+std::uint64_t RevertCommand::GetBack() const{
+    return m_back;
+}
+
+/*! \brief Get the command taken back, nullptr if it is not known here.
+*/
+const std::shared_ptr<Command>& RevertCommand::GetTarget() const{
+    return m_target;
+}
+
+/*! \brief Set the command taken back.
+*/
+void RevertCommand::SetTarget(const std::shared_ptr<Command> &target){
+    m_target = target;
+}
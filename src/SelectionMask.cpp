@@ -0,0 +1,426 @@
+/**
+ *  @file   SelectionMask.cpp
+ *  @brief  Implementation of SelectionMask.hpp
+ *  @author Team Avengers
+ *  @date   2020-12-04
+ ***********************************************/
+
+// Include our Third-Party SFML header
+#include <SFML/Graphics.hpp>
+// Include standard library C++ libraries.
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+// Project header files
+#include "SelectionMask.hpp"
+
+namespace {
+
+// Check a coordinate read from a shape. INT_MIN is left out so that every
+// coordinate can be negated.
+bool IsCoordinate(std::int64_t value){
+    return value > INT_MIN && value <= INT_MAX;
+}
+
+}
+
+/*! \brief Construct an inactive selection of a 0x0 canvas.
+*/
+SelectionMask::SelectionMask(): m_width(0), m_height(0), m_tilesX(0), m_tilesY(0), m_active(false), m_shape(SHAPE_ALL),
+ m_version(0){
+}
+
+/*! \brief Construct an inactive selection, which selects the whole canvas.
+    \param width width of the canvas in pixels
+    \param height height of the canvas in pixels
+*/
+SelectionMask::SelectionMask(unsigned width, unsigned height): m_width(width), m_height(height),
+ m_tilesX((width + TILE_SIZE - 1) / TILE_SIZE), m_tilesY((height + TILE_SIZE - 1) / TILE_SIZE),
+ m_active(false), m_states(m_tilesX * m_tilesY), m_coverage(m_tilesX * m_tilesY), m_shape(SHAPE_ALL), m_version(0){
+    Clear();
+}
+
+/*! \brief Check if a selection was made. An inactive selection covers everything.
+*/
+bool SelectionMask::IsActive() const{
+    return m_active;
+}
+
+/*! \brief Drop the selection so the whole canvas is selected again.
+*/
+void SelectionMask::Clear(){
+    Reset();
+    m_active = false;
+    for (unsigned i = 0; i < m_states.size(); i++){
+        m_states[i] = TILE_FULL;
+        m_selected.push_back(i);
+    }
+    m_bounds = sf::IntRect(0, 0, m_width, m_height);
+    m_shape = SHAPE_ALL;
+    m_shapePoints.clear();
+}
+
+/*! \brief Select a rectangle.
+    \param rect rectangle in canvas pixels, width and height may be negative
+*/
+void SelectionMask::SelectRect(const sf::IntRect &rect){
+    // Clipped to the canvas before anything is stored
+    Extent r = Normalize(rect);
+    int top = static_cast<int>(std::max<std::int64_t>(r.top, 0));
+    int bottom = static_cast<int>(std::min<std::int64_t>(r.bottom, m_height));
+    Span span = { static_cast<int>(std::max<std::int64_t>(r.left, 0)),
+                  static_cast<int>(std::min<std::int64_t>(r.right, m_width)) };
+    SpanRows rows(bottom > top && span.x1 > span.x0 ? bottom - top : 0);
+    for (std::size_t y = 0; y < rows.size(); y++){
+        rows[y].push_back(span);
+    }
+    Rasterize(top, rows);
+    m_shape = SHAPE_RECT;
+    m_shapeRect = rect;
+}
+
+/*! \brief Select the pixels whose centers are inside an ellipse.
+    \param bounds bounding rectangle of the ellipse in canvas pixels
+*/
+void SelectionMask::SelectEllipse(const sf::IntRect &bounds){
+    // Only the rows on the canvas are scanned, and the spans are clipped
+    // to it before they are turned into pixels
+    Extent r = Normalize(bounds);
+    double rx = (r.right - r.left) / 2.0;
+    double ry = (r.bottom - r.top) / 2.0;
+    double cx = r.left + rx;
+    double cy = r.top + ry;
+    int top = static_cast<int>(std::max<std::int64_t>(r.top, 0));
+    int bottom = static_cast<int>(std::min<std::int64_t>(r.bottom, m_height));
+    SpanRows rows(bottom > top ? bottom - top : 0);
+    for (int y = top; y < bottom; y++){
+        double dy = (y + 0.5 - cy) / ry;
+        double t = 1.0 - dy * dy;
+        if (t <= 0.0){
+            continue;
+        }
+        double half = rx * std::sqrt(t);
+        double x0 = std::max(std::ceil(cx - half - 0.5), 0.0);
+        double x1 = std::min(std::floor(cx + half - 0.5) + 1, static_cast<double>(m_width));
+        if (x1 > x0){
+            Span span = { static_cast<int>(x0), static_cast<int>(x1) };
+            rows[y - top].push_back(span);
+        }
+    }
+    Rasterize(top, rows);
+    m_shape = SHAPE_ELLIPSE;
+    m_shapeRect = bounds;
+}
+
+/*! \brief Select the inside of a closed polygon using the even-odd rule.
+    \param points corners of the polygon in canvas pixels
+*/
+void SelectionMask::SelectLasso(const std::vector<sf::Vector2i> &points){
+    m_shapePoints = points;
+    if (points.size() < 3){
+        Rasterize(0, SpanRows());
+        m_shape = SHAPE_LASSO;
+        return;
+    }
+    int top = INT_MAX;
+    int bottom = INT_MIN;
+    for (std::size_t i = 0; i < points.size(); i++){
+        top = std::min(top, points[i].y);
+        bottom = std::max(bottom, points[i].y);
+    }
+    // Only scan the rows that are on the canvas.
+    top = std::max(top, 0);
+    bottom = std::min(bottom, static_cast<int>(m_height) - 1);
+    SpanRows rows(bottom >= top ? bottom - top + 1 : 0);
+    std::vector<double> crossings;
+    for (int y = top; y <= bottom; y++){
+        // Scan through pixel centers, vertices sit on pixel centers too.
+        double yc = y + 0.5;
+        crossings.clear();
+        for (std::size_t i = 0, j = points.size() - 1; i < points.size(); j = i++){
+            double yi = points[i].y + 0.5;
+            double yj = points[j].y + 0.5;
+            if ((yi <= yc) != (yj <= yc)){
+                double xi = points[i].x + 0.5;
+                double xj = points[j].x + 0.5;
+                crossings.push_back(xi + (yc - yi) * (xj - xi) / (yj - yi));
+            }
+        }
+        std::sort(crossings.begin(), crossings.end());
+        for (std::size_t k = 0; k + 1 < crossings.size(); k += 2){
+            Span span = { static_cast<int>(std::ceil(crossings[k] - 0.5)),
+                          static_cast<int>(std::ceil(crossings[k + 1] - 0.5)) };
+            if (span.x1 > span.x0){
+                rows[y - top].push_back(span);
+            }
+        }
+    }
+    Rasterize(top, rows);
+    m_shape = SHAPE_LASSO;
+}
+
+/*! \brief Get how much of a tile is selected.
+*/
+SelectionMask::TileState SelectionMask::GetTileState(unsigned tile) const{
+    return static_cast<TileState>(m_states[tile]);
+}
+
+/*! \brief Get the coverage bytes of a partially selected tile.
+    \return TILE_SIZE * TILE_SIZE bytes, or nullptr if the tile is empty or full
+*/
+const sf::Uint8* SelectionMask::GetTileCoverage(unsigned tile) const{
+    return m_coverage[tile].get();
+}
+
+/*! \brief Get the coverage of a single pixel.
+    \return 0 if the pixel is not selected, 255 if it is fully selected
+*/
+sf::Uint8 SelectionMask::GetCoverage(unsigned x, unsigned y) const{
+    if (x >= m_width || y >= m_height){
+        return 0;
+    }
+    unsigned tile = (y / TILE_SIZE) * m_tilesX + x / TILE_SIZE;
+    switch (m_states[tile]){
+        case TILE_FULL:
+            return 255;
+        case TILE_PARTIAL:
+            return m_coverage[tile].get()[(y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE];
+        default:
+            return 0;
+    }
+}
+
+/*! \brief Get the indices of every tile that is at least partially selected.
+*/
+const std::vector<unsigned>& SelectionMask::GetSelectedTiles() const{
+    return m_selected;
+}
+
+/*! \brief Get the bounding rectangle of the selection in canvas pixels.
+*/
+sf::IntRect SelectionMask::GetBounds() const{
+    return m_bounds;
+}
+
+/*! \brief Get a number that changes every time the selection does, so a
+        copy can tell if it is still the same.
+*/
+std::uint64_t SelectionMask::GetVersion() const{
+    return m_version;
+}
+
+/*! \brief Write the shape of the selection.
+*/
+void SelectionMask::Serialize(ByteWriter &out) const{
+    out.PutU8(static_cast<std::uint8_t>(m_shape));
+    switch (m_shape){
+        case SHAPE_RECT:
+        case SHAPE_ELLIPSE:
+            out.PutSigned(m_shapeRect.left);
+            out.PutSigned(m_shapeRect.top);
+            out.PutSigned(m_shapeRect.width);
+            out.PutSigned(m_shapeRect.height);
+            break;
+        case SHAPE_LASSO:
+        {
+            // Neighbouring points are close, so store the steps between them.
+            out.PutVarint(m_shapePoints.size());
+            sf::Vector2i last;
+            for (std::size_t i = 0; i < m_shapePoints.size(); i++){
+                out.PutSigned(m_shapePoints[i].x - last.x);
+                out.PutSigned(m_shapePoints[i].y - last.y);
+                last = m_shapePoints[i];
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/*! \brief Read a shape written by Serialize() and select it.
+    \return false if the data is damaged or a coordinate is out of range,
+        the selection is cleared then
+*/
+bool SelectionMask::Deserialize(ByteReader &in){
+    std::uint8_t shape = in.GetU8();
+    if (shape == SHAPE_RECT || shape == SHAPE_ELLIPSE){
+        std::int64_t values[4];
+        bool valid = true;
+        for (int i = 0; i < 4; i++){
+            values[i] = in.GetSigned();
+            valid = valid && IsCoordinate(values[i]);
+        }
+        if (in.Ok() && valid){
+            sf::IntRect rect(static_cast<int>(values[0]), static_cast<int>(values[1]),
+                             static_cast<int>(values[2]), static_cast<int>(values[3]));
+            if (shape == SHAPE_RECT){
+                SelectRect(rect);
+            } else{
+                SelectEllipse(rect);
+            }
+            return true;
+        }
+    } else if (shape == SHAPE_LASSO){
+        // Every point takes at least two bytes
+        std::uint64_t count = in.GetVarint();
+        bool valid = count <= in.GetRemaining() / 2;
+        std::vector<sf::Vector2i> points;
+        std::int64_t x = 0;
+        std::int64_t y = 0;
+        for (std::uint64_t i = 0; in.Ok() && valid && i < count; i++){
+            x += in.GetSigned();
+            y += in.GetSigned();
+            valid = IsCoordinate(x) && IsCoordinate(y);
+            points.push_back(sf::Vector2i(static_cast<int>(x), static_cast<int>(y)));
+        }
+        if (in.Ok() && valid){
+            SelectLasso(points);
+            return true;
+        }
+    } else if (shape == SHAPE_ALL && in.Ok()){
+        Clear();
+        return true;
+    }
+    Clear();
+    return false;
+}
+
+/*! \brief Limit an edit of a partially selected tile to the selection.
+        Every pixel of 'edited' is mixed back towards 'original' by its coverage.
+    \param coverage TILE_SIZE * TILE_SIZE coverage bytes
+    \param original TILE_BYTES bytes before the edit, nullptr if transparent
+    \param edited TILE_BYTES bytes after the edit, overwritten with the result
+*/
+void SelectionMask::ApplyCoverage(const sf::Uint8* coverage, const sf::Uint8* original, sf::Uint8* edited){
+    static const sf::Uint8 transparent[4] = {0, 0, 0, 0};
+    for (unsigned i = 0; i < TILE_SIZE * TILE_SIZE; i++){
+        int c = coverage[i];
+        if (c == 255){
+            continue;
+        }
+        const sf::Uint8* o = original ? original + i * 4 : transparent;
+        sf::Uint8* e = edited + i * 4;
+        for (int k = 0; k < 4; k++){
+            e[k] = static_cast<sf::Uint8>(o[k] + ((e[k] - o[k]) * c + (e[k] >= o[k] ? 127 : -127)) / 255);
+        }
+    }
+}
+
+/*! \brief Empty every tile that is currently selected.
+        Only touches the selected tiles, not the whole canvas.
+*/
+void SelectionMask::Reset(){
+    m_version++;
+    for (std::size_t i = 0; i < m_selected.size(); i++){
+        m_states[m_selected[i]] = TILE_EMPTY;
+        m_coverage[m_selected[i]].reset();
+    }
+    m_selected.clear();
+    m_bounds = sf::IntRect();
+}
+
+/*! \brief Replace the selection by a set of spans. Tiles inside the spans are
+        marked full without storing any coverage, tiles crossed by an edge
+        get their own coverage bytes.
+    \param top canvas row of the first entry in rows
+    \param rows spans of every row, sorted and not overlapping
+*/
+void SelectionMask::Rasterize(int top, const SpanRows &rows){
+    Reset();
+    m_active = true;
+
+    // Clip the spans to the canvas and find the bounding box.
+    // Only rows within the selection are stored, so a small selection
+    // stays cheap on a big canvas.
+    SpanRows clipped(rows.size());
+    int minX = INT_MAX, maxX = INT_MIN, minY = INT_MAX, maxY = INT_MIN;
+    for (std::size_t i = 0; i < rows.size(); i++){
+        int y = top + static_cast<int>(i);
+        if (y < 0 || y >= static_cast<int>(m_height)){
+            continue;
+        }
+        for (std::size_t k = 0; k < rows[i].size(); k++){
+            Span span = { std::max(rows[i][k].x0, 0), std::min(rows[i][k].x1, static_cast<int>(m_width)) };
+            if (span.x1 > span.x0){
+                clipped[i].push_back(span);
+                minX = std::min(minX, span.x0);
+                maxX = std::max(maxX, span.x1);
+                minY = std::min(minY, y);
+                maxY = std::max(maxY, y + 1);
+            }
+        }
+    }
+    if (minX >= maxX){
+        return;
+    }
+    m_bounds = sf::IntRect(minX, minY, maxX - minX, maxY - minY);
+
+    for (unsigned ty = minY / TILE_SIZE; ty <= (maxY - 1) / TILE_SIZE; ty++){
+        int y0 = ty * TILE_SIZE;
+        int y1 = std::min(y0 + static_cast<int>(TILE_SIZE), static_cast<int>(m_height));
+        for (unsigned tx = minX / TILE_SIZE; tx <= (maxX - 1) / TILE_SIZE; tx++){
+            int x0 = tx * TILE_SIZE;
+            int x1 = std::min(x0 + static_cast<int>(TILE_SIZE), static_cast<int>(m_width));
+            bool full = true;
+            bool any = false;
+            for (int y = y0; y < y1; y++){
+                int covered = 0;
+                const std::vector<Span> &spans = RowSpans(clipped, top, y);
+                for (std::size_t k = 0; k < spans.size(); k++){
+                    covered += std::max(0, std::min(spans[k].x1, x1) - std::max(spans[k].x0, x0));
+                }
+                any = any || covered > 0;
+                full = full && covered == x1 - x0;
+            }
+            unsigned tile = ty * m_tilesX + tx;
+            if (full){
+                m_states[tile] = TILE_FULL;
+            } else if (any){
+                m_states[tile] = TILE_PARTIAL;
+                TilePtr coverage(new sf::Uint8[TILE_SIZE * TILE_SIZE], std::default_delete<sf::Uint8[]>());
+                std::memset(coverage.get(), 0, TILE_SIZE * TILE_SIZE);
+                for (int y = y0; y < y1; y++){
+                    const std::vector<Span> &spans = RowSpans(clipped, top, y);
+                    for (std::size_t k = 0; k < spans.size(); k++){
+                        int s0 = std::max(spans[k].x0, x0);
+                        int s1 = std::min(spans[k].x1, x1);
+                        if (s1 > s0){
+                            std::memset(coverage.get() + (y - y0) * TILE_SIZE + (s0 - x0), 255, s1 - s0);
+                        }
+                    }
+                }
+                m_coverage[tile] = coverage;
+            } else{
+                continue;
+            }
+            m_selected.push_back(tile);
+        }
+    }
+}
+
+/*! \brief Get the spans of a canvas row, empty if the row is outside 'rows'.
+*/
+const std::vector<SelectionMask::Span>& SelectionMask::RowSpans(const SpanRows &rows, int top, int y){
+    static const std::vector<Span> none;
+    if (y < top || y - top >= static_cast<int>(rows.size())){
+        return none;
+    }
+    return rows[y - top];
+}
+
+/*! \brief Get the edges of a rectangle whose width or height may be
+        negative, left of right and top above bottom.
+*/
+SelectionMask::Extent SelectionMask::Normalize(const sf::IntRect &rect){
+    Extent e = { rect.left, rect.top, static_cast<std::int64_t>(rect.left) + rect.width,
+                 static_cast<std::int64_t>(rect.top) + rect.height };
+    if (e.right < e.left){
+        std::swap(e.left, e.right);
+    }
+    if (e.bottom < e.top){
+        std::swap(e.top, e.bottom);
+    }
+    return e;
+}
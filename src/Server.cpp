@@ -0,0 +1,1017 @@
+/**
+ *  @file   Server.cpp
+ *  @brief  Implementation of Server.hpp
+ *  @author Team Avengers
+ *  @date   2020-12-11
+ ***********************************************/
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+// Project header files
+#include "App.hpp"
+#include "Draw.hpp"
+#include "RevertCommand.hpp"
+#include "Server.hpp"
+
+namespace {
+
+// Milliseconds epoll waits before checking if the server should stop
+const int POLL_MS = 200;
+// Events taken from epoll at a time
+const int MAX_EVENTS = 256;
+// Workers when the caller does not say
+const unsigned MAX_WORKERS = 4;
+// A client owed more than this gets a snapshot instead of its queue
+const std::size_t QUEUE_LIMIT = 8 << 20;
+// Snapshot tiles are only added while less than this is waiting to be
+// sent, so live batches do not queue up behind a whole canvas
+const std::size_t SNAPSHOT_WINDOW = 256 << 10;
+// Cursors are only sent to a client owed less than this, the others skip
+// updates until they caught up
+const std::size_t PRESENCE_WINDOW = 64 << 10;
+
+// A tile of a snapshot still to be sent
+struct SnapshotTile{
+    unsigned layer;     // index in Snapshot::layers
+    unsigned tile;
+    bool     viewport;
+    // Sent even if the hash matches, the client may not have it anymore
+    bool     force;
+};
+
+// Tiles a client does not have yet
+struct Snapshot{
+    std::vector<unsigned> layers;
+    std::deque<SnapshotTile> queue;
+    // Hash of the tile the client has and if it is in the queue, per layer and tile
+    std::vector<std::uint64_t> hashes;
+    std::vector<bool> queued;
+    unsigned tileCount;
+    std::size_t viewportLeft;
+    // Set once SNAPSHOT_DONE went out for the tiles in the queue so far
+    bool doneSent;
+};
+
+// Nanoseconds the calling thread spent on a CPU
+std::uint64_t ThreadCpu(){
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<std::uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+}
+
+}
+
+// One connected client.
+struct Server::Client{
+    std::unique_ptr<Connection> connection;
+    unsigned id;
+    Room*    room;
+    // Ids of the layers it has, sent again when it falls behind
+    std::vector<unsigned> layers;
+    // Set until it confirmed every tile streamed to it
+    std::unique_ptr<Snapshot> snapshot;
+    // Number of the last SNAPSHOT_DONE sent and of the last one it confirmed
+    std::uint64_t lastDone;
+    std::uint64_t confirmed;
+    // Its last commands, to find the ones it takes back
+    CommandHistory history;
+    // Batches of it applied so far
+    std::uint64_t batches;
+    // Room sequence when it joined or caught up, it has no commands up to there
+    std::uint64_t joined;
+    // Its cursor in PRESENCE_QUANTUM units, if it is on the canvas
+    bool     pointing;
+    sf::Vector2i cursor;
+    // Room presence it has the cursors of
+    std::uint64_t presenceSeen;
+    // Set while epoll also waits for the socket to take more
+    bool writing;
+    // Set while it is in the list of clients to send to this round
+    bool dirty;
+    bool closed;
+};
+
+// A canvas and the clients drawing on it. Only used by its worker.
+struct Server::Room{
+    Room(Worker &worker, unsigned width, unsigned height);
+    ~Room();
+
+    bool Join(Client &client, ByteReader &hello);
+    bool Handle(Client &client, std::uint8_t type, const std::uint8_t* payload, std::size_t size);
+    void Stream(Client &client);
+    void CatchUp(Client &client);
+    void Resend(Client &client, const Command &command, bool force);
+    void Refresh(Client &client, const Command &revert);
+    std::unique_ptr<Snapshot> NewSnapshot(const Client &client);
+    void SendStage(Client &client, SnapshotStage stage);
+    bool SendCursors();
+    void Remove(Client &client);
+
+    Worker      &worker;
+    App*        app;
+    std::vector<std::unique_ptr<Client>> clients;
+    // Commands applied so far, every command but a revert counts
+    std::uint64_t sequence;
+    // Counts the changes to the cursors of the clients
+    std::uint64_t presence;
+    CommandBatchReader reader;
+    std::vector<std::shared_ptr<Command>> received;
+    // Reused to build messages
+    ByteWriter  message;
+    ByteWriter  framed;
+    // Last tile sent in a snapshot with its hash and encoding, since runs
+    // of the same tile are common
+    TilePtr     lastTile;
+    std::uint64_t lastHash;
+    ByteWriter  lastPixels;
+    std::vector<std::uint8_t> scratch;
+
+private:
+    Room(const Room&);
+};
+
+// A thread serving the rooms whose names hash to it.
+struct Server::Worker{
+    explicit Worker(Server &server);
+    ~Worker();
+
+    void Add(std::unique_ptr<Connection> connection, const std::string &room, const std::uint8_t* hello,
+             std::size_t size);
+    void Wake();
+    void Run();
+    void Touch(Client &client);
+    void Close(Client &client);
+
+    // A connection handed over by the accepting thread
+    struct Arrival{
+        std::unique_ptr<Connection> connection;
+        std::string room;
+        std::vector<std::uint8_t> hello;
+    };
+
+    Server      &server;
+    int         epoll;
+    // Written to wake the thread up for arrivals or to stop
+    int         wake;
+    std::thread thread;
+    std::mutex  mutex;
+    std::vector<Arrival> arrivals;
+    std::map<std::string, std::unique_ptr<Room>> rooms;
+    // Clients with something to send and clients to remove, this round
+    std::vector<Client*> dirty;
+    std::vector<Client*> closing;
+    // Set while a room has cursors some client did not get, and when they
+    // were last sent
+    bool        presenceOwed;
+    std::chrono::steady_clock::time_point presenceTime;
+    std::atomic<std::uint64_t> messages;
+    std::atomic<std::uint64_t> bytesSent;
+    std::atomic<std::uint64_t> catchUps;
+    std::atomic<std::uint64_t> cpu;
+
+private:
+    void Take();
+    void Read(Client &client, bool receive);
+    void Send();
+    void Watch(Client &client, bool writing);
+    int  GetTimeout() const;
+    void SendCursors();
+    Worker(const Worker&);
+};
+
+/*! \brief Construct a room with a blank canvas.
+*/
+Server::Room::Room(Worker &worker, unsigned width, unsigned height): worker(worker), app(new App), sequence(0),
+ presence(0), lastHash(0){
+    // Rooms already run on the worker threads of the server
+    app->InitHeadless(width, height, 0);
+}
+
+/*! \brief Close the connections of the room.
+*/
+Server::Room::~Room(){
+    clients.clear();
+    app->Destroy();
+    delete app;
+}
+
+/*! \brief Welcome a client and start streaming the canvas to it.
+    \param hello rest of the hello, the viewport and the hashes of the client's tiles
+    \return false if the hello is damaged
+*/
+bool Server::Room::Join(Client &client, ByteReader &hello){
+    LayerStack &layers = app->GetLayers();
+    const TiledImage &first = layers.GetLayer(0)->GetPixels();
+    int left = static_cast<int>(hello.GetSigned());
+    int top = static_cast<int>(hello.GetSigned());
+    int right = left + static_cast<int>(std::min<std::uint64_t>(hello.GetVarint(), first.GetWidth()));
+    int bottom = top + static_cast<int>(std::min<std::uint64_t>(hello.GetVarint(), first.GetHeight()));
+    std::unique_ptr<Snapshot> snapshot(new Snapshot);
+    snapshot->tileCount = first.GetTileCount();
+    // Only layers the client has are sent, with the hashes it sent for them
+    std::uint64_t count = hello.GetVarint();
+    for (std::uint64_t i = 0; i < count && hello.Ok(); i++){
+        unsigned id = static_cast<unsigned>(hello.GetVarint());
+        std::uint64_t tiles = hello.GetVarint();
+        bool known = layers.FindLayer(id) && tiles == snapshot->tileCount &&
+            std::find(snapshot->layers.begin(), snapshot->layers.end(), id) == snapshot->layers.end();
+        if (known){
+            snapshot->layers.push_back(id);
+        }
+        for (std::uint64_t t = 0; t < tiles && hello.Ok(); t++){
+            std::uint64_t hash = hello.GetVarint();
+            if (known){
+                snapshot->hashes.push_back(hash);
+            }
+        }
+    }
+    if (!hello.Ok()){
+        return false;
+    }
+    // Tiles in the viewport first, then outwards from its center
+    std::vector<std::pair<std::int64_t, unsigned>> order(snapshot->tileCount);
+    std::int64_t centerX = (left + right) / 2;
+    std::int64_t centerY = (top + bottom) / 2;
+    for (unsigned t = 0; t < snapshot->tileCount; t++){
+        int x = static_cast<int>(t % first.GetTilesX() * TILE_SIZE);
+        int y = static_cast<int>(t / first.GetTilesX() * TILE_SIZE);
+        bool visible = x + static_cast<int>(TILE_SIZE) > left && x < right &&
+                       y + static_cast<int>(TILE_SIZE) > top && y < bottom;
+        std::int64_t dx = x + TILE_SIZE / 2 - centerX;
+        std::int64_t dy = y + TILE_SIZE / 2 - centerY;
+        order[t] = std::make_pair((visible ? 0 : (std::int64_t(1) << 62)) + dx * dx + dy * dy, t);
+    }
+    std::sort(order.begin(), order.end());
+    snapshot->queued.assign(snapshot->hashes.size(), false);
+    snapshot->viewportLeft = 0;
+    snapshot->doneSent = false;
+    std::unordered_map<const sf::Uint8*, std::uint64_t> hashes;
+    for (std::size_t i = 0; i < order.size(); i++){
+        unsigned t = order[i].second;
+        for (unsigned l = 0; l < snapshot->layers.size(); l++){
+            const sf::Uint8* pixels = layers.FindLayer(snapshot->layers[l])->GetPixels().GetTile(t);
+            std::unordered_map<const sf::Uint8*, std::uint64_t>::iterator found = hashes.find(pixels);
+            if (found == hashes.end()){
+                found = hashes.insert(std::make_pair(pixels, TiledImage::HashTile(pixels))).first;
+            }
+            std::size_t slot = l * snapshot->tileCount + t;
+            if (found->second != snapshot->hashes[slot]){
+                SnapshotTile tile = {l, t, order[i].first < (std::int64_t(1) << 62), false};
+                snapshot->queue.push_back(tile);
+                snapshot->queued[slot] = true;
+                snapshot->viewportLeft += tile.viewport;
+            }
+        }
+    }
+    client.layers = snapshot->layers;
+    client.joined = sequence;
+    message.Clear();
+    message.PutVarint(client.id);
+    message.PutVarint(layers.GetWidth());
+    message.PutVarint(layers.GetHeight());
+    message.PutVarint(snapshot->queue.size());
+    // The layers of the client the room has are the same layer everywhere
+    // once the snapshot is in, commands on any other layer are its own
+    message.PutVarint(snapshot->layers.size());
+    for (std::size_t i = 0; i < snapshot->layers.size(); i++){
+        message.PutVarint(snapshot->layers[i]);
+    }
+    client.connection->Send(MESSAGE_WELCOME, message.GetData(), message.GetSize());
+    if (snapshot->viewportLeft == 0){
+        SendStage(client, SNAPSHOT_VIEWPORT);
+    }
+    client.snapshot = std::move(snapshot);
+    worker.Touch(client);
+    return true;
+}
+
+/*! \brief Act on one message of a client.
+    \return false if the client broke the protocol and has to go
+*/
+bool Server::Room::Handle(Client &client, std::uint8_t type, const std::uint8_t* payload, std::size_t size){
+    ByteReader in(payload, size);
+    if (type == MESSAGE_SNAPSHOT){
+        std::uint64_t stage = in.GetVarint();
+        std::uint64_t done = in.GetVarint();
+        if (!in.Ok() || stage != SNAPSHOT_DONE || done > client.lastDone){
+            return false;
+        }
+        // Whatever it drew before it had every tile arrived by now
+        client.confirmed = done;
+        if (client.confirmed == client.lastDone && client.snapshot && client.snapshot->queue.empty()){
+            client.snapshot.reset();
+        }
+        return true;
+    }
+    if (type == MESSAGE_CURSOR){
+        bool pointing = in.GetU8() != 0;
+        sf::Vector2i cursor;
+        if (pointing){
+            cursor.x = static_cast<int>(in.GetSigned());
+            cursor.y = static_cast<int>(in.GetSigned());
+        }
+        if (!in.Ok()){
+            return false;
+        }
+        if (pointing != client.pointing || cursor != client.cursor){
+            client.pointing = pointing;
+            client.cursor = cursor;
+            presence++;
+            worker.presenceOwed = true;
+        }
+        return true;
+    }
+    if (type != MESSAGE_COMMANDS){
+        return false;
+    }
+    received.clear();
+    if (!reader.Read(in, *app, received)){
+        return false;
+    }
+    for (std::size_t i = 0; i < received.size(); i++){
+        std::uint64_t target = 0;
+        client.history.Record(received[i], sequence + 1, &target);
+        bool revert = received[i]->GetType() == COMMAND_REVERT;
+        if (!revert){
+            sequence++;
+        }
+        app->ApplyRemoteCommand(received[i], client.id);
+        if (client.snapshot){
+            Resend(client, *received[i], false);
+        }
+        // Clients that joined after the command was drawn can not take it
+        // back themselves
+        for (std::size_t c = 0; revert && target > 0 && c < clients.size(); c++){
+            if (clients[c].get() != &client && !clients[c]->closed && target <= clients[c]->joined){
+                Refresh(*clients[c], *received[i]);
+            }
+        }
+    }
+    // Tells the client which of its commands are in the order everyone has
+    client.batches++;
+    message.Clear();
+    message.PutVarint(client.batches);
+    client.connection->Send(MESSAGE_ACK, message.GetData(), message.GetSize());
+    worker.Touch(client);
+    // The batch goes out as it came in, with the id of its sender in front,
+    // framed once and shared by every other client
+    message.Clear();
+    message.PutVarint(client.id);
+    message.PutBytes(payload, size);
+    framed.Clear();
+    Connection::Frame(MESSAGE_COMMANDS, message.GetData(), message.GetSize(), framed);
+    SharedMessages shared = std::make_shared<std::vector<std::uint8_t>>(framed.GetData(),
+                                                                        framed.GetData() + framed.GetSize());
+    for (std::size_t i = 0; i < clients.size(); i++){
+        if (clients[i].get() != &client && !clients[i]->closed){
+            clients[i]->connection->SendShared(shared);
+            worker.Touch(*clients[i]);
+        }
+    }
+    return true;
+}
+
+/*! \brief Send the next tiles of a snapshot, as many as fit in the window.
+        A tile is read from the canvas as it is now, so it already has
+        every batch that was relayed to the client before it. The snapshot
+        is kept after the last tile until the client confirmed it, since
+        the client may have drawn on a tile before it got there.
+*/
+void Server::Room::Stream(Client &client){
+    Snapshot &snapshot = *client.snapshot;
+    LayerStack &layers = app->GetLayers();
+    while (!snapshot.queue.empty() && client.connection->GetPendingSize() < SNAPSHOT_WINDOW){
+        SnapshotTile next = snapshot.queue.front();
+        snapshot.queue.pop_front();
+        std::size_t slot = next.layer * snapshot.tileCount + next.tile;
+        snapshot.queued[slot] = false;
+        TilePtr pixels = layers.GetTile(snapshot.layers[next.layer], next.tile);
+        if (!lastTile || pixels != lastTile){
+            // Holding on to the tile keeps it from being changed in place
+            lastTile = pixels;
+            lastHash = TiledImage::HashTile(pixels.get());
+            lastPixels.Clear();
+            WriteTilePixels(pixels.get(), lastPixels, scratch);
+        }
+        if (next.force || lastHash != snapshot.hashes[slot]){
+            snapshot.hashes[slot] = lastHash;
+            message.Clear();
+            message.PutVarint(snapshot.layers[next.layer]);
+            message.PutVarint(next.tile);
+            message.PutVarint(lastHash);
+            message.PutBytes(lastPixels.GetData(), lastPixels.GetSize());
+            client.connection->Send(MESSAGE_TILE, message.GetData(), message.GetSize());
+        }
+        if (next.viewport && --snapshot.viewportLeft == 0){
+            SendStage(client, SNAPSHOT_VIEWPORT);
+        }
+    }
+    if (snapshot.queue.empty() && !snapshot.doneSent){
+        SendStage(client, SNAPSHOT_DONE);
+        snapshot.doneSent = true;
+    }
+}
+
+/*! \brief Drop what a client that fell behind is owed and send it the
+        whole canvas again instead. Every batch it misses is in the tiles.
+*/
+void Server::Room::CatchUp(Client &client){
+    client.connection->DropPending();
+    worker.catchUps++;
+    std::unique_ptr<Snapshot> snapshot = NewSnapshot(client);
+    for (std::size_t slot = 0; slot < snapshot->hashes.size(); slot++){
+        SnapshotTile tile = {static_cast<unsigned>(slot / snapshot->tileCount),
+                             static_cast<unsigned>(slot % snapshot->tileCount), false, true};
+        snapshot->queue.push_back(tile);
+        snapshot->queued[slot] = true;
+    }
+    client.snapshot = std::move(snapshot);
+    // Commands of the others it missed can not be taken back there, and
+    // the acknowledgement of its own ones may have been dropped
+    client.joined = sequence;
+    SendStage(client, SNAPSHOT_CATCH_UP);
+    message.Clear();
+    message.PutVarint(client.batches);
+    client.connection->Send(MESSAGE_ACK, message.GetData(), message.GetSize());
+}
+
+/*! \brief Send the tiles a revert changed to a client that joined after
+        the command it takes back was drawn.
+*/
+void Server::Room::Refresh(Client &client, const Command &revert){
+    if (!client.snapshot){
+        client.snapshot = NewSnapshot(client);
+    }
+    // The client does not know which hash it has
+    Resend(client, revert, true);
+}
+
+/*! \brief Make an empty snapshot of the layers a client has.
+*/
+std::unique_ptr<Snapshot> Server::Room::NewSnapshot(const Client &client){
+    std::unique_ptr<Snapshot> snapshot(new Snapshot);
+    snapshot->layers = client.layers;
+    snapshot->tileCount = app->GetLayers().GetLayer(0)->GetPixels().GetTileCount();
+    snapshot->hashes.assign(snapshot->layers.size() * snapshot->tileCount, 0);
+    snapshot->queued.assign(snapshot->hashes.size(), false);
+    snapshot->viewportLeft = 0;
+    snapshot->doneSent = false;
+    return snapshot;
+}
+
+/*! \brief Queue the tiles a command of a joining client changed again.
+        The client drew on its own canvas before the tiles got there, so
+        the ones sent before the server had the command lack it. Another
+        SNAPSHOT_DONE follows them.
+    \param force send the tiles even if the client has the same hash
+*/
+void Server::Room::Resend(Client &client, const Command &command, bool force){
+    if (command.GetType() == COMMAND_REVERT){
+        const std::shared_ptr<Command> &target = static_cast<const RevertCommand&>(command).GetTarget();
+        if (target){
+            Resend(client, *target, force);
+        }
+        return;
+    }
+    Snapshot &snapshot = *client.snapshot;
+    std::size_t first = 0;
+    std::size_t last = snapshot.queued.size();
+    if (command.GetType() == COMMAND_DRAW){
+        const Draw &draw = static_cast<const Draw&>(command);
+        std::vector<unsigned>::iterator layer = std::find(snapshot.layers.begin(), snapshot.layers.end(), draw.GetLayer());
+        const TiledImage &pixels = app->GetLayers().GetLayer(0)->GetPixels();
+        sf::Vector2i coords = draw.GetCoords();
+        if (layer == snapshot.layers.end() || coords.x < 0 || coords.y < 0 ||
+            coords.x >= static_cast<int>(pixels.GetWidth()) || coords.y >= static_cast<int>(pixels.GetHeight())){
+            return;
+        }
+        first = (layer - snapshot.layers.begin()) * snapshot.tileCount + pixels.TileIndex(coords.x, coords.y);
+        last = first + 1;
+    }
+    // Clears and filters change every tile
+    for (std::size_t slot = first; slot < last; slot++){
+        if (!snapshot.queued[slot]){
+            SnapshotTile tile = {static_cast<unsigned>(slot / snapshot.tileCount),
+                                 static_cast<unsigned>(slot % snapshot.tileCount), false, force};
+            snapshot.queue.push_front(tile);
+            snapshot.queued[slot] = true;
+            snapshot.doneSent = false;
+        }
+    }
+    worker.Touch(client);
+}
+
+/*! \brief Tell a joining client how far its snapshot got.
+*/
+void Server::Room::SendStage(Client &client, SnapshotStage stage){
+    message.Clear();
+    message.PutVarint(stage);
+    // The client confirms every SNAPSHOT_DONE by its number
+    if (stage == SNAPSHOT_DONE){
+        message.PutVarint(++client.lastDone);
+    }
+    client.connection->Send(MESSAGE_SNAPSHOT, message.GetData(), message.GetSize());
+}
+
+/*! \brief Send the cursors of the room to the clients that do not have
+        them yet. All of them go out in one message, framed once, so a
+        client that skips an update misses nothing once it gets the next.
+    \return true if a client was too far behind to get them
+*/
+bool Server::Room::SendCursors(){
+    std::size_t owed = 0;
+    unsigned pointing = 0;
+    for (std::size_t i = 0; i < clients.size(); i++){
+        owed += clients[i]->presenceSeen != presence;
+        pointing += clients[i]->pointing;
+    }
+    if (owed == 0){
+        return false;
+    }
+    message.Clear();
+    message.PutVarint(pointing);
+    for (std::size_t i = 0; i < clients.size(); i++){
+        if (clients[i]->pointing){
+            message.PutVarint(clients[i]->id);
+            message.PutSigned(clients[i]->cursor.x);
+            message.PutSigned(clients[i]->cursor.y);
+        }
+    }
+    framed.Clear();
+    Connection::Frame(MESSAGE_CURSORS, message.GetData(), message.GetSize(), framed);
+    SharedMessages shared = std::make_shared<std::vector<std::uint8_t>>(framed.GetData(),
+                                                                        framed.GetData() + framed.GetSize());
+    bool behind = false;
+    for (std::size_t i = 0; i < clients.size(); i++){
+        Client &client = *clients[i];
+        if (client.closed || client.presenceSeen == presence){
+            continue;
+        }
+        // Cursors never wait behind commands and tiles
+        if (client.connection->GetPendingSize() > PRESENCE_WINDOW){
+            behind = true;
+            continue;
+        }
+        client.connection->SendShared(shared);
+        client.presenceSeen = presence;
+        worker.Touch(client);
+    }
+    return behind;
+}
+
+/*! \brief Forget a client, which closes its connection.
+*/
+void Server::Room::Remove(Client &client){
+    std::cout << "User " << client.id << " left" << std::endl;
+    if (client.pointing){
+        presence++;
+        worker.presenceOwed = true;
+    }
+    for (std::size_t i = 0; i < clients.size(); i++){
+        if (clients[i].get() == &client){
+            clients.erase(clients.begin() + i);
+            break;
+        }
+    }
+    worker.server.m_clients--;
+}
+
+/*! \brief Construct a worker. Its thread is started by Server::Run().
+*/
+Server::Worker::Worker(Server &server): server(server), epoll(epoll_create1(EPOLL_CLOEXEC)),
+ wake(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), presenceOwed(false), messages(0), bytesSent(0), catchUps(0), cpu(0){
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, wake, &event);
+}
+
+/*! \brief Close the rooms and their connections.
+*/
+Server::Worker::~Worker(){
+    rooms.clear();
+    close(wake);
+    close(epoll);
+}
+
+/*! \brief Hand a connection that said hello to this worker. Called by the
+        accepting thread.
+    \param hello rest of the hello after the room name
+*/
+void Server::Worker::Add(std::unique_ptr<Connection> connection, const std::string &room, const std::uint8_t* hello,
+                         std::size_t size){
+    std::lock_guard<std::mutex> lock(mutex);
+    arrivals.push_back(Arrival());
+    arrivals.back().connection = std::move(connection);
+    arrivals.back().room = room;
+    arrivals.back().hello.assign(hello, hello + size);
+    Wake();
+}
+
+/*! \brief Make the thread look at its arrivals or at Server::m_stop.
+        Safe to call from a signal handler.
+*/
+void Server::Worker::Wake(){
+    std::uint64_t one = 1;
+    ssize_t written = write(wake, &one, sizeof(one));
+    (void)written;
+}
+
+/*! \brief Serve the rooms until the server stops.
+*/
+void Server::Worker::Run(){
+    struct epoll_event events[MAX_EVENTS];
+    while (!server.m_stop){
+        int count = epoll_wait(epoll, events, MAX_EVENTS, GetTimeout());
+        for (int i = 0; i < count; i++){
+            if (!events[i].data.ptr){
+                std::uint64_t value;
+                ssize_t got = read(wake, &value, sizeof(value));
+                (void)got;
+                Take();
+                continue;
+            }
+            Client &client = *static_cast<Client*>(events[i].data.ptr);
+            if (client.closed){
+                continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)){
+                Read(client, true);
+            }
+            if (events[i].events & EPOLLOUT){
+                Touch(client);
+            }
+        }
+        if (presenceOwed && GetTimeout() == 0){
+            SendCursors();
+        }
+        Send();
+        cpu = ThreadCpu();
+    }
+}
+
+/*! \brief Queue a client to be sent to at the end of the round.
+*/
+void Server::Worker::Touch(Client &client){
+    if (!client.dirty && !client.closed){
+        client.dirty = true;
+        dirty.push_back(&client);
+    }
+}
+
+/*! \brief Queue a client to be removed at the end of the round, once no
+        event of the round can point at it anymore.
+*/
+void Server::Worker::Close(Client &client){
+    if (!client.closed){
+        client.closed = true;
+        closing.push_back(&client);
+    }
+}
+
+/*! \brief Put the connections handed over since the last call in their rooms.
+*/
+void Server::Worker::Take(){
+    std::vector<Arrival> taken;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        taken.swap(arrivals);
+    }
+    for (std::size_t i = 0; i < taken.size(); i++){
+        std::map<std::string, std::unique_ptr<Room>>::iterator found = rooms.find(taken[i].room);
+        if (found == rooms.end()){
+            // Counted over every worker, the connection closes when refused
+            if (server.m_rooms.fetch_add(1) >= MAX_ROOMS){
+                server.m_rooms--;
+                std::cout << "Refused room \"" << taken[i].room << "\", the server has " << MAX_ROOMS << " rooms"
+                          << std::endl;
+                continue;
+            }
+            std::unique_ptr<Room> opened(new Room(*this, server.m_width, server.m_height));
+            found = rooms.insert(std::make_pair(taken[i].room, std::move(opened))).first;
+        }
+        std::unique_ptr<Room> &room = found->second;
+        std::unique_ptr<Client> joined(new Client);
+        joined->connection = std::move(taken[i].connection);
+        joined->id = server.m_nextId++;
+        joined->room = room.get();
+        joined->lastDone = 0;
+        joined->confirmed = 0;
+        joined->batches = 0;
+        joined->joined = 0;
+        joined->pointing = false;
+        joined->presenceSeen = 0;
+        joined->writing = false;
+        joined->dirty = false;
+        joined->closed = false;
+        Client &client = *joined;
+        room->clients.push_back(std::move(joined));
+        server.m_clients++;
+        struct epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.ptr = &client;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, client.connection->GetFd(), &event);
+        ByteReader hello(taken[i].hello.data(), taken[i].hello.size());
+        if (!room->Join(client, hello)){
+            Close(client);
+            continue;
+        }
+        std::cout << "User " << client.id << " joined room \"" << taken[i].room << "\"" << std::endl;
+        // It gets the cursors of the others with the next update
+        presenceOwed = presenceOwed || room->presence != 0;
+        // Commands sent right after the hello may already be in the buffer
+        Read(client, false);
+    }
+}
+
+/*! \brief Act on every message that arrived from a client.
+    \param receive read the socket first, false to only take buffered messages
+*/
+void Server::Worker::Read(Client &client, bool receive){
+    bool alive = !receive || client.connection->Receive();
+    std::uint8_t type;
+    const std::uint8_t* payload;
+    std::size_t size;
+    while (client.connection->NextMessage(type, payload, size)){
+        messages++;
+        if (!client.room->Handle(client, type, payload, size)){
+            Close(client);
+            return;
+        }
+    }
+    if (!alive || !client.connection->IsOpen()){
+        Close(client);
+    }
+}
+
+/*! \brief Send every client what it is owed since the last round, then
+        remove the clients that are gone.
+*/
+void Server::Worker::Send(){
+    // Streaming a snapshot or catching up can not touch other clients, so
+    // the list does not grow while it is walked
+    for (std::size_t i = 0; i < dirty.size(); i++){
+        Client &client = *dirty[i];
+        client.dirty = false;
+        if (client.closed){
+            continue;
+        }
+        Connection &connection = *client.connection;
+        if (connection.GetPendingSize() > QUEUE_LIMIT){
+            client.room->CatchUp(client);
+        }
+        if (client.snapshot){
+            client.room->Stream(client);
+        }
+        std::size_t pending = connection.GetPendingSize();
+        bool ok = connection.Flush();
+        bytesSent += pending - connection.GetPendingSize();
+        if (!ok){
+            Close(client);
+            continue;
+        }
+        // A snapshot goes on as soon as the socket takes more
+        Watch(client, connection.HasPending() || (client.snapshot && !client.snapshot->queue.empty()));
+    }
+    dirty.clear();
+    for (std::size_t i = 0; i < closing.size(); i++){
+        closing[i]->room->Remove(*closing[i]);
+    }
+    closing.clear();
+}
+
+/*! \brief Get the milliseconds epoll can wait, which is until the next
+        cursor update if one is owed.
+*/
+int Server::Worker::GetTimeout() const{
+    if (!presenceOwed){
+        return POLL_MS;
+    }
+    long long since = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - presenceTime).count();
+    return since >= PRESENCE_MS ? 0 : static_cast<int>(PRESENCE_MS - since);
+}
+
+/*! \brief Send the rooms' cursors that changed, at most once every
+        PRESENCE_MS, so a room costs the same however often they move.
+*/
+void Server::Worker::SendCursors(){
+    presenceTime = std::chrono::steady_clock::now();
+    presenceOwed = false;
+    for (std::map<std::string, std::unique_ptr<Room>>::iterator it = rooms.begin(); it != rooms.end(); ++it){
+        if (it->second->SendCursors()){
+            presenceOwed = true;
+        }
+    }
+}
+
+/*! \brief Wait for the socket of a client to take more, or stop waiting.
+*/
+void Server::Worker::Watch(Client &client, bool writing){
+    if (client.writing == writing){
+        return;
+    }
+    client.writing = writing;
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = writing ? EPOLLIN | EPOLLOUT : static_cast<std::uint32_t>(EPOLLIN);
+    event.data.ptr = &client;
+    epoll_ctl(epoll, EPOLL_CTL_MOD, client.connection->GetFd(), &event);
+}
+
+/*! \brief Construct a server whose rooms have blank canvases.
+    \param width width of the canvases, clients must have the same size
+    \param height height of the canvases
+    \param threads number of workers, 0 for one per core up to 4
+*/
+Server::Server(unsigned width, unsigned height, unsigned threads): m_width(width), m_height(height),
+ m_listen(-1), m_port(0), m_nextId(1), m_clients(0), m_rooms(0), m_acceptCpu(0), m_stop(false){
+    if (threads == 0){
+        threads = std::max(1u, std::min(MAX_WORKERS, std::thread::hardware_concurrency()));
+    }
+    for (unsigned i = 0; i < threads; i++){
+        m_workers.push_back(std::unique_ptr<Worker>(new Worker(*this)));
+    }
+}
+
+/*! \brief Close every room and connection.
+*/
+Server::~Server(){
+    m_workers.clear();
+    if (m_listen >= 0){
+        close(m_listen);
+    }
+}
+
+/*! \brief Start accepting clients.
+    \param port TCP port to listen on, 0 picks a free one
+    \return true if the port could be opened
+*/
+bool Server::Listen(unsigned short port){
+    m_listen = socket(AF_INET6, SOCK_STREAM, 0);
+    if (m_listen < 0){
+        return false;
+    }
+    int on = 1;
+    int off = 0;
+    setsockopt(m_listen, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    // Take IPv4 clients on the same socket
+    setsockopt(m_listen, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+    struct sockaddr_in6 address;
+    std::memset(&address, 0, sizeof(address));
+    address.sin6_family = AF_INET6;
+    address.sin6_addr = in6addr_any;
+    address.sin6_port = htons(port);
+    socklen_t length = sizeof(address);
+    if (bind(m_listen, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(m_listen, SOMAXCONN) != 0 ||
+        getsockname(m_listen, reinterpret_cast<struct sockaddr*>(&address), &length) != 0){
+        close(m_listen);
+        m_listen = -1;
+        return false;
+    }
+    fcntl(m_listen, F_SETFL, fcntl(m_listen, F_GETFL, 0) | O_NONBLOCK);
+    m_port = ntohs(address.sin6_port);
+    return true;
+}
+
+/*! \brief Serve clients until Stop() is called. The calling thread
+        accepts connections, the workers run on their own threads.
+*/
+void Server::Run(){
+    for (std::size_t i = 0; i < m_workers.size(); i++){
+        m_workers[i]->thread = std::thread(&Worker::Run, m_workers[i].get());
+    }
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event event;
+    std::memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.ptr = nullptr;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, m_listen, &event);
+    // Connections that did not say hello yet
+    std::vector<std::unique_ptr<Connection>> waiting;
+    struct epoll_event events[MAX_EVENTS];
+    std::hash<std::string> hash;
+    while (!m_stop){
+        int count = epoll_wait(epoll, events, MAX_EVENTS, POLL_MS);
+        for (int i = 0; i < count; i++){
+            if (!events[i].data.ptr){
+                Accept(epoll, waiting);
+                continue;
+            }
+            Connection* connection = static_cast<Connection*>(events[i].data.ptr);
+            bool alive = connection->Receive();
+            std::uint8_t type;
+            const std::uint8_t* payload;
+            std::size_t size;
+            bool greeted = connection->NextMessage(type, payload, size);
+            if (!greeted && alive && connection->IsOpen()){
+                continue;
+            }
+            std::vector<std::unique_ptr<Connection>>::iterator it = waiting.begin();
+            while (it->get() != connection){
+                ++it;
+            }
+            std::unique_ptr<Connection> owned = std::move(*it);
+            waiting.erase(it);
+            epoll_ctl(epoll, EPOLL_CTL_DEL, connection->GetFd(), nullptr);
+            ByteReader hello(payload, size);
+            if (!greeted || type != MESSAGE_HELLO || hello.GetVarint() != PROTOCOL_VERSION){
+                continue;
+            }
+            std::string room = hello.GetString();
+            if (!hello.Ok() || room.size() > MAX_ROOM_NAME){
+                continue;
+            }
+            // The rest of the hello is read by the room
+            Worker &worker = *m_workers[hash(room) % m_workers.size()];
+            worker.Add(std::move(owned), room, payload + size - hello.GetRemaining(), hello.GetRemaining());
+        }
+        m_acceptCpu = ThreadCpu();
+    }
+    close(epoll);
+    for (std::size_t i = 0; i < m_workers.size(); i++){
+        m_workers[i]->Wake();
+        m_workers[i]->thread.join();
+    }
+}
+
+/*! \brief Make Run() return. Safe to call from a signal handler or
+        another thread.
+*/
+void Server::Stop(){
+    m_stop = true;
+    for (std::size_t i = 0; i < m_workers.size(); i++){
+        m_workers[i]->Wake();
+    }
+}
+
+/*! \brief Get the port the server listens on.
+*/
+unsigned short Server::GetPort() const{
+    return m_port;
+}
+
+/*! \brief Get the number of connected clients.
+*/
+unsigned Server::GetClientCount() const{
+    return m_clients;
+}
+
+/*! \brief Get the number of rooms that were joined since the start.
+*/
+unsigned Server::GetRoomCount() const{
+    return m_rooms;
+}
+
+/*! \brief Get the totals of all threads so far.
+*/
+ServerStats Server::GetStats() const{
+    ServerStats stats = {0, 0, 0, 0};
+    std::uint64_t cpu = m_acceptCpu;
+    for (std::size_t i = 0; i < m_workers.size(); i++){
+        stats.messages += m_workers[i]->messages;
+        stats.bytesSent += m_workers[i]->bytesSent;
+        stats.catchUps += m_workers[i]->catchUps;
+        cpu += m_workers[i]->cpu;
+    }
+    stats.cpuSeconds = cpu / 1e9;
+    return stats;
+}
+
+/*! \brief Accept every client that is waiting and wait for its hello.
+*/
+void Server::Accept(int epoll, std::vector<std::unique_ptr<Connection>> &waiting){
+    while (true){
+        int fd = accept(m_listen, nullptr, nullptr);
+        if (fd < 0){
+            return;
+        }
+        waiting.push_back(std::unique_ptr<Connection>(new Connection(fd)));
+        struct epoll_event event;
+        std::memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.ptr = waiting.back().get();
+        epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event);
+    }
+}
@@ -0,0 +1,158 @@
+/**
+ *  @file   StrokeCodec.cpp
+ *  @brief  Implementation of StrokeCodec.hpp
+ *  @author Team Avengers
+ *  @date   2020-12-12
+ ***********************************************/
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <cstring>
+// Project header files
+#include "StrokeCodec.hpp"
+
+namespace {
+
+// Set in the flags byte if coverage bytes follow the coordinates
+const std::uint8_t STROKE_COVERAGE = 1;
+// Version, flags, color, brush size, layer and count at their largest
+const std::size_t MAX_HEADER = 1 + 1 + 4 + 1 + 5 + 10;
+// Two zigzag varints of 32 bit numbers and a coverage byte
+const std::size_t MAX_SAMPLE = 5 + 5 + 1;
+
+inline std::uint8_t* PutVarint(std::uint8_t* out, std::uint64_t value){
+    while (value >= 0x80){
+        *out++ = static_cast<std::uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<std::uint8_t>(value);
+    return out;
+}
+
+inline std::uint8_t* PutSigned(std::uint8_t* out, std::int32_t value){
+    return PutVarint(out, (static_cast<std::uint32_t>(value) << 1) ^ static_cast<std::uint32_t>(value >> 31));
+}
+
+// Reads stop at 'end' and set 'in' to nullptr when the data runs out
+inline std::uint64_t GetVarint(const std::uint8_t* &in, const std::uint8_t* end){
+    std::uint64_t value = 0;
+    for (unsigned shift = 0; in && shift < 64; shift += 7){
+        if (in == end){
+            break;
+        }
+        std::uint8_t byte = *in++;
+        value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80)){
+            return value;
+        }
+    }
+    in = nullptr;
+    return 0;
+}
+
+inline std::int32_t GetSigned(const std::uint8_t* &in, const std::uint8_t* end){
+    std::uint32_t value = static_cast<std::uint32_t>(GetVarint(in, end));
+    return static_cast<std::int32_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+}
+
+/*! \brief Get the most bytes a stroke can take, to size a buffer.
+    \param samples number of samples in the stroke
+*/
+std::size_t GetMaxStrokeSize(std::size_t samples){
+    return MAX_HEADER + samples * MAX_SAMPLE;
+}
+
+/*! \brief Encode a stroke.
+    \param header color, layer and brush of the stroke
+    \param points canvas position of every sample
+    \param coverage selection coverage of every sample, nullptr if all are 255
+    \param samples number of samples, at least 1
+    \param out buffer to encode into
+    \param capacity size of the buffer, GetMaxStrokeSize() is always enough
+    \return number of bytes written, 0 if the buffer is too small
+*/
+std::size_t EncodeStroke(const StrokeHeader &header, const sf::Vector2i* points, const sf::Uint8* coverage,
+                         std::size_t samples, std::uint8_t* out, std::size_t capacity){
+    if (samples == 0 || capacity < GetMaxStrokeSize(samples)){
+        return 0;
+    }
+    bool partial = false;
+    for (std::size_t i = 0; coverage && i < samples && !partial; i++){
+        partial = coverage[i] != 255;
+    }
+    std::uint8_t* p = out;
+    *p++ = STROKE_VERSION;
+    *p++ = partial ? STROKE_COVERAGE : 0;
+    *p++ = header.color.r;
+    *p++ = header.color.g;
+    *p++ = header.color.b;
+    *p++ = header.color.a;
+    *p++ = header.brushSize;
+    p = PutVarint(p, header.layer);
+    p = PutVarint(p, samples);
+    p = PutSigned(p, points[0].x);
+    p = PutSigned(p, points[0].y);
+    for (std::size_t i = 1; i < samples; i++){
+        p = PutSigned(p, points[i].x - points[i - 1].x);
+        p = PutSigned(p, points[i].y - points[i - 1].y);
+    }
+    if (partial){
+        std::memcpy(p, coverage, samples);
+        p += samples;
+    }
+    return p - out;
+}
+
+/*! \brief Decode a stroke written by EncodeStroke().
+    \param in encoded bytes
+    \param size number of bytes available, may be more than the stroke
+    \param header set to the color, layer and brush of the stroke
+    \param points receives the position of every sample
+    \param coverage receives the coverage of every sample
+    \param capacity room in points and coverage
+    \param samples set to the number of samples
+    \return number of bytes read, 0 if the data is damaged, of another
+        version or has more samples than fit
+*/
+std::size_t DecodeStroke(const std::uint8_t* in, std::size_t size, StrokeHeader &header,
+                         sf::Vector2i* points, sf::Uint8* coverage, std::size_t capacity, std::size_t &samples){
+    const std::uint8_t* end = in + size;
+    const std::uint8_t* p = in;
+    if (size < 7 || p[0] != STROKE_VERSION || (p[1] & ~STROKE_COVERAGE) != 0){
+        return 0;
+    }
+    bool partial = (p[1] & STROKE_COVERAGE) != 0;
+    header.color = sf::Color(p[2], p[3], p[4], p[5]);
+    header.brushSize = p[6];
+    p += 7;
+    header.layer = static_cast<unsigned>(GetVarint(p, end));
+    std::uint64_t count = GetVarint(p, end);
+    if (!p || count == 0 || count > capacity){
+        return 0;
+    }
+    samples = static_cast<std::size_t>(count);
+    // Unsigned sums, so damaged deltas wrap around instead of overflowing
+    std::uint32_t x = 0;
+    std::uint32_t y = 0;
+    for (std::size_t i = 0; i < samples; i++){
+        x += static_cast<std::uint32_t>(GetSigned(p, end));
+        y += static_cast<std::uint32_t>(GetSigned(p, end));
+        points[i] = sf::Vector2i(static_cast<int>(x), static_cast<int>(y));
+    }
+    if (!p){
+        return 0;
+    }
+    if (partial){
+        if (static_cast<std::size_t>(end - p) < samples){
+            return 0;
+        }
+        std::memcpy(coverage, p, samples);
+        p += samples;
+    } else{
+        std::memset(coverage, 255, samples);
+    }
+    return p - in;
+}
@@ -0,0 +1,252 @@
+/**
+ *  @file   TaskPool.cpp
+ *  @brief  Work-stealing worker threads for filters, compositing and I/O.
+ *  @author Team Avengers
+ *  @date   2020-12-16
+ ***********************************************/
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <algorithm>
+// Project header files
+#include "TaskPool.hpp"
+#include "Trace.hpp"
+
+namespace {
+
+// Pool and worker index of the calling thread, so tasks submitted from a
+// task go to the deque of the worker running it
+thread_local TaskPool* currentPool = nullptr;
+thread_local unsigned currentWorker = 0;
+
+}
+
+/*! \brief Construct an empty group.
+    \param lane queue the tasks of the group wait in
+    \param deadline tasks that have not started by then are skipped
+*/
+TaskGroup::TaskGroup(TaskLane lane, TaskClock::time_point deadline): m_lane(lane), m_deadline(deadline),
+ m_pool(nullptr), m_pending(0), m_skipped(0){
+}
+
+/*! \brief Wait for the tasks that are still running, they may use the group.
+*/
+TaskGroup::~TaskGroup(){
+    if (m_pool){
+        m_pool->Wait(*this);
+    }
+}
+
+/*! \brief Check if every task of the group ran or was skipped.
+*/
+bool TaskGroup::IsDone() const{
+    return m_pending.load() == 0;
+}
+
+/*! \brief Get the number of tasks skipped because of the deadline.
+*/
+unsigned TaskGroup::GetSkipped() const{
+    return m_skipped.load();
+}
+
+/*! \brief Construct a pool without threads, see Start().
+*/
+TaskPool::TaskPool(): m_queued(0), m_next(0), m_backgroundRunning(0), m_backgroundLimit(1), m_stop(false){
+}
+
+/*! \brief Run the tasks that are still queued and end the threads.
+*/
+TaskPool::~TaskPool(){
+    Stop();
+}
+
+/*! \brief Start the worker threads.
+    \param threads number of workers, AUTO_THREADS for one per core but one,
+           0 to run every task on the thread submitting it
+*/
+void TaskPool::Start(unsigned threads){
+    Stop();
+    if (threads == AUTO_THREADS){
+        unsigned cores = std::thread::hardware_concurrency();
+        threads = cores > 1 ? cores - 1 : 1;
+    }
+    m_stop = false;
+    m_backgroundLimit = threads > 1 ? threads - 1 : 1;
+    for (unsigned i = 0; i < threads; i++){
+        m_workers.push_back(std::unique_ptr<Worker>(new Worker));
+    }
+    for (unsigned i = 0; i < threads; i++){
+        m_workers[i]->thread = std::thread(&TaskPool::Work, this, i);
+    }
+}
+
+/*! \brief Run the tasks that are still queued and end the threads.
+*/
+void TaskPool::Stop(){
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::size_t i = 0; i < m_workers.size(); i++){
+        m_workers[i]->thread.join();
+    }
+    m_workers.clear();
+}
+
+/*! \brief Queue a task.
+    \param group group the task belongs to, it has to outlive the task
+    \param task work to do
+*/
+void TaskPool::Submit(TaskGroup &group, std::function<void()> task){
+    group.m_pool = this;
+    group.m_pending++;
+    Task queued = {std::move(task), &group};
+    if (m_workers.empty()){
+        Run(queued);
+        return;
+    }
+    if (group.m_lane == TASK_BACKGROUND){
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_background.push_back(std::move(queued));
+        }
+        m_wake.notify_one();
+        return;
+    }
+    unsigned index = currentPool == this ? currentWorker : m_next++ % m_workers.size();
+    Worker &worker = *m_workers[index];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks.push_back(std::move(queued));
+    }
+    m_queued++;
+    {
+        // A worker checks m_queued under this lock before it sleeps
+        std::lock_guard<std::mutex> lock(m_mutex);
+    }
+    m_wake.notify_one();
+}
+
+/*! \brief Block until every task of a group ran, running frame tasks of
+        the pool in the meantime.
+*/
+void TaskPool::Wait(TaskGroup &group){
+    unsigned self = currentPool == this ? currentWorker : static_cast<unsigned>(m_workers.size());
+    Task task;
+    while (group.m_pending.load() > 0){
+        if (TakeFrameTask(self, task)){
+            Run(task);
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [&group]{ return group.m_pending.load() == 0; });
+    }
+}
+
+/*! \brief Get the number of worker threads.
+*/
+unsigned TaskPool::GetThreadCount() const{
+    return static_cast<unsigned>(m_workers.size());
+}
+
+/*! \brief Take the newest frame task of a worker's own deque, or else the
+        oldest one of another worker.
+    \param worker index of the calling worker, or the worker count for a
+           thread outside the pool
+    \return false if no frame task is queued
+*/
+bool TaskPool::TakeFrameTask(unsigned worker, Task &task){
+    if (m_queued.load() == 0){
+        return false;
+    }
+    std::size_t count = m_workers.size();
+    if (worker < count){
+        Worker &own = *m_workers[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()){
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            m_queued--;
+            return true;
+        }
+    }
+    for (std::size_t i = 1; i <= count; i++){
+        Worker &victim = *m_workers[(worker + i) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()){
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            m_queued--;
+            return true;
+        }
+    }
+    return false;
+}
+
+/*! \brief Take the oldest background task, unless enough workers are busy
+        with background tasks already.
+*/
+bool TaskPool::TakeBackgroundTask(Task &task){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_background.empty() || m_backgroundRunning >= m_backgroundLimit){
+        return false;
+    }
+    task = std::move(m_background.front());
+    m_background.pop_front();
+    m_backgroundRunning++;
+    return true;
+}
+
+/*! \brief Run a task, or skip it if its group is past the deadline, and
+        wake the threads waiting for the group once it is done.
+*/
+void TaskPool::Run(Task &task){
+    TaskGroup &group = *task.group;
+    if (group.m_deadline == TaskClock::time_point::max() || TaskClock::now() < group.m_deadline){
+        task.work();
+    } else{
+        group.m_skipped++;
+    }
+    // Free what the task holds before the group counts as done
+    task.work = nullptr;
+    if (--group.m_pending == 0){
+        // The group may be gone from here on
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_done.notify_all();
+    }
+}
+
+/*! \brief Body of a worker thread.
+*/
+void TaskPool::Work(unsigned worker){
+    currentPool = this;
+    currentWorker = worker;
+    Trace::NameThread("Task worker");
+    Task task;
+    for (;;){
+        if (TakeFrameTask(worker, task)){
+            Run(task);
+            continue;
+        }
+        if (TakeBackgroundTask(task)){
+            Run(task);
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_backgroundRunning--;
+            }
+            // A background task may be waiting for this slot
+            m_wake.notify_one();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wake.wait(lock, [this]{
+            return m_queued.load() > 0 || (!m_background.empty() && m_backgroundRunning < m_backgroundLimit) ||
+                   (m_stop && m_background.empty());
+        });
+        if (m_stop && m_queued.load() == 0 && m_background.empty()){
+            return;
+        }
+    }
+}
@@ -0,0 +1,309 @@
+/**
+ *  @file   TextureStreamer.cpp
+ *  @brief  Implementation of TextureStreamer.hpp
+ *  @author Team Avengers
+ *  @date   2020-12-17
+ ***********************************************/
+
+// Include our Third-Party SFML header
+#include <SFML/OpenGL.hpp>
+#include <SFML/Window/Context.hpp>
+// Include standard library C++ libraries.
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+// Project header files
+#include "TextureStreamer.hpp"
+
+namespace {
+
+// Enums of the buffer and sync extensions, not in every gl.h
+const GLenum PIXEL_UNPACK_BUFFER = 0x88EC;
+const GLbitfield MAP_WRITE_BIT = 0x0002;
+const GLbitfield MAP_PERSISTENT_BIT = 0x0040;
+const GLbitfield MAP_COHERENT_BIT = 0x0080;
+const GLenum SYNC_GPU_COMMANDS_COMPLETE = 0x9117;
+const GLbitfield SYNC_FLUSH_COMMANDS_BIT = 0x0001;
+const GLenum ALREADY_SIGNALED = 0x911A;
+const GLenum CONDITION_SATISFIED = 0x911C;
+const GLenum WAIT_FAILED = 0x911D;
+
+const std::size_t SLOT_BYTES = static_cast<std::size_t>(TextureStreamer::SLOT_TILES) * TILE_BYTES;
+// Tiles one worker copies into a buffer
+const unsigned FILL_CHUNK = 16;
+// A fence that is not signaled within this long is waited for again
+const std::uint64_t FENCE_TIMEOUT_NS = 1000000000ull;
+
+template<typename F>
+bool Load(F &function, const char* name){
+    function = reinterpret_cast<F>(sf::Context::getFunction(name));
+    return function != nullptr;
+}
+
+}
+
+// Everything is loaded from the context, so the harness and the server
+// do not need to link the GL library.
+struct TextureStreamer::Functions{
+    const GLubyte* (APIENTRY *GetString)(GLenum);
+    void (APIENTRY *GetIntegerv)(GLenum, GLint*);
+    void (APIENTRY *BindTexture)(GLenum, GLuint);
+    void (APIENTRY *TexSubImage2D)(GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLenum, const void*);
+    void (APIENTRY *Flush)();
+    void (APIENTRY *GenBuffers)(GLsizei, GLuint*);
+    void (APIENTRY *DeleteBuffers)(GLsizei, const GLuint*);
+    void (APIENTRY *BindBuffer)(GLenum, GLuint);
+    void (APIENTRY *BufferStorage)(GLenum, std::ptrdiff_t, const void*, GLbitfield);
+    void* (APIENTRY *MapBufferRange)(GLenum, std::ptrdiff_t, std::ptrdiff_t, GLbitfield);
+    GLboolean (APIENTRY *UnmapBuffer)(GLenum);
+    void* (APIENTRY *FenceSync)(GLenum, GLbitfield);
+    GLenum (APIENTRY *ClientWaitSync)(void*, GLbitfield, std::uint64_t);
+    void (APIENTRY *DeleteSync)(void*);
+
+    bool LoadAll(){
+        return Load(GetString, "glGetString") && Load(GetIntegerv, "glGetIntegerv") &&
+               Load(BindTexture, "glBindTexture") && Load(TexSubImage2D, "glTexSubImage2D") &&
+               Load(Flush, "glFlush") && Load(GenBuffers, "glGenBuffers") &&
+               Load(DeleteBuffers, "glDeleteBuffers") && Load(BindBuffer, "glBindBuffer") &&
+               Load(BufferStorage, "glBufferStorage") && Load(MapBufferRange, "glMapBufferRange") &&
+               Load(UnmapBuffer, "glUnmapBuffer") && Load(FenceSync, "glFenceSync") &&
+               Load(ClientWaitSync, "glClientWaitSync") && Load(DeleteSync, "glDeleteSync");
+    }
+};
+
+/*! \brief Construct a streamer that uploads with sf::Texture::update()
+        until Init() is called.
+    \param tasks workers that fill the buffers
+*/
+TextureStreamer::TextureStreamer(TaskPool &tasks): m_tasks(tasks), m_gl(nullptr), m_next(0), m_stalls(0){
+    for (unsigned i = 0; i < RING_SIZE; i++){
+        m_slots[i].buffer = 0;
+        m_slots[i].mapping = nullptr;
+        m_slots[i].fence = nullptr;
+    }
+}
+
+/*! \brief Delete the buffers, if a context is still current.
+*/
+TextureStreamer::~TextureStreamer(){
+    Release();
+}
+
+/*! \brief Create and map the ring of buffers in the current context.
+        The buffers are shared with every context SFML creates.
+    \return false if uploads go through sf::Texture::update()
+*/
+bool TextureStreamer::Init(){
+    Release();
+    if (std::getenv("FSD_NO_PBO") || !sf::Context::getActiveContext()){
+        return false;
+    }
+    Functions* gl = new Functions;
+    int major = 0;
+    int minor = 0;
+    const char* version = gl->LoadAll() ? reinterpret_cast<const char*>(gl->GetString(GL_VERSION)) : nullptr;
+    if (version){
+        std::sscanf(version, "%d.%d", &major, &minor);
+    }
+    bool storage = major > 4 || (major == 4 && minor >= 4) || sf::Context::isExtensionAvailable("GL_ARB_buffer_storage");
+    bool sync = major > 3 || (major == 3 && minor >= 2) || sf::Context::isExtensionAvailable("GL_ARB_sync");
+    if (!version || major < 3 || !storage || !sync){
+        delete gl;
+        return false;
+    }
+    m_gl = gl;
+    const GLbitfield flags = MAP_WRITE_BIT | MAP_PERSISTENT_BIT | MAP_COHERENT_BIT;
+    for (unsigned i = 0; i < RING_SIZE; i++){
+        Slot &slot = m_slots[i];
+        m_gl->GenBuffers(1, &slot.buffer);
+        m_gl->BindBuffer(PIXEL_UNPACK_BUFFER, slot.buffer);
+        m_gl->BufferStorage(PIXEL_UNPACK_BUFFER, SLOT_BYTES, nullptr, flags);
+        slot.mapping = static_cast<sf::Uint8*>(m_gl->MapBufferRange(PIXEL_UNPACK_BUFFER, 0, SLOT_BYTES, flags));
+        if (!slot.mapping){
+            m_gl->BindBuffer(PIXEL_UNPACK_BUFFER, 0);
+            Release();
+            return false;
+        }
+    }
+    m_gl->BindBuffer(PIXEL_UNPACK_BUFFER, 0);
+    m_next = 0;
+    return true;
+}
+
+/*! \brief Delete the buffers and go back to sf::Texture::update().
+        Without a current context the buffers are left to the driver.
+*/
+void TextureStreamer::Release(){
+    if (!m_gl){
+        return;
+    }
+    if (sf::Context::getActiveContext()){
+        for (unsigned i = 0; i < RING_SIZE; i++){
+            Slot &slot = m_slots[i];
+            if (slot.fence){
+                m_gl->DeleteSync(slot.fence);
+            }
+            if (slot.mapping){
+                m_gl->BindBuffer(PIXEL_UNPACK_BUFFER, slot.buffer);
+                m_gl->UnmapBuffer(PIXEL_UNPACK_BUFFER);
+            }
+            if (slot.buffer){
+                m_gl->DeleteBuffers(1, &slot.buffer);
+            }
+        }
+        m_gl->BindBuffer(PIXEL_UNPACK_BUFFER, 0);
+    }
+    for (unsigned i = 0; i < RING_SIZE; i++){
+        m_slots[i].buffer = 0;
+        m_slots[i].mapping = nullptr;
+        m_slots[i].fence = nullptr;
+    }
+    delete m_gl;
+    m_gl = nullptr;
+}
+
+/*! \brief Check if uploads go through the buffers.
+*/
+bool TextureStreamer::IsStreaming() const{
+    return m_gl != nullptr;
+}
+
+/*! \brief Copy tiles of an image to the same place in a texture.
+        The texture has to be whole tiles in size. Call on the thread
+        the context is current on.
+    \param texture texture to update
+    \param image image the tiles are taken from
+    \param tiles indices of the tiles to copy
+*/
+void TextureStreamer::Upload(sf::Texture &texture, const TiledImage &image, const std::vector<unsigned> &tiles){
+    if (!m_gl){
+        UploadDirect(texture, image, tiles);
+        return;
+    }
+    if (tiles.empty()){
+        return;
+    }
+    // SFML remembers the texture it bound last, so ours is put back
+    GLint previous = 0;
+    m_gl->GetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+    m_gl->BindTexture(GL_TEXTURE_2D, texture.getNativeHandle());
+    TaskGroup groups[RING_SIZE];
+    // Buffer the workers filled last, its copies are issued while they
+    // fill the next one
+    Slot* pending = nullptr;
+    TaskGroup* pendingGroup = nullptr;
+    const unsigned* pendingTiles = nullptr;
+    unsigned pendingCount = 0;
+    std::size_t next = 0;
+    while (next < tiles.size() || pending){
+        Slot* current = nullptr;
+        TaskGroup* currentGroup = nullptr;
+        unsigned count = 0;
+        if (next < tiles.size()){
+            current = &m_slots[m_next];
+            currentGroup = &groups[m_next];
+            m_next = (m_next + 1) % RING_SIZE;
+            count = static_cast<unsigned>(std::min<std::size_t>(SLOT_TILES, tiles.size() - next));
+            WaitForSlot(*current);
+            Fill(*currentGroup, *current, image, &tiles[next], count);
+        }
+        if (pending){
+            m_tasks.Wait(*pendingGroup);
+            Issue(*pending, image, pendingTiles, pendingCount);
+        }
+        pending = current;
+        pendingGroup = currentGroup;
+        pendingTiles = current ? &tiles[next] : nullptr;
+        pendingCount = count;
+        next += count;
+    }
+    m_gl->BindTexture(GL_TEXTURE_2D, static_cast<GLuint>(previous));
+    // Like sf::Texture::update(), so other contexts see the new tiles
+    m_gl->Flush();
+}
+
+/*! \brief Get the number of times a buffer was still being copied from
+        when it was needed again, and the render thread had to wait.
+*/
+std::uint64_t TextureStreamer::GetStalls() const{
+    return m_stalls;
+}
+
+/*! \brief Upload the tiles from our memory with sf::Texture::update().
+*/
+void TextureStreamer::UploadDirect(sf::Texture &texture, const TiledImage &image, const std::vector<unsigned> &tiles){
+    for (std::size_t i = 0; i < tiles.size(); i++){
+        unsigned tile = tiles[i];
+        unsigned x = (tile % image.GetTilesX()) * TILE_SIZE;
+        unsigned y = (tile / image.GetTilesX()) * TILE_SIZE;
+        const sf::Uint8* pixels = image.GetTile(tile);
+        if (pixels){
+            texture.update(pixels, TILE_SIZE, TILE_SIZE, x, y);
+        } else{
+            static const std::vector<sf::Uint8> transparent(TILE_BYTES, 0);
+            texture.update(&transparent[0], TILE_SIZE, TILE_SIZE, x, y);
+        }
+    }
+}
+
+/*! \brief Wait until the copies out of a buffer are done, so it can be
+        written again.
+*/
+void TextureStreamer::WaitForSlot(Slot &slot){
+    if (!slot.fence){
+        return;
+    }
+    GLenum result = m_gl->ClientWaitSync(slot.fence, 0, 0);
+    if (result != ALREADY_SIGNALED && result != CONDITION_SATISFIED){
+        m_stalls++;
+        do{
+            result = m_gl->ClientWaitSync(slot.fence, SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+        } while (result != ALREADY_SIGNALED && result != CONDITION_SATISFIED && result != WAIT_FAILED);
+    }
+    m_gl->DeleteSync(slot.fence);
+    slot.fence = nullptr;
+}
+
+/*! \brief Have the workers copy tiles into a buffer, one after the other.
+        A tile that does not exist is written as transparent.
+    \param group group the copies are submitted to
+    \param slot buffer to fill
+    \param image image the tiles are taken from
+    \param tiles indices of the tiles, they have to stay until the group is done
+    \param count number of tiles, at most SLOT_TILES
+*/
+void TextureStreamer::Fill(TaskGroup &group, Slot &slot, const TiledImage &image, const unsigned* tiles, unsigned count){
+    sf::Uint8* mapping = slot.mapping;
+    for (unsigned begin = 0; begin < count; begin += FILL_CHUNK){
+        unsigned end = std::min(count, begin + FILL_CHUNK);
+        m_tasks.Submit(group, [&image, tiles, mapping, begin, end]{
+            for (unsigned i = begin; i < end; i++){
+                const sf::Uint8* pixels = image.GetTile(tiles[i]);
+                sf::Uint8* target = mapping + static_cast<std::size_t>(i) * TILE_BYTES;
+                if (pixels){
+                    std::memcpy(target, pixels, TILE_BYTES);
+                } else{
+                    std::memset(target, 0, TILE_BYTES);
+                }
+            }
+        });
+    }
+}
+
+/*! \brief Copy the tiles in a filled buffer to the bound texture and put
+        a fence after the copies.
+*/
+void TextureStreamer::Issue(Slot &slot, const TiledImage &image, const unsigned* tiles, unsigned count){
+    m_gl->BindBuffer(PIXEL_UNPACK_BUFFER, slot.buffer);
+    for (unsigned i = 0; i < count; i++){
+        GLint x = static_cast<GLint>((tiles[i] % image.GetTilesX()) * TILE_SIZE);
+        GLint y = static_cast<GLint>((tiles[i] / image.GetTilesX()) * TILE_SIZE);
+        // With a buffer bound the pointer is an offset into it
+        const void* offset = reinterpret_cast<const void*>(static_cast<std::size_t>(i) * TILE_BYTES);
+        m_gl->TexSubImage2D(GL_TEXTURE_2D, 0, x, y, TILE_SIZE, TILE_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, offset);
+    }
+    m_gl->BindBuffer(PIXEL_UNPACK_BUFFER, 0);
+    slot.fence = m_gl->FenceSync(SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
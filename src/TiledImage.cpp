@@ -0,0 +1,233 @@
+/**
+ *  @file   TiledImage.cpp
+ *  @brief  Implementation of TiledImage.hpp
+ *  @author Team Avengers
+ *  @date   2020-11-30
+ ***********************************************/
+
+// Include our Third-Party SFML header
+#include <SFML/Graphics/Color.hpp>
+// Include standard library C++ libraries.
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+// Project header files
+#include "Memory.hpp"
+#include "TiledImage.hpp"
+
+namespace {
+
+// Pixels of one tile. The empty constructor leaves them uninitialized.
+struct TileBlock{
+    TileBlock(){
+    }
+    sf::Uint8 pixels[TILE_BYTES];
+};
+
+}
+
+/*! \brief Construct an empty 0x0 image.
+*/
+TiledImage::TiledImage(): m_width(0), m_height(0), m_tilesX(0), m_tilesY(0){
+}
+
+/*! \brief Construct a fully transparent image.
+    \param width width of the image in pixels
+    \param height height of the image in pixels
+*/
+TiledImage::TiledImage(unsigned width, unsigned height): m_width(width), m_height(height),
+ m_tilesX((width + TILE_SIZE - 1) / TILE_SIZE), m_tilesY((height + TILE_SIZE - 1) / TILE_SIZE),
+ m_tiles(m_tilesX * m_tilesY){
+}
+
+/*! \brief Get the width of the image.
+    \return width in pixels
+*/
+unsigned TiledImage::GetWidth() const{
+    return m_width;
+}
+
+/*! \brief Get the height of the image.
+    \return height in pixels
+*/
+unsigned TiledImage::GetHeight() const{
+    return m_height;
+}
+
+/*! \brief Get the number of tile columns.
+*/
+unsigned TiledImage::GetTilesX() const{
+    return m_tilesX;
+}
+
+/*! \brief Get the number of tile rows.
+*/
+unsigned TiledImage::GetTilesY() const{
+    return m_tilesY;
+}
+
+/*! \brief Get the total number of tiles.
+*/
+unsigned TiledImage::GetTileCount() const{
+    return m_tilesX * m_tilesY;
+}
+
+/*! \brief Get the index of the tile containing a pixel.
+    \param x column of the pixel
+    \param y row of the pixel
+    \return tile index
+*/
+unsigned TiledImage::TileIndex(unsigned x, unsigned y) const{
+    return (y / TILE_SIZE) * m_tilesX + x / TILE_SIZE;
+}
+
+/*! \brief Read-only access to a tile.
+    \param index tile index
+    \return pointer to TILE_BYTES bytes, or nullptr if the tile is transparent
+*/
+const sf::Uint8* TiledImage::GetTile(unsigned index) const{
+    return m_tiles[index].get();
+}
+
+/*! \brief Writable access to a tile. A transparent tile is allocated and
+        a shared tile is copied first, so other images never see the write.
+    \param index tile index
+    \return pointer to TILE_BYTES bytes owned only by this image
+*/
+sf::Uint8* TiledImage::GetMutableTile(unsigned index){
+    TilePtr &tile = m_tiles[index];
+    if (!tile){
+        tile = AllocateTile();
+        std::memset(tile.get(), 0, TILE_BYTES);
+    } else if (tile.use_count() > 1){
+        TilePtr copy = AllocateTile();
+        std::memcpy(copy.get(), tile.get(), TILE_BYTES);
+        tile = copy;
+    }
+    return tile.get();
+}
+
+/*! \brief Get the shared pointer of a tile.
+    \param index tile index
+*/
+TilePtr TiledImage::GetTilePtr(unsigned index) const{
+    return m_tiles[index];
+}
+
+/*! \brief Replace a tile. The tile is shared, not copied.
+    \param index tile index
+    \param tile new tile, or nullptr for transparent
+*/
+void TiledImage::SetTilePtr(unsigned index, const TilePtr &tile){
+    m_tiles[index] = tile;
+}
+
+/*! \brief Read a single pixel.
+    \return premultiplied color of the pixel
+*/
+sf::Color TiledImage::GetPixel(unsigned x, unsigned y) const{
+    const sf::Uint8* tile = m_tiles[TileIndex(x, y)].get();
+    if (!tile){
+        return sf::Color::Transparent;
+    }
+    const sf::Uint8* p = tile + ((y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE) * 4;
+    return sf::Color(p[0], p[1], p[2], p[3]);
+}
+
+/*! \brief Write a single pixel.
+    \param premultiplied color with alpha already multiplied in
+*/
+void TiledImage::SetPixel(unsigned x, unsigned y, const sf::Color &premultiplied){
+    sf::Uint8* p = GetMutableTile(TileIndex(x, y)) + ((y % TILE_SIZE) * TILE_SIZE + x % TILE_SIZE) * 4;
+    p[0] = premultiplied.r;
+    p[1] = premultiplied.g;
+    p[2] = premultiplied.b;
+    p[3] = premultiplied.a;
+}
+
+/*! \brief Fill the whole image with one color. Every tile shares the
+        same block of memory until it is written to.
+    \param premultiplied color with alpha already multiplied in
+*/
+void TiledImage::Fill(const sf::Color &premultiplied){
+    TilePtr tile;
+    if (premultiplied.a != 0){
+        tile = AllocateTile();
+        sf::Uint8* p = tile.get();
+        for (unsigned i = 0; i < TILE_SIZE * TILE_SIZE; i++){
+            p[i * 4 + 0] = premultiplied.r;
+            p[i * 4 + 1] = premultiplied.g;
+            p[i * 4 + 2] = premultiplied.b;
+            p[i * 4 + 3] = premultiplied.a;
+        }
+    }
+    for (unsigned i = 0; i < m_tiles.size(); i++){
+        m_tiles[i] = tile;
+    }
+}
+
+/*! \brief Check if two images share exactly the same tiles.
+        This is a cheap way to tell that one is an unmodified copy of the other.
+*/
+bool TiledImage::SameTiles(const TiledImage &rhs) const{
+    return m_width == rhs.m_width && m_height == rhs.m_height && m_tiles == rhs.m_tiles;
+}
+
+/*! \brief Hash the pixels of a tile, to tell if two copies of it are
+        the same without comparing them.
+    \param pixels TILE_BYTES bytes, or nullptr for a transparent tile
+    \return 64 bit hash, 0 only for a transparent tile
+*/
+std::uint64_t TiledImage::HashTile(const sf::Uint8* pixels){
+    if (!pixels){
+        return 0;
+    }
+    // Two lanes of 8 bytes with a multiply and rotate each, mixed at the end
+    const std::uint64_t k1 = 0x9E3779B97F4A7C15ULL;
+    const std::uint64_t k2 = 0xC2B2AE3D27D4EB4FULL;
+    std::uint64_t a = k1;
+    std::uint64_t b = k2;
+    for (unsigned i = 0; i < TILE_BYTES; i += 16){
+        std::uint64_t x;
+        std::uint64_t y;
+        std::memcpy(&x, pixels + i, 8);
+        std::memcpy(&y, pixels + i + 8, 8);
+        a = ((a ^ x) * k2);
+        a = (a << 31) | (a >> 33);
+        b = ((b ^ y) * k1);
+        b = (b << 29) | (b >> 35);
+    }
+    std::uint64_t h = a ^ ((b << 32) | (b >> 32));
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h != 0 ? h : 1;
+}
+
+/*! \brief Allocate an uninitialized tile. Tiles are copied on every
+        stroke, so they come from a pool together with their count.
+*/
+TilePtr TiledImage::AllocateTile(){
+    std::shared_ptr<TileBlock> block = MakePooled<TileBlock>();
+    return TilePtr(block, block->pixels);
+}
+
+/*! \brief Convert a straight alpha color to premultiplied alpha.
+*/
+sf::Color TiledImage::Premultiply(const sf::Color &color){
+    return sf::Color((color.r * color.a + 127) / 255, (color.g * color.a + 127) / 255,
+                     (color.b * color.a + 127) / 255, color.a);
+}
+
+/*! \brief Convert a premultiplied alpha color back to straight alpha.
+*/
+sf::Color TiledImage::Unpremultiply(const sf::Color &color){
+    if (color.a == 0){
+        return sf::Color::Transparent;
+    }
+    return sf::Color(std::min(255, (color.r * 255 + color.a / 2) / color.a),
+                     std::min(255, (color.g * 255 + color.a / 2) / color.a),
+                     std::min(255, (color.b * 255 + color.a / 2) / color.a), color.a);
+}
@@ -0,0 +1,244 @@
+/**
+ *  @file   Trace.cpp
+ *  @brief  Implementation of Trace.hpp
+ *  @author Team Avengers
+ *  @date   2020-12-14
+ ***********************************************/
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+// Project header files
+#include "Trace.hpp"
+
+namespace {
+
+// Events a thread can have waiting to be flushed
+const std::size_t RING_EVENTS = 1 << 13;
+
+// A scope that ran, in nanoseconds of the steady clock
+struct TraceEvent{
+    const char*  name;
+    std::int64_t start;
+    std::int64_t duration;
+};
+
+// The events of one thread. Only the thread moves 'head' and only the
+// flushing thread moves 'tail'.
+struct ThreadRing{
+    unsigned id;
+    std::atomic<const char*> name;
+    // Capture the name was last written in
+    unsigned named;
+    std::atomic<std::size_t> head;
+    std::atomic<std::size_t> tail;
+    TraceEvent events[RING_EVENTS];
+};
+
+std::int64_t Nanoseconds(std::chrono::steady_clock::time_point time){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+}
+
+// Guards everything but the rings' events
+std::mutex mutex;
+std::condition_variable wake;
+std::vector<std::shared_ptr<ThreadRing>> rings;
+unsigned nextThread = 1;
+std::ofstream file;
+std::string path;
+std::string status = "Not tracing";
+std::thread flusher;
+bool stopping = false;
+// Counts the captures, so thread names are written once in each
+unsigned capture = 0;
+// Start of the capture, events from before are left out
+std::int64_t origin = 0;
+std::uint64_t written = 0;
+std::atomic<std::uint64_t> dropped(0);
+
+thread_local std::shared_ptr<ThreadRing> local;
+thread_local const char* localName = nullptr;
+
+/*! \brief Get the ring of the calling thread, made on its first event.
+*/
+ThreadRing& GetRing(){
+    if (!local){
+        local = std::make_shared<ThreadRing>();
+        local->named = 0;
+        local->head = 0;
+        local->tail = 0;
+        local->name = localName;
+        std::lock_guard<std::mutex> lock(mutex);
+        local->id = nextThread++;
+        rings.push_back(local);
+    }
+    return *local;
+}
+
+/*! \brief Write one event to the file, with a comma before all but the first.
+*/
+void WriteEvent(const char* json){
+    if (written++ > 0){
+        file << ",\n";
+    }
+    file << json;
+}
+
+/*! \brief Move the events of every ring to the file and forget the rings
+        of threads that ended. Called with the mutex held.
+*/
+void WriteEvents(){
+    char json[256];
+    for (std::size_t r = 0; r < rings.size(); r++){
+        ThreadRing &ring = *rings[r];
+        std::size_t head = ring.head.load(std::memory_order_acquire);
+        std::size_t tail = ring.tail.load(std::memory_order_relaxed);
+        const char* name = ring.name.load(std::memory_order_relaxed);
+        if (ring.named != capture && head != tail){
+            ring.named = capture;
+            std::snprintf(json, sizeof(json), "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                          "\"args\":{\"name\":\"%s %u\"}}", ring.id, name ? name : "Thread", ring.id);
+            WriteEvent(json);
+        }
+        for (; tail != head; tail++){
+            const TraceEvent &event = ring.events[tail % RING_EVENTS];
+            if (event.start < origin){
+                continue;
+            }
+            std::snprintf(json, sizeof(json), "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,"
+                          "\"ts\":%.3f,\"dur\":%.3f}", event.name, ring.id, (event.start - origin) / 1e3,
+                          event.duration / 1e3);
+            WriteEvent(json);
+        }
+        ring.tail.store(tail, std::memory_order_release);
+    }
+    // A ring only the list still has belongs to a thread that ended and
+    // was emptied above
+    for (std::size_t r = rings.size(); r-- > 0;){
+        if (rings[r].use_count() == 1){
+            rings.erase(rings.begin() + r);
+        }
+    }
+    file.flush();
+}
+
+/*! \brief Body of the flushing thread.
+*/
+void Run(){
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping){
+        wake.wait_for(lock, std::chrono::milliseconds(Trace::FLUSH_MS));
+        WriteEvents();
+    }
+}
+
+}
+
+const unsigned Trace::FLUSH_MS;
+std::atomic<bool> Trace::s_capturing(false);
+
+/*! \brief Start capturing into a file.
+    \return false if a capture is running or the file can not be written
+*/
+bool Trace::Start(const std::string &tracePath){
+    std::lock_guard<std::mutex> lock(mutex);
+    if (IsCapturing()){
+        return false;
+    }
+    file.open(tracePath.c_str(), std::ios::trunc);
+    if (!file){
+        file.clear();
+        status = "Could not write " + tracePath;
+        return false;
+    }
+    path = tracePath;
+    file << "{\"traceEvents\":[\n";
+    capture++;
+    origin = Nanoseconds(std::chrono::steady_clock::now());
+    written = 0;
+    dropped = 0;
+    stopping = false;
+    flusher = std::thread(&Run);
+    status = "Tracing to " + path;
+    s_capturing = true;
+    return true;
+}
+
+/*! \brief Start capturing into the file FSD_TRACE names, if it is set.
+*/
+void Trace::StartFromEnvironment(){
+    const char* tracePath = std::getenv("FSD_TRACE");
+    if (tracePath && *tracePath){
+        Start(tracePath);
+    }
+}
+
+/*! \brief Stop capturing and finish the file. Events of scopes that are
+        still running are left out.
+*/
+void Trace::Stop(){
+    if (!IsCapturing()){
+        return;
+    }
+    s_capturing = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    flusher.join();
+    std::lock_guard<std::mutex> lock(mutex);
+    WriteEvents();
+    file << "\n]}\n";
+    file.close();
+    status = "Wrote " + std::to_string(written) + " events to " + path;
+    if (dropped > 0){
+        status += ", " + std::to_string(dropped) + " dropped";
+    }
+    std::cout << status << std::endl;
+}
+
+/*! \brief Get a message describing the capture, shown in the GUI.
+        Start() and Stop() write it, so call it on the thread that calls them.
+*/
+const std::string& Trace::GetStatus(){
+    return status;
+}
+
+/*! \brief Name the calling thread in the trace.
+    \param name a string that outlives the thread
+*/
+void Trace::NameThread(const char* name){
+    localName = name;
+    if (local){
+        local->name = name;
+    }
+}
+
+/*! \brief Record a scope of the calling thread. Dropped if the ring of the
+        thread is full, which only happens if the flushing thread can not
+        keep up.
+*/
+void Trace::Add(const char* name, std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::time_point end){
+    ThreadRing &ring = GetRing();
+    std::size_t head = ring.head.load(std::memory_order_relaxed);
+    if (head - ring.tail.load(std::memory_order_acquire) >= RING_EVENTS){
+        dropped++;
+        return;
+    }
+    TraceEvent &event = ring.events[head % RING_EVENTS];
+    event.name = name;
+    event.start = Nanoseconds(start);
+    event.duration = Nanoseconds(end) - event.start;
+    ring.head.store(head + 1, std::memory_order_release);
+}
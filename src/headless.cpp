@@ -0,0 +1,675 @@
+/**
+ *  @file   headless.cpp
+ *  @brief  Entry point of the headless replay and benchmark harness.
+ *  @author Team Avengers
+ *  @date   2020-12-09
+ ***********************************************/
+
+// Runs the app without any window and pushes a session through the same
+// commands, undo stack and compositing the GUI uses, as fast as it can.
+// The results are printed as JSON so runs can be compared over time.
+//
+// HOW TO RUN
+//
+// ./App_Headless --session recorded.journal      (from ./App --record)
+// ./App_Headless --scenario mixed --actions 100000 --seed 7
+// ./App_Headless --scenario strokes --width 4096 --height 4096 --layers 8
+// ./App_Headless --blend --codec --join --output results.json
+//
+// Scenarios are strokes, clears, undo, filters and mixed. --record FILE
+// journals a synthetic session while it runs, which also measures the cost
+// of the journal. --frame N composites the canvas every N actions like a
+// frame of the GUI does, 0 only at the end. --codec measures the stroke
+// encoding the network uses against one serialized Draw per sample. --join
+// measures how long a client joining a 4K canvas on a local server takes
+// until its viewport and then the whole canvas arrived.
+
+// Include our Third-Party SFML header
+#include <SFML/Graphics/Color.hpp>
+// Include standard library C++ libraries.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <zlib.h>
+// Project header files
+#include "App.hpp"
+#include "Blend.hpp"
+#include "ClearCanvas.hpp"
+#include "Draw.hpp"
+#include "Filter.hpp"
+#include "FilterCommand.hpp"
+#include "Journal.hpp"
+#include "LayerCommand.hpp"
+#include "Server.hpp"
+#include "StrokeCodec.hpp"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+// Latency samples in nanoseconds by kind of action
+typedef std::map<std::string, std::vector<double>> Samples;
+
+const sf::Color PALETTE[] = {sf::Color::Black, sf::Color::Red, sf::Color::Green, sf::Color::Blue,
+                             sf::Color::Yellow, sf::Color::Magenta, sf::Color::Cyan, sf::Color::White};
+// Kind of the samples taken by compositing a frame, kept out of "all"
+const char* const FRAME = "frame";
+
+struct Options{
+    std::string session;
+    std::string scenario;
+    std::string record;
+    std::string output;
+    unsigned width;
+    unsigned height;
+    unsigned layers;
+    unsigned actions;
+    unsigned seed;
+    unsigned frame;
+    bool blend;
+    bool codec;
+    bool join;
+};
+
+double Nanoseconds(Clock::time_point start, Clock::time_point end){
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+// Composites the canvas every few actions and times it, like the GUI
+// does once per frame.
+class Frames{
+public:
+    Frames(App &app, unsigned every, Samples &samples):
+        m_app(app), m_every(every), m_count(0), m_samples(samples){
+    }
+
+    void Action(){
+        if (m_every > 0 && ++m_count % m_every == 0){
+            Clock::time_point start = Clock::now();
+            m_app.UpdateTexture();
+            m_samples[FRAME].push_back(Nanoseconds(start, Clock::now()));
+        }
+    }
+
+private:
+    App &m_app;
+    unsigned m_every;
+    unsigned m_count;
+    Samples &m_samples;
+};
+
+// Generates a synthetic session from a seed. The same seed and options
+// always give the same session.
+class Synthetic{
+public:
+    Synthetic(App &app, const Options &options, Samples &samples):
+        m_app(app), m_options(options), m_samples(samples), m_frames(app, options.frame, samples),
+        m_rng(options.seed), m_actions(0){
+    }
+
+    bool Run(){
+        const std::string &scenario = m_options.scenario;
+        if (scenario != "strokes" && scenario != "clears" && scenario != "undo" &&
+            scenario != "filters" && scenario != "mixed"){
+            return false;
+        }
+        // Extra layers make every tile composite through the whole stack.
+        for (unsigned i = 1; i < m_options.layers; i++){
+            Execute(std::make_shared<LayerCommand>("add layer", LayerCommand::ADD, m_app));
+            unsigned id = m_app.GetLayers().GetActiveId();
+            m_app.SetLayerSettings(id, 200, true, static_cast<BlendMode>(i % BLEND_MODE_COUNT));
+        }
+        while (m_actions < m_options.actions){
+            if (scenario == "strokes"){
+                Stroke();
+            } else if (scenario == "clears"){
+                Clear();
+            } else if (scenario == "undo"){
+                Stroke(4);
+                UndoStorm();
+            } else if (scenario == "filters"){
+                Filter();
+            } else{
+                unsigned pick = Random(100);
+                if (pick < 70){
+                    Stroke();
+                } else if (pick < 75){
+                    Clear();
+                } else if (pick < 85){
+                    Filter();
+                } else if (pick < 95){
+                    UndoStorm();
+                } else{
+                    SwitchLayer();
+                }
+            }
+        }
+        return true;
+    }
+
+private:
+    App &m_app;
+    const Options &m_options;
+    Samples &m_samples;
+    Frames m_frames;
+    std::mt19937 m_rng;
+    unsigned m_actions;
+
+    // The distributions of <random> differ between libraries, so plain
+    // modulo keeps sessions the same everywhere.
+    unsigned Random(unsigned n){
+        return static_cast<unsigned>(m_rng() % n);
+    }
+
+    sf::IntRect RandomRect(){
+        int x = Random(m_options.width);
+        int y = Random(m_options.height);
+        return sf::IntRect(x, y, 1 + Random(m_options.width - x), 1 + Random(m_options.height - y));
+    }
+
+    // Time one action the way the GUI runs it
+    void Execute(const std::shared_ptr<Command> &command){
+        Clock::time_point start = Clock::now();
+        m_app.AddCommand(command);
+        m_app.ExecuteCommand();
+        Taken(GetCommandTypeName(command->GetType()), start);
+    }
+
+    void Taken(const char* kind, Clock::time_point start){
+        m_samples[kind].push_back(Nanoseconds(start, Clock::now()));
+        m_actions++;
+        m_frames.Action();
+    }
+
+    // A random walk of single pixel draws
+    void Stroke(unsigned maxPoints = 64){
+        sf::Color color = PALETTE[Random(sizeof(PALETTE) / sizeof(PALETTE[0]))];
+        int x = Random(m_options.width);
+        int y = Random(m_options.height);
+        int dx = static_cast<int>(Random(3)) - 1;
+        int dy = static_cast<int>(Random(3)) - 1;
+        for (unsigned points = 1 + Random(maxPoints); points > 0 && m_actions < m_options.actions; points--){
+            Execute(std::make_shared<Draw>("draw", sf::Vector2i(x, y), color, m_app));
+            if (Random(8) == 0){
+                dx = static_cast<int>(Random(3)) - 1;
+                dy = static_cast<int>(Random(3)) - 1;
+            }
+            x = std::max(0, std::min<int>(m_options.width - 1, x + dx));
+            y = std::max(0, std::min<int>(m_options.height - 1, y + dy));
+        }
+    }
+
+    // Clear the whole layer or a selected part of it
+    void Clear(){
+        if (Random(2) == 0){
+            m_app.GetSelection().SelectRect(RandomRect());
+        }
+        sf::Color color = PALETTE[Random(sizeof(PALETTE) / sizeof(PALETTE[0]))];
+        Execute(std::make_shared<ClearCanvas>("clear", color, m_app.GetBackgroundColor(), m_app));
+        m_app.GetSelection().Clear();
+    }
+
+    void Filter(){
+        m_app.GetSelection().SelectRect(RandomRect());
+        FilterType type = static_cast<FilterType>(Random(FILTER_COUNT));
+        Execute(std::make_shared<FilterCommand>(GetFilterName(type), type, m_app));
+        m_app.GetSelection().Clear();
+    }
+
+    // Undo a few actions and redo them again
+    void UndoStorm(){
+        unsigned count = 1 + Random(10);
+        for (unsigned i = 0; i < count && m_actions < m_options.actions; i++){
+            Clock::time_point start = Clock::now();
+            m_app.Undo();
+            Taken("undo", start);
+        }
+        for (unsigned i = 0; i < count && m_actions < m_options.actions; i++){
+            Clock::time_point start = Clock::now();
+            m_app.Redo();
+            Taken("redo", start);
+        }
+    }
+
+    void SwitchLayer(){
+        LayerStack &layers = m_app.GetLayers();
+        unsigned id = layers.GetLayer(Random(layers.GetLayerCount()))->GetId();
+        Clock::time_point start = Clock::now();
+        m_app.SetActiveLayer(id);
+        Taken("active layer", start);
+    }
+};
+
+// Times a recorded session record by record
+struct Replay{
+    Samples* samples;
+    Frames* frames;
+    Clock::time_point last;
+
+    static void Record(const char* kind, void* user){
+        Replay &replay = *static_cast<Replay*>(user);
+        (*replay.samples)[kind].push_back(Nanoseconds(replay.last, Clock::now()));
+        replay.frames->Action();
+        replay.last = Clock::now();
+    }
+};
+
+// Throughput of every blend kernel over a buffer bigger than the caches
+void BenchmarkBlend(std::ostream &out){
+    const std::size_t pixels = 1 << 20;
+    const unsigned passes = 16;
+    std::vector<sf::Uint8> src(pixels * 4);
+    std::vector<sf::Uint8> dst(pixels * 4);
+    for (std::size_t i = 0; i < pixels; i++){
+        sf::Uint8 alpha = static_cast<sf::Uint8>(i * 7);
+        for (int c = 0; c < 3; c++){
+            src[i * 4 + c] = static_cast<sf::Uint8>(std::min<unsigned>(alpha, (i * (c + 3)) & 0xFF));
+        }
+        src[i * 4 + 3] = alpha;
+    }
+    out << ",\n  \"blend\": [";
+    bool first = true;
+    for (int isa = 0; isa < BLEND_ISA_COUNT; isa++){
+        for (int mode = 0; mode < BLEND_MODE_COUNT; mode++){
+            BlendRowFunc row = GetBlendRow(static_cast<BlendMode>(mode), static_cast<BlendIsa>(isa));
+            if (!row){
+                continue;
+            }
+            std::fill(dst.begin(), dst.end(), 0x80);
+            Clock::time_point start = Clock::now();
+            for (unsigned pass = 0; pass < passes; pass++){
+                for (std::size_t p = 0; p < pixels; p += TILE_SIZE){
+                    row(&dst[p * 4], &src[p * 4], TILE_SIZE, 200);
+                }
+            }
+            double seconds = Nanoseconds(start, Clock::now()) / 1e9;
+            out << (first ? "\n" : ",\n") << "    {\"mode\": \"" << GetBlendModeName(static_cast<BlendMode>(mode))
+                << "\", \"isa\": \"" << GetBlendIsaName(static_cast<BlendIsa>(isa))
+                << "\", \"mpix_per_second\": " << pixels * passes / seconds / 1e6 << "}";
+            first = false;
+        }
+    }
+    out << "\n  ]";
+}
+
+// Size and speed of the stroke encoding, for random walk strokes as the
+// brush makes them
+void BenchmarkStrokeCodec(std::ostream &out){
+    const std::size_t strokes = 4096;
+    const std::size_t samples = 64;
+    const unsigned passes = 16;
+    std::mt19937 rng(1);
+    std::vector<sf::Vector2i> points(strokes * samples);
+    std::vector<sf::Uint8> coverage(strokes * samples, 255);
+    std::vector<StrokeHeader> headers(strokes);
+    for (std::size_t s = 0; s < strokes; s++){
+        headers[s].color = PALETTE[rng() % (sizeof(PALETTE) / sizeof(PALETTE[0]))];
+        headers[s].layer = 1 + rng() % 4;
+        headers[s].brushSize = 1;
+        sf::Vector2i at(rng() % 1920, rng() % 1080);
+        for (std::size_t i = 0; i < samples; i++){
+            points[s * samples + i] = at;
+            at.x += static_cast<int>(rng() % 3) - 1;
+            at.y += static_cast<int>(rng() % 3) - 1;
+        }
+    }
+    std::vector<std::uint8_t> encoded(strokes * GetMaxStrokeSize(samples));
+    std::vector<std::size_t> sizes(strokes);
+    Clock::time_point start = Clock::now();
+    for (unsigned pass = 0; pass < passes; pass++){
+        std::uint8_t* at = &encoded[0];
+        for (std::size_t s = 0; s < strokes; s++){
+            sizes[s] = EncodeStroke(headers[s], &points[s * samples], &coverage[s * samples], samples,
+                                    at, GetMaxStrokeSize(samples));
+            at += sizes[s];
+        }
+    }
+    double encode = Nanoseconds(start, Clock::now()) / (passes * strokes * samples);
+    std::vector<sf::Vector2i> decodedPoints(samples);
+    std::vector<sf::Uint8> decodedCoverage(samples);
+    bool same = true;
+    start = Clock::now();
+    for (unsigned pass = 0; pass < passes; pass++){
+        const std::uint8_t* at = &encoded[0];
+        for (std::size_t s = 0; s < strokes; s++){
+            StrokeHeader header;
+            std::size_t count = 0;
+            at += DecodeStroke(at, sizes[s], header, &decodedPoints[0], &decodedCoverage[0], samples, count);
+            same = same && count == samples && decodedPoints.back() == points[s * samples + samples - 1];
+        }
+    }
+    double decode = Nanoseconds(start, Clock::now()) / (passes * strokes * samples);
+    std::size_t bytes = 0;
+    for (std::size_t s = 0; s < strokes; s++){
+        bytes += sizes[s];
+    }
+    // The same samples as serialized Draw commands, the way the journal writes them
+    App app;
+    app.InitHeadless(1920, 1080);
+    ByteWriter legacy;
+    for (std::size_t i = 0; i < points.size(); i++){
+        WriteCommand(*Draw::Create(points[i], headers[i / samples].color, headers[i / samples].layer, 255, app), legacy);
+    }
+    app.Destroy();
+    out << ",\n  \"stroke_codec\": {\"version\": " << static_cast<unsigned>(STROKE_VERSION)
+        << ", \"samples_per_stroke\": " << samples
+        << ", \"bytes_per_sample\": " << static_cast<double>(bytes) / (strokes * samples)
+        << ", \"draw_bytes_per_sample\": " << static_cast<double>(legacy.GetSize()) / (strokes * samples)
+        << ", \"encode_ns_per_sample\": " << encode
+        << ", \"decode_ns_per_sample\": " << decode
+        << ", \"round_trip\": " << (same ? "true" : "false") << "}";
+}
+
+double Percentile(std::vector<double> &values, double p){
+    std::size_t index = static_cast<std::size_t>(p * (values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+void WriteLatency(std::ostream &out, const std::string &kind, std::vector<double> values){
+    double sum = 0;
+    for (std::size_t i = 0; i < values.size(); i++){
+        sum += values[i];
+    }
+    out << "    \"" << kind << "\": {\"count\": " << values.size()
+        << ", \"mean\": " << sum / values.size()
+        << ", \"p50\": " << Percentile(values, 0.50)
+        << ", \"p99\": " << Percentile(values, 0.99)
+        << ", \"max\": " << *std::max_element(values.begin(), values.end()) << "}";
+}
+
+// Checksum of the composited canvas, to tell if a change altered the result
+unsigned long CanvasCrc(App &app){
+    const TiledImage &flattened = app.GetLayers().Flatten();
+    static const std::vector<sf::Uint8> transparent(TILE_BYTES, 0);
+    uLong crc = crc32(0L, Z_NULL, 0);
+    for (unsigned tile = 0; tile < flattened.GetTileCount(); tile++){
+        const sf::Uint8* pixels = flattened.GetTile(tile);
+        crc = crc32(crc, pixels ? pixels : &transparent[0], TILE_BYTES);
+    }
+    return crc;
+}
+
+// Poll both clients until 'done' holds or a few seconds passed
+template<typename Done>
+bool PollUntil(App &a, App &b, Done done){
+    Clock::time_point start = Clock::now();
+    while (!done()){
+        if (Nanoseconds(start, Clock::now()) > 10e9){
+            return false;
+        }
+        a.GetNetwork().Poll(a);
+        b.GetNetwork().Poll(b);
+        a.UpdateTexture();
+        b.UpdateTexture();
+    }
+    return true;
+}
+
+// Time for a client to get a 4K canvas from a local server, once with a
+// blank canvas and once with the copy it had before. Another client keeps
+// drawing all along, so live batches are interleaved with the snapshot.
+void BenchmarkJoin(std::ostream &out){
+    const int width = 3840;
+    const int height = 2160;
+    std::streambuf* console = std::cout.rdbuf(nullptr);
+    Server server(width, height);
+    server.Listen(0);
+    std::thread thread(&Server::Run, &server);
+    std::string address = "localhost:" + std::to_string(server.GetPort());
+    App painter;
+    App joiner;
+    painter.InitHeadless(width, height);
+    joiner.InitHeadless(width, height);
+    joiner.GetNetwork().SetViewport(sf::IntRect(0, 0, 1280, 720));
+    painter.GetNetwork().Connect(address);
+    bool ok = PollUntil(painter, joiner, [&]{ return painter.GetNetwork().IsCanvasLoaded(); });
+    // Random walk strokes over the whole canvas, sent a frame at a time
+    std::mt19937 rng(1);
+    auto paint = [&](unsigned strokes){
+        for (unsigned s = 0; s < strokes; s++){
+            sf::Color color = PALETTE[rng() % (sizeof(PALETTE) / sizeof(PALETTE[0]))];
+            sf::Vector2i at(rng() % width, rng() % height);
+            for (unsigned i = 0; i < 256; i++){
+                painter.RunCommand(std::make_shared<Draw>("draw", at, color, painter));
+                at.x += static_cast<int>(rng() % 5) - 2;
+                at.y += static_cast<int>(rng() % 5) - 2;
+            }
+        }
+        painter.GetNetwork().Poll(painter);
+    };
+    for (unsigned frame = 0; frame < 200; frame++){
+        paint(10);
+    }
+    double join[2] = {0, 0};
+    double viewport[2] = {0, 0};
+    for (unsigned run = 0; run < 2 && ok; run++){
+        // The second time the joiner still has the canvas from the first
+        joiner.GetNetwork().Disconnect();
+        Clock::time_point start = Clock::now();
+        joiner.GetNetwork().Connect(address);
+        ok = PollUntil(painter, joiner, [&]{
+            if (viewport[run] == 0 && joiner.GetNetwork().IsViewportLoaded()){
+                viewport[run] = Nanoseconds(start, Clock::now()) / 1e6;
+            }
+            if (!joiner.GetNetwork().IsCanvasLoaded()){
+                paint(1);
+                return false;
+            }
+            return true;
+        });
+        join[run] = Nanoseconds(start, Clock::now()) / 1e6;
+    }
+    // Let the last batches arrive, then both canvases have to be the same
+    Clock::time_point settle = Clock::now();
+    PollUntil(painter, joiner, [&]{ return Nanoseconds(settle, Clock::now()) > 200e6; });
+    bool same = ok && CanvasCrc(painter) == CanvasCrc(joiner);
+    server.Stop();
+    thread.join();
+    painter.Destroy();
+    joiner.Destroy();
+    std::cout.rdbuf(console);
+    out << ",\n  \"late_join\": {\"width\": " << width << ", \"height\": " << height
+        << ", \"viewport_ms\": " << viewport[0] << ", \"canvas_ms\": " << join[0]
+        << ", \"cached_viewport_ms\": " << viewport[1] << ", \"cached_canvas_ms\": " << join[1]
+        << ", \"converged\": " << (same ? "true" : "false") << "}";
+}
+
+long PeakMemoryKb(){
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    // Linux reports kilobytes, macOS bytes
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+std::string Quote(const std::string &text){
+    std::string quoted = "\"";
+    for (std::size_t i = 0; i < text.size(); i++){
+        if (text[i] == '"' || text[i] == '\\'){
+            quoted += '\\';
+        }
+        quoted += text[i];
+    }
+    return quoted + "\"";
+}
+
+bool ParseOptions(int argc, char** argv, Options &options){
+    options.width = 600;
+    options.height = 400;
+    options.layers = 1;
+    options.actions = 100000;
+    options.seed = 1;
+    options.frame = 16;
+    options.blend = false;
+    options.codec = false;
+    options.join = false;
+    for (int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg == "--blend"){
+            options.blend = true;
+            continue;
+        }
+        if (arg == "--codec"){
+            options.codec = true;
+            continue;
+        }
+        if (arg == "--join"){
+            options.join = true;
+            continue;
+        }
+        if (!value){
+            return false;
+        }
+        i++;
+        if (arg == "--session"){
+            options.session = value;
+        } else if (arg == "--scenario"){
+            options.scenario = value;
+        } else if (arg == "--record"){
+            options.record = value;
+        } else if (arg == "--output"){
+            options.output = value;
+        } else if (arg == "--width"){
+            options.width = std::max(1, std::atoi(value));
+        } else if (arg == "--height"){
+            options.height = std::max(1, std::atoi(value));
+        } else if (arg == "--layers"){
+            options.layers = std::max(1, std::atoi(value));
+        } else if (arg == "--actions"){
+            options.actions = std::atoi(value);
+        } else if (arg == "--seed"){
+            options.seed = std::atoi(value);
+        } else if (arg == "--frame"){
+            options.frame = std::atoi(value);
+        } else{
+            return false;
+        }
+    }
+    if (options.session.empty() && options.scenario.empty() && !options.blend && !options.codec && !options.join){
+        options.scenario = "mixed";
+    }
+    return options.session.empty() || options.scenario.empty();
+}
+
+}
+
+
+/*! \brief 	The entry point of the harness.
+*		Exits with 1 on bad arguments or a session that cannot be read.
+*
+*/
+int main(int argc, char** argv){
+    Options options;
+    if (!ParseOptions(argc, argv, options)){
+        std::cerr << "usage: " << argv[0] << " [--session FILE | --scenario strokes|clears|undo|filters|mixed]"
+                  << " [--actions N] [--seed N] [--width N] [--height N] [--layers N] [--frame N]"
+                  << " [--record FILE] [--blend] [--codec] [--join] [--output FILE]" << std::endl;
+        return 1;
+    }
+    std::ostringstream out;
+    out << "{\n  \"harness\": \"fsd-headless\"";
+    if (!options.session.empty() || !options.scenario.empty()){
+        App* app = new App;
+        if (!options.record.empty() && options.session.empty()){
+            app->RecordSession(options.record);
+        }
+        app->InitHeadless(options.width, options.height);
+        // Undo and redo print a line each, which would drown the report.
+        std::streambuf* console = std::cout.rdbuf(nullptr);
+        Samples samples;
+        Frames frames(*app, options.frame, samples);
+        bool ok;
+        unsigned actions = 0;
+        Clock::time_point start = Clock::now();
+        if (!options.session.empty()){
+            Replay replay = {&samples, &frames, Clock::now()};
+            ok = Journal::Replay(options.session, *app, &actions, &Replay::Record, &replay) > 0;
+        } else{
+            Synthetic synthetic(*app, options, samples);
+            ok = synthetic.Run();
+            actions = options.actions;
+        }
+        // The last frame is part of the work
+        Clock::time_point flatten = Clock::now();
+        app->UpdateTexture();
+        samples[FRAME].push_back(Nanoseconds(flatten, Clock::now()));
+        double seconds = Nanoseconds(start, Clock::now()) / 1e9;
+        std::cout.rdbuf(console);
+        if (!ok){
+            std::cerr << "Could not run " << (options.session.empty() ? options.scenario : options.session) << std::endl;
+            app->Destroy();
+            delete app;
+            return 1;
+        }
+        if (options.session.empty()){
+            out << ",\n  \"scenario\": " << Quote(options.scenario) << ",\n  \"seed\": " << options.seed
+                << ",\n  \"journal\": " << (options.record.empty() ? "false" : "true");
+        } else{
+            out << ",\n  \"session\": " << Quote(options.session);
+        }
+        out << ",\n  \"width\": " << options.width << ",\n  \"height\": " << options.height
+            << ",\n  \"layers\": " << app->GetLayers().GetLayerCount()
+            << ",\n  \"actions\": " << actions
+            << ",\n  \"seconds\": " << seconds
+            << ",\n  \"actions_per_second\": " << actions / seconds;
+        // Every action together, then each kind on its own
+        std::vector<double> all;
+        for (Samples::const_iterator it = samples.begin(); it != samples.end(); ++it){
+            if (it->first != FRAME){
+                all.insert(all.end(), it->second.begin(), it->second.end());
+            }
+        }
+        out << ",\n  \"latency_ns\": {\n";
+        if (!all.empty()){
+            WriteLatency(out, "all", all);
+            out << ",\n";
+        }
+        for (Samples::const_iterator it = samples.begin(); it != samples.end(); ++it){
+            WriteLatency(out, it->first, it->second);
+            out << (std::next(it) == samples.end() ? "\n" : ",\n");
+        }
+        char crc[16];
+        std::snprintf(crc, sizeof(crc), "%08lx", CanvasCrc(*app));
+        out << "  },\n  \"canvas_crc32\": \"" << crc << "\"";
+        app->Destroy();
+        delete app;
+    }
+    if (options.blend){
+        BenchmarkBlend(out);
+    }
+    if (options.codec){
+        BenchmarkStrokeCodec(out);
+    }
+    if (options.join){
+        BenchmarkJoin(out);
+    }
+    // Taken last, so it covers everything the run allocated
+    out << ",\n  \"peak_rss_kb\": " << PeakMemoryKb() << "\n}\n";
+    if (options.output.empty()){
+        std::cout << out.str();
+    } else{
+        std::ofstream file(options.output.c_str());
+        file << out.str();
+        if (!file){
+            std::cerr << "Could not write " << options.output << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
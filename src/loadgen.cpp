@@ -0,0 +1,342 @@
+/**
+ *  @file   loadgen.cpp
+ *  @brief  Entry point of the load generator for the collaboration server.
+ *  @author Team Avengers
+ *  @date   2020-12-13
+ ***********************************************/
+
+// Simulates many clients painting at once and measures what it costs the
+// server. Every client sends a short stroke a number of times per second,
+// and every client in the same room receives it. The time from sending a
+// stroke until each of the others has it is the fan-out latency. The
+// results are printed as JSON like the ones of App_Headless.
+//
+// HOW TO RUN
+//
+// ./App_LoadGen --clients 200 --rooms 10 --seconds 10 --rate 30
+// ./App_LoadGen --server localhost:7777 --clients 50 --output load.json
+//
+// Without --server a server runs in this process, with --threads workers,
+// and its CPU time per received message is reported too. The clients do not
+// keep a canvas, they say they have no layers so no snapshot is sent.
+// --output writes the results to a file, apart from the log of the server.
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sys/epoll.h>
+// Project header files
+#include "ByteStream.hpp"
+#include "Network.hpp"
+#include "Server.hpp"
+#include "StrokeCodec.hpp"
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Samples in every stroke a client sends
+const std::size_t STROKE_SAMPLES = 32;
+// Id of the first layer of the server's canvas
+const unsigned FIRST_LAYER = 1;
+// Sent strokes remembered per client, to look up their send time
+const std::uint32_t SENT_WINDOW = 1 << 12;
+
+struct Options{
+    unsigned clients = 20;
+    unsigned rooms = 1;
+    double seconds = 5;
+    double rate = 30;
+    unsigned threads = 0;
+    unsigned width = 1920;
+    unsigned height = 1080;
+    std::string server;
+    std::string output;
+};
+
+// One simulated client.
+struct Painter{
+    Connection connection;
+    std::string room;
+    unsigned id = 0;
+    bool done = false;
+    // Strokes sent so far and when each of the last SENT_WINDOW went out
+    std::uint32_t sent = 0;
+    std::vector<Clock::time_point> sentAt;
+    Clock::time_point next;
+    int x = 0;
+    int y = 0;
+};
+
+/*! \brief Parse the options, unknown ones are ignored.
+*/
+Options ParseOptions(int argc, char** argv){
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2){
+        std::string arg = argv[i];
+        std::string value = argv[i + 1];
+        if (arg == "--clients"){
+            options.clients = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--rooms"){
+            options.rooms = std::max(1, std::atoi(value.c_str()));
+        } else if (arg == "--seconds"){
+            options.seconds = std::atof(value.c_str());
+        } else if (arg == "--rate"){
+            options.rate = std::max(0.1, std::atof(value.c_str()));
+        } else if (arg == "--threads"){
+            options.threads = std::atoi(value.c_str());
+        } else if (arg == "--width"){
+            options.width = std::atoi(value.c_str());
+        } else if (arg == "--height"){
+            options.height = std::atoi(value.c_str());
+        } else if (arg == "--server"){
+            options.server = value;
+        } else if (arg == "--output"){
+            options.output = value;
+        }
+    }
+    return options;
+}
+
+/*! \brief Send the hello of a client without any layers.
+*/
+void SendHello(Painter &painter, ByteWriter &message){
+    message.Clear();
+    message.PutVarint(PROTOCOL_VERSION);
+    message.PutString(painter.room);
+    message.PutSigned(0);
+    message.PutSigned(0);
+    message.PutVarint(0);
+    message.PutVarint(0);
+    message.PutVarint(0);
+    painter.connection.Send(MESSAGE_HELLO, message.GetData(), message.GetSize());
+}
+
+/*! \brief Send a stroke whose color is its number, so receivers can tell
+        when it was sent.
+*/
+void SendStroke(Painter &painter, const Options &options, ByteWriter &message, std::vector<std::uint8_t> &encoded,
+                std::vector<sf::Vector2i> &points){
+    std::uint32_t number = painter.sent++;
+    StrokeHeader header;
+    header.color = sf::Color(number & 0xFF, (number >> 8) & 0xFF, (number >> 16) & 0xFF, number >> 24);
+    header.layer = FIRST_LAYER;
+    header.brushSize = 1;
+    for (std::size_t i = 0; i < STROKE_SAMPLES; i++){
+        painter.x = (painter.x + 1) % options.width;
+        painter.y = (painter.y + (i % 3 == 0 ? 1 : 0)) % options.height;
+        points[i] = sf::Vector2i(painter.x, painter.y);
+    }
+    std::size_t size = EncodeStroke(header, &points[0], nullptr, STROKE_SAMPLES, &encoded[0], encoded.size());
+    message.Clear();
+    message.PutVarint(1);
+    message.PutU8(1);   // a stroke entry of CommandBatchWriter
+    message.PutBytes(&encoded[0], size);
+    painter.sentAt[number % SENT_WINDOW] = Clock::now();
+    painter.connection.Send(MESSAGE_COMMANDS, message.GetData(), message.GetSize());
+}
+
+/*! \brief Get a percentile of sorted samples.
+*/
+double Percentile(const std::vector<double> &sorted, double fraction){
+    if (sorted.empty()){
+        return 0;
+    }
+    std::size_t index = static_cast<std::size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+}
+
+
+/*! \brief 	The entry point of the load generator.
+*
+*/
+int main(int argc, char** argv){
+    Options options = ParseOptions(argc, argv);
+    std::string host = "localhost";
+    unsigned short port = 0;
+    std::unique_ptr<Server> server;
+    std::thread serverThread;
+    if (options.server.empty()){
+        server.reset(new Server(options.width, options.height, options.threads));
+        if (!server->Listen(0)){
+            std::cerr << "Could not start a server" << std::endl;
+            return 1;
+        }
+        port = server->GetPort();
+        serverThread = std::thread(&Server::Run, server.get());
+    } else{
+        host = options.server;
+        port = DEFAULT_PORT;
+        std::size_t colon = host.rfind(':');
+        if (colon != std::string::npos){
+            port = static_cast<unsigned short>(std::atoi(host.c_str() + colon + 1));
+            host.erase(colon);
+        }
+    }
+
+    int epoll = epoll_create1(EPOLL_CLOEXEC);
+    ByteWriter message;
+    std::vector<std::unique_ptr<Painter>> painters;
+    for (unsigned i = 0; i < options.clients; i++){
+        std::unique_ptr<Painter> painter(new Painter);
+        painter->room = "load" + std::to_string(i % options.rooms);
+        painter->sentAt.resize(SENT_WINDOW);
+        painter->y = static_cast<int>(i * 7 % options.height);
+        if (!painter->connection.Connect(host, port)){
+            std::cerr << "Could not connect to " << host << ":" << port << std::endl;
+            return 1;
+        }
+        SendHello(*painter, message);
+        struct epoll_event event;
+        event.events = EPOLLIN;
+        event.data.ptr = painter.get();
+        epoll_ctl(epoll, EPOLL_CTL_ADD, painter->connection.GetFd(), &event);
+        painters.push_back(std::move(painter));
+    }
+
+    // Clients start at random points of their first period, so the strokes
+    // of a room do not all go out at once
+    Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1 / options.rate));
+    Clock::time_point start = Clock::now();
+    for (std::size_t i = 0; i < painters.size(); i++){
+        painters[i]->next = start + period * (i * 7919 % painters.size()) / painters.size();
+    }
+    Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.seconds));
+    ServerStats before = server ? server->GetStats() : ServerStats();
+
+    std::unordered_map<unsigned, Painter*> byId;
+    std::vector<double> latencies;
+    std::vector<std::uint8_t> encoded(GetMaxStrokeSize(STROKE_SAMPLES));
+    std::vector<sf::Vector2i> points(STROKE_SAMPLES);
+    std::vector<sf::Vector2i> decodedPoints(MAX_STROKE_SAMPLES);
+    std::vector<sf::Uint8> decodedCoverage(MAX_STROKE_SAMPLES);
+    std::uint64_t sent = 0;
+    std::uint64_t received = 0;
+    unsigned lost = 0;
+    struct epoll_event events[256];
+    // Clients keep receiving for a moment after the last stroke went out
+    Clock::time_point drain = end + std::chrono::milliseconds(500);
+    while (Clock::now() < drain){
+        Clock::time_point now = Clock::now();
+        Clock::time_point wake = drain;
+        for (std::size_t i = 0; i < painters.size(); i++){
+            Painter &painter = *painters[i];
+            if (painter.done){
+                continue;
+            }
+            while (painter.id != 0 && painter.next <= now && now < end){
+                SendStroke(painter, options, message, encoded, points);
+                painter.next += period;
+                sent++;
+            }
+            if (now < end){
+                wake = std::min(wake, painter.next);
+            }
+            if (!painter.connection.Flush()){
+                painter.done = true;
+                lost++;
+            }
+        }
+        int timeout = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(wake - now).count());
+        int count = epoll_wait(epoll, events, 256, std::max(timeout, 0));
+        for (int e = 0; e < count; e++){
+            Painter &painter = *static_cast<Painter*>(events[e].data.ptr);
+            if (painter.done){
+                continue;
+            }
+            if (!painter.connection.Receive()){
+                painter.done = true;
+                lost++;
+            }
+            Clock::time_point arrived = Clock::now();
+            std::uint8_t type;
+            const std::uint8_t* payload;
+            std::size_t size;
+            while (painter.connection.NextMessage(type, payload, size)){
+                ByteReader in(payload, size);
+                if (type == MESSAGE_WELCOME){
+                    painter.id = static_cast<unsigned>(in.GetVarint());
+                    byId[painter.id] = &painter;
+                } else if (type == MESSAGE_SNAPSHOT && in.GetVarint() == SNAPSHOT_DONE){
+                    std::uint64_t done = in.GetVarint();
+                    message.Clear();
+                    message.PutVarint(SNAPSHOT_DONE);
+                    message.PutVarint(done);
+                    painter.connection.Send(MESSAGE_SNAPSHOT, message.GetData(), message.GetSize());
+                } else if (type == MESSAGE_COMMANDS){
+                    // User id, one entry and its tag, then the stroke
+                    unsigned sender = static_cast<unsigned>(in.GetVarint());
+                    in.GetVarint();
+                    in.GetU8();
+                    StrokeHeader header;
+                    std::size_t samples = 0;
+                    std::size_t left = in.GetRemaining();
+                    std::unordered_map<unsigned, Painter*>::const_iterator from = byId.find(sender);
+                    if (from == byId.end() || !in.Ok() ||
+                        !DecodeStroke(payload + size - left, left, header,
+                                      &decodedPoints[0], &decodedCoverage[0], MAX_STROKE_SAMPLES, samples)){
+                        continue;
+                    }
+                    std::uint32_t number = header.color.r | header.color.g << 8 | header.color.b << 16 |
+                                           static_cast<std::uint32_t>(header.color.a) << 24;
+                    if (from->second->sent - number <= SENT_WINDOW){
+                        latencies.push_back(std::chrono::duration<double, std::milli>(
+                            arrived - from->second->sentAt[number % SENT_WINDOW]).count());
+                    }
+                    received++;
+                }
+            }
+        }
+    }
+    double elapsed = std::chrono::duration<double>(end - start).count();
+
+    ServerStats after = server ? server->GetStats() : ServerStats();
+    std::sort(latencies.begin(), latencies.end());
+    std::ostringstream out;
+    out << "{\n  \"load\": {\"clients\": " << options.clients << ", \"rooms\": " << options.rooms
+        << ", \"seconds\": " << elapsed << ", \"rate\": " << options.rate
+        << ", \"strokes_sent\": " << sent << ", \"strokes_received\": " << received
+        << ", \"clients_lost\": " << lost
+        << ", \"fanout_ms_p50\": " << Percentile(latencies, 0.5)
+        << ", \"fanout_ms_p99\": " << Percentile(latencies, 0.99)
+        << ", \"fanout_ms_max\": " << (latencies.empty() ? 0 : latencies.back()) << "}";
+    if (server){
+        std::uint64_t messages = after.messages - before.messages;
+        double cpu = after.cpuSeconds - before.cpuSeconds;
+        out << ",\n  \"server\": {\"threads\": " << options.threads << ", \"messages\": " << messages
+            << ", \"mb_sent\": " << (after.bytesSent - before.bytesSent) / 1e6
+            << ", \"cpu_seconds\": " << cpu
+            << ", \"cpu_us_per_message\": " << (messages ? cpu * 1e6 / messages : 0)
+            << ", \"catch_ups\": " << after.catchUps - before.catchUps << "}";
+    }
+    out << "\n}\n";
+    if (options.output.empty()){
+        std::cout << out.str();
+    } else{
+        std::ofstream file(options.output.c_str());
+        file << out.str();
+        if (!file){
+            std::cerr << "Could not write " << options.output << std::endl;
+        }
+    }
+
+    painters.clear();
+    if (server){
+        server->Stop();
+        serverThread.join();
+    }
+    return 0;
+}
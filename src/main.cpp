@@ -12,7 +12,8 @@
 //
 // HOW TO RUN
 //
-// ./App
+// ./App [images...] [--record session.journal]
+// ./App --batch --filters grayscale,sharpen --out DIR images...
 
 // Include our Third-Party SFML header
 #include <SFML/Graphics.hpp>
@@ -20,15 +21,22 @@
 #include <SFML/Graphics/Texture.hpp>
 #include <SFML/Graphics/Sprite.hpp>
 // Include standard library C++ libraries.
+#include <chrono>
 #include <iostream>
 #include <string>
+#include <vector>
 // Project header files
 #include "App.hpp"
+#include "Batch.hpp"
 #include "Command.hpp"
 #include "Draw.hpp"
 #include "ClearCanvas.hpp"
 #include <memory>
 #include "GUI.hpp"
+#include "Latency.hpp"
+#include "Memory.hpp"
+#include "Profiler.hpp"
+#include "Trace.hpp"
 
 // Preset color index needed to link app and gui together
 static int preset = 1;
@@ -45,6 +53,46 @@ void initialization(void){
 }
 
 
+/*! \brief 	Drag out a selection with one of the selection tools.
+*		The selection follows the mouse while the button is held,
+*		so it doubles as the preview of the shape.
+*
+*/
+void selectTool(App* app, bool pressed){
+	static bool dragging = false;
+	static sf::Vector2i start;
+	static std::vector<sf::Vector2i> lasso;
+	sf::Vector2i coordinate = sf::Mouse::getPosition(app->GetWindow());
+	if(!pressed){
+		dragging = false;
+		return;
+	}
+	if(!dragging){
+		dragging = true;
+		start = coordinate;
+		lasso.clear();
+	}
+	SelectionMask &selection = app->GetSelection();
+	sf::IntRect rect(start.x, start.y, coordinate.x - start.x, coordinate.y - start.y);
+	switch(app->GetTool()){
+		case TOOL_SELECT_RECT:
+			selection.SelectRect(rect);
+			break;
+		case TOOL_SELECT_ELLIPSE:
+			selection.SelectEllipse(rect);
+			break;
+		case TOOL_SELECT_LASSO:
+			if(lasso.empty() || lasso.back() != coordinate){
+				lasso.push_back(coordinate);
+				selection.SelectLasso(lasso);
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+
 /*! \brief 	The update function presented can be simplified.
 *		I have demonstrated two ways you can handle events,
 *		if for example we want to add in an event loop.
@@ -54,6 +102,8 @@ void update(App* &&app){
 	// Handle key presses
 	sf::Event event;
 	while(app->GetWindow().pollEvent(event)){
+        // What the event does is timed from here until it is shown
+        app->SetInputTime(InputClock::now());
         if (event.type == sf::Event::KeyPressed){
             sf::Keyboard::Key code = event.key.code;
             switch(code){
@@ -109,21 +159,36 @@ void update(App* &&app){
         }
 	}
 
-	// We can otherwise handle events normally
-	if(sf::Mouse::isButtonPressed(sf::Mouse::Left)){
-		sf::Vector2i coordinate = sf::Mouse::getPosition(app->GetWindow());
-		// Add command to queue if it is unique
-		std::shared_ptr<Command> command = std::make_shared<Draw>("draw", coordinate,
-                app->GetCurrentColor(), app->GetBackgroundColor(), *app);
+	// The other users see where we point while the mouse is on the canvas
+	sf::Vector2i mouse = sf::Mouse::getPosition(app->GetWindow());
+	sf::Vector2u size = app->GetWindow().getSize();
+	app->GetNetwork().SetCursor(mouse, app->GetWindow().hasFocus() && mouse.x >= 0 && mouse.y >= 0 &&
+		mouse.x < static_cast<int>(size.x) && mouse.y < static_cast<int>(size.y));
 
-        app->AddCommand(command);
-        app->ExecuteCommand();
+	// We can otherwise handle events normally
+	app->SetInputTime(InputClock::now());
+	bool pressed = sf::Mouse::isButtonPressed(sf::Mouse::Left);
+	if(app->GetTool() == TOOL_BRUSH){
+		if(pressed){
+			sf::Vector2i coordinate = sf::Mouse::getPosition(app->GetWindow());
+			// Add command to queue if it is unique
+			std::shared_ptr<Command> command = MakePooled<Draw>("draw", coordinate,
+                    app->GetCurrentColor(), *app);
 
+            app->AddCommand(command);
+            app->ExecuteCommand();
+		}
+	}
+	else{
+		selectTool(app, pressed);
 	}
+	app->SetInputTime(InputClock::time_point());
 
 	// Capture any keys that are released
+	// Closing the window ends the main loop, so the app is torn down
+	// normally and the journal knows the exit was clean.
 	if(sf::Keyboard::isKeyPressed(sf::Keyboard::Escape)){
-		exit(EXIT_SUCCESS);
+		app->GetWindow().close();
 	}
 
 }
@@ -133,32 +198,53 @@ void update(App* &&app){
 *
 */
 void draw(App *&&app){
-	// Static variable
-	static int refreshRate = 0;
-	++refreshRate;	// Increment
-
-
-	// We load into our texture the modified pixels
-	// But we only do so every 10 draw calls to reduce latency of transfer
-	// between the GPU and CPU.
-	// Ask yourself: Could we do better with sf::Clock and refresh once
-	// 	 	 every 'x' frames?
-	if(refreshRate > 10){
-		app->GetTexture().loadFromImage(app->GetImage());
-		refreshRate = 0;
-	}
+	// We load into our texture the modified pixels.
+	// Only the tiles that changed since the last frame are composited
+	// and sent to the GPU, so this is cheap enough to do every frame.
+	app->UpdateTexture();
 }
 
 
 /*! \brief 	The entry point into our program.
+*		Any image files given on the command line are opened
+*		as layers, all of them loading at the same time.
+*		--record FILE keeps the journal of the session in FILE,
+*		to be replayed by App_Headless. --batch filters files
+*		without opening any window, see Batch.hpp.
 *
 */
-int main(){
+int main(int argc, char** argv){
+	// Startup is timed up to the first frame on screen
+	std::chrono::steady_clock::time_point launch = std::chrono::steady_clock::now();
 	// Call any setup function
 	// Passing a function pointer into the 'init' function.
 	// of our application.
 
+	// FSD_TRACE=file captures a trace of the whole run
+	Trace::NameThread("Main");
+	Trace::StartFromEnvironment();
+	// Scripts run the filters without a display, so check before any
+	// window is created.
+	for (int i = 1; i < argc; i++){
+		if (std::string(argv[i]) == "--batch"){
+			int code = BatchProcessor::Main(argc, argv);
+			Trace::Stop();
+			return code;
+		}
+	}
 	App *app = new App;
+	std::vector<std::string> images;
+	for (int i = 1; i < argc; i++){
+		std::string arg = argv[i];
+		if (arg == "--record" && i + 1 < argc){
+			app->RecordSession(argv[++i]);
+		} else{
+			images.push_back(arg);
+		}
+	}
+	// The canvas is allocated on a worker while the windows are created
+	// and the font is loaded
+	app->AllocateCanvas();
     GUI *gui = new GUI(app);
     
 	app->Init(&initialization);
@@ -166,18 +252,32 @@ int main(){
 	app->UpdateCallback(&update);
 	// Setup the Draw Function
 	app->DrawCallback(&draw);
+	for (std::size_t i = 0; i < images.size(); i++){
+		app->Import(images[i]);
+	}
 	// Call the main loop function
+	bool firstFrame = true;
     while (app->GetWindow().isOpen() && gui->getWindow()->isOpen()) {
-        app->Loop();
-        gui->setPresetIndex(preset);
-        gui->loop();
-        preset = gui->getPreset();
+        {
+            ProfileScope profile(PROFILE_FRAME);
+            app->Loop();
+            gui->setPresetIndex(preset);
+            gui->loop();
+            preset = gui->getPreset();
+        }
+        Profiler::EndFrame();
+        if (firstFrame){
+            long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - launch).count();
+            std::cout << "First frame " << ms << " ms after start" << std::endl;
+            firstFrame = false;
+        }
     }
 
 	// Destroy our app
 	app->Destroy();
 
 	delete app;
+	Trace::Stop();
 
 	return 0;
 }
@@ -0,0 +1,74 @@
+/**
+ *  @file   server_main.cpp
+ *  @brief  Entry point of the collaboration server.
+ *  @author Team Avengers
+ *  @date   2020-12-11
+ ***********************************************/
+
+// HOW TO RUN
+//
+// ./App_Server [--port 7777] [--width 600] [--height 400] [--threads N]
+//
+// Then press the Connection button of each App and enter the address of
+// the server, localhost:7777 when it runs on the same machine, or
+// localhost:7777/name to draw in a room of its own. The canvas size has
+// to match the one of the apps. --threads sets the number of workers the
+// rooms are spread over, by default one per core up to 4.
+
+// Include our Third-Party SFML header
+// #include ...
+// Include standard library C++ libraries.
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+// Project header files
+#include "Network.hpp"
+#include "Server.hpp"
+
+namespace {
+
+Server* g_server = nullptr;
+
+void StopServer(int){
+    if (g_server){
+        g_server->Stop();
+    }
+}
+
+}
+
+
+/*! \brief 	The entry point of the server. Runs until interrupted.
+*
+*/
+int main(int argc, char** argv){
+    unsigned short port = DEFAULT_PORT;
+    unsigned width = 600;
+    unsigned height = 400;
+    unsigned threads = 0;
+    for (int i = 1; i + 1 < argc; i += 2){
+        std::string arg = argv[i];
+        if (arg == "--port"){
+            port = static_cast<unsigned short>(std::atoi(argv[i + 1]));
+        } else if (arg == "--width"){
+            width = std::atoi(argv[i + 1]);
+        } else if (arg == "--height"){
+            height = std::atoi(argv[i + 1]);
+        } else if (arg == "--threads"){
+            threads = std::atoi(argv[i + 1]);
+        }
+    }
+    Server server(width, height, threads);
+    if (!server.Listen(port)){
+        std::cerr << "Could not listen on port " << port << std::endl;
+        return 1;
+    }
+    g_server = &server;
+    std::signal(SIGINT, &StopServer);
+    std::signal(SIGTERM, &StopServer);
+    std::cout << "Serving a " << width << "x" << height << " canvas on port " << server.GetPort() << std::endl;
+    server.Run();
+    g_server = nullptr;
+    return 0;
+}
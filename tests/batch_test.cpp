@@ -0,0 +1,77 @@
+/**
+ *  @file   batch_test.cpp
+ *  @brief  Tests of the command-line batch mode.
+ *  @author Team Avengers
+ *  @date   2020-12-17
+ ***********************************************/
+
+// Include our Third-Party SFML header
+#include <SFML/Graphics/Color.hpp>
+// Include standard library C++ libraries.
+#include <cstdio>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+// Project header files
+#include "catch.hpp"
+#include "test_helpers.hpp"
+#include "Batch.hpp"
+#include "ImageImport.hpp"
+
+namespace {
+
+const char* const BATCH_DIR = "fsd-test-batch";
+
+void WriteImage(const std::string &path, const sf::Color &color){
+    TiledImage image(8, 8);
+    for (unsigned y = 0; y < 8; y++){
+        for (unsigned x = 0; x < 8; x++){
+            image.SetPixel(x, y, color);
+        }
+    }
+    REQUIRE(ImageExporter::Write(image, path, EXPORT_TGA));
+}
+
+}
+
+TEST_CASE("Inputs with the same name in different directories get files of their own", "[batch]"){
+    test::QuietOutput quiet;
+    std::string dir = BATCH_DIR;
+    mkdir(dir.c_str(), 0755);
+    mkdir((dir + "/a").c_str(), 0755);
+    mkdir((dir + "/b").c_str(), 0755);
+    mkdir((dir + "/out").c_str(), 0755);
+    WriteImage(dir + "/a/img.tga", sf::Color::Red);
+    WriteImage(dir + "/b/img.tga", sf::Color::Blue);
+    WriteImage(dir + "/b/Img-2.tga", sf::Color::Green);
+
+    BatchOptions options;
+    options.filters.push_back(FILTER_BLUR);
+    options.inputs.push_back(dir + "/a/img.tga");
+    options.inputs.push_back(dir + "/b/img.tga");
+    options.inputs.push_back(dir + "/b/Img-2.tga");
+    options.outputDir = dir + "/out";
+    options.format = EXPORT_TGA;
+    options.threads = 3;
+    options.inFlight = 3;
+    BatchProcessor batch(options);
+    REQUIRE(batch.GetOutputPath(0) == dir + "/out/img.tga");
+    REQUIRE(batch.GetOutputPath(1) == dir + "/out/img-2.tga");
+    // Already taken without case by the rename before it
+    REQUIRE(batch.GetOutputPath(2) == dir + "/out/Img-2-2.tga");
+    REQUIRE(batch.Run() == 0);
+
+    // A flat image stays flat through the blur, so each keeps its color
+    const sf::Color colors[] = {sf::Color::Red, sf::Color::Blue, sf::Color::Green};
+    for (std::size_t i = 0; i < 3; i++){
+        TiledImage image;
+        REQUIRE(ImageImporter::Read(batch.GetOutputPath(i), image));
+        REQUIRE(image.GetPixel(4, 4) == colors[i]);
+        std::remove(batch.GetOutputPath(i).c_str());
+        std::remove(options.inputs[i].c_str());
+    }
+    rmdir((dir + "/out").c_str());
+    rmdir((dir + "/a").c_str());
+    rmdir((dir + "/b").c_str());
+    rmdir(dir.c_str());
+}
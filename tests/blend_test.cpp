@@ -0,0 +1,87 @@
+/**
+ *  @file   blend_test.cpp
+ *  @brief  Tests of the blend kernels and the compositor.
+ *  @author Team Avengers
+ *  @date   2020-12-15
+ ***********************************************/
+
+// Include standard library C++ libraries.
+#include <random>
+#include <vector>
+// Project header files
+#include "catch.hpp"
+#include "Blend.hpp"
+#include "LayerStack.hpp"
+#include "TiledImage.hpp"
+
+namespace {
+
+// Random premultiplied pixels, with a few fully transparent and opaque ones
+std::vector<sf::Uint8> RandomPixels(std::mt19937 &random, std::size_t pixels){
+    std::vector<sf::Uint8> out(pixels * 4);
+    for (std::size_t i = 0; i < pixels; i++){
+        unsigned kind = random() % 8;
+        unsigned a = kind == 0 ? 0 : kind == 1 ? 255 : random() % 256;
+        for (unsigned c = 0; c < 3; c++){
+            out[i * 4 + c] = static_cast<sf::Uint8>(a == 0 ? 0 : random() % (a + 1));
+        }
+        out[i * 4 + 3] = static_cast<sf::Uint8>(a);
+    }
+    return out;
+}
+
+}
+
+TEST_CASE("Every SIMD kernel gives the same bytes as the scalar one", "[blend]"){
+    std::mt19937 random(1234);
+    // Odd lengths run into the scalar tail of the SIMD kernels
+    const std::size_t lengths[] = {1, 3, 7, 8, 15, 16, 17, 64, 333};
+    const unsigned opacities[] = {0, 1, 128, 254, 255};
+    for (int isa = BLEND_ISA_SCALAR + 1; isa < BLEND_ISA_COUNT; isa++){
+        for (int m = 0; m < BLEND_MODE_COUNT; m++){
+            BlendMode mode = static_cast<BlendMode>(m);
+            BlendRowFunc simd = GetBlendRow(mode, static_cast<BlendIsa>(isa));
+            if (!simd){
+                continue;
+            }
+            BlendRowFunc scalar = GetBlendRow(mode, BLEND_ISA_SCALAR);
+            for (std::size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++){
+                for (std::size_t o = 0; o < sizeof(opacities) / sizeof(opacities[0]); o++){
+                    std::vector<sf::Uint8> src = RandomPixels(random, lengths[l]);
+                    std::vector<sf::Uint8> expected = RandomPixels(random, lengths[l]);
+                    std::vector<sf::Uint8> got = expected;
+                    scalar(&expected[0], &src[0], lengths[l], opacities[o]);
+                    simd(&got[0], &src[0], lengths[l], opacities[o]);
+                    INFO(GetBlendIsaName(static_cast<BlendIsa>(isa)) << " " << GetBlendModeName(mode)
+                         << " pixels " << lengths[l] << " opacity " << opacities[o]);
+                    REQUIRE(got == expected);
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("Normal blending with an opaque source gives the source", "[blend]"){
+    sf::Uint8 dst[8] = {10, 20, 30, 255, 0, 0, 0, 0};
+    sf::Uint8 src[8] = {200, 100, 50, 255, 1, 2, 3, 255};
+    GetBlendRow(BLEND_NORMAL)(dst, src, 2, 255);
+    for (int i = 0; i < 8; i++){
+        REQUIRE(dst[i] == src[i]);
+    }
+}
+
+TEST_CASE("The composite follows the layer settings", "[blend]"){
+    LayerStack layers(TILE_SIZE, TILE_SIZE, sf::Color::White);
+    std::shared_ptr<Layer> top = layers.CreateLayer("top");
+    layers.InsertLayer(top, 1);
+    layers.Fill(top->GetId(), sf::Color(255, 0, 0, 255));
+    REQUIRE(layers.Flatten().GetPixel(5, 5) == sf::Color(255, 0, 0, 255));
+    layers.SetBlendMode(top->GetId(), BLEND_MULTIPLY);
+    REQUIRE(layers.Flatten().GetPixel(5, 5) == sf::Color(255, 0, 0, 255));
+    layers.SetVisible(top->GetId(), false);
+    REQUIRE(layers.Flatten().GetPixel(5, 5) == sf::Color::White);
+    layers.SetVisible(top->GetId(), true);
+    layers.SetBlendMode(top->GetId(), BLEND_NORMAL);
+    layers.SetOpacity(top->GetId(), 0);
+    REQUIRE(layers.Flatten().GetPixel(5, 5) == sf::Color::White);
+}
@@ -0,0 +1,169 @@
+/**
+ *  @file   codec_test.cpp
+ *  @brief  Tests of the byte streams and the stroke codec.
+ *  @author Team Avengers
+ *  @date   2020-12-15
+ ***********************************************/
+
+// Include standard library C++ libraries.
+#include <memory>
+#include <vector>
+// Project header files
+#include "catch.hpp"
+#include "test_helpers.hpp"
+#include "ByteStream.hpp"
+#include "ClearCanvas.hpp"
+#include "Draw.hpp"
+#include "Network.hpp"
+#include "StrokeCodec.hpp"
+
+TEST_CASE("Varints and signed numbers come back the same", "[codec]"){
+    const std::uint64_t values[] = {0, 1, 127, 128, 300, 16383, 16384, 0xffffffffULL, ~0ULL};
+    const std::int64_t signedValues[] = {0, -1, 1, -64, 63, -65, 1000000, -1000000};
+    ByteWriter out;
+    for (std::size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++){
+        out.PutVarint(values[i]);
+    }
+    for (std::size_t i = 0; i < sizeof(signedValues) / sizeof(signedValues[0]); i++){
+        out.PutSigned(signedValues[i]);
+    }
+    out.PutString("tile");
+    ByteReader in(out.GetData(), out.GetSize());
+    for (std::size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++){
+        REQUIRE(in.GetVarint() == values[i]);
+    }
+    for (std::size_t i = 0; i < sizeof(signedValues) / sizeof(signedValues[0]); i++){
+        REQUIRE(in.GetSigned() == signedValues[i]);
+    }
+    REQUIRE(in.GetString() == "tile");
+    REQUIRE(in.AtEnd());
+    REQUIRE(in.Ok());
+    // Small values take one byte
+    ByteWriter small;
+    small.PutVarint(127);
+    small.PutSigned(-64);
+    REQUIRE(small.GetSize() == 2);
+}
+
+TEST_CASE("Reading past the end fails and reads zeros", "[codec]"){
+    ByteWriter out;
+    out.PutVarint(300);
+    ByteReader in(out.GetData(), 1);
+    REQUIRE(in.GetVarint() == 0);
+    REQUIRE_FALSE(in.Ok());
+    REQUIRE(in.GetU8() == 0);
+}
+
+TEST_CASE("A stroke comes back the same from its encoding", "[codec]"){
+    StrokeHeader header;
+    header.color = sf::Color(10, 20, 30, 40);
+    header.layer = 3;
+    header.brushSize = 1;
+    std::vector<sf::Vector2i> points;
+    std::vector<sf::Uint8> coverage;
+    for (int i = 0; i < 200; i++){
+        // Small steps, big jumps and negative coordinates
+        points.push_back(sf::Vector2i(i % 50 == 0 ? -1000 + i : 100 + i, 50 - i / 3));
+        coverage.push_back(static_cast<sf::Uint8>(i % 7 == 0 ? 100 : 255));
+    }
+    for (int soft = 0; soft < 2; soft++){
+        std::vector<std::uint8_t> encoded(GetMaxStrokeSize(points.size()));
+        std::size_t size = EncodeStroke(header, &points[0], soft ? &coverage[0] : nullptr, points.size(),
+                                        &encoded[0], encoded.size());
+        REQUIRE(size > 0);
+        StrokeHeader read;
+        std::vector<sf::Vector2i> readPoints(points.size());
+        std::vector<sf::Uint8> readCoverage(points.size());
+        std::size_t samples = 0;
+        REQUIRE(DecodeStroke(&encoded[0], size, read, &readPoints[0], &readCoverage[0], readPoints.size(),
+                             samples) == size);
+        REQUIRE(samples == points.size());
+        REQUIRE(read.color == header.color);
+        REQUIRE(read.layer == header.layer);
+        REQUIRE(readPoints == points);
+        for (std::size_t i = 0; i < samples; i++){
+            REQUIRE(readCoverage[i] == (soft ? coverage[i] : 255));
+        }
+        // A cut off stroke is refused
+        REQUIRE(DecodeStroke(&encoded[0], size - 1, read, &readPoints[0], &readCoverage[0], readPoints.size(),
+                             samples) == 0);
+    }
+}
+
+TEST_CASE("A command batch brings the same commands to the other side", "[codec]"){
+    test::Canvas canvas;
+    CommandBatchWriter writer;
+    for (int i = 0; i < 600; i++){
+        Draw draw("draw", sf::Vector2i(i % 256, i / 256), i < 300 ? sf::Color::Red : sf::Color::Blue, canvas.app);
+        writer.Add(draw);
+    }
+    ByteWriter out;
+    writer.Finish(out);
+    // Runs of draws are packed far below their serialized size
+    REQUIRE(out.GetSize() < 600 * 4);
+    CommandBatchReader reader;
+    std::vector<std::shared_ptr<Command>> commands;
+    ByteReader in(out.GetData(), out.GetSize());
+    REQUIRE(reader.Read(in, canvas.app, commands));
+    REQUIRE(commands.size() == 600);
+    for (int i = 0; i < 600; i++){
+        REQUIRE(commands[i]->GetType() == COMMAND_DRAW);
+        const Draw &draw = static_cast<const Draw&>(*commands[i]);
+        REQUIRE(draw.GetCoords() == sf::Vector2i(i % 256, i / 256));
+        REQUIRE(draw.GetColor() == (i < 300 ? sf::Color::Red : sf::Color::Blue));
+    }
+}
+
+TEST_CASE("A stroke is refused by a buffer that may be too small for it", "[codec]"){
+    StrokeHeader header;
+    header.color = sf::Color::Red;
+    header.layer = 0;
+    header.brushSize = 1;
+    sf::Vector2i points[3] = {sf::Vector2i(0, 0), sf::Vector2i(1, 0), sf::Vector2i(2, 0)};
+    std::vector<std::uint8_t> encoded(GetMaxStrokeSize(3));
+    REQUIRE(EncodeStroke(header, points, nullptr, 3, &encoded[0], encoded.size() - 1) == 0);
+    REQUIRE(EncodeStroke(header, points, nullptr, 0, &encoded[0], encoded.size()) == 0);
+    // Room for fewer samples than the stroke has is refused too
+    std::vector<sf::Vector2i> readPoints(2);
+    std::vector<sf::Uint8> readCoverage(2);
+    std::size_t samples = 0;
+    std::size_t size = EncodeStroke(header, points, nullptr, 3, &encoded[0], encoded.size());
+    REQUIRE(size > 0);
+    REQUIRE(DecodeStroke(&encoded[0], size, header, &readPoints[0], &readCoverage[0], 2, samples) == 0);
+}
+
+TEST_CASE("A batch keeps strokes of several layers and other commands in order", "[codec]"){
+    test::Canvas canvas;
+    CommandBatchWriter writer;
+    for (int i = 0; i < 100; i++){
+        // A new stroke every time the layer changes, with soft coverage on some samples
+        unsigned layer = (i / 25) % 2;
+        writer.Add(*Draw::Create(sf::Vector2i(i, 3 * i), sf::Color::Green, layer, i % 5 == 0 ? 64 : 255, canvas.app));
+        if (i == 60){
+            writer.Add(ClearCanvas("clear", sf::Color::Cyan, sf::Color::White, canvas.app));
+        }
+    }
+    ByteWriter out;
+    writer.Finish(out);
+    CommandBatchReader reader;
+    std::vector<std::shared_ptr<Command>> commands;
+    ByteReader in(out.GetData(), out.GetSize());
+    REQUIRE(reader.Read(in, canvas.app, commands));
+    REQUIRE(in.AtEnd());
+    REQUIRE(commands.size() == 101);
+    for (int i = 0, c = 0; i < 100; i++, c++){
+        REQUIRE(commands[c]->GetType() == COMMAND_DRAW);
+        const Draw &draw = static_cast<const Draw&>(*commands[c]);
+        REQUIRE(draw.GetCoords() == sf::Vector2i(i, 3 * i));
+        REQUIRE(draw.GetColor() == sf::Color::Green);
+        REQUIRE(draw.GetLayer() == static_cast<unsigned>((i / 25) % 2));
+        REQUIRE(draw.GetCoverage() == (i % 5 == 0 ? 64 : 255));
+        if (i == 60){
+            REQUIRE(commands[++c]->GetType() == COMMAND_CLEAR);
+        }
+    }
+    // A batch cut off in the middle of a stroke is refused
+    std::vector<std::shared_ptr<Command>> cut;
+    ByteReader half(out.GetData(), out.GetSize() / 2);
+    REQUIRE_FALSE(reader.Read(half, canvas.app, cut));
+}
@@ -0,0 +1,199 @@
+/**
+ *  @file   commands_test.cpp
+ *  @brief  Tests of the commands and of undo and redo.
+ *  @author Team Avengers
+ *  @date   2020-12-15
+ ***********************************************/
+
+// Include standard library C++ libraries.
+#include <cstdio>
+#include <memory>
+// Project header files
+#include "catch.hpp"
+#include "test_helpers.hpp"
+#include "ClearCanvas.hpp"
+#include "Draw.hpp"
+#include "ImageExport.hpp"
+#include "LayerCommand.hpp"
+
+TEST_CASE("A draw colors one pixel and undo puts it back", "[commands]"){
+    test::Canvas canvas;
+    test::QuietOutput quiet;
+    sf::Color before = canvas.Pixel(10, 20);
+    canvas.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(10, 20), sf::Color::Red, canvas.app));
+    REQUIRE(canvas.Pixel(10, 20) == sf::Color::Red);
+    REQUIRE(canvas.Pixel(11, 20) == before);
+    canvas.app.Undo();
+    REQUIRE(canvas.Pixel(10, 20) == before);
+    canvas.app.Redo();
+    REQUIRE(canvas.Pixel(10, 20) == sf::Color::Red);
+}
+
+TEST_CASE("A draw outside the canvas does nothing", "[commands]"){
+    test::Canvas canvas;
+    canvas.app.AddCommand(std::make_shared<Draw>("draw", sf::Vector2i(-1, 5), sf::Color::Red, canvas.app));
+    canvas.app.ExecuteCommand();
+    canvas.app.AddCommand(std::make_shared<Draw>("draw", sf::Vector2i(5, 256), sf::Color::Red, canvas.app));
+    canvas.app.ExecuteCommand();
+    REQUIRE(canvas.app.GetLastCommand() == nullptr);
+}
+
+TEST_CASE("Clearing fills the layer and undo brings the drawing back", "[commands]"){
+    test::Canvas canvas;
+    test::QuietOutput quiet;
+    canvas.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(3, 3), sf::Color::Blue, canvas.app));
+    canvas.app.RunCommand(std::make_shared<ClearCanvas>("clear", sf::Color::Yellow, sf::Color::White, canvas.app));
+    REQUIRE(canvas.Pixel(3, 3) == sf::Color::Yellow);
+    REQUIRE(canvas.Pixel(200, 100) == sf::Color::Yellow);
+    canvas.app.Undo();
+    REQUIRE(canvas.Pixel(3, 3) == sf::Color::Blue);
+    REQUIRE(canvas.Pixel(200, 100) == sf::Color::White);
+}
+
+TEST_CASE("Undo goes back at most ten commands and redo replays them in order", "[commands]"){
+    test::Canvas canvas;
+    test::QuietOutput quiet;
+    for (int i = 0; i < 15; i++){
+        canvas.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(i, 0), sf::Color::Red, canvas.app));
+    }
+    for (int i = 0; i < 15; i++){
+        canvas.app.Undo();
+    }
+    for (int i = 0; i < 5; i++){
+        REQUIRE(canvas.Pixel(i, 0) == sf::Color::Red);
+    }
+    for (int i = 5; i < 15; i++){
+        REQUIRE(canvas.Pixel(i, 0) == sf::Color::White);
+    }
+    canvas.app.Redo();
+    canvas.app.Redo();
+    REQUIRE(canvas.Pixel(5, 0) == sf::Color::Red);
+    REQUIRE(canvas.Pixel(6, 0) == sf::Color::Red);
+    REQUIRE(canvas.Pixel(7, 0) == sf::Color::White);
+}
+
+TEST_CASE("A new command drops what could be redone", "[commands]"){
+    test::Canvas canvas;
+    test::QuietOutput quiet;
+    canvas.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(1, 1), sf::Color::Red, canvas.app));
+    canvas.app.Undo();
+    canvas.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(2, 2), sf::Color::Green, canvas.app));
+    canvas.app.Redo();
+    REQUIRE(canvas.Pixel(1, 1) == sf::Color::White);
+    REQUIRE(canvas.Pixel(2, 2) == sf::Color::Green);
+}
+
+TEST_CASE("Adding a layer draws on the new layer and undo removes it", "[commands]"){
+    test::Canvas canvas;
+    test::QuietOutput quiet;
+    LayerStack &layers = canvas.app.GetLayers();
+    canvas.app.RunCommand(std::make_shared<LayerCommand>("layer add", LayerCommand::ADD, canvas.app));
+    REQUIRE(layers.GetLayerCount() == 2);
+    canvas.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(4, 4), sf::Color::Red, canvas.app));
+    REQUIRE(layers.GetPixel(layers.GetLayer(0)->GetId(), 4, 4) == sf::Color::White);
+    REQUIRE(layers.Flatten().GetPixel(4, 4) == sf::Color::Red);
+    canvas.app.Undo();
+    canvas.app.Undo();
+    REQUIRE(layers.GetLayerCount() == 1);
+}
+
+TEST_CASE("A draw on a layer that was removed fails", "[commands]"){
+    test::Canvas canvas;
+    test::QuietOutput quiet;
+    LayerStack &layers = canvas.app.GetLayers();
+    std::shared_ptr<Layer> layer = layers.CreateLayer("gone");
+    layers.InsertLayer(layer, layers.GetLayerCount());
+    std::shared_ptr<Command> draw = std::make_shared<Draw>("draw", sf::Vector2i(4, 4), sf::Color::Red, canvas.app);
+    layers.RemoveLayer(layer->GetId());
+    canvas.app.AddCommand(draw);
+    canvas.app.ExecuteCommand();
+    REQUIRE(canvas.app.GetLastCommand() == nullptr);
+    REQUIRE(layers.Flatten().GetPixel(4, 4) == sf::Color::White);
+}
+
+TEST_CASE("A clear of a layer that was removed fails and keeps the background", "[commands]"){
+    test::Canvas canvas;
+    test::QuietOutput quiet;
+    LayerStack &layers = canvas.app.GetLayers();
+    sf::Color background = canvas.app.GetBackgroundColor();
+    std::shared_ptr<Layer> layer = layers.CreateLayer("gone");
+    layers.InsertLayer(layer, layers.GetLayerCount());
+    layers.SetActive(layer->GetId());
+    std::shared_ptr<Command> clear = std::make_shared<ClearCanvas>("clear", sf::Color::Blue, background, canvas.app);
+    canvas.app.GetSelection().SelectRect(sf::IntRect(0, 0, 40, 40));
+    std::shared_ptr<Command> selected = std::make_shared<ClearCanvas>("clear", sf::Color::Blue, background, canvas.app);
+    layers.RemoveLayer(layer->GetId());
+    canvas.app.AddCommand(clear);
+    canvas.app.ExecuteCommand();
+    canvas.app.AddCommand(selected);
+    canvas.app.ExecuteCommand();
+    REQUIRE(canvas.app.GetLastCommand() == nullptr);
+    REQUIRE(canvas.app.GetBackgroundColor() == background);
+    REQUIRE(layers.Flatten().GetPixel(4, 4) == sf::Color::White);
+}
+
+TEST_CASE("Commands made with the same selection share one copy of it", "[commands]"){
+    test::Canvas canvas;
+    std::shared_ptr<const SelectionMask> first = canvas.app.GetSelectionSnapshot();
+    REQUIRE(canvas.app.GetSelectionSnapshot() == first);
+    canvas.app.GetSelection().SelectRect(sf::IntRect(0, 0, 40, 40));
+    std::shared_ptr<const SelectionMask> selected = canvas.app.GetSelectionSnapshot();
+    REQUIRE(selected != first);
+    REQUIRE(selected->IsActive());
+    REQUIRE_FALSE(first->IsActive());
+    REQUIRE(canvas.app.GetSelectionSnapshot() == selected);
+    canvas.app.GetSelection().Clear();
+    REQUIRE_FALSE(canvas.app.GetSelectionSnapshot()->IsActive());
+    REQUIRE(selected->IsActive());
+}
+
+TEST_CASE("Undo removes an imported image and redo brings it back", "[commands]"){
+    const char* const path = "fsd-test-import.tga";
+    TiledImage image(16, 16);
+    for (unsigned y = 0; y < 16; y++){
+        for (unsigned x = 0; x < 16; x++){
+            image.SetPixel(x, y, sf::Color::Red);
+        }
+    }
+    REQUIRE(ImageExporter::Write(image, path, EXPORT_TGA));
+    test::Canvas canvas;
+    test::QuietOutput quiet;
+    LayerStack &layers = canvas.app.GetLayers();
+    canvas.app.Import(path);
+    canvas.app.GetImporter().Wait();
+    canvas.app.GetImporter().Poll(layers);
+    REQUIRE(layers.GetLayerCount() == 2);
+    REQUIRE(canvas.app.GetLastCommand()->GetType() == COMMAND_IMPORT);
+    REQUIRE(layers.Flatten().GetPixel(3, 3) == sf::Color::Red);
+    canvas.app.Undo();
+    REQUIRE(layers.GetLayerCount() == 1);
+    REQUIRE(layers.Flatten().GetPixel(3, 3) == sf::Color::White);
+    canvas.app.Redo();
+    REQUIRE(layers.GetLayerCount() == 2);
+    REQUIRE(layers.Flatten().GetPixel(3, 3) == sf::Color::Red);
+    std::remove(path);
+}
+
+TEST_CASE("Commands come back the same from their serialized form", "[commands]"){
+    test::Canvas canvas;
+    std::shared_ptr<Command> draw = Draw::Create(sf::Vector2i(7, 9), sf::Color(1, 2, 3, 4), 0, 200, canvas.app);
+    ByteWriter out;
+    WriteCommand(*draw, out);
+    WriteCommand(ClearCanvas("clear", sf::Color::Cyan, sf::Color::White, canvas.app), out);
+    ByteReader in(out.GetData(), out.GetSize());
+    std::shared_ptr<Command> first = ReadCommand(in, canvas.app);
+    std::shared_ptr<Command> second = ReadCommand(in, canvas.app);
+    REQUIRE(first);
+    REQUIRE(second);
+    REQUIRE(in.GetRemaining() == 0);
+    REQUIRE(first->GetType() == COMMAND_DRAW);
+    const Draw &read = static_cast<const Draw&>(*first);
+    REQUIRE(read.GetCoords() == sf::Vector2i(7, 9));
+    REQUIRE(read.GetColor() == sf::Color(1, 2, 3, 4));
+    REQUIRE(read.GetCoverage() == 200);
+    REQUIRE(second->GetType() == COMMAND_CLEAR);
+
+    // A cut off command is refused rather than read as garbage
+    ByteReader cut(out.GetData(), 3);
+    REQUIRE(ReadCommand(cut, canvas.app) == nullptr);
+}
@@ -0,0 +1,104 @@
+/**
+ *  @file   document_test.cpp
+ *  @brief  Tests of saving and opening project files.
+ *  @author Team Avengers
+ *  @date   2020-12-17
+ ***********************************************/
+
+// Include our Third-Party SFML header
+#include <SFML/Graphics/Color.hpp>
+// Include standard library C++ libraries.
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+// Project header files
+#include "catch.hpp"
+#include "Document.hpp"
+
+namespace {
+
+const char* const PROJECT_PATH = "fsd-test.fsdproj";
+const char* const OTHER_PATH = "fsd-test-other.fsdproj";
+
+std::uint64_t Read64(std::fstream &file, std::uint64_t offset){
+    unsigned char bytes[8];
+    file.seekg(offset);
+    file.read(reinterpret_cast<char*>(bytes), 8);
+    std::uint64_t value = 0;
+    for (int i = 7; i >= 0; i--){
+        value = value << 8 | bytes[i];
+    }
+    return value;
+}
+
+void Write64(std::fstream &file, std::uint64_t offset, std::uint64_t value){
+    file.seekp(offset);
+    for (int i = 0; i < 8; i++){
+        file.put(static_cast<char>(value >> (8 * i)));
+    }
+    file.flush();
+}
+
+}
+
+TEST_CASE("A project whose saves point at themselves or forward is not opened", "[document]"){
+    {
+        Document document(64, 64, sf::Color::White);
+        REQUIRE(document.Save(PROJECT_PATH));
+        document.GetLayers().SetPixel(document.GetLayers().GetActiveId(), 1, 1, sf::Color::Red);
+        REQUIRE(document.Save(PROJECT_PATH));
+    }
+    Document document(64, 64, sf::Color::White);
+    REQUIRE(document.Open(PROJECT_PATH));
+    REQUIRE(document.GetRevisionCount() == 2);
+    // The header holds the offset of the newest index, every index starts
+    // with its magic and then the offset of the index before
+    std::fstream file(PROJECT_PATH, std::ios::in | std::ios::out | std::ios::binary);
+    std::uint64_t newest = Read64(file, 8);
+    std::uint64_t older = Read64(file, newest + 4);
+    REQUIRE(older != 0);
+    REQUIRE(older < newest);
+    Write64(file, newest + 4, newest);
+    REQUIRE_FALSE(document.Open(PROJECT_PATH));
+    Write64(file, newest + 4, older);
+    Write64(file, older + 4, newest);
+    REQUIRE_FALSE(document.Open(PROJECT_PATH));
+    Write64(file, older + 4, 0);
+    REQUIRE(document.Open(PROJECT_PATH, 1));
+    file.close();
+    std::remove(PROJECT_PATH);
+}
+
+TEST_CASE("Saving over the opened project keeps the tiles it maps", "[document]"){
+    {
+        Document document(256, 256, sf::Color::White);
+        LayerStack &layers = document.GetLayers();
+        for (unsigned y = 0; y < 256; y += 7){
+            for (unsigned x = 0; x < 256; x += 5){
+                layers.SetPixel(layers.GetActiveId(), x, y, sf::Color(x, y, 0));
+            }
+        }
+        REQUIRE(document.Save(PROJECT_PATH));
+    }
+    Document document(256, 256, sf::Color::White);
+    REQUIRE(document.Open(PROJECT_PATH));
+    REQUIRE(document.Save(OTHER_PATH));
+    // Not the file saved last, so it is written from scratch, from tiles
+    // that still point into its old contents
+    REQUIRE(document.Save(PROJECT_PATH));
+    LayerStack &layers = document.GetLayers();
+    REQUIRE(layers.GetPixel(layers.GetActiveId(), 250, 252) == sf::Color(250, 252, 0));
+    Document reopened(256, 256, sf::Color::White);
+    REQUIRE(reopened.Open(PROJECT_PATH));
+    REQUIRE(reopened.GetRevisionCount() == 1);
+    unsigned differ = 0;
+    for (unsigned y = 0; y < 256; y++){
+        for (unsigned x = 0; x < 256; x++){
+            differ += reopened.GetLayers().GetPixel(reopened.GetLayers().GetActiveId(), x, y) !=
+                      layers.GetPixel(layers.GetActiveId(), x, y);
+        }
+    }
+    REQUIRE(differ == 0);
+    std::remove(PROJECT_PATH);
+    std::remove(OTHER_PATH);
+}
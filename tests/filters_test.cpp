@@ -0,0 +1,86 @@
+/**
+ *  @file   filters_test.cpp
+ *  @brief  Tests of the filter kernels and of FilterCommand.
+ *  @author Team Avengers
+ *  @date   2020-12-15
+ ***********************************************/
+
+// Include standard library C++ libraries.
+#include <memory>
+#include <vector>
+// Project header files
+#include "catch.hpp"
+#include "test_helpers.hpp"
+#include "ClearCanvas.hpp"
+#include "Draw.hpp"
+#include "Filter.hpp"
+#include "FilterCommand.hpp"
+
+TEST_CASE("Grayscale turns a color into its luma", "[filters]"){
+    TiledImage image(TILE_SIZE, TILE_SIZE);
+    image.Fill(sf::Color(200, 100, 50, 255));
+    std::vector<sf::Uint8> out(TILE_BYTES);
+    FilterTile(FILTER_GRAYSCALE, image, 0, &out[0]);
+    sf::Uint8 y = static_cast<sf::Uint8>((77 * 200 + 150 * 100 + 29 * 50 + 128) >> 8);
+    for (unsigned i = 0; i < TILE_BYTES; i += 4){
+        REQUIRE(out[i] == y);
+        REQUIRE(out[i + 1] == y);
+        REQUIRE(out[i + 2] == y);
+        REQUIRE(out[i + 3] == 255);
+    }
+}
+
+TEST_CASE("Blurring a flat image leaves it flat, edges included", "[filters]"){
+    TiledImage image(TILE_SIZE * 2, TILE_SIZE);
+    image.Fill(sf::Color(40, 80, 120, 255));
+    std::vector<sf::Uint8> out(TILE_BYTES);
+    for (unsigned tile = 0; tile < image.GetTileCount(); tile++){
+        FilterTile(FILTER_BLUR, image, tile, &out[0]);
+        for (unsigned i = 0; i < TILE_BYTES; i += 4){
+            REQUIRE(out[i] == 40);
+            REQUIRE(out[i + 1] == 80);
+            REQUIRE(out[i + 2] == 120);
+        }
+    }
+}
+
+TEST_CASE("Every filter has a name it can be found by", "[filters]"){
+    for (int f = 0; f < FILTER_COUNT; f++){
+        FilterType type = static_cast<FilterType>(f);
+        FilterType found = FILTER_COUNT;
+        REQUIRE(FindFilter(GetFilterName(type), found));
+        REQUIRE(found == type);
+    }
+    FilterType found;
+    REQUIRE_FALSE(FindFilter("no such filter", found));
+}
+
+TEST_CASE("A filter only changes the selection and undo puts the tiles back", "[filters]"){
+    test::Canvas canvas(200, 150);
+    test::QuietOutput quiet;
+    canvas.app.RunCommand(std::make_shared<ClearCanvas>("clear", sf::Color(200, 30, 30), sf::Color::White, canvas.app));
+    const TiledImage before = canvas.app.GetLayers().Snapshot(canvas.app.GetLayers().GetActiveId());
+    canvas.app.GetSelection().SelectRect(sf::IntRect(10, 10, 50, 40));
+    canvas.app.RunCommand(std::make_shared<FilterCommand>("Grayscale", FILTER_GRAYSCALE, canvas.app));
+    sf::Color inside = canvas.Pixel(20, 20);
+    REQUIRE(inside.r == inside.g);
+    REQUIRE(inside.g == inside.b);
+    REQUIRE(canvas.Pixel(100, 100) == sf::Color(200, 30, 30));
+    REQUIRE(canvas.Pixel(9, 20) == sf::Color(200, 30, 30));
+    REQUIRE(canvas.Pixel(60, 20) == sf::Color(200, 30, 30));
+    canvas.app.Undo();
+    REQUIRE(canvas.app.GetLayers().Snapshot(canvas.app.GetLayers().GetActiveId()).SameTiles(before));
+}
+
+TEST_CASE("Color filters leave transparent tiles alone", "[filters]"){
+    test::Canvas canvas(200, 150);
+    test::QuietOutput quiet;
+    canvas.app.RunCommand(std::make_shared<ClearCanvas>("clear", sf::Color::Transparent, sf::Color::White, canvas.app));
+    canvas.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(5, 5), sf::Color::Red, canvas.app));
+    SelectionMask all(200, 150);
+    std::vector<std::pair<unsigned, TilePtr>> filtered;
+    const TiledImage &pixels = canvas.app.GetLayers().FindLayer(canvas.app.GetLayers().GetActiveId())->GetPixels();
+    FilterCommand::FilterSelection(FILTER_SEPIA, pixels, all, filtered);
+    REQUIRE(filtered.size() == 1);
+    REQUIRE(filtered[0].first == 0);
+}
@@ -0,0 +1,67 @@
+/**
+ *  @file   fontcache_test.cpp
+ *  @brief  Tests of the cache of the baked font atlas.
+ *  @author Team Avengers
+ *  @date   2020-12-17
+ ***********************************************/
+
+// Include standard library C++ libraries.
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+// Project header files
+#include "catch.hpp"
+#include "FontCache.hpp"
+
+namespace {
+
+const char* const CACHE_PATH = "fsd-test-font.cache";
+
+// A small atlas with a pattern in it, and tables of a few floats
+void WriteCache(const std::string &key, std::vector<unsigned char> &pixels, std::vector<float> &tables){
+    pixels.resize(16 * 8 * 4);
+    for (std::size_t i = 0; i < pixels.size(); i++){
+        pixels[i] = static_cast<unsigned char>(i * 7);
+    }
+    tables.assign(10, 0.5f);
+    tables[3] = 13.0f;
+    REQUIRE(FontCache::Write(CACHE_PATH, key, pixels.data(), 16, 8, tables.data(), tables.size() * sizeof(float)));
+}
+
+}
+
+TEST_CASE("A font cache reads back the atlas it was written with", "[fontcache]"){
+    std::vector<unsigned char> pixels;
+    std::vector<float> tables;
+    WriteCache("ProggyClean 13", pixels, tables);
+    FontCache cache;
+    REQUIRE(cache.Open(CACHE_PATH, "ProggyClean 13"));
+    REQUIRE(cache.GetWidth() == 16);
+    REQUIRE(cache.GetHeight() == 8);
+    REQUIRE(std::memcmp(cache.GetPixels(), pixels.data(), pixels.size()) == 0);
+    REQUIRE(cache.GetTablesSize() == tables.size() * sizeof(float));
+    REQUIRE(reinterpret_cast<std::uintptr_t>(cache.GetTables()) % 4 == 0);
+    REQUIRE(std::memcmp(cache.GetTables(), tables.data(), cache.GetTablesSize()) == 0);
+    cache.Close();
+    REQUIRE(cache.GetPixels() == nullptr);
+    std::remove(CACHE_PATH);
+}
+
+TEST_CASE("A font cache of another font or with damaged data is not used", "[fontcache]"){
+    std::vector<unsigned char> pixels;
+    std::vector<float> tables;
+    WriteCache("ProggyClean 13", pixels, tables);
+    FontCache cache;
+    REQUIRE_FALSE(cache.Open(CACHE_PATH, "ProggyClean 14"));
+    REQUIRE_FALSE(cache.Open("fsd-missing-font.cache", "ProggyClean 13"));
+    {
+        std::fstream file(CACHE_PATH, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(100);
+        file.put('x');
+    }
+    REQUIRE_FALSE(cache.Open(CACHE_PATH, "ProggyClean 13"));
+    REQUIRE(cache.GetPixels() == nullptr);
+    std::remove(CACHE_PATH);
+}
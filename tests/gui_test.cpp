@@ -0,0 +1,159 @@
+/**
+ *  @file   gui_test.cpp
+ *  @brief  Tests of the toolbar, drawn into memory without a window.
+ *  @author Team Avengers
+ *  @date   2020-12-17
+ ***********************************************/
+
+// Include our Third-Party SFML header
+#include <SFML/Window.hpp>
+// Include standard library C++ libraries.
+#include <cstdint>
+#include <cstring>
+#include <string>
+// Same Nuklear configuration as GUI.cpp, without the implementation
+#define NK_INCLUDE_FIXED_TYPES
+#define NK_INCLUDE_STANDARD_IO
+#define NK_INCLUDE_STANDARD_VARARGS
+#define NK_INCLUDE_VERTEX_BUFFER_OUTPUT
+#define NK_INCLUDE_FONT_BAKING
+#define NK_INCLUDE_DEFAULT_FONT
+#include "nuklear.h"
+// Project header files
+#include "catch.hpp"
+#include "test_helpers.hpp"
+#include "GUI.hpp"
+#include "Memory.hpp"
+#include "Profiler.hpp"
+
+namespace {
+
+const unsigned TOOLBAR_WIDTH = 250;
+const unsigned TOOLBAR_HEIGHT = 800;
+
+// Lay the toolbar out once more and find the middle of a label in it, so
+// the tests do not depend on where the widgets are.
+bool FindLabel(GUI &gui, const std::string &label, sf::Vector2i &at){
+    struct nk_context* ctx = gui.getContext();
+    nk_input_begin(ctx);
+    nk_input_end(ctx);
+    gui.drawLayout();
+    bool found = false;
+    const struct nk_command* command;
+    nk_foreach(command, ctx){
+        if (command->type != NK_COMMAND_TEXT){
+            continue;
+        }
+        const struct nk_command_text* text = reinterpret_cast<const struct nk_command_text*>(command);
+        if (!found && label == std::string(text->string, text->length)){
+            at = sf::Vector2i(text->x + text->w / 2, text->y + text->h / 2);
+            found = true;
+        }
+    }
+    nk_clear(ctx);
+    return found;
+}
+
+void Click(GUI &gui, sf::Vector2i at){
+    sf::Event event;
+    event.type = sf::Event::MouseMoved;
+    event.mouseMove.x = at.x;
+    event.mouseMove.y = at.y;
+    gui.pushEvent(event);
+    gui.loop();
+    event.type = sf::Event::MouseButtonPressed;
+    event.mouseButton.button = sf::Mouse::Left;
+    event.mouseButton.x = at.x;
+    event.mouseButton.y = at.y;
+    gui.pushEvent(event);
+    gui.loop();
+    event.type = sf::Event::MouseButtonReleased;
+    gui.pushEvent(event);
+    gui.loop();
+}
+
+}
+
+TEST_CASE("The toolbar is drawn into memory without a window", "[gui]"){
+    test::Canvas canvas;
+    test::QuietOutput quiet;
+    GUI gui(&canvas.app, TOOLBAR_WIDTH, TOOLBAR_HEIGHT);
+    REQUIRE(gui.getContext() != nullptr);
+    REQUIRE(gui.getWindow() == nullptr);
+    REQUIRE(gui.getFramebufferSize() == sf::Vector2u(TOOLBAR_WIDTH, TOOLBAR_HEIGHT));
+    gui.loop();
+    // Cleared to black, then the window, its widgets and text on top
+    const sf::Uint8* pixels = gui.getFramebuffer();
+    std::size_t drawn = 0;
+    for (std::size_t i = 0; i < TOOLBAR_WIDTH * TOOLBAR_HEIGHT; i++){
+        if (pixels[i * 4] || pixels[i * 4 + 1] || pixels[i * 4 + 2]){
+            drawn++;
+        }
+    }
+    REQUIRE(drawn > TOOLBAR_WIDTH * TOOLBAR_HEIGHT / 2);
+    sf::Vector2i at;
+    REQUIRE(FindLabel(gui, "Fill Screen", at));
+    REQUIRE_FALSE(FindLabel(gui, "No such button", at));
+}
+
+TEST_CASE("Clicking Fill Screen fills the canvas with the color", "[gui]"){
+    test::Canvas canvas;
+    test::QuietOutput quiet;
+    GUI gui(&canvas.app, TOOLBAR_WIDTH, TOOLBAR_HEIGHT);
+    gui.loop();
+    REQUIRE(canvas.Pixel(10, 10) == sf::Color::White);
+    sf::Vector2i at;
+    REQUIRE(FindLabel(gui, "Fill Screen", at));
+    Click(gui, at);
+    // The preset chosen in the toolbar, black unless it is changed
+    REQUIRE(canvas.app.GetCurrentColor() == sf::Color::Black);
+    REQUIRE(canvas.Pixel(10, 10) == sf::Color::Black);
+    REQUIRE(canvas.Pixel(200, 200) == sf::Color::Black);
+}
+
+TEST_CASE("Clicking Undo in the toolbar takes the last command back", "[gui]"){
+    test::Canvas canvas;
+    test::QuietOutput quiet;
+    GUI gui(&canvas.app, TOOLBAR_WIDTH, TOOLBAR_HEIGHT);
+    gui.loop();
+    sf::Vector2i fill;
+    sf::Vector2i undo;
+    REQUIRE(FindLabel(gui, "Fill Screen", fill));
+    REQUIRE(FindLabel(gui, "Undo", undo));
+    Click(gui, fill);
+    REQUIRE(canvas.Pixel(10, 10) == sf::Color::Black);
+    Click(gui, undo);
+    REQUIRE(canvas.Pixel(10, 10) == sf::Color::White);
+}
+
+TEST_CASE("The open profiler panel does not go to the heap once it is warmed up", "[gui][memory]"){
+    // The toolbar is three times as high as the canvas, the panel is at
+    // its bottom
+    test::Canvas canvas(600, TOOLBAR_HEIGHT);
+    test::QuietOutput quiet;
+    GUI gui(&canvas.app, TOOLBAR_WIDTH, TOOLBAR_HEIGHT * 3);
+    gui.loop();
+    sf::Vector2i profiler;
+    REQUIRE(FindLabel(gui, "Profiler", profiler));
+    Click(gui, profiler);
+    REQUIRE(Profiler::IsEnabled());
+    // Timed like the main loop, so the panel has frames to sort
+    auto frame = [&gui]{
+        {
+            ProfileScope scope(PROFILE_FRAME);
+            gui.loop();
+        }
+        Profiler::EndFrame();
+    };
+    for (std::size_t i = 0; i < Profiler::FRAMES; i++){
+        frame();
+    }
+    REQUIRE(Profiler::GetFrameCount() == Profiler::FRAMES);
+    std::uint64_t before = GetHeapAllocations();
+    for (int i = 0; i < 100; i++){
+        frame();
+    }
+    std::uint64_t allocations = GetHeapAllocations() - before;
+    Profiler::SetEnabled(false);
+    REQUIRE(allocations == 0);
+}
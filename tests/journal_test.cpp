@@ -0,0 +1,121 @@
+/**
+ *  @file   journal_test.cpp
+ *  @brief  Tests of recording a session and replaying it without a window.
+ *  @author Team Avengers
+ *  @date   2020-12-17
+ ***********************************************/
+
+// Include standard library C++ libraries.
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+// Project header files
+#include "catch.hpp"
+#include "test_helpers.hpp"
+#include "ClearCanvas.hpp"
+#include "Draw.hpp"
+#include "Journal.hpp"
+#include "LayerCommand.hpp"
+
+namespace {
+
+const char* const JOURNAL_PATH = "fsd-test-session.journal";
+
+// Records replayed by kind, as the headless harness times them
+void CountRecord(const char* kind, void* user){
+    (*static_cast<std::map<std::string, unsigned>*>(user))[kind]++;
+}
+
+}
+
+TEST_CASE("A recorded session replays record by record to the same canvas", "[journal]"){
+    test::QuietOutput quiet;
+    TiledImage recorded;
+    {
+        App app;
+        app.RecordSession(JOURNAL_PATH);
+        app.InitHeadless(256, 256, 0);
+        for (int i = 0; i < 20; i++){
+            app.AddCommand(std::make_shared<Draw>("draw", sf::Vector2i(10 + i, 20), sf::Color::Red, app));
+            app.ExecuteCommand();
+        }
+        app.RunCommand(std::make_shared<ClearCanvas>("clear", sf::Color::Blue, sf::Color::White, app));
+        app.Undo();
+        app.Redo();
+        app.Undo();
+        app.RunCommand(std::make_shared<LayerCommand>("layer add", LayerCommand::ADD, app));
+        app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(5, 5), sf::Color::Green, app));
+        app.SetLayerSettings(app.GetLayers().GetActiveId(), 128, true, BLEND_MULTIPLY);
+        recorded = app.GetLayers().Flatten();
+        app.Destroy();
+    }
+    App replayed;
+    replayed.InitHeadless(256, 256, 0);
+    unsigned records = 0;
+    std::map<std::string, unsigned> kinds;
+    REQUIRE(Journal::Replay(JOURNAL_PATH, replayed, &records, &CountRecord, &kinds) > 0);
+    REQUIRE(records == 27);
+    REQUIRE(kinds["draw"] == 21);
+    REQUIRE(kinds["clear"] == 1);
+    REQUIRE(kinds["undo"] == 2);
+    REQUIRE(kinds["redo"] == 1);
+    REQUIRE(kinds["layer"] == 1);
+    REQUIRE(kinds["layer settings"] == 1);
+    const TiledImage &flattened = replayed.GetLayers().Flatten();
+    REQUIRE(flattened.GetPixel(15, 20) == sf::Color::Red);
+    REQUIRE(flattened.GetPixel(5, 5) != sf::Color::White);
+    unsigned differ = 0;
+    for (unsigned y = 0; y < 256; y++){
+        for (unsigned x = 0; x < 256; x++){
+            differ += flattened.GetPixel(x, y) != recorded.GetPixel(x, y);
+        }
+    }
+    REQUIRE(differ == 0);
+    replayed.Destroy();
+    std::remove(JOURNAL_PATH);
+}
+
+TEST_CASE("Commands of other users replay without going on the undo stack", "[journal]"){
+    test::QuietOutput quiet;
+    TiledImage recorded;
+    {
+        App app;
+        app.RecordSession(JOURNAL_PATH);
+        app.InitHeadless(256, 256, 0);
+        app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(10, 10), sf::Color::Red, app));
+        app.ApplyRemoteCommand(std::make_shared<Draw>("draw", sf::Vector2i(30, 30), sf::Color::Blue, app), 2);
+        app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(50, 50), sf::Color::Green, app));
+        app.ApplyRemoteCommand(std::make_shared<Draw>("draw", sf::Vector2i(70, 70), sf::Color::Blue, app), 2);
+        // Takes back the green and the red draw, the blue ones of the other user stay
+        app.Undo();
+        app.Undo();
+        app.Redo();
+        recorded = app.GetLayers().Flatten();
+        app.Destroy();
+    }
+    App replayed;
+    replayed.InitHeadless(256, 256, 0);
+    unsigned records = 0;
+    std::map<std::string, unsigned> kinds;
+    REQUIRE(Journal::Replay(JOURNAL_PATH, replayed, &records, &CountRecord, &kinds) > 0);
+    REQUIRE(records == 7);
+    REQUIRE(kinds["draw"] == 2);
+    REQUIRE(kinds["remote"] == 2);
+    REQUIRE(kinds["undo"] == 2);
+    REQUIRE(kinds["redo"] == 1);
+    const TiledImage &flattened = replayed.GetLayers().Flatten();
+    REQUIRE(flattened.GetPixel(10, 10) == sf::Color::Red);
+    REQUIRE(flattened.GetPixel(30, 30) == sf::Color::Blue);
+    REQUIRE(flattened.GetPixel(50, 50) == sf::Color::White);
+    REQUIRE(flattened.GetPixel(70, 70) == sf::Color::Blue);
+    unsigned differ = 0;
+    for (unsigned y = 0; y < 256; y++){
+        for (unsigned x = 0; x < 256; x++){
+            differ += flattened.GetPixel(x, y) != recorded.GetPixel(x, y);
+        }
+    }
+    REQUIRE(differ == 0);
+    replayed.Destroy();
+    std::remove(JOURNAL_PATH);
+}
@@ -0,0 +1,85 @@
+/**
+ *  @file   latency_test.cpp
+ *  @brief  Tests of the histogram and tracking of input latency.
+ *  @author Team Avengers
+ *  @date   2020-12-17
+ ***********************************************/
+
+// Include standard library C++ libraries.
+#include <chrono>
+#include <memory>
+#include <sstream>
+// Project header files
+#include "catch.hpp"
+#include "test_helpers.hpp"
+#include "Draw.hpp"
+#include "Latency.hpp"
+
+namespace {
+
+InputClock::duration Milliseconds(double ms){
+    return std::chrono::duration_cast<InputClock::duration>(std::chrono::duration<double, std::milli>(ms));
+}
+
+}
+
+TEST_CASE("Latencies are counted in buckets with the longest kept exactly", "[latency]"){
+    LatencyHistogram histogram;
+    REQUIRE(histogram.GetCount() == 0);
+    REQUIRE(histogram.GetPercentile(0.5f) == 0);
+    for (int i = 0; i < 98; i++){
+        histogram.Add(Milliseconds(16.5));
+    }
+    histogram.Add(Milliseconds(33));
+    histogram.Add(Milliseconds(250));
+    REQUIRE(histogram.GetCount() == 100);
+    REQUIRE(histogram.GetBucket(16 / LatencyHistogram::BUCKET_MS) == 98);
+    REQUIRE(histogram.GetBucket(LatencyHistogram::BUCKETS - 1) == 1);
+    REQUIRE(histogram.GetPercentile(0.5f) == Approx(18));
+    REQUIRE(histogram.GetPercentile(0.98f) == Approx(34));
+    REQUIRE(histogram.GetPercentile(1) == Approx(250));
+    REQUIRE(histogram.GetMax() == Approx(250));
+    REQUIRE(histogram.GetMean() == Approx((98 * 16.5 + 33 + 250) / 100));
+    std::ostringstream out;
+    histogram.Write(out);
+    REQUIRE(out.str().find("100 inputs") != std::string::npos);
+    REQUIRE(out.str().find("16-18 ms: 98") != std::string::npos);
+    REQUIRE(out.str().find("98+ ms: 1") != std::string::npos);
+    histogram.Reset();
+    REQUIRE(histogram.GetCount() == 0);
+    REQUIRE(histogram.GetMax() == 0);
+}
+
+TEST_CASE("An input is timed until the frame with the upload that contains it", "[latency]"){
+    LatencyTracker tracker;
+    InputClock::time_point input = InputClock::now();
+    tracker.Executed(input);
+    // Tiles were left for the next frame, so this frame does not show it
+    tracker.Uploaded(false);
+    tracker.Presented(input + Milliseconds(16));
+    REQUIRE(tracker.GetHistogram().GetCount() == 0);
+    REQUIRE(tracker.GetWaiting() == 1);
+    tracker.Uploaded(true);
+    tracker.Executed(input + Milliseconds(20));
+    tracker.Presented(input + Milliseconds(33));
+    REQUIRE(tracker.GetHistogram().GetCount() == 1);
+    REQUIRE(tracker.GetHistogram().GetMax() == Approx(33));
+    // Executed after the upload, so it waits for the next one
+    REQUIRE(tracker.GetWaiting() == 1);
+}
+
+TEST_CASE("Commands added while input is handled carry when it was polled", "[latency]"){
+    test::Canvas canvas;
+    test::QuietOutput quiet;
+    InputClock::time_point polled = InputClock::now();
+    canvas.app.SetInputTime(polled);
+    canvas.app.AddCommand(std::make_shared<Draw>("draw", sf::Vector2i(1, 1), sf::Color::Red, canvas.app));
+    canvas.app.SetInputTime(InputClock::time_point());
+    canvas.app.ExecuteCommand();
+    REQUIRE(canvas.app.GetLastCommand()->GetInputTime() == polled);
+    canvas.app.AddCommand(std::make_shared<Draw>("draw", sf::Vector2i(2, 2), sf::Color::Red, canvas.app));
+    canvas.app.ExecuteCommand();
+    REQUIRE(canvas.app.GetLastCommand()->GetInputTime() == InputClock::time_point());
+    // Nothing is shown without a window, so nothing waits to be timed
+    REQUIRE(canvas.app.GetLatency().GetWaiting() == 0);
+}
@@ -0,0 +1,14 @@
+/**
+ *  @file   main_test.cpp
+ *  @brief  Entry point of App_Test, provided by Catch.
+ *  @author Team Avengers
+ *  @date   2020-12-15
+ ***********************************************/
+
+// Correctness tests run by default. The throughput tests are tagged
+// [perf] and run on their own: App_Test "[perf]"
+#define CATCH_CONFIG_MAIN
+// The signal handlers of this Catch version do not build with glibc 2.34,
+// where MINSIGSTKSZ is no longer a constant
+#define CATCH_CONFIG_NO_POSIX_SIGNALS
+#include "catch.hpp"
@@ -0,0 +1,83 @@
+/**
+ *  @file   memory_test.cpp
+ *  @brief  Tests of the frame arena, the pools and the allocation count.
+ *  @author Team Avengers
+ *  @date   2020-12-16
+ ***********************************************/
+
+// Include standard library C++ libraries.
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+// Project header files
+#include "catch.hpp"
+#include "test_helpers.hpp"
+#include "Draw.hpp"
+#include "Memory.hpp"
+
+TEST_CASE("The frame arena grows to hold a whole frame", "[memory]"){
+    FrameArena arena(1024);
+    void* first = arena.Allocate(100);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(first) % alignof(std::max_align_t) == 0);
+    REQUIRE(reinterpret_cast<std::uintptr_t>(arena.Allocate(3, 1)) == reinterpret_cast<std::uintptr_t>(first) + 100);
+    void* overflow = arena.Allocate(4096);
+    REQUIRE(overflow != nullptr);
+    REQUIRE(arena.GetCapacity() == 1024);
+    arena.Reset();
+    REQUIRE(arena.GetCapacity() >= 1024 + 4096);
+    REQUIRE(arena.GetUsed() == 0);
+    std::uint64_t before = GetHeapAllocations();
+    arena.Allocate(100);
+    arena.Allocate(4096);
+    arena.Reset();
+    REQUIRE(GetHeapAllocations() == before);
+}
+
+TEST_CASE("A fixed arena fails instead of growing", "[memory]"){
+    FixedArena arena(1024);
+    REQUIRE(arena.Allocate(1000) != nullptr);
+    REQUIRE(arena.Allocate(100) == nullptr);
+    REQUIRE(arena.GetFailures() == 1);
+    REQUIRE(arena.Allocate(8, 8) != nullptr);
+    REQUIRE(arena.GetUsed() == 1008);
+    REQUIRE(arena.GetCapacity() == 1024);
+}
+
+TEST_CASE("Pooled objects reuse the blocks of freed ones", "[memory]"){
+    std::shared_ptr<int> first = MakePooled<int>(1);
+    const int* address = first.get();
+    first.reset();
+    std::uint64_t before = GetHeapAllocations();
+    std::shared_ptr<int> second = MakePooled<int>(2);
+    REQUIRE(GetHeapAllocations() == before);
+    REQUIRE(second.get() == address);
+    REQUIRE(*second == 2);
+}
+
+TEST_CASE("Painting does not go to the heap once it is warmed up", "[memory]"){
+    test::Canvas canvas(512, 512);
+    App &app = canvas.app;
+    int frame = 0;
+    // Strokes over the same corner again and again, once the tiles there
+    // exist painting only swaps them with the pool
+    auto paint = [&app, &frame]{
+        for (int i = 0; i < 20; i++){
+            sf::Vector2i at((frame * 20 + i) % 128, (frame * 7) % 128);
+            app.AddCommand(MakePooled<Draw>("draw", at, sf::Color(frame % 256, 0, 0), app));
+            app.ExecuteCommand();
+        }
+        app.UpdateTexture();
+        app.EndFrame();
+        frame++;
+    };
+    for (int i = 0; i < 200; i++){
+        paint();
+    }
+    // Checked after the frames, Catch allocates when it checks
+    std::uint64_t most = 0;
+    for (int i = 0; i < 100; i++){
+        paint();
+        most = std::max(most, app.GetFrameAllocations());
+    }
+    REQUIRE(most == 0);
+}
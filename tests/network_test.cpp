@@ -0,0 +1,315 @@
+/**
+ *  @file   network_test.cpp
+ *  @brief  Tests of drawing together through a server in the same process.
+ *  @author Team Avengers
+ *  @date   2020-12-15
+ ***********************************************/
+
+// Include standard library C++ libraries.
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+// Project header files
+#include "catch.hpp"
+#include "test_helpers.hpp"
+#include "ClearCanvas.hpp"
+#include "Draw.hpp"
+#include "Journal.hpp"
+#include "LayerCommand.hpp"
+
+using test::Canvas;
+using test::CountDifferentTiles;
+using test::LocalServer;
+using test::Pump;
+using test::PumpUntil;
+
+namespace {
+
+const char* const JOURNAL_PATH = "fsd-test-shared.journal";
+
+bool Joined(Canvas &canvas){
+    return canvas.app.GetNetwork().IsCanvasLoaded();
+}
+
+// Records replayed by kind
+void CountRecord(const char* kind, void* user){
+    (*static_cast<std::map<std::string, unsigned>*>(user))[kind]++;
+}
+
+}
+
+TEST_CASE("Clients see each other's draws and refuse a canvas of another size", "[network]"){
+    LocalServer server(600, 400);
+    Canvas a(600, 400), b(600, 400), small(300, 400);
+    a.app.GetNetwork().Connect(server.GetAddress());
+    b.app.GetNetwork().Connect(server.GetAddress());
+    REQUIRE(PumpUntil({&a.app, &b.app}, [&]{ return Joined(a) && Joined(b); }));
+    a.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(10, 10), sf::Color::Red, a.app));
+    b.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(20, 20), sf::Color::Blue, b.app));
+    REQUIRE(PumpUntil({&a.app, &b.app}, [&]{
+        return a.Pixel(20, 20) == sf::Color::Blue && b.Pixel(10, 10) == sf::Color::Red;
+    }));
+    small.app.GetNetwork().Connect(server.GetAddress());
+    Pump({&small.app}, 200);
+    REQUIRE_FALSE(small.app.GetNetwork().IsConnected());
+}
+
+TEST_CASE("Conflicting strokes end up the same on every canvas", "[network]"){
+    LocalServer server(600, 400);
+    Canvas a(600, 400), b(600, 400);
+    a.app.GetNetwork().Connect(server.GetAddress());
+    b.app.GetNetwork().Connect(server.GetAddress());
+    REQUIRE(PumpUntil({&a.app, &b.app}, [&]{ return Joined(a) && Joined(b); }));
+    for (int r = 0; r < 100; r++){
+        for (int k = 0; k < 50; k++){
+            sf::Vector2i at(100 + k, 100 + r % 20);
+            a.app.RunCommand(std::make_shared<Draw>("draw", at, sf::Color(255, 0, r), a.app));
+            b.app.RunCommand(std::make_shared<Draw>("draw", at, sf::Color(0, r, 255), b.app));
+        }
+        a.app.GetNetwork().Poll(a.app);
+        b.app.GetNetwork().Poll(b.app);
+    }
+    REQUIRE(PumpUntil({&a.app, &b.app}, [&]{ return CountDifferentTiles(a.app, b.app) == 0; }));
+}
+
+TEST_CASE("Undo on a shared canvas keeps what the others drew", "[network]"){
+    LocalServer server(600, 400);
+    Canvas a(600, 400), b(600, 400);
+    a.app.GetNetwork().Connect(server.GetAddress());
+    b.app.GetNetwork().Connect(server.GetAddress());
+    REQUIRE(PumpUntil({&a.app, &b.app}, [&]{ return Joined(a) && Joined(b); }));
+
+    a.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(10, 10), sf::Color::Green, a.app));
+    REQUIRE(PumpUntil({&a.app, &b.app}, [&]{ return b.Pixel(10, 10) == sf::Color::Green; }));
+    b.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(10, 10), sf::Color::Blue, b.app));
+    REQUIRE(PumpUntil({&a.app, &b.app}, [&]{ return a.Pixel(10, 10) == sf::Color::Blue; }));
+    a.app.Undo();
+    Pump({&a.app, &b.app});
+    REQUIRE(a.Pixel(10, 10) == sf::Color::Blue);
+    REQUIRE(b.Pixel(10, 10) == sf::Color::Blue);
+
+    sf::Color before = a.Pixel(20, 20);
+    a.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(20, 20), sf::Color::Green, a.app));
+    REQUIRE(PumpUntil({&a.app, &b.app}, [&]{ return b.Pixel(20, 20) == sf::Color::Green; }));
+    a.app.Undo();
+    REQUIRE(PumpUntil({&a.app, &b.app}, [&]{ return b.Pixel(20, 20) == before; }));
+
+    // A clear undone while the other one drew on it
+    a.app.RunCommand(std::make_shared<ClearCanvas>("clear", sf::Color::Yellow, sf::Color::White, a.app));
+    b.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(40, 40), sf::Color::Blue, b.app));
+    Pump({&a.app, &b.app});
+    a.app.Undo();
+    REQUIRE(PumpUntil({&a.app, &b.app}, [&]{ return CountDifferentTiles(a.app, b.app) == 0; }));
+    REQUIRE(a.Pixel(40, 40) == sf::Color::Blue);
+    REQUIRE(a.Pixel(41, 41) != sf::Color::Yellow);
+}
+
+TEST_CASE("Undo while connected keeps a command drawn before connecting", "[network]"){
+    test::QuietOutput quiet;
+    LocalServer server(600, 400);
+    Canvas a(600, 400), b(600, 400);
+    sf::Color before = a.Pixel(50, 50);
+    a.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(50, 50), sf::Color::Green, a.app));
+    b.app.GetNetwork().Connect(server.GetAddress());
+    REQUIRE(PumpUntil({&b.app}, [&]{ return Joined(b); }));
+    b.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(50, 50), sf::Color::Red, b.app));
+    Pump({&b.app});
+    // The snapshot of the room replaces what was drawn alone
+    a.app.GetNetwork().Connect(server.GetAddress());
+    REQUIRE(PumpUntil({&a.app, &b.app}, [&]{ return Joined(a); }));
+    REQUIRE(a.Pixel(50, 50) == sf::Color::Red);
+
+    a.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(60, 60), sf::Color::Blue, a.app));
+    REQUIRE(PumpUntil({&a.app, &b.app}, [&]{ return b.Pixel(60, 60) == sf::Color::Blue; }));
+    a.app.Undo();
+    REQUIRE(PumpUntil({&a.app, &b.app}, [&]{ return b.Pixel(60, 60) != sf::Color::Blue; }));
+    // Refused, the others have it as part of the canvas
+    a.app.Undo();
+    Pump({&a.app, &b.app});
+    REQUIRE(a.Pixel(50, 50) == sf::Color::Red);
+    REQUIRE(b.Pixel(50, 50) == sf::Color::Red);
+
+    // Still on the stack, alone again it can be taken back
+    a.app.GetNetwork().Disconnect();
+    a.app.Undo();
+    REQUIRE(a.Pixel(50, 50) == before);
+}
+
+TEST_CASE("Undos on a shared canvas replay from the journal as they were applied", "[network]"){
+    test::QuietOutput quiet;
+    LocalServer server(600, 400);
+    TiledImage recorded;
+    {
+        App a;
+        a.RecordSession(JOURNAL_PATH);
+        a.InitHeadless(600, 400);
+        Canvas b(600, 400);
+        a.GetNetwork().Connect(server.GetAddress());
+        b.app.GetNetwork().Connect(server.GetAddress());
+        REQUIRE(PumpUntil({&a, &b.app}, [&]{ return a.GetNetwork().IsCanvasLoaded() && Joined(b); }));
+
+        // Our undo keeps what the other drew over our command
+        a.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(10, 10), sf::Color::Green, a));
+        REQUIRE(PumpUntil({&a, &b.app}, [&]{ return b.Pixel(10, 10) == sf::Color::Green; }));
+        b.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(10, 10), sf::Color::Blue, b.app));
+        REQUIRE(PumpUntil({&a, &b.app}, [&]{ return a.GetLayers().Flatten().GetPixel(10, 10) == sf::Color::Blue; }));
+        a.Undo();
+
+        // The undo of the other keeps what we drew over its command
+        b.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(40, 40), sf::Color::Yellow, b.app));
+        REQUIRE(PumpUntil({&a, &b.app}, [&]{ return a.GetLayers().Flatten().GetPixel(40, 40) == sf::Color::Yellow; }));
+        a.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(40, 40), sf::Color::Red, a));
+        b.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(41, 41), sf::Color::Yellow, b.app));
+        REQUIRE(PumpUntil({&a, &b.app}, [&]{ return b.Pixel(40, 40) == sf::Color::Red; }));
+        REQUIRE(PumpUntil({&a, &b.app}, [&]{ return a.GetLayers().Flatten().GetPixel(41, 41) == sf::Color::Yellow; }));
+        b.app.Undo();
+        b.app.Undo();
+        REQUIRE(PumpUntil({&a, &b.app}, [&]{ return CountDifferentTiles(a, b.app) == 0; }));
+        REQUIRE(a.GetLayers().Flatten().GetPixel(10, 10) == sf::Color::Blue);
+        REQUIRE(a.GetLayers().Flatten().GetPixel(40, 40) == sf::Color::Red);
+        REQUIRE(a.GetLayers().Flatten().GetPixel(41, 41) == sf::Color::White);
+        recorded = a.GetLayers().Flatten();
+        a.Destroy();
+    }
+    Canvas replayed(600, 400);
+    unsigned records = 0;
+    std::map<std::string, unsigned> kinds;
+    REQUIRE(Journal::Replay(JOURNAL_PATH, replayed.app, &records, &CountRecord, &kinds) > 0);
+    REQUIRE(kinds["draw"] == 2);
+    REQUIRE(kinds["remote"] == 3);
+    REQUIRE(kinds["revert"] == 3);
+    REQUIRE(kinds["undo"] == 0);
+    const TiledImage &flattened = replayed.app.GetLayers().Flatten();
+    unsigned differ = 0;
+    for (unsigned y = 0; y < 400; y++){
+        for (unsigned x = 0; x < 600; x++){
+            differ += flattened.GetPixel(x, y) != recorded.GetPixel(x, y);
+        }
+    }
+    REQUIRE(differ == 0);
+    std::remove(JOURNAL_PATH);
+}
+
+TEST_CASE("Draws on a layer of one client do not land on a layer of another with the same id", "[network]"){
+    LocalServer server(600, 400);
+    Canvas a(600, 400), b(600, 400);
+    unsigned base = a.app.GetLayers().GetActiveId();
+    b.app.GetNetwork().Connect(server.GetAddress());
+    REQUIRE(PumpUntil({&b.app}, [&]{ return Joined(b); }));
+    b.app.RunCommand(std::make_shared<LayerCommand>("layer add", LayerCommand::ADD, b.app));
+    a.app.RunCommand(std::make_shared<LayerCommand>("layer add", LayerCommand::ADD, a.app));
+    unsigned own = a.app.GetLayers().GetActiveId();
+    REQUIRE(b.app.GetLayers().GetActiveId() == own);
+
+    // Goes out before the welcome says the layer is not shared
+    a.app.GetNetwork().Connect(server.GetAddress());
+    a.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(10, 10), sf::Color::Red, a.app));
+    REQUIRE(PumpUntil({&a.app, &b.app}, [&]{ return Joined(a); }));
+    a.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(20, 20), sf::Color::Red, a.app));
+    a.app.GetLayers().SetActive(base);
+    a.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(30, 30), sf::Color::Green, a.app));
+    REQUIRE(PumpUntil({&a.app, &b.app}, [&]{
+        return b.app.GetLayers().GetPixel(base, 30, 30) == sf::Color::Green;
+    }));
+    REQUIRE(b.app.GetLayers().GetPixel(own, 10, 10) != sf::Color::Red);
+    REQUIRE(b.app.GetLayers().GetPixel(own, 20, 20) != sf::Color::Red);
+    REQUIRE(b.app.GetLayers().GetPixel(base, 10, 10) != sf::Color::Red);
+    REQUIRE(a.app.GetLayers().GetPixel(own, 20, 20) == sf::Color::Red);
+}
+
+TEST_CASE("A server opens a limited number of rooms with short names", "[network]"){
+    test::QuietOutput quiet;
+    LocalServer server(64, 64);
+    Canvas a(64, 64);
+    for (unsigned i = 0; i < MAX_ROOMS; i++){
+        a.app.GetNetwork().Connect(server.GetAddress("room" + std::to_string(i)));
+        REQUIRE(PumpUntil({&a.app}, [&]{ return Joined(a); }));
+    }
+    REQUIRE(server.server.GetRoomCount() == MAX_ROOMS);
+    a.app.GetNetwork().Connect(server.GetAddress("one too many"));
+    REQUIRE(PumpUntil({&a.app}, [&]{ return !a.app.GetNetwork().IsConnected(); }));
+    REQUIRE(server.server.GetRoomCount() == MAX_ROOMS);
+    // Rooms that are open can still be joined
+    a.app.GetNetwork().Connect(server.GetAddress("room0"));
+    REQUIRE(PumpUntil({&a.app}, [&]{ return Joined(a); }));
+    a.app.GetNetwork().Connect(server.GetAddress(std::string(MAX_ROOM_NAME + 1, 'r')));
+    REQUIRE(PumpUntil({&a.app}, [&]{ return !a.app.GetNetwork().IsConnected(); }));
+}
+
+TEST_CASE("A late joiner gets its viewport, then the canvas, and converges while others draw", "[network]"){
+    // A 4K canvas, as App_Headless --join measures it
+    const int width = 3840;
+    const int height = 2160;
+    LocalServer server(width, height);
+    Canvas a(width, height), late(width, height);
+    a.app.GetNetwork().Connect(server.GetAddress());
+    REQUIRE(PumpUntil({&a.app}, [&]{ return Joined(a); }));
+    for (int i = 0; i < 20000; i++){
+        a.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i((i * 7919) % width, (i * 31) % height),
+                                                sf::Color(i % 255, 0, 0), a.app));
+    }
+    Pump({&a.app});
+
+    late.app.GetNetwork().SetViewport(sf::IntRect(0, 0, 600, 400));
+    late.app.GetNetwork().Connect(server.GetAddress());
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    double viewportMs = -1;
+    int frame = 0;
+    REQUIRE(PumpUntil({&a.app, &late.app}, [&]{
+        // Keep drawing during the snapshot, on both sides
+        a.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(frame % width, 5), sf::Color::Green, a.app));
+        late.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(frame % 600, 7), sf::Color::Blue, late.app));
+        frame++;
+        if (viewportMs < 0 && late.app.GetNetwork().IsViewportLoaded()){
+            viewportMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+        return Joined(late);
+    }, 20000));
+    double canvasMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    // Time to interactive, reported on every run
+    WARN("Late joiner on " << width << "x" << height << ": viewport in " << viewportMs << " ms, canvas in "
+         << canvasMs << " ms");
+    // On a local socket both may come in with the same poll
+    REQUIRE(viewportMs >= 0);
+    REQUIRE(viewportMs <= canvasMs);
+    REQUIRE(PumpUntil({&a.app, &late.app}, [&]{ return CountDifferentTiles(a.app, late.app) == 0; }));
+
+    // A joiner with the same canvas already has every tile
+    Canvas cached(width, height);
+    cached.app.GetLayers().Restore(cached.app.GetLayers().GetActiveId(),
+                                   a.app.GetLayers().Snapshot(a.app.GetLayers().GetActiveId()));
+    cached.app.GetNetwork().Connect(server.GetAddress());
+    REQUIRE(PumpUntil({&a.app, &cached.app}, [&]{ return Joined(cached); }));
+    REQUIRE(CountDifferentTiles(a.app, cached.app) == 0);
+}
+
+TEST_CASE("Cursors are shown to the others at a limited rate", "[network]"){
+    LocalServer server(600, 400);
+    Canvas a(600, 400), b(600, 400);
+    a.app.GetNetwork().Connect(server.GetAddress());
+    b.app.GetNetwork().Connect(server.GetAddress());
+    REQUIRE(PumpUntil({&a.app, &b.app}, [&]{ return Joined(a) && Joined(b); }));
+    std::uint64_t before = server.server.GetStats().messages;
+    // Moves every millisecond for about 200 ms
+    for (int i = 0; i < 200; i++){
+        a.app.GetNetwork().SetCursor(sf::Vector2i(100 + i, 50), true);
+        Pump({&a.app, &b.app}, 1);
+    }
+    const std::vector<RemoteCursor> &cursors = b.app.GetNetwork().GetCursors();
+    REQUIRE(PumpUntil({&a.app, &b.app}, [&]{
+        return cursors.size() == 1 && cursors[0].position.x >= 296 && cursors[0].position.x < 300;
+    }));
+    REQUIRE(cursors[0].id == a.app.GetNetwork().GetUserId());
+    REQUIRE(cursors[0].position.y / PRESENCE_QUANTUM == 50 / PRESENCE_QUANTUM);
+    REQUIRE(server.server.GetStats().messages - before < 30);
+    REQUIRE(a.app.GetNetwork().GetCursors().empty());
+
+    a.app.GetNetwork().SetCursor(sf::Vector2i(0, 0), false);
+    REQUIRE(PumpUntil({&a.app, &b.app}, [&]{ return cursors.empty(); }));
+    a.app.GetNetwork().SetCursor(sf::Vector2i(30, 30), true);
+    REQUIRE(PumpUntil({&a.app, &b.app}, [&]{ return cursors.size() == 1; }));
+    a.app.GetNetwork().Disconnect();
+    REQUIRE(PumpUntil({&b.app}, [&]{ return cursors.empty(); }));
+}
@@ -0,0 +1,225 @@
+/**
+ *  @file   perf_test.cpp
+ *  @brief  Throughput of the hot paths, checked against a stored baseline.
+ *  @author Team Avengers
+ *  @date   2020-12-15
+ ***********************************************/
+
+// Include standard library C++ libraries.
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+// Project header files
+#include "catch.hpp"
+#include "test_helpers.hpp"
+#include "ClearCanvas.hpp"
+#include "Draw.hpp"
+#include "FilterCommand.hpp"
+#include "GUI.hpp"
+
+// Every test runs a fixed workload and fails if its throughput is more
+// than the tolerance below the baseline in tests/perf_baseline.txt.
+// FSD_PERF_TOLERANCE=0.2 overrides the tolerance of the file.
+// FSD_PERF_UPDATE=1 writes the measured throughput into the file instead,
+// run it on the reference machine after a change that is meant to be
+// slower or faster.
+
+namespace {
+
+// Runs of a workload, the fastest one counts
+const int PERF_RUNS = 3;
+
+// Seconds the fastest run of a workload took.
+double Time(const std::function<void()> &setup, const std::function<void()> &work){
+    double best = 0;
+    for (int run = 0; run < PERF_RUNS; run++){
+        setup();
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        work();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (run == 0 || seconds < best){
+            best = seconds;
+        }
+    }
+    return best;
+}
+
+// Lines of the baseline file, comments included.
+std::vector<std::string> ReadBaselineFile(){
+    std::vector<std::string> lines;
+    std::ifstream in(FSD_PERF_BASELINE);
+    std::string line;
+    while (std::getline(in, line)){
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+// Value of a "name value" line of the baseline file, 0 if there is none.
+double ReadBaseline(const std::string &name){
+    std::vector<std::string> lines = ReadBaselineFile();
+    for (std::size_t i = 0; i < lines.size(); i++){
+        std::istringstream line(lines[i]);
+        std::string key;
+        double value = 0;
+        if (line >> key >> value && key == name){
+            return value;
+        }
+    }
+    return 0;
+}
+
+void WriteBaseline(const std::string &name, double value){
+    std::vector<std::string> lines = ReadBaselineFile();
+    std::ostringstream entry;
+    entry << name << " " << static_cast<long long>(value);
+    bool found = false;
+    for (std::size_t i = 0; i < lines.size(); i++){
+        std::istringstream line(lines[i]);
+        std::string key;
+        if (line >> key && key == name){
+            lines[i] = entry.str();
+            found = true;
+        }
+    }
+    if (!found){
+        lines.push_back(entry.str());
+    }
+    std::ofstream out(FSD_PERF_BASELINE, std::ios::trunc);
+    for (std::size_t i = 0; i < lines.size(); i++){
+        out << lines[i] << "\n";
+    }
+}
+
+// Compare a throughput, in units per second, with its baseline.
+void CheckThroughput(const std::string &name, double measured, const char* unit){
+    const char* update = std::getenv("FSD_PERF_UPDATE");
+    if (update && std::string(update) == "1"){
+        WriteBaseline(name, measured);
+        WARN(name << ": baseline set to " << measured << " " << unit);
+        return;
+    }
+    double baseline = ReadBaseline(name);
+    double tolerance = ReadBaseline("tolerance");
+    const char* overridden = std::getenv("FSD_PERF_TOLERANCE");
+    if (overridden){
+        tolerance = std::atof(overridden);
+    }
+    if (baseline <= 0){
+        WARN(name << ": no baseline, measured " << measured << " " << unit);
+        return;
+    }
+    INFO(name << ": " << measured << " " << unit << ", baseline " << baseline << ", tolerance " << tolerance);
+    CHECK(measured >= baseline * (1 - tolerance));
+}
+
+}
+
+TEST_CASE("Strokes of 10000 stamps", "[perf]"){
+    const int STROKES = 10;
+    const int STAMPS = 10000;
+    std::unique_ptr<test::Canvas> canvas;
+    test::QuietOutput quiet;
+    double seconds = Time([&]{
+        canvas.reset(new test::Canvas(1920, 1080));
+    }, [&]{
+        App &app = canvas->app;
+        for (int s = 0; s < STROKES; s++){
+            for (int i = 0; i < STAMPS; i++){
+                // A wavy line across the canvas, as the mouse would draw it
+                sf::Vector2i at(100 + i / 6, 80 * s + (i % 400 < 200 ? i % 200 : 200 - i % 200));
+                app.AddCommand(std::make_shared<Draw>("draw", at, sf::Color(i % 256, 40, 200), app));
+                app.ExecuteCommand();
+                if (i % 16 == 15){
+                    app.GetLayers().Flatten();
+                }
+            }
+        }
+        app.GetLayers().Flatten();
+    });
+    CheckThroughput("stroke_10k", STROKES * STAMPS / seconds, "stamps/s");
+}
+
+TEST_CASE("Filters on a 4K canvas", "[perf]"){
+    std::unique_ptr<test::Canvas> canvas;
+    test::QuietOutput quiet;
+    double seconds = Time([&]{
+        canvas.reset(new test::Canvas(3840, 2160));
+        App &app = canvas->app;
+        app.RunCommand(std::make_shared<ClearCanvas>("clear", sf::Color(180, 120, 60), sf::Color::White, app));
+        for (int i = 0; i < 2000; i++){
+            app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i((i * 7919) % 3840, (i * 104729) % 2160),
+                                                  sf::Color::Blue, app));
+        }
+        app.GetLayers().Flatten();
+    }, [&]{
+        App &app = canvas->app;
+        const FilterType filters[] = {FILTER_GRAYSCALE, FILTER_SEPIA, FILTER_SHARPEN, FILTER_BLUR};
+        for (int f = 0; f < 4; f++){
+            app.RunCommand(std::make_shared<FilterCommand>(GetFilterName(filters[f]), filters[f], app));
+        }
+        app.GetLayers().Flatten();
+    });
+    CheckThroughput("filter_4k", 4 * 3840.0 * 2160.0 / 1e6 / seconds, "Mpixel/s");
+}
+
+TEST_CASE("Storm of 1000 undo and redo steps", "[perf]"){
+    const int ROUNDS = 50;
+    std::unique_ptr<test::Canvas> canvas;
+    test::QuietOutput quiet;
+    double seconds = Time([&]{
+        canvas.reset(new test::Canvas(1920, 1080));
+        App &app = canvas->app;
+        // Ten commands of every kind, as deep as the undo stack goes
+        for (int i = 0; i < 10; i++){
+            app.GetSelection().SelectRect(sf::IntRect(150 * i, 80 * i, 300, 200));
+            if (i % 3 == 0){
+                app.RunCommand(std::make_shared<ClearCanvas>("clear", sf::Color(i * 20, 0, 0), sf::Color::White, app));
+            } else if (i % 3 == 1){
+                app.RunCommand(std::make_shared<FilterCommand>("Sepia", FILTER_SEPIA, app));
+            } else{
+                app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i(150 * i + 5, 80 * i + 5), sf::Color::Green, app));
+            }
+        }
+        app.GetLayers().Flatten();
+    }, [&]{
+        App &app = canvas->app;
+        for (int round = 0; round < ROUNDS; round++){
+            for (int i = 0; i < 10; i++){
+                app.Undo();
+                app.GetLayers().Flatten();
+            }
+            for (int i = 0; i < 10; i++){
+                app.Redo();
+                app.GetLayers().Flatten();
+            }
+        }
+    });
+    CheckThroughput("undo_storm", ROUNDS * 20 / seconds, "steps/s");
+}
+
+TEST_CASE("Toolbar frames drawn into memory", "[perf]"){
+    const int FRAMES = 200;
+    std::unique_ptr<test::Canvas> canvas;
+    std::unique_ptr<GUI> gui;
+    test::QuietOutput quiet;
+    // Input, layout and the software renderer of the whole toolbar
+    double seconds = Time([&]{
+        gui.reset();
+        canvas.reset(new test::Canvas);
+        gui.reset(new GUI(&canvas->app, 250, 800));
+        gui->loop();
+    }, [&]{
+        for (int i = 0; i < FRAMES; i++){
+            gui->loop();
+            canvas->app.EndFrame();
+        }
+    });
+    gui.reset();
+    CheckThroughput("gui_frame", FRAMES / seconds, "frames/s");
+}
@@ -0,0 +1,148 @@
+/**
+ *  @file   selection_test.cpp
+ *  @brief  Tests of the selection rasterizers.
+ *  @author Team Avengers
+ *  @date   2020-12-15
+ ***********************************************/
+
+// Include standard library C++ libraries.
+#include <climits>
+#include <cstdint>
+#include <vector>
+// Project header files
+#include "catch.hpp"
+#include "SelectionMask.hpp"
+
+TEST_CASE("Nothing selected means everything is selected", "[selection]"){
+    SelectionMask mask(300, 200);
+    REQUIRE_FALSE(mask.IsActive());
+    REQUIRE(mask.GetCoverage(0, 0) == 255);
+    REQUIRE(mask.GetCoverage(299, 199) == 255);
+    REQUIRE(mask.GetSelectedTiles().size() == TiledImage(300, 200).GetTileCount());
+}
+
+TEST_CASE("A rectangle covers exactly its pixels", "[selection]"){
+    SelectionMask mask(300, 200);
+    mask.SelectRect(sf::IntRect(70, 10, 100, 60));
+    REQUIRE(mask.IsActive());
+    REQUIRE(mask.GetBounds() == sf::IntRect(70, 10, 100, 60));
+    for (unsigned y = 0; y < 200; y += 3){
+        for (unsigned x = 0; x < 300; x += 3){
+            bool inside = x >= 70 && x < 170 && y >= 10 && y < 70;
+            REQUIRE(mask.GetCoverage(x, y) == (inside ? 255 : 0));
+        }
+    }
+    // Tiles it only touches are partial, the ones outside are not listed
+    REQUIRE(mask.GetTileState(0) == SelectionMask::TILE_EMPTY);
+    REQUIRE(mask.GetTileState(1) == SelectionMask::TILE_PARTIAL);
+    for (std::size_t i = 0; i < mask.GetSelectedTiles().size(); i++){
+        REQUIRE(mask.GetTileState(mask.GetSelectedTiles()[i]) != SelectionMask::TILE_EMPTY);
+    }
+}
+
+TEST_CASE("A rectangle dragged backwards selects the same pixels", "[selection]"){
+    SelectionMask forward(300, 200);
+    SelectionMask backward(300, 200);
+    forward.SelectRect(sf::IntRect(20, 30, 50, 40));
+    backward.SelectRect(sf::IntRect(70, 70, -50, -40));
+    REQUIRE(backward.GetBounds() == forward.GetBounds());
+    for (unsigned y = 0; y < 200; y += 2){
+        for (unsigned x = 0; x < 300; x += 2){
+            REQUIRE(forward.GetCoverage(x, y) == backward.GetCoverage(x, y));
+        }
+    }
+}
+
+TEST_CASE("An ellipse covers its center and not the corners of its bounds", "[selection]"){
+    SelectionMask mask(300, 200);
+    mask.SelectEllipse(sf::IntRect(50, 50, 128, 96));
+    REQUIRE(mask.GetCoverage(114, 98) == 255);
+    REQUIRE(mask.GetCoverage(51, 51) == 0);
+    REQUIRE(mask.GetCoverage(176, 144) == 0);
+    REQUIRE(mask.GetCoverage(40, 98) == 0);
+    // Pixels count if their center is inside, so the shape is symmetric
+    for (unsigned y = 50; y < 146; y++){
+        for (unsigned x = 50; x < 178; x++){
+            REQUIRE(mask.GetCoverage(x, y) == mask.GetCoverage(227 - x, y));
+            REQUIRE(mask.GetCoverage(x, y) == mask.GetCoverage(x, 195 - y));
+        }
+    }
+}
+
+TEST_CASE("A lasso covers the inside of its polygon", "[selection]"){
+    SelectionMask mask(300, 200);
+    std::vector<sf::Vector2i> points;
+    points.push_back(sf::Vector2i(10, 10));
+    points.push_back(sf::Vector2i(190, 10));
+    points.push_back(sf::Vector2i(10, 190));
+    mask.SelectLasso(points);
+    REQUIRE(mask.GetCoverage(30, 30) == 255);
+    REQUIRE(mask.GetCoverage(150, 150) == 0);
+    REQUIRE(mask.GetCoverage(5, 5) == 0);
+}
+
+TEST_CASE("A selection comes back the same from its serialized form", "[selection]"){
+    SelectionMask mask(300, 200);
+    mask.SelectEllipse(sf::IntRect(20, 20, 100, 70));
+    ByteWriter out;
+    mask.Serialize(out);
+    SelectionMask read(300, 200);
+    ByteReader in(out.GetData(), out.GetSize());
+    REQUIRE(read.Deserialize(in));
+    for (unsigned y = 0; y < 200; y++){
+        for (unsigned x = 0; x < 300; x++){
+            REQUIRE(read.GetCoverage(x, y) == mask.GetCoverage(x, y));
+        }
+    }
+}
+
+TEST_CASE("Shapes reaching far off the canvas only select what is on it", "[selection]"){
+    SelectionMask mask(300, 200);
+    mask.SelectRect(sf::IntRect(INT_MIN, INT_MIN, INT_MAX, INT_MAX));
+    REQUIRE(mask.GetSelectedTiles().empty());
+    mask.SelectRect(sf::IntRect(INT_MAX, INT_MAX, INT_MIN, INT_MIN));
+    REQUIRE(mask.GetBounds() == sf::IntRect(0, 0, 300, 200));
+    mask.SelectRect(sf::IntRect(-10, 50, INT_MAX, 10));
+    REQUIRE(mask.GetBounds() == sf::IntRect(0, 50, 300, 10));
+    // Centered on the canvas, far bigger than it
+    mask.SelectEllipse(sf::IntRect(150 - 1000000000, 100 - 1000000000, 2000000000, 2000000000));
+    REQUIRE(mask.GetBounds() == sf::IntRect(0, 0, 300, 200));
+    mask.SelectEllipse(sf::IntRect(INT_MIN, INT_MIN, INT_MIN, INT_MIN));
+    REQUIRE(mask.GetSelectedTiles().empty());
+}
+
+TEST_CASE("A serialized shape out of range is refused", "[selection]"){
+    // Shape tags as Serialize() writes them
+    const std::uint8_t rect = 1;
+    const std::uint8_t lasso = 3;
+    const std::int64_t refused[] = {INT_MIN, static_cast<std::int64_t>(INT_MAX) + 1, INT64_MIN};
+    for (std::size_t i = 0; i < sizeof(refused) / sizeof(refused[0]); i++){
+        ByteWriter out;
+        out.PutU8(rect);
+        out.PutSigned(0);
+        out.PutSigned(0);
+        out.PutSigned(refused[i]);
+        out.PutSigned(10);
+        SelectionMask mask(300, 200);
+        ByteReader in(out.GetData(), out.GetSize());
+        REQUIRE_FALSE(mask.Deserialize(in));
+        REQUIRE_FALSE(mask.IsActive());
+    }
+    // Steps that add up past the range of a coordinate
+    ByteWriter steps;
+    steps.PutU8(lasso);
+    steps.PutVarint(3);
+    for (int i = 0; i < 3; i++){
+        steps.PutSigned(INT_MAX);
+        steps.PutSigned(0);
+    }
+    SelectionMask mask(300, 200);
+    ByteReader in(steps.GetData(), steps.GetSize());
+    REQUIRE_FALSE(mask.Deserialize(in));
+    // More points than the data could hold
+    ByteWriter count;
+    count.PutU8(lasso);
+    count.PutVarint(UINT64_MAX);
+    ByteReader short_in(count.GetData(), count.GetSize());
+    REQUIRE_FALSE(mask.Deserialize(short_in));
+}
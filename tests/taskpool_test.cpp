@@ -0,0 +1,126 @@
+/**
+ *  @file   taskpool_test.cpp
+ *  @brief  Tests of the work-stealing task pool.
+ *  @author Team Avengers
+ *  @date   2020-12-16
+ ***********************************************/
+
+// Include standard library C++ libraries.
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+// Project header files
+#include "catch.hpp"
+#include "test_helpers.hpp"
+#include "Draw.hpp"
+#include "FilterCommand.hpp"
+#include "TaskPool.hpp"
+
+TEST_CASE("Every task of a group runs once, also tasks queued by tasks", "[tasks]"){
+    const unsigned threads[] = {0, 1, 4};
+    for (std::size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++){
+        TaskPool pool;
+        pool.Start(threads[t]);
+        REQUIRE(pool.GetThreadCount() == threads[t]);
+        std::vector<std::atomic<int>> runs(1000);
+        for (std::size_t i = 0; i < runs.size(); i++){
+            runs[i] = 0;
+        }
+        TaskGroup group;
+        for (std::size_t i = 0; i < runs.size(); i += 10){
+            pool.Submit(group, [&pool, &group, &runs, i]{
+                for (std::size_t k = i; k < i + 10; k++){
+                    pool.Submit(group, [&runs, k]{ runs[k]++; });
+                }
+            });
+        }
+        pool.Wait(group);
+        REQUIRE(group.IsDone());
+        for (std::size_t i = 0; i < runs.size(); i++){
+            REQUIRE(runs[i] == 1);
+        }
+    }
+}
+
+TEST_CASE("Frame tasks do not wait behind long background tasks", "[tasks]"){
+    TaskPool pool;
+    pool.Start(2);
+    std::atomic<bool> release(false);
+    TaskGroup background(TASK_BACKGROUND);
+    for (int i = 0; i < 4; i++){
+        pool.Submit(background, [&release]{
+            while (!release){
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::atomic<int> done(0);
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    {
+        TaskGroup frame;
+        for (int i = 0; i < 100; i++){
+            pool.Submit(frame, [&done]{ done++; });
+        }
+        pool.Wait(frame);
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    REQUIRE(done == 100);
+    REQUIRE(ms < 1000);
+    REQUIRE_FALSE(background.IsDone());
+    release = true;
+    pool.Wait(background);
+}
+
+TEST_CASE("Tasks that miss the deadline of their group are skipped", "[tasks]"){
+    TaskPool pool;
+    pool.Start(1);
+    std::atomic<int> ran(0);
+    TaskGroup group(TASK_FRAME, TaskClock::now() + std::chrono::milliseconds(30));
+    for (int i = 0; i < 20; i++){
+        pool.Submit(group, [&ran]{
+            ran++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        });
+    }
+    pool.Wait(group);
+    REQUIRE(ran > 0);
+    REQUIRE(ran < 20);
+    REQUIRE(group.GetSkipped() == static_cast<unsigned>(20 - ran));
+}
+
+TEST_CASE("A composite cut off by its deadline is finished by the next one", "[tasks]"){
+    test::Canvas canvas(1920, 1080);
+    LayerStack &layers = canvas.app.GetLayers();
+    layers.Flatten();
+    layers.Fill(layers.GetActiveId(), sf::Color(0, 0, 255, 255));
+    std::vector<unsigned> updated;
+    layers.Flatten(&updated, &canvas.app.GetTasks(), TaskClock::now());
+    REQUIRE(updated.size() < layers.GetFlattened().GetTileCount());
+    layers.Flatten(&updated, &canvas.app.GetTasks());
+    REQUIRE(updated.size() == layers.GetFlattened().GetTileCount());
+    REQUIRE(layers.GetFlattened().GetPixel(1900, 1000) == sf::Color(0, 0, 255, 255));
+}
+
+TEST_CASE("Filtering on the pool gives the same tiles as on one thread", "[tasks]"){
+    test::Canvas canvas(1024, 512);
+    for (int i = 0; i < 3000; i++){
+        canvas.app.RunCommand(std::make_shared<Draw>("draw", sf::Vector2i((i * 7919) % 1024, (i * 31) % 512),
+                                                     sf::Color(i % 256, 80, 160), canvas.app));
+    }
+    const TiledImage &pixels = canvas.app.GetLayers().GetLayer(0)->GetPixels();
+    SelectionMask selection(1024, 512);
+    selection.SelectEllipse(sf::IntRect(100, 50, 800, 400));
+    std::vector<std::pair<unsigned, TilePtr>> serial;
+    std::vector<std::pair<unsigned, TilePtr>> parallel;
+    FilterCommand::FilterSelection(FILTER_BLUR, pixels, selection, serial);
+    FilterCommand::FilterSelection(FILTER_BLUR, pixels, selection, parallel, &canvas.app.GetTasks());
+    REQUIRE(serial.size() == parallel.size());
+    for (std::size_t i = 0; i < serial.size(); i++){
+        REQUIRE(serial[i].first == parallel[i].first);
+        REQUIRE(std::memcmp(serial[i].second.get(), parallel[i].second.get(), TILE_BYTES) == 0);
+    }
+}
@@ -0,0 +1,115 @@
+/**
+ *  @file   test_helpers.hpp
+ *  @brief  Canvases and servers shared by the tests.
+ *  @author Team Avengers
+ *  @date   2020-12-15
+ ***********************************************/
+#ifndef TEST_HELPERS_HPP
+#define TEST_HELPERS_HPP
+
+// Include our Third-Party SFML header
+#include <SFML/Graphics/Color.hpp>
+// Include standard library C++ libraries.
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+// Project header files
+#include "App.hpp"
+#include "Server.hpp"
+
+namespace test {
+
+// A headless app that is torn down at the end of the test.
+class Canvas{
+public:
+    Canvas(int width = 256, int height = 256){
+        app.InitHeadless(width, height);
+    }
+    ~Canvas(){
+        app.Destroy();
+    }
+
+    sf::Color Pixel(unsigned x, unsigned y){
+        return app.GetLayers().GetPixel(app.GetLayers().GetActiveId(), x, y);
+    }
+
+    App app;
+};
+
+// Number of tiles that differ between the composited images of two apps.
+inline unsigned CountDifferentTiles(App &a, App &b){
+    const TiledImage &fa = a.GetLayers().Flatten();
+    const TiledImage &fb = b.GetLayers().Flatten();
+    unsigned differ = 0;
+    for (unsigned t = 0; t < fa.GetTileCount(); t++){
+        const sf::Uint8* p = fa.GetTile(t);
+        const sf::Uint8* q = fb.GetTile(t);
+        if (!p != !q || (p && std::memcmp(p, q, TILE_BYTES) != 0)){
+            differ++;
+        }
+    }
+    return differ;
+}
+
+// A server on a free port, running until the end of the test.
+class LocalServer{
+public:
+    LocalServer(unsigned width, unsigned height): server(width, height, 2){
+        server.Listen(0);
+        thread = std::thread(&Server::Run, &server);
+    }
+    ~LocalServer(){
+        server.Stop();
+        thread.join();
+    }
+
+    std::string GetAddress(const std::string &room = "test") const{
+        return "localhost:" + std::to_string(server.GetPort()) + "/" + room;
+    }
+
+    Server server;
+    std::thread thread;
+};
+
+// Poll the network of every app until 'done' is true or 'ms' passed.
+inline bool PumpUntil(const std::vector<App*> &apps, const std::function<bool()> &done, int ms = 5000){
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::milliseconds(ms);
+    while (std::chrono::steady_clock::now() < end){
+        for (std::size_t i = 0; i < apps.size(); i++){
+            apps[i]->GetNetwork().Poll(*apps[i]);
+        }
+        if (done()){
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+// Poll the network of every app for a while, so what is in flight arrives.
+inline void Pump(const std::vector<App*> &apps, int ms = 100){
+    PumpUntil(apps, []{ return false; }, ms);
+}
+
+// Keeps std::cout quiet while it lives, the app prints every undo.
+class QuietOutput{
+public:
+    QuietOutput(): m_old(std::cout.rdbuf(m_sink.rdbuf())){
+    }
+    ~QuietOutput(){
+        std::cout.rdbuf(m_old);
+    }
+
+private:
+    std::ostringstream m_sink;
+    std::streambuf* m_old;
+};
+
+}
+
+
+#endif
@@ -0,0 +1,120 @@
+/**
+ *  @file   texturestream_test.cpp
+ *  @brief  Tests of the tile uploads through pixel buffers.
+ *  @author Team Avengers
+ *  @date   2020-12-17
+ ***********************************************/
+
+// Include our Third-Party SFML header
+#include <SFML/Graphics/Image.hpp>
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Window/Context.hpp>
+// Include standard library C++ libraries.
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+// Project header files
+#include "catch.hpp"
+#include "TaskPool.hpp"
+#include "TextureStreamer.hpp"
+#include "TiledImage.hpp"
+
+namespace {
+
+// SFML needs a display for a context. Without a GPU, Mesa's software GL
+// under Xvfb is enough.
+bool HasDisplay(){
+    return std::getenv("DISPLAY") != nullptr;
+}
+
+// Every tile with its own pattern, and every seventh one transparent
+TiledImage MakeImage(unsigned width, unsigned height, unsigned seed){
+    TiledImage image(width, height);
+    for (unsigned tile = 0; tile < image.GetTileCount(); tile++){
+        if ((tile + seed) % 7 == 0){
+            image.SetTilePtr(tile, TilePtr());
+            continue;
+        }
+        sf::Uint8* pixels = image.GetMutableTile(tile);
+        for (unsigned i = 0; i < TILE_BYTES; i++){
+            pixels[i] = static_cast<sf::Uint8>(i * 13 + tile * 7 + seed);
+        }
+    }
+    return image;
+}
+
+bool Matches(const sf::Texture &texture, const TiledImage &image){
+    sf::Image copy = texture.copyToImage();
+    const sf::Uint8* pixels = copy.getPixelsPtr();
+    unsigned width = copy.getSize().x;
+    static const std::vector<sf::Uint8> transparent(TILE_BYTES, 0);
+    for (unsigned tile = 0; tile < image.GetTileCount(); tile++){
+        const sf::Uint8* expected = image.GetTile(tile) ? image.GetTile(tile) : &transparent[0];
+        unsigned x = (tile % image.GetTilesX()) * TILE_SIZE;
+        unsigned y = (tile / image.GetTilesX()) * TILE_SIZE;
+        for (unsigned row = 0; row < TILE_SIZE; row++){
+            const sf::Uint8* actual = pixels + ((y + row) * width + x) * 4;
+            if (std::memcmp(actual, expected + row * TILE_SIZE * 4, TILE_SIZE * 4) != 0){
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Uploads every tile of a few images, more tiles than the ring holds,
+// and then only some of them
+void CheckUploads(TextureStreamer &streamer){
+    sf::Texture texture;
+    REQUIRE(texture.create(1024, 1024));
+    std::vector<unsigned> tiles;
+    for (unsigned seed = 0; seed < 3; seed++){
+        TiledImage image = MakeImage(1024, 1024, seed);
+        tiles.clear();
+        for (unsigned tile = 0; tile < image.GetTileCount(); tile++){
+            tiles.push_back(tile);
+        }
+        streamer.Upload(texture, image, tiles);
+        REQUIRE(Matches(texture, image));
+    }
+    TiledImage image = MakeImage(1024, 1024, 2);
+    TiledImage changed = MakeImage(1024, 1024, 5);
+    tiles.clear();
+    for (unsigned tile = 0; tile < image.GetTileCount(); tile += 3){
+        image.SetTilePtr(tile, changed.GetTilePtr(tile));
+        tiles.push_back(tile);
+    }
+    streamer.Upload(texture, image, tiles);
+    REQUIRE(Matches(texture, image));
+}
+
+}
+
+TEST_CASE("Tiles streamed through pixel buffers reach the texture", "[texture]"){
+    if (!HasDisplay()){
+        WARN("No display, uploads to a texture are not tested");
+        return;
+    }
+    sf::Context context;
+    TaskPool tasks;
+    tasks.Start(2);
+    TextureStreamer streamer(tasks);
+    if (!streamer.Init()){
+        WARN("The GL has no persistently mapped buffers, only sf::Texture::update is tested");
+    }
+    CheckUploads(streamer);
+    streamer.Release();
+    REQUIRE_FALSE(streamer.IsStreaming());
+}
+
+TEST_CASE("Tiles reach the texture without pixel buffers", "[texture]"){
+    if (!HasDisplay()){
+        WARN("No display, uploads to a texture are not tested");
+        return;
+    }
+    sf::Context context;
+    TaskPool tasks;
+    TextureStreamer streamer(tasks);
+    REQUIRE_FALSE(streamer.IsStreaming());
+    CheckUploads(streamer);
+}